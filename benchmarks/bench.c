@@ -0,0 +1,395 @@
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include <time.h>
+
+#include "exyz.h"
+
+/// Micro-benchmarks for the comment line parser, timing each production of
+/// the grammar separately. Each benchmark synthesizes comment lines containing
+/// `keys` values of a single kind (`k0=<value> k1=<value> ...`), parses them
+/// repeatedly with `exyz_read_comment_line`, and prints one JSON object per
+/// line with the best time over all repetitions.
+
+typedef struct buffer_t {
+    char* data;
+    size_t size;
+    size_t capacity;
+} buffer_t;
+
+static void buffer_printf(buffer_t* buffer, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    int size = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+    assert(size >= 0);
+
+    size_t needed = buffer->size + (size_t)size + 1;
+    if (needed > buffer->capacity) {
+        size_t capacity = 2 * buffer->capacity;
+        if (capacity < needed) {
+            capacity = needed;
+        }
+
+        buffer->data = realloc(buffer->data, capacity);
+        if (buffer->data == NULL) {
+            fprintf(stderr, "failed to allocate memory\n");
+            exit(EXIT_FAILURE);
+        }
+        buffer->capacity = capacity;
+    }
+
+    va_start(args, format);
+    vsnprintf(buffer->data + buffer->size, (size_t)size + 1, format, args);
+    va_end(args);
+    buffer->size += (size_t)size;
+}
+
+/******************************************************************************/
+/*                           Input generation                                 */
+/******************************************************************************/
+
+/// xorshift64* generator, to make the inputs reproducible
+static uint64_t random_u64(uint64_t* state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * UINT64_C(2685821657736338717);
+}
+
+static double random_real(uint64_t* state) {
+    double value = (double)(random_u64(state) >> 11) / 9007199254740992.0;
+    return 200.0 * value - 100.0;
+}
+
+typedef void (*generate_fn)(buffer_t* buffer, uint64_t* state, size_t width);
+
+static void generate_integer(buffer_t* buffer, uint64_t* state, size_t width) {
+    int64_t value = (int64_t)(random_u64(state) % 2000000000) - 1000000000;
+    buffer_printf(buffer, "%" PRId64, value);
+}
+
+static void generate_real(buffer_t* buffer, uint64_t* state, size_t width) {
+    buffer_printf(buffer, "%.8f", random_real(state));
+}
+
+static void generate_real_e(buffer_t* buffer, uint64_t* state, size_t width) {
+    double value = random_real(state);
+    if (value < 0) {
+        value = -value;
+    }
+    buffer_printf(buffer, "%.8fe%d", value, (int)(random_u64(state) % 30));
+}
+
+static void generate_real_d(buffer_t* buffer, uint64_t* state, size_t width) {
+    double value = random_real(state);
+    if (value < 0) {
+        value = -value;
+    }
+    buffer_printf(buffer, "%.8fd%d", value, (int)(random_u64(state) % 30));
+}
+
+static void generate_boolean(buffer_t* buffer, uint64_t* state, size_t width) {
+    static const char* BOOLEANS[] = {"T", "F", "true", "false", "True", "False", "TRUE", "FALSE"};
+    buffer_printf(buffer, "%s", BOOLEANS[random_u64(state) % 8]);
+}
+
+static void generate_bare_string(buffer_t* buffer, uint64_t* state, size_t width) {
+    buffer_printf(buffer, "bare_%" PRIx64, random_u64(state) % 0xffffff);
+}
+
+static void generate_quoted_string(buffer_t* buffer, uint64_t* state, size_t width) {
+    buffer_printf(buffer, "\"quoted string %" PRIx64 "\"", random_u64(state) % 0xffffff);
+}
+
+static void generate_old_array(buffer_t* buffer, uint64_t* state, size_t width, char open, char close) {
+    buffer_printf(buffer, "%c", open);
+    for (size_t i=0; i<width; i++) {
+        buffer_printf(buffer, i == 0 ? "%.8f" : " %.8f", random_real(state));
+    }
+    buffer_printf(buffer, "%c", close);
+}
+
+static void generate_old_array_quotes(buffer_t* buffer, uint64_t* state, size_t width) {
+    generate_old_array(buffer, state, width, '"', '"');
+}
+
+static void generate_old_array_braces(buffer_t* buffer, uint64_t* state, size_t width) {
+    generate_old_array(buffer, state, width, '{', '}');
+}
+
+static void generate_new_array_1d(buffer_t* buffer, uint64_t* state, size_t width) {
+    buffer_printf(buffer, "[");
+    for (size_t i=0; i<width; i++) {
+        buffer_printf(buffer, i == 0 ? "%.8f" : ", %.8f", random_real(state));
+    }
+    buffer_printf(buffer, "]");
+}
+
+/// 2D arrays use 3 columns, and `width / 3` rows
+static void generate_new_array_2d(buffer_t* buffer, uint64_t* state, size_t width) {
+    buffer_printf(buffer, "[");
+    for (size_t row=0; row<width / 3; row++) {
+        buffer_printf(buffer, row == 0 ? "[" : ", [");
+        for (size_t column=0; column<3; column++) {
+            buffer_printf(buffer, column == 0 ? "%.8f" : ", %.8f", random_real(state));
+        }
+        buffer_printf(buffer, "]");
+    }
+    buffer_printf(buffer, "]");
+}
+
+typedef struct production_t {
+    const char* name;
+    generate_fn generate;
+    /// type of the values the parser should produce for this production
+    exyz_data_t type;
+    /// does each value contain `width` items?
+    bool is_array;
+} production_t;
+
+static const production_t PRODUCTIONS[] = {
+    {"integer", generate_integer, EXYZ_INTEGER, false},
+    {"real", generate_real, EXYZ_REAL, false},
+    {"real_e", generate_real_e, EXYZ_REAL, false},
+    {"real_d", generate_real_d, EXYZ_REAL, false},
+    {"boolean", generate_boolean, EXYZ_BOOL, false},
+    {"bare_string", generate_bare_string, EXYZ_STRING, false},
+    {"quoted_string", generate_quoted_string, EXYZ_STRING, false},
+    {"old_array_quotes", generate_old_array_quotes, EXYZ_ARRAY, true},
+    {"old_array_braces", generate_old_array_braces, EXYZ_ARRAY, true},
+    {"new_array_1d", generate_new_array_1d, EXYZ_ARRAY, true},
+    {"new_array_2d", generate_new_array_2d, EXYZ_ARRAY, true},
+};
+
+#define PRODUCTIONS_COUNT (sizeof(PRODUCTIONS) / sizeof(PRODUCTIONS[0]))
+
+/******************************************************************************/
+/*                                Timing                                      */
+/******************************************************************************/
+
+typedef struct options_t {
+    size_t values;
+    size_t keys;
+    size_t width;
+    size_t repeat;
+    uint64_t seed;
+} options_t;
+
+static double now_ns(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return 1e9 * (double)time.tv_sec + (double)time.tv_nsec;
+}
+
+static size_t values_in_item(const production_t* production, size_t width) {
+    if (!production->is_array) {
+        return 1;
+    } else if (production->generate == generate_new_array_2d) {
+        return 3 * (width / 3);
+    } else {
+        return width;
+    }
+}
+
+/// parse a single line, returning false if it failed or did not produce
+/// values of the expected type
+static bool parse_line(const production_t* production, const char* line, size_t length, size_t keys) {
+    exyz_atom_property_t* properties = NULL;
+    size_t properties_count = 0;
+    exyz_info_t* info = NULL;
+    size_t info_count = 0;
+
+    exyz_status_t status = exyz_read_comment_line(
+        line, length, &properties, &properties_count, &info, &info_count
+    );
+    if (status != EXYZ_SUCCESS) {
+        return false;
+    }
+
+    bool valid = info_count == keys;
+    for (size_t i=0; i<info_count; i++) {
+        valid = valid && info[i].type == production->type;
+        exyz_info_free(info[i]);
+    }
+    exyz_free(info);
+
+    for (size_t i=0; i<properties_count; i++) {
+        exyz_atom_property_free(properties[i]);
+    }
+    exyz_free(properties);
+
+    return valid;
+}
+
+static int run(const production_t* production, const options_t* options) {
+    size_t per_item = values_in_item(production, options->width);
+    size_t per_line = per_item * options->keys;
+    size_t lines_count = (options->values + per_line - 1) / per_line;
+
+    uint64_t state = options->seed;
+    buffer_t buffer = {NULL, 0, 0};
+    size_t* offsets = malloc((lines_count + 1) * sizeof(size_t));
+    if (offsets == NULL) {
+        fprintf(stderr, "failed to allocate memory\n");
+        return EXIT_FAILURE;
+    }
+
+    // lines are stored one after the other, separated by NULL characters
+    for (size_t line=0; line<lines_count; line++) {
+        offsets[line] = buffer.size;
+        for (size_t key=0; key<options->keys; key++) {
+            buffer_printf(&buffer, key == 0 ? "k%zu=" : " k%zu=", key);
+            production->generate(&buffer, &state, options->width);
+        }
+        buffer_printf(&buffer, "%c", '\0');
+    }
+    offsets[lines_count] = buffer.size;
+
+    // this also warms up the caches and the allocator
+    for (size_t line=0; line<lines_count; line++) {
+        const char* data = buffer.data + offsets[line];
+        size_t length = offsets[line + 1] - offsets[line] - 1;
+        if (!parse_line(production, data, length, options->keys)) {
+            fprintf(stderr, "%s: failed to parse '%.60s...'\n", production->name, data);
+            free(offsets);
+            free(buffer.data);
+            return EXIT_FAILURE;
+        }
+    }
+
+    double best = -1;
+    for (size_t repeat=0; repeat<options->repeat; repeat++) {
+        double start = now_ns();
+        for (size_t line=0; line<lines_count; line++) {
+            const char* data = buffer.data + offsets[line];
+            size_t length = offsets[line + 1] - offsets[line] - 1;
+            parse_line(production, data, length, options->keys);
+        }
+        double elapsed = now_ns() - start;
+        if (best < 0 || elapsed < best) {
+            best = elapsed;
+        }
+    }
+
+    size_t values = lines_count * per_line;
+    size_t bytes = buffer.size - lines_count;
+    printf(
+        "{\"production\": \"%s\", \"values\": %zu, \"bytes\": %zu, \"lines\": %zu, "
+        "\"ns_per_value\": %.3f, \"mb_per_s\": %.3f}\n",
+        production->name, values, bytes, lines_count,
+        best / (double)values, 1e3 * (double)bytes / best
+    );
+    fflush(stdout);
+
+    free(offsets);
+    free(buffer.data);
+    return EXIT_SUCCESS;
+}
+
+/******************************************************************************/
+/*                           Command line parsing                             */
+/******************************************************************************/
+
+static void usage(const char* name) {
+    fprintf(stderr, "usage: %s [options] [production...]\n\n", name);
+    fprintf(stderr, "Time the parsing of each production of the comment line grammar, and\n");
+    fprintf(stderr, "print the results as one JSON object per line.\n\n");
+    fprintf(stderr, "options:\n");
+    fprintf(stderr, "    --values N   total number of values to parse per production [1000000]\n");
+    fprintf(stderr, "    --keys N     number of key=value pairs in each comment line [64]\n");
+    fprintf(stderr, "    --width N    number of items in array values [9]\n");
+    fprintf(stderr, "    --repeat N   number of timed repetitions, the best one is reported [5]\n");
+    fprintf(stderr, "    --seed N     seed for the random inputs [42]\n");
+    fprintf(stderr, "    --list       list the available productions\n\n");
+    fprintf(stderr, "productions default to all of them\n");
+}
+
+static bool parse_size(const char* value, size_t* output) {
+    char* end = NULL;
+    unsigned long long parsed = strtoull(value, &end, 10);
+    if (value[0] == '\0' || value[0] == '-' || *end != '\0' || parsed == 0) {
+        return false;
+    }
+    *output = (size_t)parsed;
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    options_t options = {1000000, 64, 9, 5, 42};
+    bool selected[PRODUCTIONS_COUNT] = {false};
+    bool any_selected = false;
+
+    for (int i=1; i<argc; i++) {
+        const char* arg = argv[i];
+        size_t* option = NULL;
+        size_t seed = 0;
+        if (strcmp(arg, "--values") == 0) {
+            option = &options.values;
+        } else if (strcmp(arg, "--keys") == 0) {
+            option = &options.keys;
+        } else if (strcmp(arg, "--width") == 0) {
+            option = &options.width;
+        } else if (strcmp(arg, "--repeat") == 0) {
+            option = &options.repeat;
+        } else if (strcmp(arg, "--seed") == 0) {
+            option = &seed;
+        } else if (strcmp(arg, "--list") == 0) {
+            for (size_t p=0; p<PRODUCTIONS_COUNT; p++) {
+                printf("%s\n", PRODUCTIONS[p].name);
+            }
+            return EXIT_SUCCESS;
+        } else if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0) {
+            usage(argv[0]);
+            return EXIT_SUCCESS;
+        } else {
+            bool found = false;
+            for (size_t p=0; p<PRODUCTIONS_COUNT; p++) {
+                if (strcmp(arg, PRODUCTIONS[p].name) == 0) {
+                    selected[p] = true;
+                    any_selected = true;
+                    found = true;
+                }
+            }
+
+            if (!found) {
+                fprintf(stderr, "unknown production or option '%s'\n\n", arg);
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+            continue;
+        }
+
+        if (i + 1 >= argc || !parse_size(argv[i + 1], option)) {
+            fprintf(stderr, "%s expects a positive integer\n", arg);
+            return EXIT_FAILURE;
+        }
+        i += 1;
+
+        if (option == &seed) {
+            options.seed = (uint64_t)seed;
+        }
+    }
+
+    if (options.width < 3) {
+        fprintf(stderr, "--width must be at least 3\n");
+        return EXIT_FAILURE;
+    }
+
+    for (size_t p=0; p<PRODUCTIONS_COUNT; p++) {
+        if (any_selected && !selected[p]) {
+            continue;
+        }
+
+        int status = run(&PRODUCTIONS[p], &options);
+        if (status != EXIT_SUCCESS) {
+            return status;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,417 @@
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "exyz.h"
+
+/// Generator for synthetic trajectories, used as input for the throughput
+/// benchmarks. The output only depends on the options and the seed, so the
+/// same file can be re-created on any machine instead of being shared.
+
+typedef enum float_style_t {
+    FLOAT_FIXED,
+    FLOAT_SCIENTIFIC,
+    FLOAT_FORTRAN,
+    FLOAT_SHORT,
+} float_style_t;
+
+typedef struct options_t {
+    const char* output;
+    /// number of frames to generate, or 0 to use `size`
+    size_t frames;
+    /// stop after generating at least this many bytes, if `frames` is 0
+    uint64_t size;
+    size_t min_atoms;
+    size_t max_atoms;
+    const char* properties;
+    size_t info;
+    float_style_t float_style;
+    int precision;
+    /// minimal width of atom values, padded with spaces on the left
+    int width;
+    const char* newline;
+    uint64_t seed;
+} options_t;
+
+/// xorshift64* generator, to make the output reproducible
+static uint64_t random_u64(uint64_t* state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * UINT64_C(2685821657736338717);
+}
+
+static double random_real(uint64_t* state, double scale) {
+    double value = (double)(random_u64(state) >> 11) / 9007199254740992.0;
+    return scale * (2.0 * value - 1.0);
+}
+
+static const char* SPECIES[] = {"H", "C", "N", "O", "Si", "Fe", "Cu", "Au"};
+
+/// write a real atom value in the requested style, returning the number of
+/// bytes written
+static int write_real(FILE* output, const options_t* options, double value) {
+    switch (options->float_style) {
+    case FLOAT_FIXED:
+        return fprintf(output, "%*.*f", options->width, options->precision, value);
+    case FLOAT_SCIENTIFIC:
+        return fprintf(output, "%*.*e", options->width, options->precision, value);
+    case FLOAT_SHORT:
+        return fprintf(output, "%*.*g", options->width, options->precision, value);
+    case FLOAT_FORTRAN: {
+        char buffer[64];
+        snprintf(buffer, sizeof(buffer), "%.*e", options->precision, value);
+        char* exponent = strchr(buffer, 'e');
+        if (exponent != NULL) {
+            *exponent = 'D';
+        }
+        return fprintf(output, "%*s", options->width, buffer);
+    }
+    }
+    return 0;
+}
+
+/// write the `index`-th additional info value. The kinds of values cycle
+/// through all the productions of the comment line grammar.
+static int write_info(FILE* output, uint64_t* state, size_t index) {
+    switch (index % 8) {
+    case 0:
+        return fprintf(output, " energy_%zu=%.10f", index, random_real(state, 1000.0));
+    case 1:
+        return fprintf(output, " step_%zu=%" PRIu64, index, random_u64(state) % 1000000);
+    case 2:
+        return fprintf(output, " flag_%zu=%s", index, random_u64(state) % 2 ? "T" : "F");
+    case 3:
+        return fprintf(output, " config_%zu=bulk_%" PRIu64, index, random_u64(state) % 100);
+    case 4:
+        return fprintf(output, " comment_%zu=\"generated frame %" PRIu64 "\"", index, random_u64(state) % 1000);
+    case 5: {
+        double x = random_real(state, 1.0);
+        double y = random_real(state, 1.0);
+        double z = random_real(state, 1.0);
+        return fprintf(output, " vector_%zu=[%.8f, %.8f, %.8f]", index, x, y, z);
+    }
+    case 6: {
+        double a = random_real(state, 1.0);
+        double b = random_real(state, 1.0);
+        double c = random_real(state, 1.0);
+        double d = random_real(state, 1.0);
+        return fprintf(output, " matrix_%zu=[[%.8f, %.8f], [%.8f, %.8f]]", index, a, b, c, d);
+    }
+    default: {
+        double x = random_real(state, 10.0);
+        double y = random_real(state, 10.0);
+        double z = random_real(state, 10.0);
+        return fprintf(output, " stress_%zu={%.8f %.8f %.8f}", index, x, y, z);
+    }
+    }
+}
+
+static int write_atom_value(FILE* output, const options_t* options, uint64_t* state, const exyz_atom_property_t* property) {
+    switch (property->type) {
+    case EXYZ_STRING:
+        return fprintf(output, "%*s", options->width, SPECIES[random_u64(state) % 8]);
+    case EXYZ_REAL:
+        return write_real(output, options, random_real(state, 50.0));
+    case EXYZ_INTEGER:
+        return fprintf(output, "%*" PRIu64, options->width, random_u64(state) % 100000);
+    case EXYZ_BOOL:
+        return fprintf(output, "%*s", options->width, random_u64(state) % 2 ? "T" : "F");
+    case EXYZ_ARRAY:
+        break;
+    }
+    return 0;
+}
+
+static int generate(const options_t* options) {
+    // use the parser to validate the properties specification
+    char* line = malloc(strlen(options->properties) + sizeof("Properties="));
+    if (line == NULL) {
+        fprintf(stderr, "failed to allocate memory\n");
+        return EXIT_FAILURE;
+    }
+    sprintf(line, "Properties=%s", options->properties);
+
+    exyz_atom_property_t* properties = NULL;
+    size_t properties_count = 0;
+    exyz_info_t* info = NULL;
+    size_t info_count = 0;
+    exyz_status_t status = exyz_read_comment_line(
+        line, strlen(line), &properties, &properties_count, &info, &info_count
+    );
+    free(line);
+    if (status != EXYZ_SUCCESS) {
+        fprintf(stderr, "\ninvalid properties specification '%s'\n", options->properties);
+        return EXIT_FAILURE;
+    }
+
+    for (size_t i=0; i<info_count; i++) {
+        exyz_info_free(info[i]);
+    }
+    exyz_free(info);
+
+    FILE* output = stdout;
+    if (strcmp(options->output, "-") != 0) {
+        output = fopen(options->output, "wb");
+        if (output == NULL) {
+            fprintf(stderr, "failed to open '%s' for writing\n", options->output);
+            goto cleanup;
+        }
+    }
+    setvbuf(output, NULL, _IOFBF, 1 << 20);
+
+    uint64_t state = options->seed;
+    uint64_t written = 0;
+    for (size_t frame=0; options->frames == 0 || frame < options->frames; frame++) {
+        if (options->frames == 0 && written >= options->size) {
+            break;
+        }
+
+        size_t n_atoms = options->min_atoms;
+        if (options->max_atoms > options->min_atoms) {
+            n_atoms += random_u64(&state) % (options->max_atoms - options->min_atoms + 1);
+        }
+
+        int size = fprintf(output, "%zu%s", n_atoms, options->newline);
+        size += fprintf(output, "Properties=%s", options->properties);
+        size += fprintf(output,
+            " Lattice=\"%.8f 0.0 0.0 0.0 %.8f 0.0 0.0 0.0 %.8f\" frame=%zu",
+            20.0 + random_real(&state, 1.0),
+            20.0 + random_real(&state, 1.0),
+            20.0 + random_real(&state, 1.0),
+            frame
+        );
+        for (size_t i=0; i<options->info; i++) {
+            size += write_info(output, &state, i);
+        }
+        size += fprintf(output, "%s", options->newline);
+
+        for (size_t atom=0; atom<n_atoms; atom++) {
+            for (size_t p=0; p<properties_count; p++) {
+                for (size_t k=0; k<properties[p].count; k++) {
+                    if (p != 0 || k != 0) {
+                        size += fprintf(output, " ");
+                    }
+                    size += write_atom_value(output, options, &state, &properties[p]);
+                }
+            }
+            size += fprintf(output, "%s", options->newline);
+        }
+
+        if (size < 0) {
+            fprintf(stderr, "failed to write to '%s'\n", options->output);
+            goto cleanup;
+        }
+        written += (uint64_t)size;
+    }
+
+    if (output != stdout) {
+        if (fclose(output) != 0) {
+            fprintf(stderr, "failed to write to '%s'\n", options->output);
+            output = stdout;
+            goto cleanup;
+        }
+    } else {
+        fflush(output);
+    }
+
+    for (size_t i=0; i<properties_count; i++) {
+        exyz_atom_property_free(properties[i]);
+    }
+    exyz_free(properties);
+    return EXIT_SUCCESS;
+
+cleanup:
+    if (output != NULL && output != stdout) {
+        fclose(output);
+    }
+
+    for (size_t i=0; i<properties_count; i++) {
+        exyz_atom_property_free(properties[i]);
+    }
+    exyz_free(properties);
+    return EXIT_FAILURE;
+}
+
+/******************************************************************************/
+/*                           Command line parsing                             */
+/******************************************************************************/
+
+static void usage(const char* name) {
+    fprintf(stderr, "usage: %s [options] <output>\n\n", name);
+    fprintf(stderr, "Generate a synthetic extended XYZ trajectory in <output>, or to the\n");
+    fprintf(stderr, "standard output if <output> is '-'.\n\n");
+    fprintf(stderr, "options:\n");
+    fprintf(stderr, "    --frames N         number of frames to generate [100]\n");
+    fprintf(stderr, "    --size N[K|M|G]    generate frames until the output contains N bytes,\n");
+    fprintf(stderr, "                       instead of a fixed number of frames\n");
+    fprintf(stderr, "    --atoms N[:M]      number of atoms per frame, or uniform range [100]\n");
+    fprintf(stderr, "    --properties SPEC  atom properties [species:S:1:pos:R:3]\n");
+    fprintf(stderr, "    --info N           number of additional frame properties [4]\n");
+    fprintf(stderr, "    --float STYLE      format of real atom properties, one of fixed,\n");
+    fprintf(stderr, "                       scientific, fortran or short [fixed]\n");
+    fprintf(stderr, "    --precision N      number of digits for real atom properties [8]\n");
+    fprintf(stderr, "    --width N          pad atom values to at least N characters, as\n");
+    fprintf(stderr, "                       fixed width formats such as %%16.8f do [0]\n");
+    fprintf(stderr, "    --crlf             use \\r\\n line endings instead of \\n\n");
+    fprintf(stderr, "    --seed N           seed for the random values [42]\n");
+}
+
+static bool parse_u64(const char* value, uint64_t* output) {
+    char* end = NULL;
+    if (value[0] < '0' || value[0] > '9') {
+        return false;
+    }
+    unsigned long long parsed = strtoull(value, &end, 10);
+    *output = (uint64_t)parsed;
+    return *end == '\0';
+}
+
+static bool parse_byte_size(const char* value, uint64_t* output) {
+    char* end = NULL;
+    if (value[0] < '0' || value[0] > '9') {
+        return false;
+    }
+    unsigned long long parsed = strtoull(value, &end, 10);
+
+    uint64_t multiplier = 1;
+    if (strcmp(end, "K") == 0) {
+        multiplier = UINT64_C(1) << 10;
+    } else if (strcmp(end, "M") == 0) {
+        multiplier = UINT64_C(1) << 20;
+    } else if (strcmp(end, "G") == 0) {
+        multiplier = UINT64_C(1) << 30;
+    } else if (*end != '\0') {
+        return false;
+    }
+
+    *output = (uint64_t)parsed * multiplier;
+    return *output != 0;
+}
+
+static bool parse_atoms(const char* value, options_t* options) {
+    uint64_t min = 0;
+    uint64_t max = 0;
+
+    const char* colon = strchr(value, ':');
+    if (colon == NULL) {
+        if (!parse_u64(value, &min)) {
+            return false;
+        }
+        max = min;
+    } else {
+        char* first = strndup(value, (size_t)(colon - value));
+        bool valid = first != NULL && parse_u64(first, &min) && parse_u64(colon + 1, &max);
+        free(first);
+        if (!valid || max < min) {
+            return false;
+        }
+    }
+
+    options->min_atoms = (size_t)min;
+    options->max_atoms = (size_t)max;
+    return true;
+}
+
+static bool parse_float_style(const char* value, float_style_t* style) {
+    if (strcmp(value, "fixed") == 0) {
+        *style = FLOAT_FIXED;
+    } else if (strcmp(value, "scientific") == 0) {
+        *style = FLOAT_SCIENTIFIC;
+    } else if (strcmp(value, "fortran") == 0) {
+        *style = FLOAT_FORTRAN;
+    } else if (strcmp(value, "short") == 0) {
+        *style = FLOAT_SHORT;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    options_t options = {
+        .output = NULL,
+        .frames = 100,
+        .size = 0,
+        .min_atoms = 100,
+        .max_atoms = 100,
+        .properties = "species:S:1:pos:R:3",
+        .info = 4,
+        .float_style = FLOAT_FIXED,
+        .precision = 8,
+        .width = 0,
+        .newline = "\n",
+        .seed = 42,
+    };
+
+    for (int i=1; i<argc; i++) {
+        const char* arg = argv[i];
+        if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0) {
+            usage(argv[0]);
+            return EXIT_SUCCESS;
+        } else if (strcmp(arg, "--crlf") == 0) {
+            options.newline = "\r\n";
+            continue;
+        } else if (arg[0] != '-' || strcmp(arg, "-") == 0) {
+            if (options.output != NULL) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+            options.output = arg;
+            continue;
+        }
+
+        if (i + 1 >= argc) {
+            fprintf(stderr, "missing value for %s\n", arg);
+            return EXIT_FAILURE;
+        }
+        const char* value = argv[i + 1];
+        i += 1;
+
+        bool valid = true;
+        uint64_t integer = 0;
+        if (strcmp(arg, "--frames") == 0) {
+            valid = parse_u64(value, &integer) && integer != 0;
+            options.frames = (size_t)integer;
+            options.size = 0;
+        } else if (strcmp(arg, "--size") == 0) {
+            valid = parse_byte_size(value, &options.size);
+            options.frames = 0;
+        } else if (strcmp(arg, "--atoms") == 0) {
+            valid = parse_atoms(value, &options);
+        } else if (strcmp(arg, "--properties") == 0) {
+            options.properties = value;
+        } else if (strcmp(arg, "--info") == 0) {
+            valid = parse_u64(value, &integer);
+            options.info = (size_t)integer;
+        } else if (strcmp(arg, "--float") == 0) {
+            valid = parse_float_style(value, &options.float_style);
+        } else if (strcmp(arg, "--precision") == 0) {
+            valid = parse_u64(value, &integer) && integer <= 17;
+            options.precision = (int)integer;
+        } else if (strcmp(arg, "--width") == 0) {
+            valid = parse_u64(value, &integer) && integer <= 64;
+            options.width = (int)integer;
+        } else if (strcmp(arg, "--seed") == 0) {
+            valid = parse_u64(value, &options.seed) && options.seed != 0;
+        } else {
+            fprintf(stderr, "unknown option '%s'\n\n", arg);
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        if (!valid) {
+            fprintf(stderr, "invalid value '%s' for %s\n", value, arg);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (options.output == NULL) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    return generate(&options);
+}
@@ -0,0 +1,464 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <time.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+#include "exyz.h"
+
+/// End-to-end throughput benchmarks, reading (or writing) a whole trajectory
+/// and reporting frames/s, atoms/s, bytes/s and the peak memory usage of the
+/// process as one JSON object. Each mode should be run in a separate process,
+/// since the peak memory usage covers the whole lifetime of the process.
+
+typedef enum bench_mode_t {
+    MODE_READ,
+    MODE_READER,
+    MODE_WRITE,
+    MODE_INDEX,
+    MODE_LAZY,
+} bench_mode_t;
+
+static const char* MODE_NAMES[] = {"read", "reader", "write", "index", "lazy"};
+
+typedef struct totals_t {
+    size_t frames;
+    size_t atoms;
+    /// time spent in the benchmarked function, in nanoseconds
+    double elapsed;
+} totals_t;
+
+static double now_ns(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return 1e9 * (double)time.tv_sec + (double)time.tv_nsec;
+}
+
+static void free_frame(exyz_info_t* info, size_t info_count, exyz_atom_array_t* arrays, size_t arrays_count) {
+    for (size_t i=0; i<info_count; i++) {
+        exyz_info_free(info[i]);
+    }
+    exyz_free(info);
+
+    for (size_t i=0; i<arrays_count; i++) {
+        exyz_atom_array_free(arrays[i]);
+    }
+    exyz_free(arrays);
+}
+
+/// is `path` referring to the standard input?
+static bool is_stdin(const char* path) {
+    return strcmp(path, "-") == 0;
+}
+
+/// open a reader for `path`, or for the standard input if `path` is "-"
+static exyz_status_t open_reader(exyz_reader_t** reader, const char* path) {
+    if (is_stdin(path)) {
+        return exyz_reader_from_file(reader, stdin);
+    }
+    return exyz_reader_open(reader, path);
+}
+
+/// read all frames with `exyz_read`, directly from the file
+static int bench_read(const char* path, totals_t* totals) {
+    FILE* file = is_stdin(path) ? stdin : fopen(path, "rb");
+    if (file == NULL) {
+        fprintf(stderr, "failed to open '%s'\n", path);
+        return EXIT_FAILURE;
+    }
+
+    double start = now_ns();
+    while (true) {
+        size_t n_atoms = 0;
+        exyz_info_t* info = NULL;
+        size_t info_count = 0;
+        exyz_atom_array_t* arrays = NULL;
+        size_t arrays_count = 0;
+
+        exyz_status_t status = exyz_read(file, &n_atoms, &info, &info_count, &arrays, &arrays_count);
+        if (status == EXYZ_END_OF_FILE) {
+            break;
+        } else if (status != EXYZ_SUCCESS) {
+            fprintf(stderr, "\nfailed to read frame %zu from '%s'\n", totals->frames, path);
+            if (file != stdin) {
+                fclose(file);
+            }
+            return EXIT_FAILURE;
+        }
+
+        totals->frames += 1;
+        totals->atoms += n_atoms;
+        free_frame(info, info_count, arrays, arrays_count);
+    }
+    totals->elapsed = now_ns() - start;
+
+    if (file != stdin) {
+        fclose(file);
+    }
+    return EXIT_SUCCESS;
+}
+
+/// find the start of all frames with `exyz_index_frames`. Atoms are not
+/// counted in this mode.
+static int bench_index(const char* path, size_t threads, totals_t* totals) {
+    double start = now_ns();
+    uint64_t* offsets = NULL;
+    size_t count = 0;
+    exyz_status_t status = exyz_index_frames(path, threads, &offsets, &count);
+    totals->elapsed = now_ns() - start;
+
+    if (status != EXYZ_SUCCESS) {
+        char message[512];
+        exyz_error_format(exyz_last_error(), message, sizeof(message));
+        fprintf(stderr, "failed to index '%s': %s\n", path, message);
+        return EXIT_FAILURE;
+    }
+
+    totals->frames = count;
+    exyz_free(offsets);
+    return EXIT_SUCCESS;
+}
+
+/// maximal number of atom properties given to `--properties`
+#define MAX_PROPERTIES 64
+
+/// select the comma-separated atom `properties` in `reader`
+static exyz_status_t select_properties(exyz_reader_t* reader, const char* properties) {
+    char* copy = strdup(properties);
+    if (copy == NULL) {
+        return EXYZ_ERROR;
+    }
+
+    const char* names[MAX_PROPERTIES];
+    size_t count = 0;
+    for (char* name = strtok(copy, ","); name != NULL && count < MAX_PROPERTIES; name = strtok(NULL, ",")) {
+        names[count] = name;
+        count += 1;
+    }
+
+    exyz_status_t status = exyz_reader_select_properties(reader, names, count);
+    free(copy);
+    return status;
+}
+
+/// read all frames with `exyz_reader_read`, which also supports compressed
+/// files. If `properties` is not NULL, only read these atom properties. If
+/// `output` is not NULL, also write all the frames to it, and only measure the
+/// time spent writing. Large frames are parsed with up to `threads` threads.
+/// If `atomic_numbers` is not NULL, this atom property is read as atomic
+/// numbers.
+static int bench_reader(const char* path, const char* properties, const char* atomic_numbers, size_t threads, FILE* output, totals_t* totals) {
+    exyz_reader_t* reader = NULL;
+    exyz_status_t status = open_reader(&reader, path);
+    if (status != EXYZ_SUCCESS) {
+        fprintf(stderr, "\nfailed to open '%s'\n", path);
+        return EXIT_FAILURE;
+    }
+
+    if (properties != NULL && select_properties(reader, properties) != EXYZ_SUCCESS) {
+        fprintf(stderr, "\nfailed to select atom properties '%s'\n", properties);
+        exyz_reader_close(reader);
+        return EXIT_FAILURE;
+    }
+    exyz_reader_set_threads(reader, threads);
+
+    if (exyz_reader_set_atomic_numbers(reader, atomic_numbers, false, 0) != EXYZ_SUCCESS) {
+        fprintf(stderr, "\nfailed to read '%s' as atomic numbers\n", atomic_numbers);
+        exyz_reader_close(reader);
+        return EXIT_FAILURE;
+    }
+
+    double start = now_ns();
+    while (true) {
+        size_t n_atoms = 0;
+        exyz_info_t* info = NULL;
+        size_t info_count = 0;
+        exyz_atom_array_t* arrays = NULL;
+        size_t arrays_count = 0;
+
+        status = exyz_reader_read(reader, &n_atoms, &info, &info_count, &arrays, &arrays_count);
+        if (status == EXYZ_END_OF_FILE) {
+            break;
+        } else if (status != EXYZ_SUCCESS) {
+            fprintf(stderr, "\nfailed to read frame %zu from '%s'\n", totals->frames, path);
+            exyz_reader_close(reader);
+            return EXIT_FAILURE;
+        }
+
+        if (output != NULL) {
+            exyz_array_t* columns = calloc(arrays_count + 1, sizeof(exyz_array_t));
+            if (columns == NULL) {
+                fprintf(stderr, "failed to allocate memory\n");
+                free_frame(info, info_count, arrays, arrays_count);
+                exyz_reader_close(reader);
+                return EXIT_FAILURE;
+            }
+
+            for (size_t i=0; i<arrays_count; i++) {
+                columns[i] = arrays[i].array;
+            }
+
+            double write_start = now_ns();
+            status = exyz_write(output, &n_atoms, info, columns);
+            totals->elapsed += now_ns() - write_start;
+            free(columns);
+
+            if (status != EXYZ_SUCCESS) {
+                fprintf(stderr, "\nfailed to write frame %zu\n", totals->frames);
+                free_frame(info, info_count, arrays, arrays_count);
+                exyz_reader_close(reader);
+                return EXIT_FAILURE;
+            }
+        }
+
+        totals->frames += 1;
+        totals->atoms += n_atoms;
+        free_frame(info, info_count, arrays, arrays_count);
+    }
+
+    if (output == NULL) {
+        totals->elapsed = now_ns() - start;
+    }
+
+    exyz_reader_close(reader);
+    return EXIT_SUCCESS;
+}
+
+/// read all frames with `exyz_reader_read_lazy`, only parsing the comma
+/// separated atom `properties` of each frame, or none of them if `properties`
+/// is NULL
+static int bench_lazy(const char* path, const char* properties, const char* atomic_numbers, size_t threads, totals_t* totals) {
+    exyz_reader_t* reader = NULL;
+    exyz_status_t status = open_reader(&reader, path);
+    if (status != EXYZ_SUCCESS) {
+        fprintf(stderr, "\nfailed to open '%s'\n", path);
+        return EXIT_FAILURE;
+    }
+    exyz_reader_set_threads(reader, threads);
+
+    if (exyz_reader_set_atomic_numbers(reader, atomic_numbers, false, 0) != EXYZ_SUCCESS) {
+        fprintf(stderr, "\nfailed to read '%s' as atomic numbers\n", atomic_numbers);
+        exyz_reader_close(reader);
+        return EXIT_FAILURE;
+    }
+
+    char* names = properties != NULL ? strdup(properties) : NULL;
+    const char* selected[MAX_PROPERTIES];
+    size_t count = 0;
+    if (names != NULL) {
+        for (char* name = strtok(names, ","); name != NULL && count < MAX_PROPERTIES; name = strtok(NULL, ",")) {
+            selected[count] = name;
+            count += 1;
+        }
+    }
+
+    double start = now_ns();
+    while (true) {
+        exyz_lazy_frame_t* frame = NULL;
+        status = exyz_reader_read_lazy(reader, &frame);
+        if (status == EXYZ_END_OF_FILE) {
+            break;
+        }
+
+        for (size_t i=0; status == EXYZ_SUCCESS && i<count; i++) {
+            const exyz_array_t* array = NULL;
+            status = exyz_lazy_frame_array(frame, selected[i], &array);
+        }
+
+        if (status != EXYZ_SUCCESS) {
+            fprintf(stderr, "\nfailed to read frame %zu from '%s'\n", totals->frames, path);
+            exyz_lazy_frame_free(frame);
+            exyz_reader_close(reader);
+            free(names);
+            return EXIT_FAILURE;
+        }
+
+        totals->frames += 1;
+        totals->atoms += exyz_lazy_frame_n_atoms(frame);
+        exyz_lazy_frame_free(frame);
+    }
+    totals->elapsed = now_ns() - start;
+
+    exyz_reader_close(reader);
+    free(names);
+    return EXIT_SUCCESS;
+}
+
+static void usage(const char* name) {
+    fprintf(stderr, "usage: %s [options] <path>\n\n", name);
+    fprintf(stderr, "Measure the throughput of the library on the trajectory at <path>, which\n");
+    fprintf(stderr, "can be created with exyz_generate, and print the results as JSON. Use '-' as\n");
+    fprintf(stderr, "<path> to read from the standard input, except in index mode.\n\n");
+    fprintf(stderr, "options:\n");
+    fprintf(stderr, "    --mode MODE     what to measure [read]:\n");
+    fprintf(stderr, "                    - read: exyz_read on the uncompressed file\n");
+    fprintf(stderr, "                    - reader: exyz_reader_read, with support for compression\n");
+    fprintf(stderr, "                    - write: exyz_write of all frames in the file\n");
+    fprintf(stderr, "                    - index: exyz_index_frames on the uncompressed file\n");
+    fprintf(stderr, "                    - lazy: exyz_reader_read_lazy, only parsing the atom\n");
+    fprintf(stderr, "                      properties given to --properties\n");
+    fprintf(stderr, "    --output PATH   where to write frames in write mode [/dev/null]\n");
+    fprintf(stderr, "    --properties P  comma-separated atom properties to read in reader, lazy and\n");
+    fprintf(stderr, "                    write modes, e.g. 'pos,forces' [all]\n");
+    fprintf(stderr, "    --species P     atom property to read as atomic numbers in reader,\n");
+    fprintf(stderr, "                    lazy and write modes, e.g. 'species' [none]\n");
+    fprintf(stderr, "    --threads N     number of threads for indexing or large frames, 0 for one per CPU [0]\n");
+    fprintf(stderr, "    --stats         collect and print the parser statistics\n");
+    fprintf(stderr, "    --allocations   use a counting allocator, and print the counts\n");
+}
+
+int main(int argc, char* argv[]) {
+    bench_mode_t mode = MODE_READ;
+    const char* path = NULL;
+    const char* output_path = "/dev/null";
+    const char* properties = NULL;
+    const char* atomic_numbers = NULL;
+    size_t threads = 0;
+    bool collect_stats = false;
+    bool count_allocations = false;
+
+    for (int i=1; i<argc; i++) {
+        const char* arg = argv[i];
+        if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0) {
+            usage(argv[0]);
+            return EXIT_SUCCESS;
+        } else if (strcmp(arg, "--mode") == 0 && i + 1 < argc) {
+            i += 1;
+            if (strcmp(argv[i], "read") == 0) {
+                mode = MODE_READ;
+            } else if (strcmp(argv[i], "reader") == 0) {
+                mode = MODE_READER;
+            } else if (strcmp(argv[i], "write") == 0) {
+                mode = MODE_WRITE;
+            } else if (strcmp(argv[i], "index") == 0) {
+                mode = MODE_INDEX;
+            } else if (strcmp(argv[i], "lazy") == 0) {
+                mode = MODE_LAZY;
+            } else {
+                fprintf(stderr, "unknown mode '%s'\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(arg, "--output") == 0 && i + 1 < argc) {
+            i += 1;
+            output_path = argv[i];
+        } else if (strcmp(arg, "--properties") == 0 && i + 1 < argc) {
+            i += 1;
+            properties = argv[i];
+        } else if (strcmp(arg, "--species") == 0 && i + 1 < argc) {
+            i += 1;
+            atomic_numbers = argv[i];
+        } else if (strcmp(arg, "--threads") == 0 && i + 1 < argc) {
+            i += 1;
+            threads = (size_t)strtoul(argv[i], NULL, 10);
+        } else if (strcmp(arg, "--stats") == 0) {
+            collect_stats = true;
+        } else if (strcmp(arg, "--allocations") == 0) {
+            count_allocations = true;
+        } else if ((arg[0] != '-' || is_stdin(arg)) && path == NULL) {
+            path = arg;
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (path == NULL) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    struct stat file_stat;
+    memset(&file_stat, 0, sizeof(file_stat));
+    if (is_stdin(path)) {
+        if (mode == MODE_INDEX) {
+            fprintf(stderr, "can not index frames in the standard input\n");
+            return EXIT_FAILURE;
+        }
+    } else if (stat(path, &file_stat) != 0) {
+        fprintf(stderr, "failed to open '%s'\n", path);
+        return EXIT_FAILURE;
+    }
+
+    // the size of the standard input is only known after reading it, so we
+    // use the number of (uncompressed) bytes seen by the parser instead
+    exyz_stats_t stats;
+    memset(&stats, 0, sizeof(stats));
+    if (collect_stats || is_stdin(path)) {
+        exyz_stats_collect(&stats);
+    }
+
+    exyz_allocator_t allocator;
+    exyz_allocation_counts_t counts;
+    if (count_allocations) {
+        exyz_counting_allocator(&allocator, &counts);
+        exyz_set_allocator(&allocator);
+    }
+
+    totals_t totals = {0, 0, 0.0};
+    int status = EXIT_SUCCESS;
+    if (mode == MODE_READ) {
+        status = bench_read(path, &totals);
+    } else if (mode == MODE_READER) {
+        status = bench_reader(path, properties, atomic_numbers, threads, NULL, &totals);
+    } else if (mode == MODE_INDEX) {
+        status = bench_index(path, threads, &totals);
+    } else if (mode == MODE_LAZY) {
+        status = bench_lazy(path, properties, atomic_numbers, threads, &totals);
+    } else {
+        FILE* output = fopen(output_path, "wb");
+        if (output == NULL) {
+            fprintf(stderr, "failed to open '%s' for writing\n", output_path);
+            return EXIT_FAILURE;
+        }
+        status = bench_reader(path, properties, atomic_numbers, threads, output, &totals);
+        fclose(output);
+    }
+
+    if (status != EXIT_SUCCESS) {
+        return status;
+    }
+
+    struct rusage usage_stats;
+    getrusage(RUSAGE_SELF, &usage_stats);
+
+    double seconds = totals.elapsed / 1e9;
+    double bytes = is_stdin(path) ? (double)stats.bytes : (double)file_stat.st_size;
+    printf(
+        "{\"mode\": \"%s\", \"path\": \"%s\", \"frames\": %zu, \"atoms\": %zu, \"bytes\": %.0f, "
+        "\"seconds\": %.6f, \"frames_per_s\": %.3f, \"atoms_per_s\": %.3f, \"mb_per_s\": %.3f, "
+        "\"peak_rss_kb\": %ld, \"simd\": \"%s\"",
+        MODE_NAMES[mode], path, totals.frames, totals.atoms, bytes, seconds,
+        (double)totals.frames / seconds, (double)totals.atoms / seconds, bytes / seconds / 1e6,
+        usage_stats.ru_maxrss, exyz_simd_level()
+    );
+
+    if (collect_stats) {
+        exyz_stats_collect(NULL);
+        printf(
+            ", \"stats\": {\"bytes\": %" PRIu64 ", \"frames\": %" PRIu64 ", \"atoms\": %" PRIu64 ", "
+            "\"skipped_frames\": %" PRIu64 ", "
+            "\"integers\": %" PRIu64 ", \"reals\": %" PRIu64 ", \"booleans\": %" PRIu64 ", "
+            "\"strings\": %" PRIu64 ", \"arrays\": %" PRIu64 ", \"allocations\": %" PRIu64 ", "
+            "\"allocated_bytes\": %" PRIu64 ", \"failed_reads\": %" PRIu64 ", "
+            "\"framing_ns\": %" PRIu64 ", \"comment_line_ns\": %" PRIu64 ", \"atoms_ns\": %" PRIu64 "}",
+            stats.bytes, stats.frames, stats.atoms, stats.skipped_frames,
+            stats.integers, stats.reals, stats.booleans,
+            stats.strings, stats.arrays, stats.allocations,
+            stats.allocated_bytes, stats.failed_reads,
+            stats.framing_ns, stats.comment_line_ns, stats.atoms_ns
+        );
+    }
+    if (count_allocations) {
+        printf(
+            ", \"allocations\": {\"allocations\": %" PRIu64 ", \"frees\": %" PRIu64 ", "
+            "\"allocated_bytes\": %" PRIu64 ", \"peak_bytes\": %" PRIu64 "}",
+            counts.allocations, counts.frees, counts.allocated_bytes, counts.peak_bytes
+        );
+    }
+    printf("}\n");
+
+    return EXIT_SUCCESS;
+}
@@ -1,3 +1,4 @@
-from .parser import parse_comment_line
+from .parser import parse_comment_line, parse_comment_lines
+from .reader import iread
 
-__all__ = ["parse_comment_line"]
+__all__ = ["parse_comment_line", "parse_comment_lines", "iread"]
@@ -0,0 +1,19 @@
+from ._exyz import ffi, lib
+
+
+def _last_error(message):
+    """
+    Create an exception for the last error of the C library on this thread,
+    with ``message`` as context.
+    """
+    error = lib.exyz_last_error()
+
+    size = lib.exyz_error_format(error, ffi.NULL, 0)
+    buffer = ffi.new("char[]", size + 1)
+    lib.exyz_error_format(error, buffer, size + 1)
+
+    details = ffi.string(buffer).decode("utf8", errors="replace")
+    if details:
+        message = f"{message}: {details}"
+
+    return Exception(message)
@@ -1,4 +1,6 @@
 import os
+import sys
+import ctypes.util
 from cffi import FFI
 
 ROOT = os.path.abspath(os.path.join(os.path.dirname(__file__), ".."))
@@ -9,14 +11,59 @@ with open(os.path.join(ROOT, "src/exyz.h")) as fd:
     lines = fd.readlines()
     header = "\n".join(lines[8:-4])
 
-    header += "\nvoid free(void*);"
+with open(os.path.join(ROOT, "exyz/helpers.h")) as fd:
+    header += "\n" + fd.read()
 
 builder.cdef(header)
 
+
+def _has_header(name):
+    include_dirs = ["/usr/include", "/usr/local/include", os.path.join(sys.prefix, "include")]
+    for variable in ["CPATH", "C_INCLUDE_PATH"]:
+        include_dirs += [d for d in os.environ.get(variable, "").split(os.pathsep) if d]
+
+    return any(os.path.exists(os.path.join(d, name)) for d in include_dirs)
+
+
+# optional compression libraries, used if they are installed
+define_macros = []
+libraries = ["pthread"]
+for macro, header, library in [
+    ("EXYZ_HAVE_ZLIB", "zlib.h", "z"),
+    ("EXYZ_HAVE_LZMA", "lzma.h", "lzma"),
+    ("EXYZ_HAVE_ZSTD", "zstd.h", "zstd"),
+]:
+    if _has_header(header) and ctypes.util.find_library(library) is not None:
+        define_macros.append((macro, None))
+        libraries.append(library)
+
 builder.set_source(
     "exyz._exyz",
-    f'#include "{os.path.join(ROOT, "src/exyz.h")}"',
-    sources=["src/types.c", "src/parser.c", "src/writer.c"],
+    f'#include "{os.path.join(ROOT, "src/exyz.h")}"\n'
+    + f'#include "{os.path.join(ROOT, "exyz/helpers.h")}"',
+    sources=[
+        "exyz/helpers.c",
+        "src/types.c",
+        "src/parser.c",
+        "src/writer.c",
+        "src/reader.c",
+        "src/stream.c",
+        "src/seekable.c",
+        "src/cache.c",
+        "src/arrow.c",
+        "src/stats.c",
+        "src/allocator.c",
+        "src/errors.c",
+        "src/index.c",
+        "src/tokenizer.c",
+        "src/cpu.c",
+        "src/elements.c",
+        "src/lazy.c",
+        "src/lru.c",
+    ],
+    include_dirs=[os.path.join(ROOT, "src")],
+    define_macros=define_macros,
+    libraries=libraries,
 )
 
 if __name__ == "__main__":
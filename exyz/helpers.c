@@ -0,0 +1,715 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include <pthread.h>
+
+#include "exyz.h"
+#include "internal.h"
+#include "helpers.h"
+
+static exyz_status_t error(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    exyz_status_t status = exyz_set_error(format, args);
+    va_end(args);
+
+    return status;
+}
+
+/******************************************************************************/
+/*                              String arrays                                 */
+/******************************************************************************/
+
+/// number of unicode code points in a UTF-8 string
+static size_t utf8_length(const char* string) {
+    size_t length = 0;
+    for (const char* c=string; *c != '\0'; c++) {
+        // count all bytes except UTF-8 continuation bytes
+        if ((*c & 0xC0) != 0x80) {
+            length += 1;
+        }
+    }
+    return length;
+}
+
+size_t exyz_python_strings_width(const exyz_array_t* array) {
+    size_t width = 0;
+    size_t count = array->nrows * array->ncols;
+    for (size_t i=0; i<count; i++) {
+        size_t length = utf8_length(array->data.string[i]);
+        if (length > width) {
+            width = length;
+        }
+    }
+    return width;
+}
+
+/// decode a single code point from `string`, advancing the pointer. Invalid
+/// sequences are replaced by U+FFFD.
+static uint32_t decode_utf8(const unsigned char** string) {
+    const unsigned char* c = *string;
+    uint32_t codepoint = 0;
+    size_t extra = 0;
+    if (c[0] < 0x80) {
+        codepoint = c[0];
+    } else if ((c[0] & 0xE0) == 0xC0) {
+        codepoint = c[0] & 0x1F;
+        extra = 1;
+    } else if ((c[0] & 0xF0) == 0xE0) {
+        codepoint = c[0] & 0x0F;
+        extra = 2;
+    } else if ((c[0] & 0xF8) == 0xF0) {
+        codepoint = c[0] & 0x07;
+        extra = 3;
+    } else {
+        *string += 1;
+        return 0xFFFD;
+    }
+
+    for (size_t i=1; i<=extra; i++) {
+        if ((c[i] & 0xC0) != 0x80) {
+            // this also stops at the terminating null byte
+            *string += i;
+            return 0xFFFD;
+        }
+        codepoint = (codepoint << 6) | (c[i] & 0x3F);
+    }
+
+    *string += extra + 1;
+    return codepoint;
+}
+
+/// decode `string` into the `width` code points in `output`, padding with
+/// zeros
+static void utf8_to_ucs4(const char* string, uint32_t* output, size_t width) {
+    const unsigned char* c = (const unsigned char*)string;
+    size_t i = 0;
+    for (; i<width && *c != '\0'; i++) {
+        output[i] = decode_utf8(&c);
+    }
+    for (; i<width; i++) {
+        output[i] = 0;
+    }
+}
+
+void exyz_python_strings_to_ucs4(const exyz_array_t* array, uint32_t* output, size_t width) {
+    size_t count = array->nrows * array->ncols;
+    for (size_t i=0; i<count; i++) {
+        utf8_to_ucs4(array->data.string[i], output + i * width, width);
+    }
+}
+
+/******************************************************************************/
+/*                                 Batches                                    */
+/******************************************************************************/
+
+struct exyz_python_batch_t {
+    /// number of comment lines or frames in this batch
+    size_t count;
+    exyz_info_t** info;
+    size_t* info_count;
+    /// properties, only used for batches of comment lines
+    exyz_atom_property_t** properties;
+    size_t* properties_count;
+    /// atoms data, only used for batches of frames
+    size_t* n_atoms;
+    exyz_atom_array_t** arrays;
+    size_t* arrays_count;
+
+    exyz_python_column_t* columns;
+    size_t columns_count;
+
+    /// schema of each line
+    size_t* schema_ids;
+    /// index of the first line using each schema
+    size_t* schemas;
+    size_t schemas_count;
+};
+
+typedef struct batch_task_t {
+    exyz_python_batch_t* batch;
+    const char* data;
+    const int64_t* offsets;
+    size_t start;
+    size_t end;
+    /// allocator and statistics of the thread which started this task
+    const exyz_allocator_t* allocator;
+    bool collect_stats;
+    exyz_stats_t stats;
+    exyz_status_t status;
+    size_t failed;
+    /// error for the failed line, moved to the calling thread
+    exyz_error_state_t error;
+} batch_task_t;
+
+/// parse the lines from `task->start` to `task->end`
+static void* parse_lines(void* data) {
+    batch_task_t* task = data;
+    exyz_python_batch_t* batch = task->batch;
+    const exyz_allocator_t* previous_allocator = exyz_use_allocator(task->allocator);
+    exyz_stats_t* previous_stats = exyz_current_stats;
+    exyz_current_stats = task->collect_stats ? &task->stats : NULL;
+
+    // copy of the current line, with a terminating null byte
+    char* line = NULL;
+    size_t capacity = 0;
+
+    task->status = EXYZ_SUCCESS;
+    for (size_t i=task->start; i<task->end; i++) {
+        const char* start = task->data + task->offsets[i];
+        size_t length = (size_t)(task->offsets[i + 1] - task->offsets[i]);
+        // allow lines separated by new lines
+        if (length > 0 && start[length - 1] == '\n') {
+            length -= 1;
+        }
+        if (length > 0 && start[length - 1] == '\r') {
+            length -= 1;
+        }
+
+        if (length + 1 > capacity) {
+            capacity = 2 * (length + 1);
+            char* new_line = exyz_realloc(line, capacity);
+            if (new_line == NULL) {
+                task->status = error("failed to allocate memory");
+                task->failed = i;
+                exyz_save_error(&task->error);
+                break;
+            }
+            line = new_line;
+        }
+
+        memcpy(line, start, length);
+        line[length] = '\0';
+
+        if (strlen(line) != length) {
+            task->status = error("unexpected null byte in comment line");
+            exyz_error_at(1, (int64_t)strlen(line));
+        } else {
+            task->status = exyz_read_comment_line(
+                line, length,
+                &batch->properties[i], &batch->properties_count[i],
+                &batch->info[i], &batch->info_count[i]
+            );
+        }
+
+        if (task->status != EXYZ_SUCCESS) {
+            task->failed = i;
+            // each comment line is a line of the input data
+            exyz_error_shift((int64_t)i, task->offsets[i]);
+            exyz_save_error(&task->error);
+            break;
+        }
+    }
+
+    exyz_free(line);
+    exyz_current_stats = previous_stats;
+    exyz_use_allocator(previous_allocator);
+    return NULL;
+}
+
+static const exyz_info_t* find_info(const exyz_info_t* info, size_t count, const char* key, size_t guess) {
+    // keys are usually in the same order in all lines
+    if (guess < count && strcmp(info[guess].key, key) == 0) {
+        return &info[guess];
+    }
+
+    return exyz_info_find(info, count, key);
+}
+
+/// merge `type` into `current`, allowing integers to be promoted to reals
+static bool merge_type(exyz_data_t* current, exyz_data_t type) {
+    if (*current == type) {
+        return true;
+    } else if (*current == EXYZ_INTEGER && type == EXYZ_REAL) {
+        *current = EXYZ_REAL;
+        return true;
+    } else if (*current == EXYZ_REAL && type == EXYZ_INTEGER) {
+        return true;
+    }
+    return false;
+}
+
+static size_t strings_width(const exyz_info_t* info) {
+    if (info->type == EXYZ_STRING) {
+        return utf8_length(info->data.string);
+    } else if (info->type == EXYZ_ARRAY && info->data.array.type == EXYZ_STRING) {
+        return exyz_python_strings_width(&info->data.array);
+    }
+    return 0;
+}
+
+/// find the type and shape of all info keys in the batch
+static exyz_status_t collect_columns(exyz_python_batch_t* batch) {
+    size_t capacity = 0;
+    size_t* present = NULL;
+
+    for (size_t line=0; line<batch->count; line++) {
+        for (size_t i=0; i<batch->info_count[line]; i++) {
+            const exyz_info_t* info = &batch->info[line][i];
+
+            size_t column = batch->columns_count;
+            if (i < batch->columns_count && strcmp(batch->columns[i].key, info->key) == 0) {
+                column = i;
+            } else {
+                for (size_t c=0; c<batch->columns_count; c++) {
+                    if (strcmp(batch->columns[c].key, info->key) == 0) {
+                        column = c;
+                        break;
+                    }
+                }
+            }
+
+            if (column == batch->columns_count) {
+                if (batch->columns_count == capacity) {
+                    capacity = capacity == 0 ? 16 : 2 * capacity;
+                    exyz_python_column_t* columns = exyz_realloc(batch->columns, capacity * sizeof(exyz_python_column_t));
+                    size_t* new_present = exyz_realloc(present, capacity * sizeof(size_t));
+                    if (columns != NULL) {
+                        batch->columns = columns;
+                    }
+                    if (new_present != NULL) {
+                        present = new_present;
+                    }
+                    if (columns == NULL || new_present == NULL) {
+                        exyz_free(present);
+                        return error("failed to allocate memory");
+                    }
+                }
+
+                exyz_python_column_t* current = &batch->columns[column];
+                memset(current, 0, sizeof(exyz_python_column_t));
+                current->key = info->key;
+                current->type = info->type;
+                if (info->type == EXYZ_ARRAY) {
+                    current->array_type = info->data.array.type;
+                    current->nrows = info->data.array.nrows;
+                    current->ncols = info->data.array.ncols;
+                }
+                present[column] = 0;
+                batch->columns_count += 1;
+            }
+
+            exyz_python_column_t* current = &batch->columns[column];
+            bool compatible = false;
+            if (current->type == EXYZ_ARRAY) {
+                compatible = info->type == EXYZ_ARRAY &&
+                    merge_type(&current->array_type, info->data.array.type) &&
+                    current->nrows == info->data.array.nrows &&
+                    current->ncols == info->data.array.ncols;
+            } else {
+                compatible = info->type != EXYZ_ARRAY && merge_type(&current->type, info->type);
+            }
+
+            if (!compatible) {
+                exyz_free(present);
+                return error(
+                    "the value for '%s' in line %zu has a different type or shape than in previous lines",
+                    info->key, line
+                );
+            }
+
+            size_t width = strings_width(info);
+            if (width > current->width) {
+                current->width = width;
+            }
+            present[column] += 1;
+        }
+    }
+
+    for (size_t c=0; c<batch->columns_count; c++) {
+        exyz_python_column_t* current = &batch->columns[c];
+        current->missing = batch->count - present[c];
+
+        // numpy does not support zero-width strings
+        bool strings = current->type == EXYZ_STRING || (current->type == EXYZ_ARRAY && current->array_type == EXYZ_STRING);
+        if (strings && current->width == 0) {
+            current->width = 1;
+        }
+    }
+    exyz_free(present);
+
+    return EXYZ_SUCCESS;
+}
+
+static bool same_schema(
+    const exyz_atom_property_t* first, size_t first_count,
+    const exyz_atom_property_t* second, size_t second_count
+) {
+    if (first_count != second_count) {
+        return false;
+    }
+
+    for (size_t i=0; i<first_count; i++) {
+        if (first[i].type != second[i].type || first[i].count != second[i].count ||
+            strcmp(first[i].key, second[i].key) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// group lines with the same Properties
+static exyz_status_t collect_schemas(exyz_python_batch_t* batch) {
+    batch->schema_ids = exyz_malloc((batch->count + 1) * sizeof(size_t));
+    batch->schemas = exyz_malloc((batch->count + 1) * sizeof(size_t));
+    if (batch->schema_ids == NULL || batch->schemas == NULL) {
+        return error("failed to allocate memory");
+    }
+
+    size_t last = 0;
+    for (size_t line=0; line<batch->count; line++) {
+        size_t schema = batch->schemas_count;
+
+        // check the schema of the previous line first
+        size_t start = batch->schemas_count == 0 ? 0 : last;
+        for (size_t k=0; k<batch->schemas_count; k++) {
+            size_t candidate = (start + k) % batch->schemas_count;
+            size_t other = batch->schemas[candidate];
+            if (same_schema(batch->properties[line], batch->properties_count[line], batch->properties[other], batch->properties_count[other])) {
+                schema = candidate;
+                break;
+            }
+        }
+
+        if (schema == batch->schemas_count) {
+            batch->schemas[schema] = line;
+            batch->schemas_count += 1;
+        }
+
+        batch->schema_ids[line] = schema;
+        last = schema;
+    }
+
+    return EXYZ_SUCCESS;
+}
+
+/// allocate a batch with space for `count` lines or frames
+static exyz_python_batch_t* batch_new(size_t count, bool frames) {
+    exyz_python_batch_t* batch = exyz_calloc(1, sizeof(exyz_python_batch_t));
+    if (batch == NULL) {
+        return NULL;
+    }
+
+    batch->count = count;
+    batch->info = exyz_calloc(count + 1, sizeof(exyz_info_t*));
+    batch->info_count = exyz_calloc(count + 1, sizeof(size_t));
+    if (batch->info == NULL || batch->info_count == NULL) {
+        batch->count = 0;
+        exyz_python_batch_free(batch);
+        return NULL;
+    }
+
+    if (frames) {
+        batch->n_atoms = exyz_calloc(count + 1, sizeof(size_t));
+        batch->arrays = exyz_calloc(count + 1, sizeof(exyz_atom_array_t*));
+        batch->arrays_count = exyz_calloc(count + 1, sizeof(size_t));
+        if (batch->n_atoms == NULL || batch->arrays == NULL || batch->arrays_count == NULL) {
+            batch->count = 0;
+            exyz_python_batch_free(batch);
+            return NULL;
+        }
+    } else {
+        batch->properties = exyz_calloc(count + 1, sizeof(exyz_atom_property_t*));
+        batch->properties_count = exyz_calloc(count + 1, sizeof(size_t));
+        if (batch->properties == NULL || batch->properties_count == NULL) {
+            batch->count = 0;
+            exyz_python_batch_free(batch);
+            return NULL;
+        }
+    }
+
+    return batch;
+}
+
+exyz_status_t exyz_python_batch_parse(
+    const char* data,
+    const int64_t* offsets,
+    size_t count,
+    size_t n_threads,
+    exyz_python_batch_t** batch_ptr,
+    size_t* failed
+) {
+    *failed = count;
+
+    exyz_python_batch_t* batch = batch_new(count, false);
+    if (batch == NULL) {
+        return error("failed to allocate memory");
+    }
+
+    if (n_threads > count) {
+        n_threads = count;
+    }
+    if (n_threads == 0) {
+        n_threads = 1;
+    }
+
+    batch_task_t* tasks = exyz_calloc(n_threads, sizeof(batch_task_t));
+    pthread_t* threads = exyz_calloc(n_threads, sizeof(pthread_t));
+    bool* started = exyz_calloc(n_threads, sizeof(bool));
+    if (tasks == NULL || threads == NULL || started == NULL) {
+        exyz_free(tasks);
+        exyz_free(threads);
+        exyz_free(started);
+        exyz_python_batch_free(batch);
+        return error("failed to allocate memory");
+    }
+
+    for (size_t t=0; t<n_threads; t++) {
+        tasks[t].batch = batch;
+        tasks[t].data = data;
+        tasks[t].offsets = offsets;
+        tasks[t].start = t * count / n_threads;
+        tasks[t].end = (t + 1) * count / n_threads;
+        tasks[t].allocator = exyz_current_allocator();
+        tasks[t].collect_stats = exyz_current_stats != NULL;
+
+        // the first range is parsed on the calling thread
+        if (t != 0) {
+            started[t] = pthread_create(&threads[t], NULL, parse_lines, &tasks[t]) == 0;
+        }
+    }
+
+    parse_lines(&tasks[0]);
+    for (size_t t=1; t<n_threads; t++) {
+        if (started[t]) {
+            pthread_join(threads[t], NULL);
+        } else {
+            parse_lines(&tasks[t]);
+        }
+    }
+
+    if (exyz_current_stats != NULL) {
+        for (size_t t=0; t<n_threads; t++) {
+            exyz_stats_add(exyz_current_stats, &tasks[t].stats);
+        }
+    }
+
+    // the ranges are in order, so the first failed task has the first
+    // invalid line
+    exyz_status_t status = EXYZ_SUCCESS;
+    for (size_t t=0; t<n_threads; t++) {
+        if (tasks[t].status != EXYZ_SUCCESS) {
+            status = tasks[t].status;
+            *failed = tasks[t].failed;
+            exyz_restore_error(&tasks[t].error);
+            break;
+        }
+    }
+
+    exyz_free(tasks);
+    exyz_free(threads);
+    exyz_free(started);
+
+    if (status == EXYZ_SUCCESS) {
+        status = collect_columns(batch);
+    }
+
+    if (status == EXYZ_SUCCESS) {
+        status = collect_schemas(batch);
+    }
+
+    if (status != EXYZ_SUCCESS) {
+        exyz_python_batch_free(batch);
+        return status;
+    }
+
+    *batch_ptr = batch;
+    return EXYZ_SUCCESS;
+}
+
+void exyz_python_batch_free(exyz_python_batch_t* batch) {
+    if (batch == NULL) {
+        return;
+    }
+
+    for (size_t line=0; line<batch->count; line++) {
+        if (batch->info != NULL) {
+            for (size_t i=0; i<batch->info_count[line]; i++) {
+                exyz_info_free(batch->info[line][i]);
+            }
+            exyz_free(batch->info[line]);
+        }
+
+        if (batch->properties != NULL) {
+            for (size_t i=0; i<batch->properties_count[line]; i++) {
+                exyz_atom_property_free(batch->properties[line][i]);
+            }
+            exyz_free(batch->properties[line]);
+        }
+
+        if (batch->arrays != NULL) {
+            for (size_t i=0; i<batch->arrays_count[line]; i++) {
+                exyz_atom_array_free(batch->arrays[line][i]);
+            }
+            exyz_free(batch->arrays[line]);
+        }
+    }
+
+    exyz_free(batch->info);
+    exyz_free(batch->info_count);
+    exyz_free(batch->properties);
+    exyz_free(batch->properties_count);
+    exyz_free(batch->n_atoms);
+    exyz_free(batch->arrays);
+    exyz_free(batch->arrays_count);
+    exyz_free(batch->columns);
+    exyz_free(batch->schema_ids);
+    exyz_free(batch->schemas);
+    exyz_free(batch);
+}
+
+size_t exyz_python_batch_columns_count(const exyz_python_batch_t* batch) {
+    return batch->columns_count;
+}
+
+const exyz_python_column_t* exyz_python_batch_column(const exyz_python_batch_t* batch, size_t column) {
+    return &batch->columns[column];
+}
+
+/// size in bytes of a single element with the given type in numpy arrays
+static size_t element_size(exyz_data_t type, size_t width) {
+    switch (type) {
+    case EXYZ_INTEGER:
+        return sizeof(int64_t);
+    case EXYZ_REAL:
+        return sizeof(double);
+    case EXYZ_BOOL:
+        return sizeof(bool);
+    case EXYZ_STRING:
+        return width * sizeof(uint32_t);
+    case EXYZ_ARRAY:
+        break;
+    }
+    return 0;
+}
+
+/// copy a single value from `info` to `output`, converting it to `type`
+static void copy_value(const exyz_info_t* info, exyz_data_t type, size_t width, uint8_t* output) {
+    if (type == EXYZ_REAL && info->type == EXYZ_INTEGER) {
+        double value = (double)info->data.integer;
+        memcpy(output, &value, sizeof(double));
+    } else if (type == EXYZ_STRING) {
+        utf8_to_ucs4(info->data.string, (uint32_t*)(void*)output, width);
+    } else {
+        memcpy(output, &info->data, element_size(type, width));
+    }
+}
+
+/// copy an array from `array` to `output`, converting it to `type`
+static void copy_array(const exyz_array_t* array, exyz_data_t type, size_t width, uint8_t* output) {
+    size_t count = array->nrows * array->ncols;
+    if (type == EXYZ_REAL && array->type == EXYZ_INTEGER) {
+        for (size_t i=0; i<count; i++) {
+            double value = (double)array->data.integer[i];
+            memcpy(output + i * sizeof(double), &value, sizeof(double));
+        }
+    } else if (type == EXYZ_STRING) {
+        exyz_python_strings_to_ucs4(array, (uint32_t*)(void*)output, width);
+    } else if (count != 0) {
+        memcpy(output, array->data.integer, count * element_size(type, width));
+    }
+}
+
+void exyz_python_batch_fill_column(const exyz_python_batch_t* batch, size_t column, void* values, bool* mask) {
+    const exyz_python_column_t* current = &batch->columns[column];
+
+    size_t size = 0;
+    if (current->type == EXYZ_ARRAY) {
+        size = current->nrows * current->ncols * element_size(current->array_type, current->width);
+    } else {
+        size = element_size(current->type, current->width);
+    }
+
+    uint8_t* output = values;
+    for (size_t line=0; line<batch->count; line++) {
+        const exyz_info_t* info = find_info(batch->info[line], batch->info_count[line], current->key, column);
+        if (info == NULL) {
+            mask[line] = true;
+            memset(output, 0, size);
+        } else {
+            mask[line] = false;
+            if (current->type == EXYZ_ARRAY) {
+                copy_array(&info->data.array, current->array_type, current->width, output);
+            } else {
+                copy_value(info, current->type, current->width, output);
+            }
+        }
+        output += size;
+    }
+}
+
+size_t exyz_python_batch_schemas_count(const exyz_python_batch_t* batch) {
+    return batch->schemas_count;
+}
+
+void exyz_python_batch_schema_ids(const exyz_python_batch_t* batch, int64_t* ids) {
+    for (size_t line=0; line<batch->count; line++) {
+        ids[line] = (int64_t)batch->schema_ids[line];
+    }
+}
+
+const exyz_atom_property_t* exyz_python_batch_schema(const exyz_python_batch_t* batch, size_t schema, size_t* count) {
+    size_t line = batch->schemas[schema];
+    *count = batch->properties_count[line];
+    return batch->properties[line];
+}
+
+exyz_status_t exyz_python_batch_read(exyz_reader_t* reader, size_t max_frames, exyz_python_batch_t** batch_ptr) {
+    exyz_python_batch_t* batch = batch_new(max_frames, true);
+    if (batch == NULL) {
+        return error("failed to allocate memory");
+    }
+
+    // only free the frames we actually read on error
+    batch->count = 0;
+    exyz_status_t status = EXYZ_SUCCESS;
+    while (batch->count < max_frames) {
+        size_t frame = batch->count;
+        status = exyz_reader_read(
+            reader,
+            &batch->n_atoms[frame],
+            &batch->info[frame], &batch->info_count[frame],
+            &batch->arrays[frame], &batch->arrays_count[frame]
+        );
+
+        if (status != EXYZ_SUCCESS) {
+            break;
+        }
+        batch->count += 1;
+    }
+
+    if (status == EXYZ_END_OF_FILE) {
+        status = EXYZ_SUCCESS;
+    }
+
+    if (status == EXYZ_SUCCESS) {
+        status = collect_columns(batch);
+    }
+
+    if (status != EXYZ_SUCCESS) {
+        exyz_python_batch_free(batch);
+        return status;
+    }
+
+    *batch_ptr = batch;
+    return EXYZ_SUCCESS;
+}
+
+size_t exyz_python_batch_count(const exyz_python_batch_t* batch) {
+    return batch->count;
+}
+
+size_t exyz_python_batch_n_atoms(const exyz_python_batch_t* batch, size_t frame) {
+    return batch->n_atoms[frame];
+}
+
+exyz_info_t* exyz_python_batch_info(const exyz_python_batch_t* batch, size_t frame, size_t* count) {
+    *count = batch->info_count[frame];
+    return batch->info[frame];
+}
+
+exyz_atom_array_t* exyz_python_batch_arrays(const exyz_python_batch_t* batch, size_t frame, size_t* count) {
+    *count = batch->arrays_count[frame];
+    return batch->arrays[frame];
+}
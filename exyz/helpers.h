@@ -0,0 +1,72 @@
+// Helper functions for the Python binding. This file is given to cffi as-is,
+// and must be included after exyz.h.
+
+/// Get the maximal number of unicode code points in the strings of `array`
+size_t exyz_python_strings_width(const exyz_array_t* array);
+
+/// Decode the UTF-8 strings in `array` into `output`, which should contain
+/// space for `width` UCS4 code points per string, i.e. the memory layout of
+/// a numpy array with dtype `U<width>`. Shorter strings are padded with zeros.
+void exyz_python_strings_to_ucs4(const exyz_array_t* array, uint32_t* output, size_t width);
+
+/// Results of parsing multiple comment lines or frames at once
+typedef struct exyz_python_batch_t exyz_python_batch_t;
+
+/// Parse `count` comment lines using `n_threads` threads. Line `i` contains
+/// the bytes in `data[offsets[i]:offsets[i + 1]]`, where a final new line is
+/// ignored. If a line can not be parsed, `failed` is set to the index of the
+/// first invalid line, and it is set to `count` for other errors.
+exyz_status_t exyz_python_batch_parse(
+    const char* data,
+    const int64_t* offsets,
+    size_t count,
+    size_t n_threads,
+    exyz_python_batch_t** batch,
+    size_t* failed
+);
+
+void exyz_python_batch_free(exyz_python_batch_t* batch);
+
+/// Description of all the values for a given info key in a batch
+typedef struct exyz_python_column_t {
+    const char* key;
+    /// type of the values, integers are converted to reals if other lines
+    /// contain a real value for the same key
+    exyz_data_t type;
+    /// type and shape of the values for arrays
+    exyz_data_t array_type;
+    size_t nrows;
+    size_t ncols;
+    /// maximal number of code points in string values
+    size_t width;
+    /// number of lines without this key
+    size_t missing;
+} exyz_python_column_t;
+
+size_t exyz_python_batch_columns_count(const exyz_python_batch_t* batch);
+const exyz_python_column_t* exyz_python_batch_column(const exyz_python_batch_t* batch, size_t column);
+
+/// Copy all values for `column` in `values`, with the memory layout of a numpy
+/// array with one entry per line. `mask` is set to true for lines without this
+/// key.
+void exyz_python_batch_fill_column(const exyz_python_batch_t* batch, size_t column, void* values, bool* mask);
+
+/// Lines with the same Properties share the same schema. This is only
+/// available for batches created by `exyz_python_batch_parse`. `ids` is filled with
+/// the schema of each line.
+size_t exyz_python_batch_schemas_count(const exyz_python_batch_t* batch);
+void exyz_python_batch_schema_ids(const exyz_python_batch_t* batch, int64_t* ids);
+const exyz_atom_property_t* exyz_python_batch_schema(const exyz_python_batch_t* batch, size_t schema, size_t* count);
+
+/// Read up to `max_frames` frames from `reader` into a new batch. The batch is
+/// empty once all frames have been read.
+exyz_status_t exyz_python_batch_read(exyz_reader_t* reader, size_t max_frames, exyz_python_batch_t** batch);
+
+/// Number of lines or frames in the batch
+size_t exyz_python_batch_count(const exyz_python_batch_t* batch);
+
+/// Access the data of a single frame for batches created by
+/// `exyz_python_batch_read`.
+size_t exyz_python_batch_n_atoms(const exyz_python_batch_t* batch, size_t frame);
+exyz_info_t* exyz_python_batch_info(const exyz_python_batch_t* batch, size_t frame, size_t* count);
+exyz_atom_array_t* exyz_python_batch_arrays(const exyz_python_batch_t* batch, size_t frame, size_t* count);
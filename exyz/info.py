@@ -1,18 +1,29 @@
+from collections.abc import Mapping
+
 import numpy as np
 
 from ._exyz import ffi, lib
+from .errors import _last_error
+
 
+class Info(Mapping):
+    """
+    Frame properties, behaving like a read-only dict. Values are converted to
+    Python objects the first time they are accessed, and then cached.
+    """
 
-class Info:
     def __init__(self, ptr, count):
         self._ptr = ptr
         self._count = count
+        self._keys = None
+        self._index = None
+        self._values = {}
 
     def __del__(self):
         for i in range(self.count):
             lib.exyz_info_free(self.ptr[i])
 
-        lib.free(self.ptr)
+        lib.exyz_free(self.ptr)
 
     @property
     def ptr(self):
@@ -22,60 +33,151 @@ class Info:
     def count(self):
         return self._count[0]
 
-    def to_dict(self):
-        output = {}
+    def __len__(self):
+        return self.count
 
-        for i in range(self.count):
-            key = ffi.string(self.ptr[i].key).decode("utf8")
-
-            kind = self.ptr[i].type
-            if kind == lib.EXYZ_INTEGER:
-                value = self.ptr[i].data.integer
-            elif kind == lib.EXYZ_REAL:
-                value = self.ptr[i].data.real
-            elif kind == lib.EXYZ_BOOL:
-                value = self.ptr[i].data.boolean
-            elif kind == lib.EXYZ_STRING:
-                value = ffi.string(self.ptr[i].data.string).decode("utf8")
-            else:
-                assert kind == lib.EXYZ_ARRAY
-                value = _read_array(self.ptr[i].data.array)
+    def __iter__(self):
+        if self._keys is None:
+            ptr = self.ptr
+            self._keys = [ffi.string(ptr[i].key).decode("utf8") for i in range(self.count)]
+        return iter(self._keys)
+
+    def __contains__(self, key):
+        return self._find(key) >= 0
+
+    def __getitem__(self, key):
+        try:
+            return self._values[key]
+        except KeyError:
+            pass
+
+        index = self._find(key)
+        if index < 0:
+            raise KeyError(key)
+
+        value = _info_value(self.ptr[index], owner=self)
+        self._values[key] = value
+        return value
+
+    def _find(self, key):
+        if not isinstance(key, str):
+            return -1
 
+        if self._index is None:
+            self._index = _keys_index(lib.exyz_info_index, self.ptr, self.count)
+        return lib.exyz_keys_index_find(self._index, key.encode("utf8"))
+
+    def to_dict(self):
+        """
+        Get the info as a dictionary. Numeric arrays share memory with this
+        object, which is kept alive as long as the arrays are.
+        """
+        ptr = self.ptr
+        output = {}
+        for i, key in enumerate(self):
+            if key in output:
+                # same as __getitem__ for duplicated keys
+                continue
+
+            value = self._values.get(key)
+            if value is None:
+                value = _info_value(ptr[i], owner=self)
+                self._values[key] = value
             output[key] = value
 
         return output
 
 
-def _read_array(array):
-    if array.type == lib.EXYZ_STRING:
-        np_array = np.zeros((array.nrows, array.ncols), dtype=np.str)
-        index = 0
-        for i in range(array.nrows):
-            for j in range(array.ncols):
-                np_array[i, j] = ffi.string(array.data.string[index]).decode("utf8")
-                index += 1
-
+def _keys_index(create, ptr, count):
+    """
+    Create an index of the keys in the list at ``ptr`` with the ``create``
+    function from the C library
+    """
+    index = ffi.new("exyz_keys_index_t**")
+    status = create(ptr, count, index)
+    if status != lib.EXYZ_SUCCESS:
+        raise _last_error("failed to create the index of keys")
+
+    return ffi.gc(index[0], lib.exyz_keys_index_free)
+
+
+def _info_value(info, owner):
+    """Convert the value of a single ``exyz_info_t`` to a Python object"""
+    kind = info.type
+    if kind == lib.EXYZ_INTEGER:
+        return info.data.integer
+    elif kind == lib.EXYZ_REAL:
+        return info.data.real
+    elif kind == lib.EXYZ_BOOL:
+        return info.data.boolean
+    elif kind == lib.EXYZ_STRING:
+        return ffi.string(info.data.string).decode("utf8")
+    else:
+        assert kind == lib.EXYZ_ARRAY
+        return _read_array(ffi.addressof(info.data, "array"), owner)
+
+
+def _info_to_dict(ptr, count, owner):
+    """
+    Convert ``count`` ``exyz_info_t`` starting at ``ptr`` to a dict. ``owner``
+    is kept alive as long as the numpy arrays sharing memory with ``ptr``.
+    """
+    output = {}
+    for i in range(count):
+        key = ffi.string(ptr[i].key).decode("utf8")
+        output[key] = _info_value(ptr[i], owner)
+
+    return output
+
+
+_DTYPES = {
+    lib.EXYZ_INTEGER: np.dtype(np.int64),
+    lib.EXYZ_REAL: np.dtype(np.float64),
+    lib.EXYZ_BOOL: np.dtype(np.bool_),
+}
+
+
+class _CArray:
+    """
+    Expose C memory to numpy through the array interface. numpy keeps this
+    object as the ``base`` of the array, which in turn keeps ``owner`` (the
+    object responsible for freeing the memory) alive.
+    """
+
+    def __init__(self, ptr, shape, dtype, owner):
+        self.__array_interface__ = {
+            "version": 3,
+            "shape": shape,
+            "typestr": dtype.str,
+            "data": (int(ffi.cast("uintptr_t", ptr)), False),
+        }
+        self._owner = owner
+
+
+def _read_array(array, owner, shape=None):
+    """
+    Create a numpy array from the ``exyz_array_t*`` ``array``. Numeric arrays
+    point to the C memory without copies, and ``owner`` is kept alive as long
+    as the numpy array exists. String arrays are converted to fixed-width
+    unicode arrays.
+
+    By default, arrays with a single row are returned as 1-dimensional arrays.
+    """
+    if shape is None:
         if array.nrows == 1:
-            return np_array.reshape(-1)
+            shape = (array.ncols,)
         else:
-            return np_array
-
-    if array.type == lib.EXYZ_INTEGER:
-        sizeof = ffi.sizeof("int64_t")
-        ptr = array.data.integer
-        dtype = np.int64
-    elif array.type == lib.EXYZ_REAL:
-        sizeof = ffi.sizeof("double")
-        ptr = array.data.real
-        dtype = np.float64
-    elif array.type == lib.EXYZ_BOOL:
-        sizeof = ffi.sizeof("bool")
-        ptr = array.data.boolean
-        dtype = np.bool8
-
-    buffer = ffi.buffer(ptr, array.nrows * array.ncols * sizeof)
-    np_array = np.frombuffer(buffer, dtype=dtype)
-    if array.nrows != 1:
-        np_array = np_array.reshape(array.nrows, array.ncols)
-
-    return np.copy(np_array)
+            shape = (array.nrows, array.ncols)
+
+    if array.type == lib.EXYZ_STRING:
+        width = max(lib.exyz_python_strings_width(array), 1)
+        np_array = np.empty(shape, dtype=f"U{width}")
+        output = ffi.from_buffer("uint32_t[]", np_array, require_writable=True)
+        lib.exyz_python_strings_to_ucs4(array, output, width)
+        return np_array
+
+    dtype = _DTYPES[array.type]
+    if array.nrows * array.ncols == 0:
+        return np.empty(shape, dtype=dtype)
+
+    return np.asarray(_CArray(array.data.integer, shape, dtype, owner))
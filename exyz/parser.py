@@ -1,7 +1,12 @@
+import os
+
+import numpy as np
+
 from ._exyz import ffi, lib
 
-from .info import Info
-from .properties import Properties
+from .errors import _last_error
+from .info import Info, _DTYPES
+from .properties import Properties, _properties_to_dict
 
 
 def parse_comment_line(line):
@@ -18,9 +23,121 @@ def parse_comment_line(line):
     )
 
     if status != lib.EXYZ_SUCCESS:
-        raise Exception("failed to parse comment line")
+        raise _last_error("failed to parse comment line")
 
     properties = Properties(properties_ptr, properties_count)
     info = Info(info_ptr, info_count)
 
     return properties, info
+
+
+def parse_comment_lines(lines, offsets=None, threads=None):
+    """
+    Parse multiple comment lines at once. All lines are parsed in a single
+    call to the C library, which does not hold the GIL and can use multiple
+    threads.
+
+    :param lines: either a list of ``str``, or a bytes-like object containing
+        the UTF-8 encoded lines one after the other
+    :param offsets: when ``lines`` is a bytes-like object, array containing the
+        start of each line in ``lines``, with one additional entry for the end
+        of the last line. Lines can end with a new line character.
+    :param threads: number of threads to use, defaults to the number of CPUs
+
+    :return: a tuple ``(properties, info)``. ``properties`` contains one dict
+        per line, shared between lines with the same Properties. ``info`` is a
+        dict containing one numpy array per key, with the values for all lines.
+        If some lines do not contain a key, the corresponding array is a masked
+        array, with the missing values masked.
+    """
+    if offsets is None:
+        encoded = [line.encode("utf8") for line in lines]
+        offsets = np.zeros(len(encoded) + 1, dtype=np.int64)
+        np.cumsum([len(line) for line in encoded], out=offsets[1:])
+        data = b"".join(encoded)
+    else:
+        data = lines
+        offsets = np.ascontiguousarray(offsets, dtype=np.int64)
+        if offsets.ndim != 1 or len(offsets) == 0:
+            raise ValueError("offsets must be a 1-dimensional array with at least one entry")
+        if np.any(np.diff(offsets) < 0) or offsets[0] < 0 or offsets[-1] > len(memoryview(data).cast("B")):
+            raise ValueError("offsets must be increasing and inside the data")
+
+    count = len(offsets) - 1
+    if threads is None:
+        threads = os.cpu_count() or 1
+
+    batch_ptr = ffi.new("exyz_python_batch_t**")
+    failed = ffi.new("size_t*")
+    status = lib.exyz_python_batch_parse(
+        ffi.from_buffer(data),
+        ffi.from_buffer("int64_t[]", offsets),
+        count,
+        threads,
+        batch_ptr,
+        failed,
+    )
+
+    if status != lib.EXYZ_SUCCESS:
+        if failed[0] < count:
+            raise _last_error(f"failed to parse comment line {failed[0]}")
+        else:
+            raise _last_error("failed to parse comment lines")
+
+    batch = ffi.gc(batch_ptr[0], lib.exyz_python_batch_free)
+
+    info = _batch_info_columns(batch, count)
+
+    schemas = []
+    for i in range(lib.exyz_python_batch_schemas_count(batch)):
+        schema_count = ffi.new("size_t*")
+        ptr = lib.exyz_python_batch_schema(batch, i, schema_count)
+        schemas.append(_properties_to_dict(ptr, schema_count[0]))
+
+    ids = np.empty(count, dtype=np.int64)
+    lib.exyz_python_batch_schema_ids(batch, ffi.from_buffer("int64_t[]", ids, require_writable=True))
+    properties = [schemas[i] for i in ids.tolist()]
+
+    return properties, info
+
+
+def _batch_info_columns(batch, count):
+    """Get the info of all lines or frames in ``batch`` as numpy arrays"""
+    info = {}
+    for i in range(lib.exyz_python_batch_columns_count(batch)):
+        column = lib.exyz_python_batch_column(batch, i)
+        key = ffi.string(column.key).decode("utf8")
+
+        if column.type == lib.EXYZ_ARRAY:
+            dtype = _column_dtype(column.array_type, column.width)
+            if column.nrows == 1:
+                shape = (count, column.ncols)
+            else:
+                shape = (count, column.nrows, column.ncols)
+        else:
+            dtype = _column_dtype(column.type, column.width)
+            shape = (count,)
+
+        values = np.empty(shape, dtype=dtype)
+        mask = np.empty(count, dtype=np.bool_)
+        lib.exyz_python_batch_fill_column(
+            batch,
+            i,
+            ffi.from_buffer(values, require_writable=True),
+            ffi.from_buffer("bool[]", mask, require_writable=True),
+        )
+
+        if column.missing != 0:
+            mask = mask.reshape((count,) + (1,) * (len(shape) - 1))
+            values = np.ma.MaskedArray(values, mask=np.broadcast_to(mask, shape))
+
+        info[key] = values
+
+    return info
+
+
+def _column_dtype(kind, width):
+    if kind == lib.EXYZ_STRING:
+        return np.dtype(f"U{width}")
+    else:
+        return _DTYPES[kind]
@@ -1,10 +1,20 @@
+from collections.abc import Mapping
+
 from ._exyz import ffi, lib
+from .info import _keys_index
+
 
+class Properties(Mapping):
+    """
+    Atom properties from the comment line, behaving like a read-only dict
+    mapping the name of each property to its type and number of columns.
+    """
 
-class Properties:
     def __init__(self, ptr, count):
         self._ptr = ptr
         self._count = count
+        self._keys = None
+        self._index = None
 
     @property
     def ptr(self):
@@ -18,27 +28,64 @@ class Properties:
         for i in range(self.count):
             lib.exyz_atom_property_free(self.ptr[i])
 
-        lib.free(self.ptr)
+        lib.exyz_free(self.ptr)
+
+    def __len__(self):
+        return self.count
+
+    def __iter__(self):
+        if self._keys is None:
+            ptr = self.ptr
+            self._keys = [ffi.string(ptr[i].key).decode("utf8") for i in range(self.count)]
+        return iter(self._keys)
+
+    def __contains__(self, key):
+        return self._find(key) >= 0
+
+    def __getitem__(self, key):
+        index = self._find(key)
+        if index < 0:
+            raise KeyError(key)
+        return _property_value(self.ptr[index])
+
+    def _find(self, key):
+        if not isinstance(key, str):
+            return -1
+
+        if self._index is None:
+            self._index = _keys_index(lib.exyz_atom_properties_index, self.ptr, self.count)
+        return lib.exyz_keys_index_find(self._index, key.encode("utf8"))
 
     def to_dict(self):
+        ptr = self.ptr
         output = {}
-
-        for i in range(self.count):
-            key = ffi.string(self.ptr[i].key).decode("utf8")
-            count = self.ptr[i].count
-            kind = self.ptr[i].type
-            if kind == lib.EXYZ_INTEGER:
-                kind = "integer"
-            elif kind == lib.EXYZ_REAL:
-                kind = "real"
-            elif kind == lib.EXYZ_BOOL:
-                kind = "bool"
-            elif kind == lib.EXYZ_STRING:
-                kind = "string"
-
-            output[key] = {
-                "type": kind,
-                "count": count,
-            }
+        for i, key in enumerate(self):
+            if key not in output:
+                output[key] = _property_value(ptr[i])
 
         return output
+
+
+_KINDS = {
+    lib.EXYZ_INTEGER: "integer",
+    lib.EXYZ_REAL: "real",
+    lib.EXYZ_BOOL: "bool",
+    lib.EXYZ_STRING: "string",
+}
+
+
+def _property_value(property):
+    return {
+        "type": _KINDS[property.type],
+        "count": property.count,
+    }
+
+
+def _properties_to_dict(ptr, count):
+    """Convert ``count`` ``exyz_atom_property_t`` starting at ``ptr`` to a dict"""
+    output = {}
+    for i in range(count):
+        key = ffi.string(ptr[i].key).decode("utf8")
+        output[key] = _property_value(ptr[i])
+
+    return output
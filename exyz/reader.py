@@ -0,0 +1,242 @@
+import os
+import queue
+import threading
+
+import numpy as np
+
+from ._exyz import ffi, lib
+
+from .errors import _last_error
+from .info import _info_to_dict, _read_array
+from .parser import _batch_info_columns
+
+
+def iread(
+    path,
+    batch=None,
+    prefetch=True,
+    properties=None,
+    frames=None,
+    atomic_numbers=None,
+    unknown_species=None,
+):
+    """
+    Iterate over the frames in the file at ``path``, which can be compressed
+    with gzip, xz or zstd. The file is read incrementally, so memory usage does
+    not depend on the size of the file.
+
+    If ``batch`` is ``None``, this yields one dict per frame, containing
+    ``"n_atoms"``, ``"info"`` (the frame properties) and ``"arrays"`` (the atom
+    properties). Numeric atom properties share memory with the C library.
+
+    Otherwise, this yields dicts containing up to ``batch`` frames, with the
+    data stored by columns: ``"n_atoms"`` is an array with the number of atoms
+    in each frame, ``"info"`` contains one array per key with the values for
+    all frames, and ``"arrays"`` contains one array per atom property, with
+    the atoms of all frames one after the other.
+
+    The file is read and parsed without holding the GIL, and if ``prefetch``
+    is ``True`` the next frames are read on a background thread while the
+    current ones are being used.
+
+    If ``properties`` is a list of atom property names (e.g. ``["pos"]``),
+    only these are included in ``"arrays"``, and the values of other atom
+    properties are skipped without being parsed.
+
+    ``frames`` can be a ``slice`` with non-negative ``start`` and ``stop``
+    selecting which frames to read, e.g. ``slice(None, None, 100)`` for every
+    100th frame. Other frames are skipped without being parsed.
+
+    If ``atomic_numbers`` is the name of a string atom property (e.g.
+    ``"species"``), its values are converted to atomic numbers while parsing,
+    and returned in an integer array. Labels which are not element symbols
+    raise an error, unless ``unknown_species`` gives the atomic number to use
+    for them.
+    """
+    if batch is not None and batch < 1:
+        raise ValueError("batch must be at least 1")
+
+    if frames is not None:
+        start = 0 if frames.start is None else frames.start
+        stop = frames.stop
+        step = 1 if frames.step is None else frames.step
+        if start < 0 or (stop is not None and stop < 0) or step < 1:
+            raise ValueError("frames must be a slice with non-negative start and stop, and positive step")
+
+        if stop is None:
+            stop = ffi.cast("size_t", -1)
+
+    reader_ptr = ffi.new("exyz_reader_t**")
+    status = lib.exyz_reader_open(reader_ptr, os.fsencode(path))
+    if status != lib.EXYZ_SUCCESS:
+        raise _last_error("failed to open trajectory")
+    reader = reader_ptr[0]
+
+    if properties is not None:
+        names = [ffi.new("char[]", name.encode("utf8")) for name in properties]
+        status = lib.exyz_reader_select_properties(reader, names, len(names))
+        if status != lib.EXYZ_SUCCESS:
+            lib.exyz_reader_close(reader)
+            raise _last_error("failed to select atom properties")
+
+    if atomic_numbers is not None:
+        strict = unknown_species is None
+        unknown = 0 if strict else unknown_species
+        status = lib.exyz_reader_set_atomic_numbers(reader, atomic_numbers.encode("utf8"), strict, unknown)
+        if status != lib.EXYZ_SUCCESS:
+            lib.exyz_reader_close(reader)
+            raise _last_error("failed to read atomic numbers")
+
+    if frames is not None:
+        status = lib.exyz_reader_set_stride(reader, start, stop, step)
+        if status != lib.EXYZ_SUCCESS:
+            lib.exyz_reader_close(reader)
+            raise _last_error("failed to select frames")
+
+    # read multiple frames in each call to the C library, even when they are
+    # given to the user one at a time
+    batch_size = batch if batch is not None else 16
+
+    if prefetch:
+        batches = _Prefetcher(reader, batch_size)
+    else:
+        batches = _read_batches(reader, batch_size)
+
+    try:
+        for current in batches:
+            if batch is None:
+                for frame in range(current.count):
+                    yield current.frame(frame)
+            else:
+                yield current.columns()
+    finally:
+        if prefetch:
+            batches.stop()
+        lib.exyz_reader_close(reader)
+
+
+class _Batch:
+    """Owner of the C memory for a batch of frames"""
+
+    def __init__(self, ptr):
+        self.ptr = ffi.gc(ptr, lib.exyz_python_batch_free)
+        self.count = lib.exyz_python_batch_count(self.ptr)
+
+    def frame(self, frame):
+        count = ffi.new("size_t*")
+
+        info = lib.exyz_python_batch_info(self.ptr, frame, count)
+        info = _info_to_dict(info, count[0], owner=self)
+
+        n_atoms = lib.exyz_python_batch_n_atoms(self.ptr, frame)
+        arrays = lib.exyz_python_batch_arrays(self.ptr, frame, count)
+        arrays = _arrays_to_dict(arrays, count[0], owner=self)
+
+        return {"n_atoms": n_atoms, "info": info, "arrays": arrays}
+
+    def columns(self):
+        n_atoms = np.array(
+            [lib.exyz_python_batch_n_atoms(self.ptr, i) for i in range(self.count)],
+            dtype=np.int64,
+        )
+
+        all_arrays = []
+        count = ffi.new("size_t*")
+        for frame in range(self.count):
+            arrays = lib.exyz_python_batch_arrays(self.ptr, frame, count)
+            all_arrays.append(_arrays_to_dict(arrays, count[0], owner=self))
+
+        arrays = {}
+        if len(all_arrays) != 0:
+            keys = all_arrays[0].keys()
+            for frame_arrays in all_arrays:
+                if frame_arrays.keys() != keys:
+                    raise ValueError("all frames in a batch must have the same atom properties")
+
+            for key in keys:
+                arrays[key] = np.concatenate([frame_arrays[key] for frame_arrays in all_arrays])
+
+        return {
+            "n_atoms": n_atoms,
+            "info": _batch_info_columns(self.ptr, self.count),
+            "arrays": arrays,
+        }
+
+
+def _arrays_to_dict(ptr, count, owner):
+    output = {}
+    for i in range(count):
+        array = ffi.addressof(ptr[i], "array")
+        if array.ncols == 1:
+            shape = (array.nrows,)
+        else:
+            shape = (array.nrows, array.ncols)
+
+        key = ffi.string(ptr[i].key).decode("utf8")
+        output[key] = _read_array(array, owner, shape)
+
+    return output
+
+
+def _read_batch(reader, batch_size):
+    batch_ptr = ffi.new("exyz_python_batch_t**")
+    status = lib.exyz_python_batch_read(reader, batch_size, batch_ptr)
+    if status != lib.EXYZ_SUCCESS:
+        raise _last_error("failed to read frames")
+
+    return _Batch(batch_ptr[0])
+
+
+def _read_batches(reader, batch_size):
+    while True:
+        batch = _read_batch(reader, batch_size)
+        if batch.count == 0:
+            return
+        yield batch
+
+
+class _Prefetcher:
+    """
+    Read batches on a background thread. At most one batch is waiting to be
+    used, so memory usage stays bounded.
+    """
+
+    def __init__(self, reader, batch_size):
+        self._queue = queue.Queue(maxsize=1)
+        self._stopped = threading.Event()
+        self._thread = threading.Thread(target=self._run, args=(reader, batch_size), daemon=True)
+        self._thread.start()
+
+    def _run(self, reader, batch_size):
+        try:
+            for batch in _read_batches(reader, batch_size):
+                if not self._put(batch):
+                    return
+        except Exception as e:
+            self._put(e)
+            return
+
+        self._put(None)
+
+    def _put(self, item):
+        while not self._stopped.is_set():
+            try:
+                self._queue.put(item, timeout=0.1)
+                return True
+            except queue.Full:
+                pass
+        return False
+
+    def __iter__(self):
+        while True:
+            item = self._queue.get()
+            if item is None:
+                return
+            elif isinstance(item, Exception):
+                raise item
+            yield item
+
+    def stop(self):
+        """Stop the background thread, and wait for it to finish"""
+        self._stopped.set()
+        self._thread.join()
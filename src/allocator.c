@@ -0,0 +1,206 @@
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "exyz.h"
+#include "internal.h"
+
+static void* default_malloc(void* data, size_t size) {
+    return malloc(size);
+}
+
+static void* default_realloc(void* data, void* ptr, size_t size) {
+    return realloc(ptr, size);
+}
+
+static void default_free(void* data, void* ptr) {
+    free(ptr);
+}
+
+static const exyz_allocator_t DEFAULT_ALLOCATOR = {
+    .malloc = default_malloc,
+    .realloc = default_realloc,
+    .free = default_free,
+    .data = NULL,
+};
+
+/// allocator used by threads which did not call `exyz_use_allocator`
+static exyz_allocator_t GLOBAL_ALLOCATOR = {
+    .malloc = default_malloc,
+    .realloc = default_realloc,
+    .free = default_free,
+    .data = NULL,
+};
+
+/// allocator selected by the current thread, or NULL to use the global one
+static _Thread_local const exyz_allocator_t* THREAD_ALLOCATOR = NULL;
+
+void exyz_set_allocator(const exyz_allocator_t* allocator) {
+    if (allocator == NULL) {
+        GLOBAL_ALLOCATOR = DEFAULT_ALLOCATOR;
+    } else {
+        GLOBAL_ALLOCATOR = *allocator;
+    }
+}
+
+const exyz_allocator_t* exyz_use_allocator(const exyz_allocator_t* allocator) {
+    const exyz_allocator_t* previous = THREAD_ALLOCATOR;
+    THREAD_ALLOCATOR = allocator;
+    return previous;
+}
+
+const exyz_allocator_t* exyz_current_allocator(void) {
+    if (THREAD_ALLOCATOR != NULL) {
+        return THREAD_ALLOCATOR;
+    }
+    return &GLOBAL_ALLOCATOR;
+}
+
+/******************************************************************************/
+/*                  Allocation functions used by the library                  */
+/******************************************************************************/
+
+static void count_allocation(size_t size) {
+    exyz_stats_t* stats = exyz_current_stats;
+    if (stats != NULL) {
+        stats->allocations += 1;
+        stats->allocated_bytes += size;
+    }
+}
+
+void* exyz_malloc(size_t size) {
+    count_allocation(size);
+    const exyz_allocator_t* allocator = exyz_current_allocator();
+    return allocator->malloc(allocator->data, size);
+}
+
+void* exyz_calloc(size_t count, size_t size) {
+    if (size != 0 && count > SIZE_MAX / size) {
+        return NULL;
+    }
+
+    void* ptr = exyz_malloc(count * size);
+    if (ptr != NULL) {
+        memset(ptr, 0, count * size);
+    }
+    return ptr;
+}
+
+void* exyz_realloc(void* ptr, size_t size) {
+    if (ptr == NULL) {
+        return exyz_malloc(size);
+    }
+
+    count_allocation(size);
+    const exyz_allocator_t* allocator = exyz_current_allocator();
+    return allocator->realloc(allocator->data, ptr, size);
+}
+
+char* exyz_strdup(const char* string) {
+    size_t size = strlen(string);
+    char* copy = exyz_malloc(size + 1);
+    if (copy != NULL) {
+        memcpy(copy, string, size + 1);
+    }
+    return copy;
+}
+
+char* exyz_strndup(const char* string, size_t size) {
+    const char* end = memchr(string, '\0', size);
+    if (end != NULL) {
+        size = (size_t)(end - string);
+    }
+
+    char* copy = exyz_malloc(size + 1);
+    if (copy != NULL) {
+        memcpy(copy, string, size);
+        copy[size] = '\0';
+    }
+    return copy;
+}
+
+void exyz_free(void* ptr) {
+    if (ptr != NULL) {
+        const exyz_allocator_t* allocator = exyz_current_allocator();
+        allocator->free(allocator->data, ptr);
+    }
+}
+
+/******************************************************************************/
+/*                           Counting allocator                               */
+/******************************************************************************/
+
+/// each allocation starts with a header storing its size, padded to keep the
+/// user data aligned
+typedef union counting_header_t {
+    size_t size;
+    max_align_t align;
+} counting_header_t;
+
+static void count_bytes(exyz_allocation_counts_t* counts, size_t allocated, size_t freed) {
+    if (allocated != 0) {
+        __atomic_fetch_add(&counts->allocated_bytes, allocated, __ATOMIC_RELAXED);
+    }
+
+    uint64_t current = 0;
+    if (allocated >= freed) {
+        current = __atomic_add_fetch(&counts->current_bytes, allocated - freed, __ATOMIC_RELAXED);
+    } else {
+        current = __atomic_sub_fetch(&counts->current_bytes, freed - allocated, __ATOMIC_RELAXED);
+    }
+
+    uint64_t peak = __atomic_load_n(&counts->peak_bytes, __ATOMIC_RELAXED);
+    while (current > peak) {
+        if (__atomic_compare_exchange_n(&counts->peak_bytes, &peak, current, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+}
+
+static void* counting_malloc(void* data, size_t size) {
+    exyz_allocation_counts_t* counts = data;
+    counting_header_t* header = malloc(sizeof(counting_header_t) + size);
+    if (header == NULL) {
+        return NULL;
+    }
+    header->size = size;
+
+    __atomic_fetch_add(&counts->allocations, 1, __ATOMIC_RELAXED);
+    count_bytes(counts, size, 0);
+    return header + 1;
+}
+
+static void* counting_realloc(void* data, void* ptr, size_t size) {
+    exyz_allocation_counts_t* counts = data;
+    counting_header_t* header = (counting_header_t*)ptr - 1;
+    size_t previous = header->size;
+
+    header = realloc(header, sizeof(counting_header_t) + size);
+    if (header == NULL) {
+        return NULL;
+    }
+    header->size = size;
+
+    // reallocation replaces the previous block with a new one
+    __atomic_fetch_add(&counts->allocations, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&counts->frees, 1, __ATOMIC_RELAXED);
+    count_bytes(counts, size, previous);
+    return header + 1;
+}
+
+static void counting_free(void* data, void* ptr) {
+    exyz_allocation_counts_t* counts = data;
+    counting_header_t* header = (counting_header_t*)ptr - 1;
+
+    __atomic_fetch_add(&counts->frees, 1, __ATOMIC_RELAXED);
+    count_bytes(counts, 0, header->size);
+    free(header);
+}
+
+void exyz_counting_allocator(exyz_allocator_t* allocator, exyz_allocation_counts_t* counts) {
+    memset(counts, 0, sizeof(exyz_allocation_counts_t));
+    allocator->malloc = counting_malloc;
+    allocator->realloc = counting_realloc;
+    allocator->free = counting_free;
+    allocator->data = counts;
+}
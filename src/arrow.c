@@ -0,0 +1,1076 @@
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include <pthread.h>
+
+#include "exyz.h"
+#include "internal.h"
+#include "exyz_arrow.h"
+
+static exyz_status_t error(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    exyz_status_t status = exyz_set_error(format, args);
+    va_end(args);
+
+    return status;
+}
+
+/******************************************************************************/
+/*                           Memory management                                */
+/******************************************************************************/
+
+/// Frame data shared by all the arrays exported from this frame. Consumers
+/// can move children out of the top-level array and release them separately,
+/// so the data is freed when the last array using it is released.
+typedef struct shared_frame_t {
+    pthread_mutex_t mutex;
+    size_t refcount;
+    exyz_atom_array_t* arrays;
+    size_t arrays_count;
+} shared_frame_t;
+
+static shared_frame_t* shared_retain(shared_frame_t* shared) {
+    if (shared != NULL) {
+        pthread_mutex_lock(&shared->mutex);
+        shared->refcount += 1;
+        pthread_mutex_unlock(&shared->mutex);
+    }
+    return shared;
+}
+
+static void shared_release(shared_frame_t* shared) {
+    if (shared == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&shared->mutex);
+    assert(shared->refcount > 0);
+    shared->refcount -= 1;
+    size_t refcount = shared->refcount;
+    pthread_mutex_unlock(&shared->mutex);
+
+    if (refcount == 0) {
+        for (size_t i=0; i<shared->arrays_count; i++) {
+            exyz_atom_array_free(shared->arrays[i]);
+        }
+        exyz_free(shared->arrays);
+        pthread_mutex_destroy(&shared->mutex);
+        exyz_free(shared);
+    }
+}
+
+/// private data for exported arrays
+typedef struct array_data_t {
+    shared_frame_t* shared;
+    const void* buffers[3];
+    /// buffers allocated for this array, freed on release
+    void* owned[3];
+    struct ArrowArray* children_data;
+    struct ArrowArray** children;
+    struct ArrowArray dictionary;
+    /// allocator in use when the array was exported, since consumers can
+    /// release arrays from any thread
+    exyz_allocator_t allocator;
+} array_data_t;
+
+static void release_array(struct ArrowArray* array) {
+    array_data_t* data = array->private_data;
+    exyz_allocator_t allocator = data->allocator;
+    const exyz_allocator_t* previous_allocator = exyz_use_allocator(&allocator);
+    for (int64_t i=0; i<array->n_children; i++) {
+        struct ArrowArray* child = data->children[i];
+        if (child->release != NULL) {
+            child->release(child);
+        }
+    }
+
+    if (data->dictionary.release != NULL) {
+        data->dictionary.release(&data->dictionary);
+    }
+
+    for (size_t i=0; i<3; i++) {
+        exyz_free(data->owned[i]);
+    }
+
+    shared_release(data->shared);
+    exyz_free(data->children_data);
+    exyz_free(data->children);
+    exyz_free(data);
+
+    exyz_use_allocator(previous_allocator);
+    array->release = NULL;
+}
+
+/// initialize `array` with the given length and number of buffers/children.
+/// The children are zero-initialized, and must be filled by the caller.
+static exyz_status_t array_init(
+    struct ArrowArray* array,
+    int64_t length,
+    int64_t n_buffers,
+    int64_t n_children,
+    shared_frame_t* shared
+) {
+    assert(n_buffers <= 3);
+    memset(array, 0, sizeof(struct ArrowArray));
+
+    array_data_t* data = exyz_calloc(1, sizeof(array_data_t));
+    if (data == NULL) {
+        return error("failed to allocate memory");
+    }
+    data->allocator = *exyz_current_allocator();
+
+    if (n_children != 0) {
+        data->children_data = exyz_calloc((size_t)n_children, sizeof(struct ArrowArray));
+        data->children = exyz_calloc((size_t)n_children, sizeof(struct ArrowArray*));
+        if (data->children_data == NULL || data->children == NULL) {
+            exyz_free(data->children_data);
+            exyz_free(data->children);
+            exyz_free(data);
+            return error("failed to allocate memory");
+        }
+
+        for (int64_t i=0; i<n_children; i++) {
+            data->children[i] = &data->children_data[i];
+        }
+    }
+
+    data->shared = shared_retain(shared);
+
+    array->length = length;
+    array->n_buffers = n_buffers;
+    array->n_children = n_children;
+    array->buffers = data->buffers;
+    array->children = data->children;
+    array->release = release_array;
+    array->private_data = data;
+
+    return EXYZ_SUCCESS;
+}
+
+/// private data for exported schemas
+typedef struct schema_data_t {
+    char* format;
+    char* name;
+    struct ArrowSchema* children_data;
+    struct ArrowSchema** children;
+    struct ArrowSchema dictionary;
+    /// allocator in use when the schema was exported
+    exyz_allocator_t allocator;
+} schema_data_t;
+
+static void release_schema(struct ArrowSchema* schema) {
+    schema_data_t* data = schema->private_data;
+    exyz_allocator_t allocator = data->allocator;
+    const exyz_allocator_t* previous_allocator = exyz_use_allocator(&allocator);
+    for (int64_t i=0; i<schema->n_children; i++) {
+        struct ArrowSchema* child = data->children[i];
+        if (child->release != NULL) {
+            child->release(child);
+        }
+    }
+
+    if (data->dictionary.release != NULL) {
+        data->dictionary.release(&data->dictionary);
+    }
+
+    exyz_free(data->format);
+    exyz_free(data->name);
+    exyz_free(data->children_data);
+    exyz_free(data->children);
+    exyz_free(data);
+
+    exyz_use_allocator(previous_allocator);
+    schema->release = NULL;
+}
+
+static exyz_status_t schema_init(
+    struct ArrowSchema* schema,
+    const char* format,
+    const char* name,
+    int64_t flags,
+    int64_t n_children
+) {
+    memset(schema, 0, sizeof(struct ArrowSchema));
+
+    schema_data_t* data = exyz_calloc(1, sizeof(schema_data_t));
+    if (data == NULL) {
+        return error("failed to allocate memory");
+    }
+    data->allocator = *exyz_current_allocator();
+
+    data->format = exyz_strdup(format);
+    data->name = exyz_strdup(name);
+    if (data->format == NULL || data->name == NULL) {
+        exyz_free(data->format);
+        exyz_free(data->name);
+        exyz_free(data);
+        return error("failed to allocate memory");
+    }
+
+    if (n_children != 0) {
+        data->children_data = exyz_calloc((size_t)n_children, sizeof(struct ArrowSchema));
+        data->children = exyz_calloc((size_t)n_children, sizeof(struct ArrowSchema*));
+        if (data->children_data == NULL || data->children == NULL) {
+            exyz_free(data->children_data);
+            exyz_free(data->children);
+            exyz_free(data->format);
+            exyz_free(data->name);
+            exyz_free(data);
+            return error("failed to allocate memory");
+        }
+
+        for (int64_t i=0; i<n_children; i++) {
+            data->children[i] = &data->children_data[i];
+        }
+    }
+
+    schema->format = data->format;
+    schema->name = data->name;
+    schema->flags = flags;
+    schema->n_children = n_children;
+    schema->children = data->children;
+    schema->release = release_schema;
+    schema->private_data = data;
+
+    return EXYZ_SUCCESS;
+}
+
+/// release both the schema and array if they have been initialized
+static void release_both(struct ArrowSchema* schema, struct ArrowArray* array) {
+    if (schema->release != NULL) {
+        schema->release(schema);
+    }
+    if (array->release != NULL) {
+        array->release(array);
+    }
+}
+
+/******************************************************************************/
+/*                               Buffers                                      */
+/******************************************************************************/
+
+/// pack `count` booleans in an Arrow bitmap
+static uint8_t* pack_bits(const bool* values, size_t count) {
+    uint8_t* bitmap = exyz_calloc((count + 7) / 8 + 1, 1);
+    if (bitmap == NULL) {
+        return NULL;
+    }
+
+    for (size_t i=0; i<count; i++) {
+        if (values[i]) {
+            bitmap[i / 8] |= (uint8_t)(1 << (i % 8));
+        }
+    }
+    return bitmap;
+}
+
+/// create the offsets and data buffers for Arrow utf8 arrays from `count`
+/// strings. NULL strings are exported as empty strings.
+static exyz_status_t utf8_buffers(char* const* strings, size_t count, int32_t** offsets_ptr, char** data_ptr) {
+    size_t total = 0;
+    for (size_t i=0; i<count; i++) {
+        if (strings[i] != NULL) {
+            total += strlen(strings[i]);
+        }
+    }
+
+    if (total > INT32_MAX) {
+        return error("strings are too large to be exported to Arrow");
+    }
+
+    int32_t* offsets = exyz_malloc((count + 1) * sizeof(int32_t));
+    char* data = exyz_malloc(total + 1);
+    if (offsets == NULL || data == NULL) {
+        exyz_free(offsets);
+        exyz_free(data);
+        return error("failed to allocate memory");
+    }
+
+    size_t position = 0;
+    for (size_t i=0; i<count; i++) {
+        offsets[i] = (int32_t)position;
+        if (strings[i] != NULL) {
+            size_t length = strlen(strings[i]);
+            memcpy(data + position, strings[i], length);
+            position += length;
+        }
+    }
+    offsets[count] = (int32_t)position;
+
+    *offsets_ptr = offsets;
+    *data_ptr = data;
+    return EXYZ_SUCCESS;
+}
+
+static uint64_t hash_string(const char* string) {
+    uint64_t hash = UINT64_C(0xcbf29ce484222325);
+    for (const char* c=string; *c != '\0'; c++) {
+        hash ^= (uint8_t)*c;
+        hash *= UINT64_C(0x100000001b3);
+    }
+    return hash;
+}
+
+/// Open addressing hash table from strings to their index in a separate array
+/// of strings, which is owned by the caller.
+typedef struct string_table_t {
+    int32_t* slots;
+    size_t size;
+} string_table_t;
+
+/// create a table which can contain up to `count` strings
+static exyz_status_t string_table_init(string_table_t* table, size_t count) {
+    table->size = 16;
+    while (table->size < 2 * count) {
+        table->size *= 2;
+    }
+
+    table->slots = exyz_malloc(table->size * sizeof(int32_t));
+    if (table->slots == NULL) {
+        return error("failed to allocate memory");
+    }
+
+    for (size_t i=0; i<table->size; i++) {
+        table->slots[i] = -1;
+    }
+    return EXYZ_SUCCESS;
+}
+
+/// get the index of `string` in `strings`, inserting it at position `*count`
+/// in `strings` if it is not already there. NULL is stored as an empty string.
+static int32_t string_table_insert(string_table_t* table, const char** strings, size_t* count, const char* string) {
+    if (string == NULL) {
+        string = "";
+    }
+
+    size_t slot = (size_t)hash_string(string) & (table->size - 1);
+    while (table->slots[slot] != -1 && strcmp(strings[table->slots[slot]], string) != 0) {
+        slot = (slot + 1) & (table->size - 1);
+    }
+
+    if (table->slots[slot] == -1) {
+        table->slots[slot] = (int32_t)*count;
+        strings[*count] = string;
+        *count += 1;
+    }
+    return table->slots[slot];
+}
+
+/// dictionary-encode `count` strings, setting `indexes` to the index of each
+/// string in the `unique` array of `unique_count` strings. The strings in
+/// `unique` are borrowed from `strings`.
+static exyz_status_t dictionary_encode(
+    char* const* strings,
+    size_t count,
+    int32_t** indexes_ptr,
+    char*** unique_ptr,
+    size_t* unique_count
+) {
+    string_table_t table;
+    exyz_status_t status = string_table_init(&table, count);
+    if (status != EXYZ_SUCCESS) {
+        return status;
+    }
+
+    int32_t* indexes = exyz_malloc((count + 1) * sizeof(int32_t));
+    const char** unique = exyz_malloc((count + 1) * sizeof(char*));
+    if (indexes == NULL || unique == NULL) {
+        exyz_free(table.slots);
+        exyz_free(indexes);
+        exyz_free(unique);
+        return error("failed to allocate memory");
+    }
+
+    *unique_count = 0;
+    for (size_t i=0; i<count; i++) {
+        indexes[i] = string_table_insert(&table, unique, unique_count, strings[i]);
+    }
+
+    exyz_free(table.slots);
+    *indexes_ptr = indexes;
+    *unique_ptr = (char**)unique;
+    return EXYZ_SUCCESS;
+}
+
+/******************************************************************************/
+/*                            Atom properties                                 */
+/******************************************************************************/
+
+/// used as data buffer for empty arrays, since Arrow buffers should not be NULL
+static const int64_t EMPTY_BUFFER[1] = {0};
+
+/// create the schema for flat values of the given `type`. Strings are
+/// dictionary-encoded.
+static exyz_status_t values_schema(exyz_data_t type, const char* name, struct ArrowSchema* schema) {
+    const char* format = NULL;
+    switch (type) {
+    case EXYZ_INTEGER:
+        format = "l";
+        break;
+    case EXYZ_REAL:
+        format = "g";
+        break;
+    case EXYZ_BOOL:
+        format = "b";
+        break;
+    case EXYZ_STRING:
+        // dictionary indexes
+        format = "i";
+        break;
+    case EXYZ_ARRAY:
+        return error("invalid array type");
+    }
+
+    exyz_status_t status = schema_init(schema, format, name, 0, 0);
+    if (status != EXYZ_SUCCESS || type != EXYZ_STRING) {
+        return status;
+    }
+
+    schema_data_t* schema_data = schema->private_data;
+    status = schema_init(&schema_data->dictionary, "u", "", 0, 0);
+    if (status != EXYZ_SUCCESS) {
+        schema->release(schema);
+        return status;
+    }
+    schema->dictionary = &schema_data->dictionary;
+
+    return EXYZ_SUCCESS;
+}
+
+/// create the schema for a single atom property, using a fixed-size list for
+/// properties with more than one column
+static exyz_status_t property_schema(const exyz_atom_property_t* property, struct ArrowSchema* schema) {
+    if (property->count == 1) {
+        return values_schema(property->type, property->key, schema);
+    }
+
+    char format[32];
+    snprintf(format, sizeof(format), "+w:%zu", property->count);
+    exyz_status_t status = schema_init(schema, format, property->key, 0, 1);
+    if (status != EXYZ_SUCCESS) {
+        return status;
+    }
+
+    status = values_schema(property->type, "item", schema->children[0]);
+    if (status != EXYZ_SUCCESS) {
+        schema->release(schema);
+        return status;
+    }
+
+    return EXYZ_SUCCESS;
+}
+
+/// create the schema of the struct array containing all atom properties
+static exyz_status_t atoms_schema(const exyz_atom_property_t* properties, size_t count, struct ArrowSchema* schema) {
+    exyz_status_t status = schema_init(schema, "+s", "", 0, (int64_t)count);
+    if (status != EXYZ_SUCCESS) {
+        return status;
+    }
+
+    for (size_t i=0; i<count; i++) {
+        status = property_schema(&properties[i], schema->children[i]);
+        if (status != EXYZ_SUCCESS) {
+            schema->release(schema);
+            return status;
+        }
+    }
+
+    return EXYZ_SUCCESS;
+}
+
+/// describe the atom property in `array`, borrowing its key
+static exyz_atom_property_t array_property(const exyz_atom_array_t* array) {
+    exyz_atom_property_t property;
+    property.key = array->key;
+    property.type = array->array.type;
+    property.count = array->array.ncols;
+    return property;
+}
+
+/// export the `count` values in `values` as a flat Arrow array
+static exyz_status_t export_values(
+    const exyz_array_t* values,
+    size_t count,
+    shared_frame_t* shared,
+    struct ArrowArray* array
+) {
+    exyz_status_t status = array_init(array, (int64_t)count, 2, 0, shared);
+    if (status != EXYZ_SUCCESS) {
+        return status;
+    }
+    array_data_t* data = array->private_data;
+
+    if (values->type == EXYZ_INTEGER || values->type == EXYZ_REAL) {
+        // no copy, the data is kept alive by the shared frame
+        data->buffers[1] = values->data.real;
+        if (data->buffers[1] == NULL) {
+            data->buffers[1] = EMPTY_BUFFER;
+        }
+        return EXYZ_SUCCESS;
+    }
+
+    if (values->type == EXYZ_BOOL) {
+        // Arrow uses one bit per boolean, while we use one byte
+        data->owned[1] = pack_bits(values->data.boolean, count);
+        data->buffers[1] = data->owned[1];
+        if (data->owned[1] == NULL) {
+            array->release(array);
+            return error("failed to allocate memory");
+        }
+        return EXYZ_SUCCESS;
+    }
+
+    assert(values->type == EXYZ_STRING);
+    int32_t* indexes = NULL;
+    char** unique = NULL;
+    size_t unique_count = 0;
+    status = dictionary_encode(values->data.string, count, &indexes, &unique, &unique_count);
+    if (status != EXYZ_SUCCESS) {
+        array->release(array);
+        return status;
+    }
+    data->owned[1] = indexes;
+    data->buffers[1] = indexes;
+
+    status = array_init(&data->dictionary, (int64_t)unique_count, 3, 0, NULL);
+    if (status != EXYZ_SUCCESS) {
+        exyz_free(unique);
+        array->release(array);
+        return status;
+    }
+    array->dictionary = &data->dictionary;
+
+    array_data_t* dictionary = data->dictionary.private_data;
+    int32_t* offsets = NULL;
+    char* strings = NULL;
+    status = utf8_buffers(unique, unique_count, &offsets, &strings);
+    exyz_free(unique);
+    if (status != EXYZ_SUCCESS) {
+        array->release(array);
+        return status;
+    }
+    dictionary->owned[1] = offsets;
+    dictionary->owned[2] = strings;
+    dictionary->buffers[1] = offsets;
+    dictionary->buffers[2] = strings;
+
+    return EXYZ_SUCCESS;
+}
+
+/// export a single atom property, using a fixed-size list for properties with
+/// more than one column
+static exyz_status_t export_property(
+    const exyz_atom_array_t* property,
+    shared_frame_t* shared,
+    struct ArrowArray* array
+) {
+    const exyz_array_t* values = &property->array;
+    if (values->ncols == 1) {
+        return export_values(values, values->nrows, shared, array);
+    }
+
+    exyz_status_t status = array_init(array, (int64_t)values->nrows, 1, 1, shared);
+    if (status != EXYZ_SUCCESS) {
+        return status;
+    }
+
+    // atom arrays are stored in row-major order, so the values of the list
+    // are contiguous
+    status = export_values(values, values->nrows * values->ncols, shared, array->children[0]);
+    if (status != EXYZ_SUCCESS) {
+        array->release(array);
+        return status;
+    }
+
+    return EXYZ_SUCCESS;
+}
+
+/// export the atom properties of a frame as a struct array, taking ownership
+/// of `arrays` on success
+static exyz_status_t export_atoms(
+    size_t n_atoms,
+    exyz_atom_array_t* arrays,
+    size_t arrays_count,
+    struct ArrowArray* array
+) {
+    for (size_t i=0; i<arrays_count; i++) {
+        if (arrays[i].array.nrows != n_atoms) {
+            return error("invalid number of rows for '%s', expected %zu", arrays[i].key, n_atoms);
+        }
+    }
+
+    shared_frame_t* shared = exyz_calloc(1, sizeof(shared_frame_t));
+    if (shared == NULL) {
+        return error("failed to allocate memory");
+    }
+    pthread_mutex_init(&shared->mutex, NULL);
+
+    exyz_status_t status = array_init(array, (int64_t)n_atoms, 1, (int64_t)arrays_count, shared);
+    if (status != EXYZ_SUCCESS) {
+        pthread_mutex_destroy(&shared->mutex);
+        exyz_free(shared);
+        return status;
+    }
+
+    // the data is owned by the shared frame from here on, and freed when all
+    // arrays are released
+    shared->arrays = arrays;
+    shared->arrays_count = arrays_count;
+
+    for (size_t i=0; i<arrays_count; i++) {
+        status = export_property(&arrays[i], shared, array->children[i]);
+        if (status != EXYZ_SUCCESS) {
+            // give back ownership of the data to the caller
+            shared->arrays = NULL;
+            shared->arrays_count = 0;
+            array->release(array);
+            return status;
+        }
+    }
+
+    return EXYZ_SUCCESS;
+}
+
+exyz_status_t exyz_arrow_export_atoms(
+    size_t n_atoms,
+    exyz_atom_array_t* arrays,
+    size_t arrays_count,
+    struct ArrowSchema* schema,
+    struct ArrowArray* array
+) {
+    exyz_atom_property_t* properties = exyz_malloc((arrays_count + 1) * sizeof(exyz_atom_property_t));
+    if (properties == NULL) {
+        return error("failed to allocate memory");
+    }
+
+    for (size_t i=0; i<arrays_count; i++) {
+        properties[i] = array_property(&arrays[i]);
+    }
+
+    exyz_status_t status = atoms_schema(properties, arrays_count, schema);
+    exyz_free(properties);
+    if (status != EXYZ_SUCCESS) {
+        return status;
+    }
+
+    status = export_atoms(n_atoms, arrays, arrays_count, array);
+    if (status != EXYZ_SUCCESS) {
+        schema->release(schema);
+    }
+
+    return status;
+}
+
+/******************************************************************************/
+/*                           Multiple frames                                  */
+/******************************************************************************/
+
+/// private data for streams of atom properties
+typedef struct atoms_stream_t {
+    /// properties shared by all frames, with owned keys
+    exyz_atom_property_t* properties;
+    size_t properties_count;
+
+    size_t frames_count;
+    size_t* n_atoms;
+    exyz_atom_array_t** arrays;
+    size_t* arrays_count;
+    /// next frame to export, all frames before this one are owned by the
+    /// arrays given to the consumer
+    size_t next;
+
+    /// message of the last error, returned by `get_last_error`
+    char* last_error;
+    /// allocator in use when the stream was created
+    exyz_allocator_t allocator;
+} atoms_stream_t;
+
+/// free the frames which were not given to the consumer, and the stream data
+static void atoms_stream_free(atoms_stream_t* data) {
+    for (size_t frame=data->next; frame<data->frames_count; frame++) {
+        for (size_t i=0; i<data->arrays_count[frame]; i++) {
+            exyz_atom_array_free(data->arrays[frame][i]);
+        }
+        exyz_free(data->arrays[frame]);
+    }
+
+    for (size_t i=0; i<data->properties_count; i++) {
+        exyz_free(data->properties[i].key);
+    }
+    exyz_free(data->properties);
+    exyz_free(data->n_atoms);
+    exyz_free(data->arrays);
+    exyz_free(data->arrays_count);
+    exyz_free(data->last_error);
+    exyz_free(data);
+}
+
+/// keep the message of the last error for `get_last_error`
+static int atoms_stream_error(atoms_stream_t* data) {
+    exyz_free(data->last_error);
+    data->last_error = exyz_strdup(exyz_last_error()->message);
+    return EIO;
+}
+
+static int atoms_stream_get_schema(struct ArrowArrayStream* stream, struct ArrowSchema* schema) {
+    atoms_stream_t* data = stream->private_data;
+    const exyz_allocator_t* previous_allocator = exyz_use_allocator(&data->allocator);
+
+    int result = 0;
+    exyz_status_t status = atoms_schema(data->properties, data->properties_count, schema);
+    if (status != EXYZ_SUCCESS) {
+        result = atoms_stream_error(data);
+    }
+
+    exyz_use_allocator(previous_allocator);
+    return result;
+}
+
+static int atoms_stream_get_next(struct ArrowArrayStream* stream, struct ArrowArray* array) {
+    atoms_stream_t* data = stream->private_data;
+    if (data->next == data->frames_count) {
+        // end of the stream
+        memset(array, 0, sizeof(struct ArrowArray));
+        return 0;
+    }
+
+    const exyz_allocator_t* previous_allocator = exyz_use_allocator(&data->allocator);
+
+    int result = 0;
+    size_t frame = data->next;
+    exyz_status_t status = export_atoms(data->n_atoms[frame], data->arrays[frame], data->arrays_count[frame], array);
+    if (status == EXYZ_SUCCESS) {
+        data->next += 1;
+    } else {
+        result = atoms_stream_error(data);
+    }
+
+    exyz_use_allocator(previous_allocator);
+    return result;
+}
+
+static const char* atoms_stream_get_last_error(struct ArrowArrayStream* stream) {
+    atoms_stream_t* data = stream->private_data;
+    return data->last_error;
+}
+
+static void atoms_stream_release(struct ArrowArrayStream* stream) {
+    atoms_stream_t* data = stream->private_data;
+    exyz_allocator_t allocator = data->allocator;
+    const exyz_allocator_t* previous_allocator = exyz_use_allocator(&allocator);
+    atoms_stream_free(data);
+    exyz_use_allocator(previous_allocator);
+
+    stream->release = NULL;
+}
+
+/// check that all frames contain the same atom properties as the first one
+static exyz_status_t check_frames(
+    size_t frames_count,
+    const size_t* n_atoms,
+    exyz_atom_array_t* const* arrays,
+    const size_t* arrays_count
+) {
+    for (size_t frame=0; frame<frames_count; frame++) {
+        if (arrays_count[frame] != arrays_count[0]) {
+            return error(
+                "frame %zu has %zu atom properties, but the first frame has %zu",
+                frame, arrays_count[frame], arrays_count[0]
+            );
+        }
+
+        for (size_t i=0; i<arrays_count[frame]; i++) {
+            const exyz_atom_array_t* current = &arrays[frame][i];
+            const exyz_atom_array_t* first = &arrays[0][i];
+            if (strcmp(current->key, first->key) != 0 ||
+                current->array.type != first->array.type ||
+                current->array.ncols != first->array.ncols
+            ) {
+                return error("atom property '%s' in frame %zu does not match the first frame", current->key, frame);
+            }
+
+            if (current->array.nrows != n_atoms[frame]) {
+                return error("invalid number of rows for '%s' in frame %zu, expected %zu", current->key, frame, n_atoms[frame]);
+            }
+        }
+    }
+
+    return EXYZ_SUCCESS;
+}
+
+exyz_status_t exyz_arrow_export_atoms_stream(
+    size_t frames_count,
+    const size_t* n_atoms,
+    exyz_atom_array_t* const* arrays,
+    const size_t* arrays_count,
+    struct ArrowArrayStream* stream
+) {
+    memset(stream, 0, sizeof(struct ArrowArrayStream));
+
+    exyz_status_t status = check_frames(frames_count, n_atoms, arrays, arrays_count);
+    if (status != EXYZ_SUCCESS) {
+        return status;
+    }
+
+    atoms_stream_t* data = exyz_calloc(1, sizeof(atoms_stream_t));
+    if (data == NULL) {
+        return error("failed to allocate memory");
+    }
+    data->allocator = *exyz_current_allocator();
+
+    size_t properties_count = frames_count != 0 ? arrays_count[0] : 0;
+    data->properties = exyz_calloc(properties_count + 1, sizeof(exyz_atom_property_t));
+    data->n_atoms = exyz_malloc((frames_count + 1) * sizeof(size_t));
+    data->arrays = exyz_malloc((frames_count + 1) * sizeof(exyz_atom_array_t*));
+    data->arrays_count = exyz_malloc((frames_count + 1) * sizeof(size_t));
+    if (data->properties == NULL || data->n_atoms == NULL || data->arrays == NULL || data->arrays_count == NULL) {
+        atoms_stream_free(data);
+        return error("failed to allocate memory");
+    }
+
+    for (size_t i=0; i<properties_count; i++) {
+        data->properties[i] = array_property(&arrays[0][i]);
+        data->properties[i].key = exyz_strdup(arrays[0][i].key);
+        if (data->properties[i].key == NULL) {
+            atoms_stream_free(data);
+            return error("failed to allocate memory");
+        }
+        data->properties_count += 1;
+    }
+
+    // the stream takes ownership of the frames from here on
+    memcpy(data->n_atoms, n_atoms, frames_count * sizeof(size_t));
+    memcpy(data->arrays, arrays, frames_count * sizeof(exyz_atom_array_t*));
+    memcpy(data->arrays_count, arrays_count, frames_count * sizeof(size_t));
+    data->frames_count = frames_count;
+
+    stream->get_schema = atoms_stream_get_schema;
+    stream->get_next = atoms_stream_get_next;
+    stream->get_last_error = atoms_stream_get_last_error;
+    stream->release = atoms_stream_release;
+    stream->private_data = data;
+
+    return EXYZ_SUCCESS;
+}
+
+/******************************************************************************/
+/*                               Frames info                                  */
+/******************************************************************************/
+
+/// size in bytes of a single value with the given type in `exyz_info_t::data`
+static size_t info_value_size(exyz_data_t type) {
+    switch (type) {
+    case EXYZ_INTEGER:
+        return sizeof(int64_t);
+    case EXYZ_REAL:
+        return sizeof(double);
+    case EXYZ_BOOL:
+        return sizeof(bool);
+    case EXYZ_STRING:
+        return sizeof(char*);
+    case EXYZ_ARRAY:
+        break;
+    }
+    return 0;
+}
+
+/// values of a single info key for all frames, gathered before exporting them
+typedef struct info_column_t {
+    const char* key;
+    exyz_data_t type;
+    /// `frames_count` values of `size` bytes each
+    uint8_t* values;
+    size_t size;
+    bool* valid;
+    int64_t null_count;
+} info_column_t;
+
+/// export the values gathered in `column` for `frames_count` frames
+static exyz_status_t export_info_column(
+    info_column_t* column,
+    size_t frames_count,
+    struct ArrowSchema* schema,
+    struct ArrowArray* array
+) {
+    const char* format = NULL;
+    int64_t n_buffers = 2;
+    switch (column->type) {
+    case EXYZ_INTEGER:
+        format = "l";
+        break;
+    case EXYZ_REAL:
+        format = "g";
+        break;
+    case EXYZ_BOOL:
+        format = "b";
+        break;
+    case EXYZ_STRING:
+        format = "u";
+        n_buffers = 3;
+        break;
+    case EXYZ_ARRAY:
+        return error("invalid info type");
+    }
+
+    exyz_status_t status = schema_init(schema, format, column->key, ARROW_FLAG_NULLABLE, 0);
+    if (status != EXYZ_SUCCESS) {
+        return status;
+    }
+
+    status = array_init(array, (int64_t)frames_count, n_buffers, 0, NULL);
+    if (status != EXYZ_SUCCESS) {
+        release_both(schema, array);
+        return status;
+    }
+    array_data_t* data = array->private_data;
+
+    if (column->null_count != 0) {
+        data->owned[0] = pack_bits(column->valid, frames_count);
+        data->buffers[0] = data->owned[0];
+        if (data->owned[0] == NULL) {
+            status = error("failed to allocate memory");
+        }
+    }
+    array->null_count = column->null_count;
+
+    if (status == EXYZ_SUCCESS) {
+        if (column->type == EXYZ_BOOL) {
+            data->owned[1] = pack_bits((const bool*)column->values, frames_count);
+            if (data->owned[1] == NULL) {
+                status = error("failed to allocate memory");
+            }
+        } else if (column->type == EXYZ_STRING) {
+            int32_t* offsets = NULL;
+            char* strings = NULL;
+            status = utf8_buffers((char* const*)(void*)column->values, frames_count, &offsets, &strings);
+            data->owned[1] = offsets;
+            data->owned[2] = strings;
+        } else {
+            // the array takes ownership of the values
+            data->owned[1] = column->values;
+            column->values = NULL;
+        }
+        data->buffers[1] = data->owned[1];
+        data->buffers[2] = data->owned[2];
+    }
+
+    if (status != EXYZ_SUCCESS) {
+        release_both(schema, array);
+    }
+    return status;
+}
+
+static void free_info_columns(info_column_t* columns, size_t count) {
+    if (columns == NULL) {
+        return;
+    }
+
+    for (size_t k=0; k<count; k++) {
+        exyz_free(columns[k].values);
+        exyz_free(columns[k].valid);
+    }
+    exyz_free(columns);
+}
+
+exyz_status_t exyz_arrow_export_info(
+    exyz_info_t* const* info,
+    const size_t* info_count,
+    size_t frames_count,
+    struct ArrowSchema* schema,
+    struct ArrowArray* array
+) {
+    size_t max_keys = 0;
+    for (size_t frame=0; frame<frames_count; frame++) {
+        max_keys += info_count[frame];
+    }
+
+    // map from keys to their column, with the keys in order of first
+    // appearance. The type of each column is the type of the first value for
+    // this key.
+    string_table_t table;
+    exyz_status_t status = string_table_init(&table, max_keys);
+    if (status != EXYZ_SUCCESS) {
+        return status;
+    }
+
+    const char** keys = exyz_malloc((max_keys + 1) * sizeof(char*));
+    info_column_t* columns = exyz_calloc(max_keys + 1, sizeof(info_column_t));
+    if (keys == NULL || columns == NULL) {
+        exyz_free(table.slots);
+        exyz_free(keys);
+        exyz_free(columns);
+        return error("failed to allocate memory");
+    }
+
+    size_t keys_count = 0;
+    for (size_t frame=0; frame<frames_count && status == EXYZ_SUCCESS; frame++) {
+        for (size_t i=0; i<info_count[frame]; i++) {
+            const exyz_info_t* current = &info[frame][i];
+            if (current->type == EXYZ_ARRAY) {
+                continue;
+            }
+
+            size_t previous_count = keys_count;
+            info_column_t* column = &columns[string_table_insert(&table, keys, &keys_count, current->key)];
+            if (keys_count != previous_count) {
+                column->key = current->key;
+                column->type = current->type;
+                column->size = info_value_size(current->type);
+                column->values = exyz_calloc(frames_count + 1, column->size);
+                column->valid = exyz_calloc(frames_count + 1, sizeof(bool));
+                if (column->values == NULL || column->valid == NULL) {
+                    status = error("failed to allocate memory");
+                    break;
+                }
+            }
+
+            if (current->type == column->type && !column->valid[frame]) {
+                column->valid[frame] = true;
+                memcpy(column->values + frame * column->size, &current->data, column->size);
+            }
+        }
+    }
+    exyz_free(table.slots);
+    exyz_free(keys);
+
+    if (status != EXYZ_SUCCESS) {
+        free_info_columns(columns, keys_count);
+        return status;
+    }
+
+    for (size_t k=0; k<keys_count; k++) {
+        for (size_t frame=0; frame<frames_count; frame++) {
+            if (!columns[k].valid[frame]) {
+                columns[k].null_count += 1;
+            }
+        }
+    }
+
+    status = schema_init(schema, "+s", "", 0, (int64_t)keys_count);
+    if (status != EXYZ_SUCCESS) {
+        free_info_columns(columns, keys_count);
+        return status;
+    }
+
+    status = array_init(array, (int64_t)frames_count, 1, (int64_t)keys_count, NULL);
+    if (status != EXYZ_SUCCESS) {
+        free_info_columns(columns, keys_count);
+        schema->release(schema);
+        return status;
+    }
+
+    for (size_t k=0; k<keys_count; k++) {
+        status = export_info_column(&columns[k], frames_count, schema->children[k], array->children[k]);
+        if (status != EXYZ_SUCCESS) {
+            release_both(schema, array);
+            break;
+        }
+    }
+
+    free_info_columns(columns, keys_count);
+    return status;
+}
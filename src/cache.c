@@ -0,0 +1,809 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "exyz.h"
+#include "internal.h"
+
+static exyz_status_t error(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    exyz_status_t status = exyz_set_error(format, args);
+    va_end(args);
+
+    return status;
+}
+
+/******************************************************************************/
+/*                              File format                                   */
+/******************************************************************************/
+
+// All values are stored in little-endian, and all offsets are aligned to 8
+// bytes. The file contains a header, followed by one record per frame and a
+// table with the offset of each frame record.
+//
+// A frame record contains a `cache_frame_t`, then `info_count + arrays_count`
+// `cache_entry_t`, then the data for these entries. Offsets inside a frame
+// record are relative to the start of the record.
+//
+// Strings are stored null-terminated. Arrays of strings are stored as an array
+// of `uint64_t` offsets to each string, and boolean arrays use one byte per
+// value, exactly like `bool` in memory.
+
+#define CACHE_MAGIC "EXYZCACH"
+#define CACHE_VERSION 1
+
+/// number of bytes at the start and end of the source file used to compute
+/// the hash
+#define HASH_SAMPLE_SIZE (64 * 1024)
+
+typedef struct cache_header_t {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    /// size, modification time and hash of the source file
+    uint64_t source_size;
+    int64_t source_mtime;
+    uint64_t source_hash;
+    uint64_t frames_count;
+    /// offset of the table of frames offsets
+    uint64_t frames_offset;
+} cache_header_t;
+
+typedef struct cache_frame_t {
+    uint64_t n_atoms;
+    uint32_t info_count;
+    uint32_t arrays_count;
+} cache_frame_t;
+
+typedef struct cache_entry_t {
+    /// offset of the key
+    uint64_t key;
+    /// data type of the entry. For info arrays this is `EXYZ_ARRAY`, and
+    /// `array_type` contains the type of the array elements.
+    uint32_t type;
+    uint32_t array_type;
+    /// the value itself for integer, real and bool info; and the offset of
+    /// the data for string and array entries
+    uint64_t value;
+    uint64_t nrows;
+    uint64_t ncols;
+} cache_entry_t;
+
+static bool is_little_endian(void) {
+    uint16_t value = 1;
+    uint8_t first = 0;
+    memcpy(&first, &value, 1);
+    return first == 1;
+}
+
+static size_t align8(size_t size) {
+    return (size + 7) & ~(size_t)7;
+}
+
+/// size of a single element of an array with the given type, strings are
+/// stored as offsets
+static size_t element_size(exyz_data_t type) {
+    switch (type) {
+    case EXYZ_INTEGER:
+        return sizeof(int64_t);
+    case EXYZ_REAL:
+        return sizeof(double);
+    case EXYZ_BOOL:
+        return sizeof(bool);
+    case EXYZ_STRING:
+        return sizeof(uint64_t);
+    case EXYZ_ARRAY:
+        break;
+    }
+    return 0;
+}
+
+/******************************************************************************/
+/*                           Source validation                                */
+/******************************************************************************/
+
+static void fnv1a(uint64_t* hash, const uint8_t* data, size_t size) {
+    for (size_t i=0; i<size; i++) {
+        *hash ^= data[i];
+        *hash *= UINT64_C(0x100000001b3);
+    }
+}
+
+/// get size, modification time and hash of the file at `path`. To keep this
+/// fast on large files, only the beginning and the end of the file are hashed.
+static exyz_status_t source_signature(const char* path, uint64_t* size, int64_t* mtime, uint64_t* hash) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return error("failed to open '%s'", path);
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return error("failed to get information about '%s'", path);
+    }
+    *size = (uint64_t)info.st_size;
+    *mtime = (int64_t)info.st_mtime;
+
+    uint8_t* buffer = exyz_malloc(HASH_SAMPLE_SIZE);
+    if (buffer == NULL) {
+        close(fd);
+        return error("failed to allocate memory");
+    }
+
+    *hash = UINT64_C(0xcbf29ce484222325);
+    fnv1a(hash, (const uint8_t*)size, sizeof(uint64_t));
+
+    off_t offsets[2] = {0, 0};
+    if (info.st_size > HASH_SAMPLE_SIZE) {
+        offsets[1] = info.st_size - HASH_SAMPLE_SIZE;
+    }
+
+    for (size_t i=0; i<2; i++) {
+        ssize_t count = pread(fd, buffer, HASH_SAMPLE_SIZE, offsets[i]);
+        if (count < 0) {
+            exyz_free(buffer);
+            close(fd);
+            return error("failed to read '%s'", path);
+        }
+        fnv1a(hash, buffer, (size_t)count);
+    }
+
+    exyz_free(buffer);
+    close(fd);
+    return EXYZ_SUCCESS;
+}
+
+/******************************************************************************/
+/*                             Cache creation                                 */
+/******************************************************************************/
+
+/// growable buffer for the data part of a frame record
+typedef struct buffer_t {
+    uint8_t* data;
+    size_t size;
+    size_t capacity;
+    /// offset of the start of this buffer in the frame record
+    size_t base;
+} buffer_t;
+
+/// append `size` bytes to the buffer, aligning the start of the new data to
+/// 8 bytes, and store the corresponding offset in the frame record in `offset`
+static exyz_status_t buffer_append(buffer_t* buffer, const void* data, size_t size, uint64_t* offset) {
+    size_t start = align8(buffer->size);
+    if (start + size > buffer->capacity) {
+        size_t capacity = buffer->capacity == 0 ? 4096 : buffer->capacity;
+        while (start + size > capacity) {
+            capacity *= 2;
+        }
+
+        uint8_t* new_data = exyz_realloc(buffer->data, capacity);
+        if (new_data == NULL) {
+            return error("failed to allocate memory");
+        }
+        buffer->data = new_data;
+        buffer->capacity = capacity;
+    }
+
+    if (start != buffer->size) {
+        memset(buffer->data + buffer->size, 0, start - buffer->size);
+    }
+    if (size != 0) {
+        memcpy(buffer->data + start, data, size);
+    }
+    buffer->size = start + size;
+
+    *offset = buffer->base + start;
+    return EXYZ_SUCCESS;
+}
+
+static exyz_status_t buffer_append_string(buffer_t* buffer, const char* string, uint64_t* offset) {
+    return buffer_append(buffer, string, strlen(string) + 1, offset);
+}
+
+/// append the data of `array` to the buffer, setting the corresponding fields
+/// of `entry`
+static exyz_status_t buffer_append_array(buffer_t* buffer, const exyz_array_t* array, cache_entry_t* entry) {
+    entry->nrows = array->nrows;
+    entry->ncols = array->ncols;
+    entry->value = 0;
+
+    size_t count = array->nrows * array->ncols;
+    if (count == 0) {
+        return EXYZ_SUCCESS;
+    }
+
+    if (array->type != EXYZ_STRING) {
+        return buffer_append(buffer, array->data.integer, count * element_size(array->type), &entry->value);
+    }
+
+    uint64_t* offsets = exyz_malloc(count * sizeof(uint64_t));
+    if (offsets == NULL) {
+        return error("failed to allocate memory");
+    }
+
+    exyz_status_t status = EXYZ_SUCCESS;
+    for (size_t i=0; i<count; i++) {
+        status = buffer_append_string(buffer, array->data.string[i], &offsets[i]);
+        if (status != EXYZ_SUCCESS) {
+            break;
+        }
+    }
+
+    if (status == EXYZ_SUCCESS) {
+        status = buffer_append(buffer, offsets, count * sizeof(uint64_t), &entry->value);
+    }
+    exyz_free(offsets);
+
+    return status;
+}
+
+static exyz_status_t write_all(FILE* file, const void* data, size_t size) {
+    if (size != 0 && fwrite(data, 1, size, file) != size) {
+        return error("failed to write cache file");
+    }
+    return EXYZ_SUCCESS;
+}
+
+/// write a single frame record to `file`
+static exyz_status_t write_frame(
+    FILE* file,
+    buffer_t* buffer,
+    size_t n_atoms,
+    const exyz_info_t* info,
+    size_t info_count,
+    const exyz_atom_array_t* arrays,
+    size_t arrays_count
+) {
+    size_t entries_count = info_count + arrays_count;
+    cache_entry_t* entries = exyz_calloc(entries_count + 1, sizeof(cache_entry_t));
+    if (entries == NULL) {
+        return error("failed to allocate memory");
+    }
+
+    buffer->size = 0;
+    buffer->base = sizeof(cache_frame_t) + entries_count * sizeof(cache_entry_t);
+
+    exyz_status_t status = EXYZ_SUCCESS;
+    for (size_t i=0; i<info_count && status == EXYZ_SUCCESS; i++) {
+        cache_entry_t* entry = &entries[i];
+        entry->type = (uint32_t)info[i].type;
+
+        status = buffer_append_string(buffer, info[i].key, &entry->key);
+        if (status != EXYZ_SUCCESS) {
+            break;
+        }
+
+        switch (info[i].type) {
+        case EXYZ_INTEGER:
+            memcpy(&entry->value, &info[i].data.integer, sizeof(int64_t));
+            break;
+        case EXYZ_REAL:
+            memcpy(&entry->value, &info[i].data.real, sizeof(double));
+            break;
+        case EXYZ_BOOL:
+            entry->value = info[i].data.boolean;
+            break;
+        case EXYZ_STRING:
+            status = buffer_append_string(buffer, info[i].data.string, &entry->value);
+            break;
+        case EXYZ_ARRAY:
+            entry->array_type = (uint32_t)info[i].data.array.type;
+            status = buffer_append_array(buffer, &info[i].data.array, entry);
+            break;
+        }
+    }
+
+    for (size_t i=0; i<arrays_count && status == EXYZ_SUCCESS; i++) {
+        cache_entry_t* entry = &entries[info_count + i];
+        entry->type = (uint32_t)arrays[i].array.type;
+
+        status = buffer_append_string(buffer, arrays[i].key, &entry->key);
+        if (status != EXYZ_SUCCESS) {
+            break;
+        }
+        status = buffer_append_array(buffer, &arrays[i].array, entry);
+    }
+
+    if (status == EXYZ_SUCCESS) {
+        // pad the record to keep the next one aligned
+        uint64_t end = 0;
+        status = buffer_append(buffer, NULL, 0, &end);
+    }
+
+    if (status == EXYZ_SUCCESS) {
+        cache_frame_t frame = {
+            .n_atoms = n_atoms,
+            .info_count = (uint32_t)info_count,
+            .arrays_count = (uint32_t)arrays_count,
+        };
+
+        status = write_all(file, &frame, sizeof(frame));
+        if (status == EXYZ_SUCCESS) {
+            status = write_all(file, entries, entries_count * sizeof(cache_entry_t));
+        }
+        if (status == EXYZ_SUCCESS) {
+            status = write_all(file, buffer->data, buffer->size);
+        }
+    }
+
+    exyz_free(entries);
+    return status;
+}
+
+/// parse the whole trajectory at `path` and write the corresponding cache
+/// to `file`
+static exyz_status_t write_cache(FILE* file, const char* path, const cache_header_t* source) {
+    exyz_reader_t* reader = NULL;
+    exyz_status_t status = exyz_reader_open(&reader, path);
+    if (status != EXYZ_SUCCESS) {
+        return status;
+    }
+
+    cache_header_t header = *source;
+    buffer_t buffer = {NULL, 0, 0, 0};
+    uint64_t* frames = NULL;
+    size_t frames_capacity = 0;
+    uint64_t offset = sizeof(cache_header_t);
+
+    // the header is written again at the end, once we know the number of frames
+    status = write_all(file, &header, sizeof(header));
+
+    while (status == EXYZ_SUCCESS) {
+        size_t n_atoms = 0;
+        exyz_info_t* info = NULL;
+        size_t info_count = 0;
+        exyz_atom_array_t* arrays = NULL;
+        size_t arrays_count = 0;
+        status = exyz_reader_read(reader, &n_atoms, &info, &info_count, &arrays, &arrays_count);
+        if (status == EXYZ_END_OF_FILE) {
+            status = EXYZ_SUCCESS;
+            break;
+        } else if (status != EXYZ_SUCCESS) {
+            break;
+        }
+
+        if (header.frames_count == frames_capacity) {
+            frames_capacity = frames_capacity == 0 ? 1024 : 2 * frames_capacity;
+            uint64_t* new_frames = exyz_realloc(frames, frames_capacity * sizeof(uint64_t));
+            if (new_frames == NULL) {
+                status = error("failed to allocate memory");
+            } else {
+                frames = new_frames;
+            }
+        }
+
+        if (status == EXYZ_SUCCESS) {
+            frames[header.frames_count] = offset;
+            header.frames_count += 1;
+            status = write_frame(file, &buffer, n_atoms, info, info_count, arrays, arrays_count);
+            offset += sizeof(cache_frame_t) + (info_count + arrays_count) * sizeof(cache_entry_t) + buffer.size;
+        }
+
+        for (size_t i=0; i<info_count; i++) {
+            exyz_info_free(info[i]);
+        }
+        exyz_free(info);
+        for (size_t i=0; i<arrays_count; i++) {
+            exyz_atom_array_free(arrays[i]);
+        }
+        exyz_free(arrays);
+    }
+
+    if (status == EXYZ_SUCCESS) {
+        header.frames_offset = offset;
+        status = write_all(file, frames, header.frames_count * sizeof(uint64_t));
+    }
+
+    if (status == EXYZ_SUCCESS) {
+        if (fseek(file, 0, SEEK_SET) != 0) {
+            status = error("failed to seek in cache file");
+        } else {
+            status = write_all(file, &header, sizeof(header));
+        }
+    }
+
+    exyz_free(frames);
+    exyz_free(buffer.data);
+    exyz_reader_close(reader);
+
+    return status;
+}
+
+/// create the cache at `cache_path`. The data is first written to a
+/// temporary file which is then renamed, so concurrent processes never see a
+/// partial cache.
+static exyz_status_t create_cache(const char* path, const char* cache_path, const cache_header_t* source) {
+    size_t length = strlen(cache_path) + 32;
+    char* tmp_path = exyz_malloc(length);
+    if (tmp_path == NULL) {
+        return error("failed to allocate memory");
+    }
+    snprintf(tmp_path, length, "%s.%ld.tmp", cache_path, (long)getpid());
+
+    FILE* file = fopen(tmp_path, "wb");
+    if (file == NULL) {
+        exyz_status_t status = error("failed to create cache file at '%s'", tmp_path);
+        exyz_free(tmp_path);
+        return status;
+    }
+
+    exyz_status_t status = write_cache(file, path, source);
+    if (fclose(file) != 0 && status == EXYZ_SUCCESS) {
+        status = error("failed to write cache file");
+    }
+
+    if (status == EXYZ_SUCCESS && rename(tmp_path, cache_path) != 0) {
+        status = error("failed to move cache file to '%s'", cache_path);
+    }
+
+    if (status != EXYZ_SUCCESS) {
+        remove(tmp_path);
+    }
+    exyz_free(tmp_path);
+
+    return status;
+}
+
+/******************************************************************************/
+/*                             Cache loading                                  */
+/******************************************************************************/
+
+struct exyz_cache_t {
+    /// memory mapped cache file
+    uint8_t* data;
+    size_t size;
+
+    size_t frames_count;
+    /// offset of each frame record
+    const uint64_t* frames;
+
+    /// memory used for the last frame returned by `exyz_cache_read`
+    exyz_info_t* info;
+    size_t info_capacity;
+    exyz_atom_array_t* arrays;
+    size_t arrays_capacity;
+    char** strings;
+    size_t strings_capacity;
+
+    /// allocator in use when the cache was opened
+    exyz_allocator_t allocator;
+};
+
+/// map the cache file at `path` in memory, and check that it was created
+/// from a source file matching `source`. This returns `EXYZ_FAILED_READING`
+/// if the cache does not exist or is out of date.
+static exyz_status_t map_cache(exyz_cache_t* cache, const char* path, const cache_header_t* source) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return EXYZ_FAILED_READING;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(cache_header_t)) {
+        close(fd);
+        return EXYZ_FAILED_READING;
+    }
+
+    // private mapping: users can modify the data they get without changing
+    // the file on disk
+    size_t size = (size_t)info.st_size;
+    void* data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return error("failed to map cache file '%s' in memory", path);
+    }
+
+    cache_header_t header;
+    memcpy(&header, data, sizeof(header));
+
+    if (memcmp(header.magic, CACHE_MAGIC, 8) != 0 || header.version != CACHE_VERSION ||
+        header.source_size != source->source_size ||
+        header.source_mtime != source->source_mtime ||
+        header.source_hash != source->source_hash ||
+        header.frames_offset % 8 != 0 || header.frames_offset > size ||
+        header.frames_count > (size - header.frames_offset) / sizeof(uint64_t)
+    ) {
+        munmap(data, size);
+        return EXYZ_FAILED_READING;
+    }
+
+    cache->data = data;
+    cache->size = size;
+    cache->frames_count = (size_t)header.frames_count;
+    cache->frames = (const uint64_t*)(void*)(cache->data + header.frames_offset);
+
+    return EXYZ_SUCCESS;
+}
+
+exyz_status_t exyz_cache_open(exyz_cache_t** cache_ptr, const char* path, const char* cache_path) {
+    if (!is_little_endian()) {
+        return error("binary caches are only supported on little-endian systems");
+    }
+
+    char* default_path = NULL;
+    if (cache_path == NULL) {
+        size_t length = strlen(path) + sizeof(".exyzcache");
+        default_path = exyz_malloc(length);
+        if (default_path == NULL) {
+            return error("failed to allocate memory");
+        }
+        snprintf(default_path, length, "%s.exyzcache", path);
+        cache_path = default_path;
+    }
+
+    cache_header_t source;
+    memset(&source, 0, sizeof(source));
+    memcpy(source.magic, CACHE_MAGIC, 8);
+    source.version = CACHE_VERSION;
+
+    exyz_status_t status = source_signature(path, &source.source_size, &source.source_mtime, &source.source_hash);
+    if (status != EXYZ_SUCCESS) {
+        exyz_free(default_path);
+        return status;
+    }
+
+    exyz_cache_t* cache = exyz_calloc(1, sizeof(exyz_cache_t));
+    if (cache == NULL) {
+        exyz_free(default_path);
+        return error("failed to allocate memory");
+    }
+    cache->allocator = *exyz_current_allocator();
+
+    status = map_cache(cache, cache_path, &source);
+    if (status == EXYZ_FAILED_READING) {
+        // the cache is missing or out of date
+        status = create_cache(path, cache_path, &source);
+        if (status == EXYZ_SUCCESS) {
+            status = map_cache(cache, cache_path, &source);
+            if (status == EXYZ_FAILED_READING) {
+                status = error("failed to read newly created cache at '%s'", cache_path);
+            }
+        }
+    }
+
+    exyz_free(default_path);
+    if (status != EXYZ_SUCCESS) {
+        exyz_cache_close(cache);
+        return status;
+    }
+
+    *cache_ptr = cache;
+    return EXYZ_SUCCESS;
+}
+
+size_t exyz_cache_frames_count(const exyz_cache_t* cache) {
+    return cache->frames_count;
+}
+
+/// make sure `buffer` can hold at least `count` elements
+#define RESERVE(buffer, capacity, count) do {                                   \
+    if ((count) > (capacity)) {                                                 \
+        void* new_buffer = exyz_realloc((buffer), (count) * sizeof(*(buffer)));      \
+        if (new_buffer == NULL) {                                               \
+            return error("failed to allocate memory");                          \
+        }                                                                       \
+        (buffer) = new_buffer;                                                  \
+        (capacity) = (count);                                                   \
+    }                                                                           \
+} while (false)
+
+/// context used to check offsets when reading a frame record
+typedef struct record_t {
+    uint8_t* data;
+    size_t size;
+} record_t;
+
+static exyz_status_t record_string(const record_t* record, uint64_t offset, char** string) {
+    if (offset >= record->size || memchr(record->data + offset, '\0', record->size - (size_t)offset) == NULL) {
+        return error("invalid string in cache file");
+    }
+    *string = (char*)(record->data + offset);
+    return EXYZ_SUCCESS;
+}
+
+static bool valid_type(uint32_t type) {
+    return type == EXYZ_INTEGER || type == EXYZ_REAL || type == EXYZ_BOOL || type == EXYZ_STRING;
+}
+
+/// set `array` to point to the data for `entry` in the record
+static exyz_status_t record_array(
+    exyz_cache_t* cache,
+    const record_t* record,
+    const cache_entry_t* entry,
+    uint32_t type,
+    size_t* strings_used,
+    exyz_array_t* array
+) {
+    if (!valid_type(type)) {
+        return error("invalid array type in cache file");
+    }
+
+    array->type = (exyz_data_t)type;
+    array->nrows = (size_t)entry->nrows;
+    array->ncols = (size_t)entry->ncols;
+    array->data.integer = NULL;
+
+    size_t count = array->nrows * array->ncols;
+    if (count == 0) {
+        return EXYZ_SUCCESS;
+    }
+
+    size_t size = element_size(array->type);
+    if (array->ncols != 0 && count / array->ncols != array->nrows) {
+        return error("invalid array size in cache file");
+    }
+    if (entry->value % 8 != 0 || entry->value > record->size || count > (record->size - (size_t)entry->value) / size) {
+        return error("invalid array data in cache file");
+    }
+
+    void* data = record->data + entry->value;
+    if (array->type != EXYZ_STRING) {
+        array->data.integer = data;
+        return EXYZ_SUCCESS;
+    }
+
+    assert(*strings_used + count <= cache->strings_capacity);
+    char** strings = cache->strings + *strings_used;
+    const uint64_t* offsets = data;
+    for (size_t i=0; i<count; i++) {
+        exyz_status_t status = record_string(record, offsets[i], &strings[i]);
+        if (status != EXYZ_SUCCESS) {
+            return status;
+        }
+    }
+    *strings_used += count;
+    array->data.string = strings;
+
+    return EXYZ_SUCCESS;
+}
+
+static exyz_status_t cache_read(
+    exyz_cache_t* cache,
+    size_t index,
+    size_t* n_atoms,
+    exyz_info_t** info,
+    size_t* info_count,
+    exyz_atom_array_t** arrays,
+    size_t* arrays_count
+) {
+    if (index >= cache->frames_count) {
+        return error(
+            "can not read frame %zu, this cache only contains %zu frames",
+            index, cache->frames_count
+        );
+    }
+
+    uint64_t start = cache->frames[index];
+    if (start % 8 != 0 || start > cache->size || cache->size - start < sizeof(cache_frame_t)) {
+        return error("invalid frame offset in cache file");
+    }
+
+    record_t record = {cache->data + start, cache->size - (size_t)start};
+    cache_frame_t frame;
+    memcpy(&frame, record.data, sizeof(frame));
+
+    size_t entries_count = (size_t)frame.info_count + (size_t)frame.arrays_count;
+    if (entries_count > (record.size - sizeof(cache_frame_t)) / sizeof(cache_entry_t)) {
+        return error("invalid frame record in cache file");
+    }
+    const cache_entry_t* entries = (const cache_entry_t*)(void*)(record.data + sizeof(cache_frame_t));
+
+    // count the strings pointers we need for string arrays
+    size_t strings_count = 0;
+    for (size_t i=0; i<entries_count; i++) {
+        uint32_t type = i < frame.info_count ? entries[i].array_type : entries[i].type;
+        bool is_array = i >= frame.info_count || entries[i].type == EXYZ_ARRAY;
+        if (is_array && type == EXYZ_STRING) {
+            strings_count += (size_t)(entries[i].nrows * entries[i].ncols);
+        }
+    }
+
+    RESERVE(cache->info, cache->info_capacity, (size_t)frame.info_count);
+    RESERVE(cache->arrays, cache->arrays_capacity, (size_t)frame.arrays_count);
+    RESERVE(cache->strings, cache->strings_capacity, strings_count);
+
+    size_t strings_used = 0;
+    exyz_status_t status = EXYZ_SUCCESS;
+    for (size_t i=0; i<frame.info_count; i++) {
+        const cache_entry_t* entry = &entries[i];
+        exyz_info_t* current = &cache->info[i];
+
+        status = record_string(&record, entry->key, &current->key);
+        if (status != EXYZ_SUCCESS) {
+            return status;
+        }
+
+        switch (entry->type) {
+        case EXYZ_INTEGER:
+            memcpy(&current->data.integer, &entry->value, sizeof(int64_t));
+            break;
+        case EXYZ_REAL:
+            memcpy(&current->data.real, &entry->value, sizeof(double));
+            break;
+        case EXYZ_BOOL:
+            current->data.boolean = entry->value != 0;
+            break;
+        case EXYZ_STRING:
+            status = record_string(&record, entry->value, &current->data.string);
+            break;
+        case EXYZ_ARRAY:
+            status = record_array(cache, &record, entry, entry->array_type, &strings_used, &current->data.array);
+            break;
+        default:
+            status = error("invalid info type in cache file");
+            break;
+        }
+
+        if (status != EXYZ_SUCCESS) {
+            return status;
+        }
+        current->type = (exyz_data_t)entry->type;
+    }
+
+    for (size_t i=0; i<frame.arrays_count; i++) {
+        const cache_entry_t* entry = &entries[frame.info_count + i];
+        exyz_atom_array_t* current = &cache->arrays[i];
+
+        status = record_string(&record, entry->key, &current->key);
+        if (status != EXYZ_SUCCESS) {
+            return status;
+        }
+
+        status = record_array(cache, &record, entry, entry->type, &strings_used, &current->array);
+        if (status != EXYZ_SUCCESS) {
+            return status;
+        }
+    }
+
+    *n_atoms = (size_t)frame.n_atoms;
+    *info = cache->info;
+    *info_count = frame.info_count;
+    *arrays = cache->arrays;
+    *arrays_count = frame.arrays_count;
+
+    return EXYZ_SUCCESS;
+}
+
+exyz_status_t exyz_cache_read(
+    exyz_cache_t* cache,
+    size_t index,
+    size_t* n_atoms,
+    exyz_info_t** info,
+    size_t* info_count,
+    exyz_atom_array_t** arrays,
+    size_t* arrays_count
+) {
+    const exyz_allocator_t* previous_allocator = exyz_use_allocator(&cache->allocator);
+    exyz_status_t status = cache_read(cache, index, n_atoms, info, info_count, arrays, arrays_count);
+    exyz_use_allocator(previous_allocator);
+    return status;
+}
+
+exyz_status_t exyz_cache_close(exyz_cache_t* cache) {
+    if (cache == NULL) {
+        return EXYZ_SUCCESS;
+    }
+
+    if (cache->data != NULL) {
+        munmap(cache->data, cache->size);
+    }
+
+    exyz_allocator_t allocator = cache->allocator;
+    const exyz_allocator_t* previous_allocator = exyz_use_allocator(&allocator);
+
+    exyz_free(cache->info);
+    exyz_free(cache->arrays);
+    exyz_free(cache->strings);
+    exyz_free(cache);
+
+    exyz_use_allocator(previous_allocator);
+    return EXYZ_SUCCESS;
+}
@@ -0,0 +1,49 @@
+#include <pthread.h>
+
+#include "exyz.h"
+#include "internal.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define EXYZ_X86_DISPATCH
+#endif
+
+static exyz_simd_t CPU_SIMD = EXYZ_SIMD_SCALAR;
+static pthread_once_t CPU_SIMD_ONCE = PTHREAD_ONCE_INIT;
+
+static void detect_cpu_simd(void) {
+#if defined(EXYZ_FORCE_SIMD)
+    CPU_SIMD = EXYZ_FORCE_SIMD;
+#elif defined(EXYZ_X86_DISPATCH)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512bw")) {
+        CPU_SIMD = EXYZ_SIMD_AVX512;
+    } else if (__builtin_cpu_supports("avx2")) {
+        CPU_SIMD = EXYZ_SIMD_AVX2;
+    } else if (__builtin_cpu_supports("sse2")) {
+        CPU_SIMD = EXYZ_SIMD_SSE2;
+    } else {
+        CPU_SIMD = EXYZ_SIMD_SCALAR;
+    }
+#else
+    CPU_SIMD = EXYZ_SIMD_SCALAR;
+#endif
+}
+
+exyz_simd_t exyz_cpu_simd(void) {
+    pthread_once(&CPU_SIMD_ONCE, detect_cpu_simd);
+    return CPU_SIMD;
+}
+
+const char* exyz_simd_level(void) {
+    switch (exyz_cpu_simd()) {
+    case EXYZ_SIMD_SCALAR:
+        return "scalar";
+    case EXYZ_SIMD_SSE2:
+        return "sse2";
+    case EXYZ_SIMD_AVX2:
+        return "avx2";
+    case EXYZ_SIMD_AVX512:
+        return "avx512";
+    }
+    return "unknown";
+}
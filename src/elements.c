@@ -0,0 +1,67 @@
+#include <pthread.h>
+
+#include "exyz.h"
+#include "internal.h"
+
+/// symbols of the elements, in the order of their atomic numbers
+static const char* const ELEMENTS[] = {
+    "H", "He", "Li", "Be", "B", "C", "N", "O", "F", "Ne", "Na", "Mg", "Al",
+    "Si", "P", "S", "Cl", "Ar", "K", "Ca", "Sc", "Ti", "V", "Cr", "Mn", "Fe",
+    "Co", "Ni", "Cu", "Zn", "Ga", "Ge", "As", "Se", "Br", "Kr", "Rb", "Sr",
+    "Y", "Zr", "Nb", "Mo", "Tc", "Ru", "Rh", "Pd", "Ag", "Cd", "In", "Sn",
+    "Sb", "Te", "I", "Xe", "Cs", "Ba", "La", "Ce", "Pr", "Nd", "Pm", "Sm",
+    "Eu", "Gd", "Tb", "Dy", "Ho", "Er", "Tm", "Yb", "Lu", "Hf", "Ta", "W",
+    "Re", "Os", "Ir", "Pt", "Au", "Hg", "Tl", "Pb", "Bi", "Po", "At", "Rn",
+    "Fr", "Ra", "Ac", "Th", "Pa", "U", "Np", "Pu", "Am", "Cm", "Bk", "Cf",
+    "Es", "Fm", "Md", "No", "Lr", "Rf", "Db", "Sg", "Bh", "Hs", "Mt", "Ds",
+    "Rg", "Cn", "Nh", "Fl", "Mc", "Lv", "Ts", "Og",
+};
+
+// All element symbols are an uppercase letter, optionally followed by a
+// lowercase letter. Using the two letters as a number in base 27 gives a
+// distinct index for each possible symbol, which is used as a perfect hash
+// for the table below.
+
+/// number of possible second characters: none or a lowercase letter
+#define SECOND_CHARS 27
+
+/// atomic number for each symbol hash, or 0 for unknown symbols
+static uint8_t ATOMIC_NUMBERS[26 * SECOND_CHARS];
+static pthread_once_t ATOMIC_NUMBERS_ONCE = PTHREAD_ONCE_INIT;
+
+/// get the hash of a one or two characters `symbol`, or `SIZE_MAX` if this
+/// can not be an element symbol
+static size_t symbol_hash(const char* symbol, size_t length) {
+    if (length == 0 || length > 2 || symbol[0] < 'A' || symbol[0] > 'Z') {
+        return SIZE_MAX;
+    }
+
+    size_t second = 0;
+    if (length == 2) {
+        if (symbol[1] < 'a' || symbol[1] > 'z') {
+            return SIZE_MAX;
+        }
+        second = (size_t)(symbol[1] - 'a') + 1;
+    }
+
+    return (size_t)(symbol[0] - 'A') * SECOND_CHARS + second;
+}
+
+static void create_atomic_numbers(void) {
+    size_t count = sizeof(ELEMENTS) / sizeof(ELEMENTS[0]);
+    for (size_t i=0; i<count; i++) {
+        const char* symbol = ELEMENTS[i];
+        size_t length = symbol[1] == '\0' ? 1 : 2;
+        ATOMIC_NUMBERS[symbol_hash(symbol, length)] = (uint8_t)(i + 1);
+    }
+}
+
+int64_t exyz_atomic_number(const char* symbol, size_t length) {
+    pthread_once(&ATOMIC_NUMBERS_ONCE, create_atomic_numbers);
+
+    size_t hash = symbol_hash(symbol, length);
+    if (hash == SIZE_MAX) {
+        return 0;
+    }
+    return ATOMIC_NUMBERS[hash];
+}
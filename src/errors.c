@@ -0,0 +1,428 @@
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "exyz.h"
+#include "internal.h"
+
+/// last error for each thread
+static _Thread_local exyz_error_state_t LAST_ERROR = {
+    .error = {
+        .message = {0},
+        .frame = -1,
+        .line = -1,
+        .offset = -1,
+    },
+    .format = NULL,
+};
+
+/// A conversion specification (`%...`) in the format of an error message
+typedef struct conversion_t {
+    /// start of the specification, on the '%' character
+    const char* start;
+    /// size of the specification, including the conversion character
+    size_t size;
+    /// is the width given by an argument ('*')?
+    bool width_argument;
+    /// is the precision given by an argument ('*')?
+    bool precision_argument;
+    /// precision given in the format, or -1 if there is none
+    int precision;
+    /// length modifier: 'H' for "hh", 'q' for "ll", '\0' if there is none, and
+    /// the modifier character otherwise
+    char modifier;
+    /// conversion character
+    char conversion;
+} conversion_t;
+
+/// find the next conversion in `format`, starting at `*format`. On success,
+/// `*format` is moved after the conversion. This returns false at the end of
+/// the format, or for a conversion that errors messages do not support.
+static bool next_conversion(const char** format, conversion_t* conversion) {
+    const char* current = *format;
+    while (true) {
+        current = strchr(current, '%');
+        if (current == NULL) {
+            return false;
+        }
+
+        if (current[1] == '%') {
+            current += 2;
+        } else {
+            break;
+        }
+    }
+
+    conversion->start = current;
+    conversion->width_argument = false;
+    conversion->precision_argument = false;
+    conversion->precision = -1;
+    conversion->modifier = '\0';
+
+    current += 1;
+    while (*current != '\0' && strchr("-+ #0", *current) != NULL) {
+        current += 1;
+    }
+
+    if (*current == '*') {
+        conversion->width_argument = true;
+        current += 1;
+    } else {
+        while (*current >= '0' && *current <= '9') {
+            current += 1;
+        }
+    }
+
+    if (*current == '.') {
+        current += 1;
+        if (*current == '*') {
+            conversion->precision_argument = true;
+            current += 1;
+        } else {
+            conversion->precision = 0;
+            while (*current >= '0' && *current <= '9') {
+                conversion->precision = 10 * conversion->precision + (*current - '0');
+                current += 1;
+            }
+        }
+    }
+
+    if (current[0] == 'h' && current[1] == 'h') {
+        conversion->modifier = 'H';
+        current += 2;
+    } else if (current[0] == 'l' && current[1] == 'l') {
+        conversion->modifier = 'q';
+        current += 2;
+    } else if (*current == 'h' || *current == 'l' || *current == 'z' || *current == 'j' || *current == 't') {
+        conversion->modifier = *current;
+        current += 1;
+    }
+
+    conversion->conversion = *current;
+    if (conversion->conversion == '\0' || strchr("dicuoxXfFeEgGaAsp", conversion->conversion) == NULL) {
+        return false;
+    }
+
+    current += 1;
+    conversion->size = (size_t)(current - conversion->start);
+    *format = current;
+    return true;
+}
+
+/// number of arguments used by `conversion`
+static size_t conversion_arguments(const conversion_t* conversion) {
+    size_t count = 1;
+    if (conversion->width_argument) {
+        count += 1;
+    }
+    if (conversion->precision_argument) {
+        count += 1;
+    }
+    return count;
+}
+
+static bool is_signed_conversion(char conversion) {
+    return conversion == 'd' || conversion == 'i' || conversion == 'c';
+}
+
+static bool is_unsigned_conversion(char conversion) {
+    return conversion == 'u' || conversion == 'o' || conversion == 'x' || conversion == 'X';
+}
+
+/// get the next signed integer in `args`, with the type given by `modifier`
+static intmax_t signed_argument(va_list* args, char modifier) {
+    switch (modifier) {
+    case 'l':
+        return va_arg(*args, long);
+    case 'q':
+        return va_arg(*args, long long);
+    case 'j':
+        return va_arg(*args, intmax_t);
+    case 'z':
+    case 't':
+        return va_arg(*args, ptrdiff_t);
+    default:
+        return va_arg(*args, int);
+    }
+}
+
+/// get the next unsigned integer in `args`, with the type given by `modifier`
+static uintmax_t unsigned_argument(va_list* args, char modifier) {
+    switch (modifier) {
+    case 'l':
+        return va_arg(*args, unsigned long);
+    case 'q':
+        return va_arg(*args, unsigned long long);
+    case 'j':
+        return va_arg(*args, uintmax_t);
+    case 'z':
+        return va_arg(*args, size_t);
+    case 't':
+        return (uintmax_t)va_arg(*args, ptrdiff_t);
+    default:
+        return va_arg(*args, unsigned);
+    }
+}
+
+/// copy the string argument `value` in the storage of `state`, keeping at
+/// most `precision` bytes if it is not negative
+static size_t store_string(exyz_error_state_t* state, size_t* used, const char* value, int precision) {
+    if (value == NULL) {
+        value = "(null)";
+    }
+
+    if (*used + 1 >= sizeof(state->strings)) {
+        // no space left, use an empty string
+        state->strings[sizeof(state->strings) - 1] = '\0';
+        return sizeof(state->strings) - 1;
+    }
+
+    size_t available = sizeof(state->strings) - *used - 1;
+    size_t length = precision >= 0 ? strnlen(value, (size_t)precision) : strlen(value);
+    if (length > available) {
+        length = available;
+    }
+
+    size_t start = *used;
+    memcpy(state->strings + start, value, length);
+    state->strings[start + length] = '\0';
+    *used += length + 1;
+    return start;
+}
+
+exyz_status_t exyz_set_error(const char* format, va_list args) {
+    exyz_error_state_t* state = &LAST_ERROR;
+    state->error.message[0] = '\0';
+    state->error.frame = -1;
+    state->error.line = -1;
+    state->error.offset = -1;
+    state->format = format;
+
+    // only the arguments are kept here, the message is created by
+    // `exyz_last_error` when it is needed. Many errors are discarded by the
+    // parser without ever being looked at.
+    va_list copy;
+    va_copy(copy, args);
+
+    size_t count = 0;
+    size_t used = 0;
+    const char* current = format;
+    conversion_t conversion;
+    while (next_conversion(&current, &conversion)) {
+        if (count + conversion_arguments(&conversion) > EXYZ_ERROR_MAX_ARGS) {
+            break;
+        }
+
+        if (conversion.width_argument) {
+            state->args[count++].integer = va_arg(copy, int);
+        }
+
+        if (conversion.precision_argument) {
+            conversion.precision = va_arg(copy, int);
+            state->args[count++].integer = conversion.precision;
+        }
+
+        exyz_error_arg_t* arg = &state->args[count++];
+        if (is_signed_conversion(conversion.conversion)) {
+            arg->integer = signed_argument(&copy, conversion.modifier);
+        } else if (is_unsigned_conversion(conversion.conversion)) {
+            arg->unsigned_integer = unsigned_argument(&copy, conversion.modifier);
+        } else if (conversion.conversion == 's') {
+            arg->string = store_string(state, &used, va_arg(copy, const char*), conversion.precision);
+        } else if (conversion.conversion == 'p') {
+            arg->pointer = va_arg(copy, const void*);
+        } else {
+            arg->real = va_arg(copy, double);
+        }
+    }
+
+    va_end(copy);
+    return EXYZ_ERROR;
+}
+
+/// write the conversion `conversion` with the argument values starting at
+/// `args` in `buffer`, returning the number of bytes written
+static size_t format_conversion(
+    const exyz_error_state_t* state,
+    const conversion_t* conversion,
+    const exyz_error_arg_t* args,
+    char* buffer,
+    size_t size
+) {
+    // the conversion specification, with '*' replaced by the values from the
+    // arguments
+    char specification[64] = {0};
+    size_t length = 0;
+    for (size_t i=0; i<conversion->size && length + 16 < sizeof(specification); i++) {
+        char c = conversion->start[i];
+        if (c == '*') {
+            length += (size_t)snprintf(specification + length, sizeof(specification) - length, "%d", (int)args->integer);
+            args += 1;
+        } else {
+            specification[length] = c;
+            length += 1;
+        }
+    }
+
+    int written = 0;
+    char modifier = conversion->modifier;
+    if (is_signed_conversion(conversion->conversion)) {
+        if (modifier == 'l') {
+            written = snprintf(buffer, size, specification, (long)args->integer);
+        } else if (modifier == 'q') {
+            written = snprintf(buffer, size, specification, (long long)args->integer);
+        } else if (modifier == 'j') {
+            written = snprintf(buffer, size, specification, args->integer);
+        } else if (modifier == 'z' || modifier == 't') {
+            written = snprintf(buffer, size, specification, (ptrdiff_t)args->integer);
+        } else {
+            written = snprintf(buffer, size, specification, (int)args->integer);
+        }
+    } else if (is_unsigned_conversion(conversion->conversion)) {
+        if (modifier == 'l') {
+            written = snprintf(buffer, size, specification, (unsigned long)args->unsigned_integer);
+        } else if (modifier == 'q') {
+            written = snprintf(buffer, size, specification, (unsigned long long)args->unsigned_integer);
+        } else if (modifier == 'j') {
+            written = snprintf(buffer, size, specification, args->unsigned_integer);
+        } else if (modifier == 'z' || modifier == 't') {
+            written = snprintf(buffer, size, specification, (size_t)args->unsigned_integer);
+        } else {
+            written = snprintf(buffer, size, specification, (unsigned)args->unsigned_integer);
+        }
+    } else if (conversion->conversion == 's') {
+        written = snprintf(buffer, size, specification, state->strings + args->string);
+    } else if (conversion->conversion == 'p') {
+        written = snprintf(buffer, size, specification, args->pointer);
+    } else {
+        written = snprintf(buffer, size, specification, args->real);
+    }
+
+    if (written < 0) {
+        return 0;
+    }
+    return (size_t)written < size ? (size_t)written : size - 1;
+}
+
+/// create the message of the error in `state` from its format and arguments
+static void format_message(exyz_error_state_t* state) {
+    char* message = state->error.message;
+    size_t size = sizeof(state->error.message);
+    size_t length = 0;
+    size_t count = 0;
+
+    const char* current = state->format;
+    const char* literal = current;
+    conversion_t conversion;
+    while (length + 1 < size) {
+        bool found = next_conversion(&current, &conversion);
+        if (found && count + conversion_arguments(&conversion) > EXYZ_ERROR_MAX_ARGS) {
+            // the arguments of this conversion were not kept
+            found = false;
+        }
+
+        // copy the text before the conversion, replacing "%%" with '%'
+        const char* end = found ? conversion.start : literal + strlen(literal);
+        while (literal < end && length + 1 < size) {
+            message[length] = *literal;
+            length += 1;
+            literal += literal[0] == '%' && literal[1] == '%' ? 2 : 1;
+        }
+
+        if (!found) {
+            break;
+        }
+
+        length += format_conversion(state, &conversion, &state->args[count], message + length, size - length);
+        count += conversion_arguments(&conversion);
+        literal = current;
+    }
+
+    message[length] = '\0';
+    state->format = NULL;
+}
+
+const exyz_error_t* exyz_last_error(void) {
+    if (LAST_ERROR.format != NULL) {
+        format_message(&LAST_ERROR);
+    }
+    return &LAST_ERROR.error;
+}
+
+void exyz_reset_error(void) {
+    LAST_ERROR.error.message[0] = '\0';
+    LAST_ERROR.error.frame = -1;
+    LAST_ERROR.error.line = -1;
+    LAST_ERROR.error.offset = -1;
+    LAST_ERROR.format = NULL;
+}
+
+void exyz_save_error(exyz_error_state_t* state) {
+    *state = LAST_ERROR;
+}
+
+void exyz_restore_error(const exyz_error_state_t* state) {
+    LAST_ERROR = *state;
+}
+
+void exyz_error_at(int64_t line, int64_t offset) {
+    if (LAST_ERROR.error.line < 0 && LAST_ERROR.error.offset < 0) {
+        LAST_ERROR.error.line = line;
+        LAST_ERROR.error.offset = offset;
+    }
+}
+
+void exyz_error_shift(int64_t lines, int64_t offset) {
+    exyz_error_t* error = &LAST_ERROR.error;
+    if (error->line >= 0) {
+        error->line = lines >= 0 ? error->line + lines : -1;
+    }
+
+    if (error->offset >= 0) {
+        error->offset = offset >= 0 ? error->offset + offset : -1;
+    }
+}
+
+void exyz_error_frame(int64_t frame) {
+    if (LAST_ERROR.error.frame < 0) {
+        LAST_ERROR.error.frame = frame;
+    }
+}
+
+size_t exyz_error_format(const exyz_error_t* error, char* buffer, size_t size) {
+    if (error == &LAST_ERROR.error) {
+        exyz_last_error();
+    }
+
+    char position[128] = {0};
+    size_t length = 0;
+
+    if (error->frame >= 0) {
+        length += (size_t)snprintf(position + length, sizeof(position) - length, "frame %" PRId64, error->frame);
+    }
+
+    if (error->line >= 0) {
+        length += (size_t)snprintf(
+            position + length, sizeof(position) - length,
+            "%sline %" PRId64, length == 0 ? "" : ", ", error->line
+        );
+    }
+
+    if (error->offset >= 0) {
+        length += (size_t)snprintf(
+            position + length, sizeof(position) - length,
+            "%sbyte %" PRId64, length == 0 ? "" : ", ", error->offset
+        );
+    }
+
+    int written = 0;
+    if (length == 0) {
+        written = snprintf(buffer, size, "%s", error->message);
+    } else {
+        written = snprintf(buffer, size, "%s (%s)", error->message, position);
+    }
+
+    return written < 0 ? 0 : (size_t)written;
+}
@@ -10,8 +10,34 @@ typedef enum exyz_status_t {
     EXYZ_SUCCESS = 0,
     EXYZ_ERROR,
     EXYZ_FAILED_READING,
+    EXYZ_END_OF_FILE,
 } exyz_status_t;
 
+/// Description of an error in the library. Errors are never printed, instead
+/// the last one is stored for each thread and can be retrieved with
+/// `exyz_last_error`.
+typedef struct exyz_error_t {
+    /// error message, without the position of the error in the input
+    char message[256];
+    /// index of the frame containing the error, or -1 if unknown
+    int64_t frame;
+    /// line containing the error, starting at 1, or -1 if unknown
+    int64_t line;
+    /// offset of the error in bytes from the start of the input, or -1 if
+    /// unknown
+    int64_t offset;
+} exyz_error_t;
+
+/// Get the last error that happened in the current thread. This is reset when
+/// a reading function starts, and should only be used after a function
+/// returned `EXYZ_ERROR`.
+const exyz_error_t* exyz_last_error(void);
+
+/// Format the message of `error` together with the position of the error in
+/// `buffer`, which contains `size` bytes. Like `snprintf`, the length of the
+/// full message is returned even if it was truncated.
+size_t exyz_error_format(const exyz_error_t* error, char* buffer, size_t size);
+
 typedef enum exyz_data_t {
     EXYZ_INTEGER = 'I',
     EXYZ_REAL = 'R',
@@ -20,6 +46,51 @@ typedef enum exyz_data_t {
     EXYZ_ARRAY = 'A',
 } exyz_data_t;
 
+/// Memory allocator used by the library. `realloc` is only called with
+/// memory from the same allocator, and `free` is never called with NULL.
+/// `data` is given as the first argument of all functions.
+typedef struct exyz_allocator_t {
+    void* (*malloc)(void* data, size_t size);
+    void* (*realloc)(void* data, void* ptr, size_t size);
+    void (*free)(void* data, void* ptr);
+    void* data;
+} exyz_allocator_t;
+
+/// Set the allocator used by all threads that did not select another one with
+/// `exyz_use_allocator`, or go back to the C library allocator if `allocator`
+/// is NULL. All the memory returned by the library (including the memory
+/// released by the `exyz_*_free` functions) comes from this allocator, so it
+/// should be set before using any other function.
+void exyz_set_allocator(const exyz_allocator_t* allocator);
+
+/// Use `allocator` for all the allocations and deallocations made by the
+/// current thread, until this function is called again. Passing NULL goes
+/// back to the global allocator. `allocator` must stay valid while it is in
+/// use, and the allocator that was previously selected (or NULL) is returned.
+const exyz_allocator_t* exyz_use_allocator(const exyz_allocator_t* allocator);
+
+/// Free memory allocated by the library, such as the lists of `exyz_info_t`
+/// or `exyz_atom_array_t` returned by `exyz_read`, using the allocator of the
+/// current thread.
+void exyz_free(void* ptr);
+
+/// Allocation counts maintained by `exyz_counting_allocator`
+typedef struct exyz_allocation_counts_t {
+    /// number of allocations and deallocations, `realloc` counting as both
+    uint64_t allocations;
+    uint64_t frees;
+    /// total number of bytes requested by all allocations
+    uint64_t allocated_bytes;
+    /// number of bytes currently allocated, and maximal value over time
+    uint64_t current_bytes;
+    uint64_t peak_bytes;
+} exyz_allocation_counts_t;
+
+/// Initialize `allocator` to use the C library allocator, while keeping track
+/// of allocations in `counts`, which is zeroed. The counts are updated
+/// atomically, so the allocator can be used by multiple threads.
+void exyz_counting_allocator(exyz_allocator_t* allocator, exyz_allocation_counts_t* counts);
+
 typedef struct exyz_array_t {
     union {
         int64_t* integer;
@@ -54,6 +125,11 @@ typedef struct exyz_info_t {
     enum exyz_data_t type;
 } exyz_info_t;
 
+/// Find the frame property named `key` in `info`, or return NULL if there is
+/// no such property. This is a linear search, use `exyz_info_index` to look up
+/// many keys in the same list.
+const exyz_info_t* exyz_info_find(const exyz_info_t* info, size_t count, const char* key);
+
 exyz_status_t exyz_info_init_integer(exyz_info_t* info, const char* name, int64_t value);
 exyz_status_t exyz_info_init_real(exyz_info_t* info, const char* name, double value);
 exyz_status_t exyz_info_init_string(exyz_info_t* info, const char* name, const char* value);
@@ -70,12 +146,28 @@ typedef struct exyz_atom_property_t {
 
 exyz_status_t exyz_atom_property_free(exyz_atom_property_t property);
 
+/// Hash table from the keys of a list of frame properties (or atom
+/// properties) to their position in the list, to look up many keys without a
+/// linear search for each one. The index borrows the keys of the list, and
+/// must be freed with `exyz_keys_index_free` before the list.
+typedef struct exyz_keys_index_t exyz_keys_index_t;
+
+exyz_status_t exyz_info_index(const exyz_info_t* info, size_t count, exyz_keys_index_t** index);
+exyz_status_t exyz_atom_properties_index(const exyz_atom_property_t* properties, size_t count, exyz_keys_index_t** index);
+
+/// Get the position of `key` in the list used to create `index`, or -1 if it
+/// is not there. The first position is used for duplicated keys.
+int64_t exyz_keys_index_find(const exyz_keys_index_t* index, const char* key);
+
+void exyz_keys_index_free(exyz_keys_index_t* index);
+
 /// Atom properties
 typedef struct exyz_atom_array_t {
     char* key;
     exyz_array_t array;
 } exyz_atom_array_t;
 
+exyz_status_t exyz_atom_array_free(exyz_atom_array_t array);
 
 exyz_status_t exyz_read_comment_line(
     const char* line,
@@ -86,6 +178,8 @@ exyz_status_t exyz_read_comment_line(
     size_t* info_count
 );
 
+/// Read the next frame in `fp`. The file is only read forward, so `fp` can also
+/// be a pipe or the standard input, in which case offsets in errors are unknown.
 exyz_status_t exyz_read(
     FILE* fp,
     size_t* n_atoms,
@@ -95,6 +189,275 @@ exyz_status_t exyz_read(
     size_t* arrays_count
 );
 
+/// A frame with a parsed comment line, where the atoms lines are kept as text
+/// and each atom property is only parsed the first time it is requested.
+typedef struct exyz_lazy_frame_t exyz_lazy_frame_t;
+
+/// Read the next frame in `fp` like `exyz_read`, only parsing the comment
+/// line. The frame must be released with `exyz_lazy_frame_free`.
+exyz_status_t exyz_read_lazy(FILE* fp, exyz_lazy_frame_t** frame);
+
+size_t exyz_lazy_frame_n_atoms(const exyz_lazy_frame_t* frame);
+
+/// Get the values from the comment line of this frame, which are owned by
+/// the frame.
+const exyz_info_t* exyz_lazy_frame_info(const exyz_lazy_frame_t* frame, size_t* count);
+
+/// Get the atom properties defined in the comment line of this frame, which
+/// are owned by the frame.
+const exyz_atom_property_t* exyz_lazy_frame_properties(const exyz_lazy_frame_t* frame, size_t* count);
+
+/// Get the values of the atom property `key` in `array`, parsing them from the
+/// atoms lines on the first call and returning the same array afterwards. The
+/// array is owned by the frame. Invalid values in the atoms lines are only
+/// reported when requesting the corresponding property.
+exyz_status_t exyz_lazy_frame_array(exyz_lazy_frame_t* frame, const char* key, const exyz_array_t** array);
+
+/// Get the text of the line for `atom` in this frame, without the end of line
+/// characters. The offsets of the lines are found on the first call.
+exyz_status_t exyz_lazy_frame_line(exyz_lazy_frame_t* frame, size_t atom, const char** line, size_t* length);
+
+void exyz_lazy_frame_free(exyz_lazy_frame_t* frame);
+
+/// Performance counters for the parser. Statistics are accumulated across
+/// calls, so the same `exyz_stats_t` can be used for many frames; zero it to
+/// start again. All counters are cheap enough to be always enabled.
+typedef struct exyz_stats_t {
+    /// number of bytes of (uncompressed) input consumed by the parser
+    uint64_t bytes;
+    uint64_t frames;
+    uint64_t atoms;
+    /// number of frames skipped without parsing their atoms, e.g. because
+    /// they were rejected by a reader filter
+    uint64_t skipped_frames;
+    /// number of values read, by type. Atom properties count one value for
+    /// each atom and each column, while frame properties containing arrays
+    /// are counted in `arrays`.
+    uint64_t integers;
+    uint64_t reals;
+    uint64_t booleans;
+    uint64_t strings;
+    uint64_t arrays;
+    /// number of memory allocations made by the parser, and total number of
+    /// bytes requested by these allocations
+    uint64_t allocations;
+    uint64_t allocated_bytes;
+    /// number of times a value in the comment line failed to parse as one
+    /// type, and the parser had to try again with the next possible type
+    uint64_t failed_reads;
+    /// time spent finding the limits of frames in the input
+    uint64_t framing_ns;
+    /// time spent parsing the comment line
+    uint64_t comment_line_ns;
+    /// time spent parsing the atoms lines
+    uint64_t atoms_ns;
+} exyz_stats_t;
+
+/// Collect statistics for all the parsing done by the current thread in
+/// `stats`, until this function is called again. Passing NULL stops the
+/// collection. This returns the statistics that were previously collected.
+exyz_stats_t* exyz_stats_collect(exyz_stats_t* stats);
+
+/// Get the name of the instruction set used by the vectorized parts of the
+/// parser: "avx512", "avx2", "sse2" or "scalar". This is detected from the
+/// CPU when the library is first used, unless the library was built with a
+/// fixed level.
+const char* exyz_simd_level(void);
+
+/// Compression formats, detected from the first bytes of the input
+typedef enum exyz_compression_t {
+    EXYZ_COMPRESSION_NONE = 0,
+    EXYZ_COMPRESSION_GZIP,
+    EXYZ_COMPRESSION_ZSTD,
+    EXYZ_COMPRESSION_XZ,
+} exyz_compression_t;
+
+/// Was the library built with support for the given compression format?
+bool exyz_compression_supported(exyz_compression_t compression);
+
+/// In-memory cache of parsed frames, keyed by their index in a file. The least
+/// recently used frames are evicted once the memory used by the frames data
+/// goes over the budget of the cache. A cache can be shared by multiple
+/// readers, including readers used concurrently from different threads.
+typedef struct exyz_frame_cache_t exyz_frame_cache_t;
+
+/// Create a frame cache storing at most `max_bytes` bytes of frames data
+exyz_status_t exyz_frame_cache_create(exyz_frame_cache_t** cache, size_t max_bytes);
+
+/// Counters describing the use of a frame cache
+typedef struct exyz_frame_cache_counts_t {
+    /// number of frames found in the cache
+    uint64_t hits;
+    /// number of frames which had to be read from the file
+    uint64_t misses;
+    /// number of frames removed to stay under the memory budget
+    uint64_t evictions;
+    /// current number of frames in the cache
+    uint64_t frames;
+    /// current memory used by the frames in the cache
+    uint64_t bytes;
+} exyz_frame_cache_counts_t;
+
+void exyz_frame_cache_counts(const exyz_frame_cache_t* cache, exyz_frame_cache_counts_t* counts);
+
+/// Release a frame cache and all the frames it contains. Readers using this
+/// cache must be closed first.
+void exyz_frame_cache_free(exyz_frame_cache_t* cache);
+
+/// Streaming reader for trajectory files. Compressed files are decompressed
+/// on a separate thread while the parser runs, and the input is only read
+/// forward.
+typedef struct exyz_reader_t exyz_reader_t;
+
+exyz_status_t exyz_reader_open(exyz_reader_t** reader, const char* path);
+/// Create a reader from an already opened file, which will not be closed by
+/// `exyz_reader_close`.
+exyz_status_t exyz_reader_from_file(exyz_reader_t** reader, FILE* fp);
+
+exyz_compression_t exyz_reader_compression(const exyz_reader_t* reader);
+
+/// Read the next frame, returning `EXYZ_END_OF_FILE` once all frames have
+/// been read.
+exyz_status_t exyz_reader_read(
+    exyz_reader_t* reader,
+    size_t* n_atoms,
+    exyz_info_t** info,
+    size_t* info_count,
+    exyz_atom_array_t** arrays,
+    size_t* arrays_count
+);
+
+/// Read the next frame like `exyz_reader_read`, only parsing the comment line.
+/// The atom properties selection does not apply to lazy frames, which give
+/// access to all properties. The frame must be released with
+/// `exyz_lazy_frame_free`.
+exyz_status_t exyz_reader_read_lazy(exyz_reader_t* reader, exyz_lazy_frame_t** frame);
+
+/// Get the number of frames in the file. This requires an index of the frames,
+/// such as the one stored in files created by `exyz_compress_seekable`.
+exyz_status_t exyz_reader_frames_count(exyz_reader_t* reader, size_t* count);
+
+/// Move the reader to the frame at `index`, so that the next call to
+/// `exyz_reader_read` returns this frame. This requires an index of the
+/// frames, such as the one stored in files created by `exyz_compress_seekable`.
+exyz_status_t exyz_reader_seek_frame(exyz_reader_t* reader, size_t index);
+
+/// Collect statistics for all frames read with this reader in `stats`, which
+/// must stay valid until the reader is closed or this is called again with
+/// NULL. This takes precedence over `exyz_stats_collect` for this reader.
+void exyz_reader_set_stats(exyz_reader_t* reader, exyz_stats_t* stats);
+
+/// Allocate the frames returned by this reader with `allocator`, instead of
+/// the allocator of the calling thread. The frames must be freed while the
+/// same allocator is in use. The buffers of the reader itself always use the
+/// allocator that was in use when it was opened. `allocator` must stay valid
+/// until the reader is closed, or this is called again with NULL.
+void exyz_reader_set_allocator(exyz_reader_t* reader, const exyz_allocator_t* allocator);
+
+/// Only read the atom properties in `names` (e.g. "pos" and "forces") in the
+/// frames returned by this reader. The values of the other properties are
+/// skipped without being converted. Selected properties missing from a frame
+/// are not returned for this frame, and the arrays are returned in the order
+/// of the `Properties` of each frame. `names` are copied, and a NULL `names`
+/// reads all properties again.
+exyz_status_t exyz_reader_select_properties(exyz_reader_t* reader, const char* const* names, size_t count);
+
+/// Function deciding if a frame should be returned by a reader, given the
+/// number of atoms and the `info` from the comment line of the frame. `data`
+/// is the pointer given to `exyz_reader_set_filter`.
+typedef bool (*exyz_frame_filter_t)(size_t n_atoms, const exyz_info_t* info, size_t info_count, void* data);
+
+/// Only return the frames accepted by `filter` from this reader. The filter is
+/// called after parsing the comment line, and the atoms lines of rejected
+/// frames are skipped without being parsed. A NULL `filter` returns all frames
+/// again.
+void exyz_reader_set_filter(exyz_reader_t* reader, exyz_frame_filter_t filter, void* data);
+
+/// Only return the frames with `start <= index < stop` and `index - start` a
+/// multiple of `step` from this reader, where `index` counts all frames in
+/// the file. Use `SIZE_MAX` as `stop` to read until the end of the file. Other
+/// frames are skipped without parsing them, or by seeking when the file
+/// contains an index of the frames. This applies to frames after the current
+/// position of the reader, before the filter from `exyz_reader_set_filter`.
+exyz_status_t exyz_reader_set_stride(exyz_reader_t* reader, size_t start, size_t stop, size_t step);
+
+/// Use up to `threads` threads to parse the atoms lines of large frames in
+/// this reader. Smaller frames are always parsed by the calling thread. The
+/// default `0` uses one thread per CPU, and `1` disables parallel parsing.
+/// This also sets the number of threads decompressing zstd seekable files
+/// (a single one by default), up to a small maximum.
+void exyz_reader_set_threads(exyz_reader_t* reader, size_t threads);
+
+/// Read the string atom property `name` (usually "species") of the next
+/// frames as atomic numbers, in an `EXYZ_INTEGER` array, instead of creating
+/// one string per atom. Labels which are not element symbols are an error if
+/// `strict` is true, and are given the atomic number `unknown` otherwise. Use
+/// `NULL` as `name` to read the property as strings again.
+exyz_status_t exyz_reader_set_atomic_numbers(exyz_reader_t* reader, const char* name, bool strict, int64_t unknown);
+
+/// Keep the frames returned by this reader in `cache`, and return copies of
+/// the cached frames instead of parsing them again. With an index of the
+/// frames in the file, seeking to a cached frame and reading it does not
+/// access the file. Cached frames are stored after applying the filter and
+/// atom properties selection of the reader which added them, so all readers
+/// sharing a cache should read the same file with the same options. Use `NULL`
+/// to stop using a cache.
+void exyz_reader_set_frame_cache(exyz_reader_t* reader, exyz_frame_cache_t* cache);
+
+/// Get the last error that happened while reading with this reader, with the
+/// position of the error in the (uncompressed) file.
+const exyz_error_t* exyz_reader_last_error(const exyz_reader_t* reader);
+
+exyz_status_t exyz_reader_close(exyz_reader_t* reader);
+
+/// Find the start of all frames in the uncompressed trajectory at `path`,
+/// using `threads` threads (or one per CPU if `threads` is 0). On success,
+/// `offsets` contains `frames_count + 1` entries: the offset of the first
+/// line of each frame, and the end of the last frame. The result does not
+/// depend on the number of threads, and `offsets` must be freed with
+/// `exyz_free`.
+exyz_status_t exyz_index_frames(const char* path, size_t threads, uint64_t** offsets, size_t* frames_count);
+
+/// Compress the trajectory at `input` to `output`, using the zstd seekable
+/// format. Each compressed block contains a whole number of frames and at
+/// least `block_size` bytes of uncompressed data (except for the last block),
+/// and the file contains an index of which frames are in which block.
+exyz_status_t exyz_compress_seekable(
+    const char* input,
+    const char* output,
+    size_t block_size,
+    int level
+);
+
+/// Binary cache of a text trajectory, storing the parsed frames in a
+/// memory-mapped file to avoid parsing the same file multiple times.
+typedef struct exyz_cache_t exyz_cache_t;
+
+/// Open the binary cache for the trajectory at `path`. The cache is stored in
+/// `cache_path`, or in `<path>.exyzcache` if `cache_path` is NULL. If the cache
+/// does not exist yet, or if the size, modification time or content of the
+/// trajectory changed since the cache was created, the whole trajectory is
+/// parsed and the cache is created again.
+exyz_status_t exyz_cache_open(exyz_cache_t** cache, const char* path, const char* cache_path);
+
+size_t exyz_cache_frames_count(const exyz_cache_t* cache);
+
+/// Get the frame at `index` from the cache. Keys, strings and arrays point
+/// directly inside the memory-mapped cache, and must not be freed. The data
+/// stays valid until the cache is closed, while `info` and `arrays` are only
+/// valid until the next call to `exyz_cache_read`.
+exyz_status_t exyz_cache_read(
+    exyz_cache_t* cache,
+    size_t index,
+    size_t* n_atoms,
+    exyz_info_t** info,
+    size_t* info_count,
+    exyz_atom_array_t** arrays,
+    size_t* arrays_count
+);
+
+exyz_status_t exyz_cache_close(exyz_cache_t* cache);
+
 exyz_status_t exyz_write(
     FILE* fp,
     size_t* n_atoms,
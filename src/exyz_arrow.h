@@ -0,0 +1,131 @@
+#ifndef EXYZ_ARROW_H
+#define EXYZ_ARROW_H
+
+// this file must be included after exyz.h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Arrow C Data Interface, as defined in
+// https://arrow.apache.org/docs/format/CDataInterface.html
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema {
+    // Array type description
+    const char* format;
+    const char* name;
+    const char* metadata;
+    int64_t flags;
+    int64_t n_children;
+    struct ArrowSchema** children;
+    struct ArrowSchema* dictionary;
+
+    // Release callback
+    void (*release)(struct ArrowSchema*);
+    // Opaque producer-specific data
+    void* private_data;
+};
+
+struct ArrowArray {
+    // Array data description
+    int64_t length;
+    int64_t null_count;
+    int64_t offset;
+    int64_t n_buffers;
+    int64_t n_children;
+    const void** buffers;
+    struct ArrowArray** children;
+    struct ArrowArray* dictionary;
+
+    // Release callback
+    void (*release)(struct ArrowArray*);
+    // Opaque producer-specific data
+    void* private_data;
+};
+
+#endif  // ARROW_C_DATA_INTERFACE
+
+// Arrow C Stream Interface, as defined in
+// https://arrow.apache.org/docs/format/CStreamInterface.html
+#ifndef ARROW_C_STREAM_INTERFACE
+#define ARROW_C_STREAM_INTERFACE
+
+struct ArrowArrayStream {
+    // Callbacks providing stream functionality
+    int (*get_schema)(struct ArrowArrayStream*, struct ArrowSchema* out);
+    int (*get_next)(struct ArrowArrayStream*, struct ArrowArray* out);
+    const char* (*get_last_error)(struct ArrowArrayStream*);
+
+    // Release callback
+    void (*release)(struct ArrowArrayStream*);
+    // Opaque producer-specific data
+    void* private_data;
+};
+
+#endif  // ARROW_C_STREAM_INTERFACE
+
+/// Export the atom properties of a single frame as an Arrow struct array, with
+/// one row per atom and one child per property. String properties (such as
+/// the species) are dictionary-encoded, and properties with multiple columns
+/// (such as the positions) are exported as fixed-size lists.
+///
+/// On success, the Arrow array takes ownership of `arrays`, which must have
+/// been allocated by `exyz_read` or `exyz_reader_read`, and the caller must
+/// not free it. Integer and real data is exported without copies, and freed
+/// once all the exported arrays have been released. Use
+/// `exyz_arrow_export_atoms_stream` to export multiple frames.
+exyz_status_t exyz_arrow_export_atoms(
+    size_t n_atoms,
+    exyz_atom_array_t* arrays,
+    size_t arrays_count,
+    struct ArrowSchema* schema,
+    struct ArrowArray* array
+);
+
+/// Export the atom properties of `frames_count` frames as an Arrow stream,
+/// where each frame is a separate struct array (a chunk of the table) using
+/// the same layout as `exyz_arrow_export_atoms`. Frame `i` contains
+/// `n_atoms[i]` atoms and the `arrays_count[i]` properties in `arrays[i]`. All
+/// frames must have the same atom properties, in the same order and with the
+/// same types and number of columns. The dictionary of string properties can
+/// differ between frames.
+///
+/// On success, the stream takes ownership of all the `arrays[i]`, and the
+/// caller must not free them. On error, the caller keeps ownership. The
+/// `n_atoms`, `arrays` and `arrays_count` lists themselves are copied. Frames
+/// are exported without copies when requested with `get_next`, and frames
+/// which are never requested are freed with the stream.
+exyz_status_t exyz_arrow_export_atoms_stream(
+    size_t frames_count,
+    const size_t* n_atoms,
+    exyz_atom_array_t* const* arrays,
+    const size_t* arrays_count,
+    struct ArrowArrayStream* stream
+);
+
+/// Export the scalar info of `frames_count` frames as an Arrow struct array,
+/// with one row per frame and one child per key. `info[i]` contains the
+/// `info_count[i]` values for frame `i`. The type of each column is taken from
+/// the first frame containing the key, and values missing from a frame (or
+/// with a different type) are null. Array values are not exported.
+///
+/// The values are copied, and `info` is not modified.
+exyz_status_t exyz_arrow_export_info(
+    exyz_info_t* const* info,
+    const size_t* info_count,
+    size_t frames_count,
+    struct ArrowSchema* schema,
+    struct ArrowArray* array
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
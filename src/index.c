@@ -0,0 +1,363 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "exyz.h"
+#include "internal.h"
+
+static exyz_status_t error(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    exyz_status_t status = exyz_set_error(format, args);
+    va_end(args);
+
+    return status;
+}
+
+// The frames are found in two passes. First, the file is split in one range
+// of bytes per thread, and each thread goes over the lines starting in its
+// range. Lines which could start a frame (a single integer) or which could be
+// skipped between frames (blank lines) are recorded with their line number
+// inside the range. All other lines are only counted.
+//
+// Then, the number of lines in each range gives the global line numbers, and
+// a single thread follows the chain of frames from the start of the file,
+// using the number of atoms of each frame to find the line where the next one
+// starts. Only the recorded lines are visited in this pass.
+
+/// minimal number of bytes given to each thread
+#define INDEX_MIN_RANGE_SIZE (4 * 1024 * 1024)
+
+/// `n_atoms` value used for blank lines
+#define BLANK_LINE UINT64_MAX
+
+/// a line that could be visited by the chain of frames
+typedef struct index_line_t {
+    /// line number, starting at 0
+    uint64_t line;
+    /// offset of the start of the line in the file
+    uint64_t offset;
+    /// number of atoms if this line contains a single integer, or
+    /// `BLANK_LINE` for blank lines
+    uint64_t n_atoms;
+} index_line_t;
+
+typedef struct index_task_t {
+    const char* data;
+    size_t size;
+    /// lines starting between `start` and `end` belong to this task
+    size_t start;
+    size_t end;
+    /// number of lines starting in this range
+    uint64_t lines_count;
+    /// candidate lines, with line numbers relative to the start of the range
+    index_line_t* lines;
+    size_t count;
+    size_t capacity;
+    exyz_status_t status;
+    /// allocator of the thread which started this task
+    const exyz_allocator_t* allocator;
+} index_task_t;
+
+static bool is_blank(const char* line, size_t length) {
+    for (size_t i=0; i<length; i++) {
+        char c = line[i];
+        if (c != ' ' && c != '\t' && c != '\r') {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// check if `line` only contains a number of atoms, using the same rules as
+/// the reader, and store it in `n_atoms`
+static bool is_atoms_count(const char* line, size_t length, uint64_t* n_atoms) {
+    size_t i = 0;
+    while (i < length && (line[i] == ' ' || line[i] == '\t')) {
+        i++;
+    }
+
+    size_t start = i;
+    uint64_t value = 0;
+    while (i < length && line[i] >= '0' && line[i] <= '9') {
+        uint64_t digit = (uint64_t)(line[i] - '0');
+        if (value > (SIZE_MAX - 1 - digit) / 10) {
+            return false;
+        }
+        value = 10 * value + digit;
+        i++;
+    }
+
+    if (i == start) {
+        return false;
+    }
+
+    while (i < length && (line[i] == ' ' || line[i] == '\t' || line[i] == '\r')) {
+        i++;
+    }
+
+    *n_atoms = value;
+    return i == length;
+}
+
+static exyz_status_t add_line(index_task_t* task, uint64_t line, size_t offset, uint64_t n_atoms) {
+    if (task->count == task->capacity) {
+        size_t capacity = task->capacity == 0 ? 1024 : 2 * task->capacity;
+        index_line_t* lines = exyz_realloc(task->lines, capacity * sizeof(index_line_t));
+        if (lines == NULL) {
+            return error("failed to allocate memory");
+        }
+        task->lines = lines;
+        task->capacity = capacity;
+    }
+
+    task->lines[task->count].line = line;
+    task->lines[task->count].offset = offset;
+    task->lines[task->count].n_atoms = n_atoms;
+    task->count += 1;
+    return EXYZ_SUCCESS;
+}
+
+/// go over the lines starting in the range of `task`
+static void* index_range(void* data) {
+    index_task_t* task = data;
+    const exyz_allocator_t* previous_allocator = exyz_use_allocator(task->allocator);
+
+    const char* file = task->data;
+    size_t position = task->start;
+    if (position != 0) {
+        // the first line of this range starts after the first newline at or
+        // after the end of the previous range
+        const char* newline = memchr(file + position - 1, '\n', task->size - position + 1);
+        position = newline != NULL ? (size_t)(newline - file) + 1 : task->size;
+    }
+
+    task->status = EXYZ_SUCCESS;
+    while (position < task->end) {
+        const char* line = file + position;
+        const char* newline = memchr(line, '\n', task->size - position);
+        size_t length = newline != NULL ? (size_t)(newline - line) : task->size - position;
+
+        // most lines are atoms lines, starting with a letter
+        char first = line[0];
+        uint64_t n_atoms = 0;
+        if ((first >= '0' && first <= '9') || first == ' ' || first == '\t' || first == '\r' || first == '\n') {
+            if (is_blank(line, length)) {
+                task->status = add_line(task, task->lines_count, position, BLANK_LINE);
+            } else if (is_atoms_count(line, length, &n_atoms)) {
+                task->status = add_line(task, task->lines_count, position, n_atoms);
+            }
+
+            if (task->status != EXYZ_SUCCESS) {
+                break;
+            }
+        }
+
+        task->lines_count += 1;
+        position += length + 1;
+    }
+
+    exyz_use_allocator(previous_allocator);
+    return NULL;
+}
+
+/// follow the chain of frames through the candidate `lines` of a file with
+/// `lines_count` lines and `size` bytes, storing the start of each frame in
+/// `offsets`
+static exyz_status_t follow_frames(
+    const index_line_t* lines,
+    size_t count,
+    uint64_t lines_count,
+    size_t size,
+    uint64_t** offsets,
+    size_t* frames_count
+) {
+    size_t capacity = 1024;
+    *offsets = exyz_malloc(capacity * sizeof(uint64_t));
+    if (*offsets == NULL) {
+        return error("failed to allocate memory");
+    }
+    *frames_count = 0;
+
+    uint64_t next = 0;
+    // the last frame ends at the first blank line after it, or at the end of
+    // the file
+    uint64_t end_line = 0;
+    uint64_t end = 0;
+    size_t current = 0;
+    while (next < lines_count) {
+        while (current < count && lines[current].line < next) {
+            current += 1;
+        }
+
+        if (current == count || lines[current].line != next) {
+            error("failed to parse the number of atoms");
+            exyz_error_at((int64_t)next + 1, -1);
+            exyz_error_frame((int64_t)*frames_count);
+            return EXYZ_ERROR;
+        }
+
+        const index_line_t* line = &lines[current];
+        if (line->n_atoms == BLANK_LINE) {
+            // skip empty lines between frames and at the end of the file
+            if (next == end_line && *frames_count != 0) {
+                end = line->offset;
+            }
+            next += 1;
+            continue;
+        }
+
+        if (lines_count - next < 2 || line->n_atoms > lines_count - next - 2) {
+            error("not enough lines in file for XYZ format: expected %zu atoms", (size_t)line->n_atoms);
+            exyz_error_at((int64_t)next + 1, (int64_t)line->offset);
+            exyz_error_frame((int64_t)*frames_count);
+            return EXYZ_ERROR;
+        }
+
+        if (*frames_count + 1 == capacity) {
+            capacity *= 2;
+            uint64_t* new_offsets = exyz_realloc(*offsets, capacity * sizeof(uint64_t));
+            if (new_offsets == NULL) {
+                return error("failed to allocate memory");
+            }
+            *offsets = new_offsets;
+        }
+
+        (*offsets)[*frames_count] = line->offset;
+        *frames_count += 1;
+
+        next += line->n_atoms + 2;
+        end_line = next;
+        end = size;
+    }
+
+    (*offsets)[*frames_count] = end;
+    return EXYZ_SUCCESS;
+}
+
+exyz_status_t exyz_index_frames(const char* path, size_t threads, uint64_t** offsets, size_t* frames_count) {
+    *offsets = NULL;
+    *frames_count = 0;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return error("failed to open '%s'", path);
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return error("failed to get information about '%s'", path);
+    }
+
+    size_t size = (size_t)info.st_size;
+    if (size == 0) {
+        close(fd);
+        *offsets = exyz_calloc(1, sizeof(uint64_t));
+        if (*offsets == NULL) {
+            return error("failed to allocate memory");
+        }
+        return EXYZ_SUCCESS;
+    }
+
+    const char* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return error("failed to map '%s' in memory", path);
+    }
+    madvise((void*)data, size, MADV_SEQUENTIAL);
+
+    if (threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus < 1 ? 1 : (size_t)cpus;
+    }
+    if (threads > size / INDEX_MIN_RANGE_SIZE + 1) {
+        threads = size / INDEX_MIN_RANGE_SIZE + 1;
+    }
+
+    exyz_status_t status = EXYZ_SUCCESS;
+    index_task_t* tasks = exyz_calloc(threads, sizeof(index_task_t));
+    pthread_t* handles = exyz_calloc(threads, sizeof(pthread_t));
+    bool* started = exyz_calloc(threads, sizeof(bool));
+    index_line_t* lines = NULL;
+    if (tasks == NULL || handles == NULL || started == NULL) {
+        status = error("failed to allocate memory");
+        goto cleanup;
+    }
+
+    for (size_t t=0; t<threads; t++) {
+        tasks[t].data = data;
+        tasks[t].size = size;
+        tasks[t].start = t * (size / threads);
+        tasks[t].end = t + 1 == threads ? size : (t + 1) * (size / threads);
+        tasks[t].allocator = exyz_current_allocator();
+        if (t != 0) {
+            started[t] = pthread_create(&handles[t], NULL, index_range, &tasks[t]) == 0;
+        }
+    }
+
+    // the first range is handled by the current thread, as well as any range
+    // for which we could not start a thread
+    index_range(&tasks[0]);
+    for (size_t t=1; t<threads; t++) {
+        if (started[t]) {
+            pthread_join(handles[t], NULL);
+        } else {
+            index_range(&tasks[t]);
+        }
+    }
+
+    // give global line numbers to all candidate lines
+    uint64_t lines_count = 0;
+    size_t count = 0;
+    for (size_t t=0; t<threads; t++) {
+        if (tasks[t].status != EXYZ_SUCCESS) {
+            status = error("failed to allocate memory");
+            goto cleanup;
+        }
+        count += tasks[t].count;
+    }
+
+    lines = exyz_malloc((count + 1) * sizeof(index_line_t));
+    if (lines == NULL) {
+        status = error("failed to allocate memory");
+        goto cleanup;
+    }
+
+    count = 0;
+    for (size_t t=0; t<threads; t++) {
+        for (size_t i=0; i<tasks[t].count; i++) {
+            lines[count] = tasks[t].lines[i];
+            lines[count].line += lines_count;
+            count += 1;
+        }
+        lines_count += tasks[t].lines_count;
+    }
+
+    status = follow_frames(lines, count, lines_count, size, offsets, frames_count);
+    if (status != EXYZ_SUCCESS) {
+        exyz_free(*offsets);
+        *offsets = NULL;
+        *frames_count = 0;
+    }
+
+cleanup:
+    if (tasks != NULL) {
+        for (size_t t=0; t<threads; t++) {
+            exyz_free(tasks[t].lines);
+        }
+    }
+    exyz_free(lines);
+    exyz_free(started);
+    exyz_free(handles);
+    exyz_free(tasks);
+    munmap((void*)data, size);
+
+    return status;
+}
@@ -0,0 +1,340 @@
+#ifndef EXYZ_INTERNAL_H
+#define EXYZ_INTERNAL_H
+
+// this file must be included after exyz.h
+
+/******************************************************************************/
+/*                                 Errors                                     */
+/******************************************************************************/
+
+/// Maximal number of arguments kept for the message of an error
+#define EXYZ_ERROR_MAX_ARGS 8
+
+/// Value of an argument in the format of an error message
+typedef union exyz_error_arg_t {
+    intmax_t integer;
+    uintmax_t unsigned_integer;
+    double real;
+    const void* pointer;
+    /// offset of the string in `exyz_error_state_t.strings`
+    size_t string;
+} exyz_error_arg_t;
+
+/// Last error of a thread. The message is only created from `format` and
+/// `args` when the error is requested with `exyz_last_error`.
+typedef struct exyz_error_state_t {
+    /// the error, `error.message` is only set once `format` is NULL
+    exyz_error_t error;
+    /// format of the message, this must be a string literal
+    const char* format;
+    /// arguments for `format`
+    exyz_error_arg_t args[EXYZ_ERROR_MAX_ARGS];
+    /// copies of the string arguments, which might not outlive the call to
+    /// `exyz_set_error`
+    char strings[256];
+} exyz_error_state_t;
+
+/// Record an error in the current thread, replacing the previous one. The
+/// position of the error is unknown until set by `exyz_error_at`. This always
+/// returns `EXYZ_ERROR`. `format` must be a string literal, and only supports
+/// the `printf` conversions for integers, reals, strings and pointers.
+exyz_status_t exyz_set_error(const char* format, va_list args);
+
+/// Clear the last error of the current thread, this is done when entering
+/// the public reading functions.
+void exyz_reset_error(void);
+
+/// Copy the last error of the current thread to `state`, without creating
+/// its message.
+void exyz_save_error(exyz_error_state_t* state);
+
+/// Replace the last error of the current thread with `state`, e.g. to move an
+/// error from a worker thread to the thread that started it.
+void exyz_restore_error(const exyz_error_state_t* state);
+
+/// Set the position of the last error, relative to the start of the data
+/// being parsed, if it is not already known. Lines start at 1.
+void exyz_error_at(int64_t line, int64_t offset);
+
+/// Update the position of the last error when going from a piece of input to
+/// a larger one containing it, starting `lines` lines and `offset` bytes
+/// after the beginning. Negative values mark the position as unknown.
+void exyz_error_shift(int64_t lines, int64_t offset);
+
+/// Set the frame containing the last error, if it is not already known
+void exyz_error_frame(int64_t frame);
+
+/******************************************************************************/
+/*                               Statistics                                   */
+/******************************************************************************/
+
+/// Statistics collected by the current thread, or NULL if statistics are not
+/// being collected. This is a variable and not a function call to keep the
+/// cost of checking it as low as possible.
+extern _Thread_local exyz_stats_t* exyz_current_stats;
+
+/// Get a monotonic timestamp in nanoseconds
+uint64_t exyz_stats_now(void);
+
+/// Add all the counters in `other` to `stats`, e.g. to merge the statistics
+/// collected by worker threads
+void exyz_stats_add(exyz_stats_t* stats, const exyz_stats_t* other);
+
+/******************************************************************************/
+/*                               Allocations                                  */
+/******************************************************************************/
+
+/// Get the allocator used by the current thread
+const exyz_allocator_t* exyz_current_allocator(void);
+
+/// Allocation functions used by the whole library, going through the
+/// allocator of the current thread and counting allocations in the current
+/// statistics. Memory from all of these must be released with `exyz_free`.
+void* exyz_malloc(size_t size);
+void* exyz_calloc(size_t count, size_t size);
+void* exyz_realloc(void* ptr, size_t size);
+char* exyz_strdup(const char* string);
+char* exyz_strndup(const char* string, size_t size);
+
+/******************************************************************************/
+/*                                 Parser                                     */
+/******************************************************************************/
+
+/// Options controlling which parts of a frame are parsed
+typedef struct exyz_parse_options_t {
+    /// names of the atom properties to read, or NULL to read all of them.
+    /// Other properties are skipped without converting their values.
+    char** properties;
+    size_t properties_count;
+    /// function selecting the frames to parse after reading their comment
+    /// line, or NULL to parse all frames
+    exyz_frame_filter_t filter;
+    void* filter_data;
+    /// maximal number of threads used to parse the atoms of large frames, or
+    /// 0 to use one thread per CPU
+    size_t threads;
+    /// name of a string atom property containing chemical species to read as
+    /// atomic numbers in an integer array, or NULL to read it as strings
+    char* atomic_numbers;
+    /// should unknown species be an error when reading atomic numbers?
+    bool strict_species;
+    /// atomic number used for unknown species if `strict_species` is false
+    int64_t unknown_species;
+} exyz_parse_options_t;
+
+/// Check if the `length` bytes of `line` only contain whitespace. Blank lines
+/// are skipped between frames and at the end of the file.
+bool exyz_is_blank_line(const char* line, size_t length);
+
+/// Parse the number of atoms from the first line of a frame, which contains
+/// `length` bytes without the final newline. Only a single non-negative
+/// integer, with optional surrounding whitespace, is accepted.
+exyz_status_t exyz_parse_atoms_count(const char* line, size_t length, size_t* n_atoms);
+
+/// Parse a full frame (comment line and atoms lines) from `frame`. `frame`
+/// must contain exactly `n_atoms + 1` lines, and `frame[frame_size]` must be a
+/// null character. The content of `frame` is modified during parsing.
+/// `options` can be NULL to parse everything. If the frame is rejected by
+/// `options->filter`, this returns `EXYZ_FAILED_READING` without parsing the
+/// atoms lines.
+exyz_status_t exyz_parse_frame(
+    char* frame,
+    size_t frame_size,
+    size_t n_atoms,
+    const exyz_parse_options_t* options,
+    exyz_info_t** info,
+    size_t* info_count,
+    exyz_atom_array_t** arrays,
+    size_t* arrays_count
+);
+
+/// Parse the comment line of `frame` like `exyz_parse_frame`, without parsing
+/// the atoms lines, which start at `frame + *atoms_start`. If the comment line
+/// does not define any atom property, `properties` contains the default ones.
+/// The content of `frame` is modified during parsing.
+exyz_status_t exyz_parse_frame_header(
+    char* frame,
+    size_t frame_size,
+    size_t n_atoms,
+    const exyz_parse_options_t* options,
+    exyz_atom_property_t** properties,
+    size_t* properties_count,
+    exyz_info_t** info,
+    size_t* info_count,
+    size_t* atoms_start
+);
+
+/// Parse the values of `properties[property]` from the `n_atoms` atoms lines
+/// in `block`, and store them in a new `array`. The values of other properties
+/// are skipped without being converted. `block[length]` must be a null
+/// character, and the content of `block` is modified during parsing. The
+/// position of errors is relative to the start of `block`.
+exyz_status_t exyz_parse_atoms_column(
+    char* block,
+    size_t length,
+    size_t n_atoms,
+    const exyz_parse_options_t* options,
+    const exyz_atom_property_t* properties,
+    size_t properties_count,
+    size_t property,
+    exyz_array_t* array
+);
+
+/// Create a lazy frame from the text of a frame, starting with the comment
+/// line, and the number of atoms. The comment line is parsed immediately, and
+/// the atoms lines are copied to be parsed later. `frame_index`, `line` and
+/// `offset` give the position of the comment line in the file for errors in
+/// the atoms lines, or -1 if it is unknown. The content of `frame` is
+/// modified, and can be released once this function returns.
+exyz_status_t exyz_lazy_frame_parse(
+    char* frame,
+    size_t frame_size,
+    size_t n_atoms,
+    const exyz_parse_options_t* options,
+    int64_t frame_index,
+    int64_t line,
+    int64_t offset,
+    exyz_lazy_frame_t** lazy
+);
+
+/******************************************************************************/
+/*                               Frame cache                                  */
+/******************************************************************************/
+
+/// Get a copy of the frame at `index` from `cache`, allocated with the
+/// allocator of the current thread. This returns `EXYZ_FAILED_READING` if the
+/// frame is not in the cache.
+exyz_status_t exyz_frame_cache_get(
+    exyz_frame_cache_t* cache,
+    size_t index,
+    size_t* n_atoms,
+    exyz_info_t** info,
+    size_t* info_count,
+    exyz_atom_array_t** arrays,
+    size_t* arrays_count
+);
+
+/// Add a copy of the frame at `index` to `cache`, evicting the least recently
+/// used frames if needed. Frames larger than the whole budget of the cache
+/// are not added. Failing to add a frame is not an error.
+void exyz_frame_cache_add(
+    exyz_frame_cache_t* cache,
+    size_t index,
+    size_t n_atoms,
+    const exyz_info_t* info,
+    size_t info_count,
+    const exyz_atom_array_t* arrays,
+    size_t arrays_count
+);
+
+/******************************************************************************/
+/*                               Elements                                     */
+/******************************************************************************/
+
+/// Get the atomic number of the element with the given `length` characters
+/// `symbol` (e.g. "Fe"), or 0 if this is not an element symbol. Symbols are
+/// case-sensitive.
+int64_t exyz_atomic_number(const char* symbol, size_t length);
+
+/******************************************************************************/
+/*                             CPU features                                   */
+/******************************************************************************/
+
+/// Instruction sets with vectorized kernels, from the least to the most
+/// capable
+typedef enum exyz_simd_t {
+    EXYZ_SIMD_SCALAR = 0,
+    EXYZ_SIMD_SSE2 = 1,
+    EXYZ_SIMD_AVX2 = 2,
+    EXYZ_SIMD_AVX512 = 3,
+} exyz_simd_t;
+
+/// Get the best instruction set supported by the current CPU, or the one
+/// forced with `EXYZ_FORCE_SIMD` at build time. This is detected once, and
+/// the result is cached for the next calls.
+exyz_simd_t exyz_cpu_simd(void);
+
+/******************************************************************************/
+/*                                Tokenizer                                   */
+/******************************************************************************/
+
+/// A whitespace-separated field in an atom line, from `start` (included) to
+/// `end` (excluded)
+typedef struct exyz_field_t {
+    size_t start;
+    size_t end;
+} exyz_field_t;
+
+/// Find the fields separated by spaces and tabs in the `length` bytes of
+/// `line`, storing the first `capacity` of them in `fields`. This returns the
+/// number of fields, stopping the search after `capacity + 1` fields. The end
+/// of the last field is only set if all fields fit in `fields`. `readable`
+/// bytes starting at `line` (with `readable >= length`) can be read, which
+/// allows to read the end of the line in larger chunks.
+///
+/// Quoted strings can contain whitespace, so this returns `SIZE_MAX` if the
+/// line contains a `"` or a null byte, and the line must be parsed value by
+/// value instead.
+size_t exyz_tokenize_fields(const char* line, size_t length, size_t readable, exyz_field_t* fields, size_t capacity);
+
+/******************************************************************************/
+/*                              Input streams                                 */
+/******************************************************************************/
+
+/// Forward-only byte stream over a (possibly compressed) file
+typedef struct exyz_stream_t exyz_stream_t;
+
+/// Create a stream reading from `file`, detecting the compression from the
+/// first bytes of the file. Compressed data is decompressed on a background
+/// thread.
+exyz_status_t exyz_stream_open(exyz_stream_t** stream, FILE* file);
+
+/// Read up to `size` bytes of uncompressed data into `buffer`. `n_read` is
+/// set to 0 at the end of the stream.
+exyz_status_t exyz_stream_read(exyz_stream_t* stream, char* buffer, size_t size, size_t* n_read);
+
+exyz_compression_t exyz_stream_compression(const exyz_stream_t* stream);
+
+void exyz_stream_close(exyz_stream_t* stream);
+
+/// Index of the blocks in a zstd seekable file
+typedef struct exyz_seek_table_t {
+    size_t blocks_count;
+    /// offset of each block in the file, with one additional entry for the end
+    /// of the last block
+    uint64_t* offsets;
+    /// size of each block after decompression
+    uint64_t* sizes;
+    /// index of the first trajectory frame in each block, with one additional
+    /// entry for the total number of frames. This is NULL if the file does not
+    /// contain an index of the frames.
+    uint64_t* first_frames;
+} exyz_seek_table_t;
+
+/// Read the seek table at the end of `file`, if this file uses the zstd
+/// seekable format with the first block at offset `start`. This returns
+/// `EXYZ_FAILED_READING` if the file is not in the seekable format or can not
+/// be seeked, leaving the file position unchanged.
+exyz_status_t exyz_seek_table_read(FILE* file, long start, exyz_seek_table_t** table);
+void exyz_seek_table_free(exyz_seek_table_t* table);
+
+/// Get the seek table of this stream, or NULL if the stream is not seekable
+const exyz_seek_table_t* exyz_stream_seek_table(const exyz_stream_t* stream);
+
+/// Restart decompression from the beginning of the given block
+exyz_status_t exyz_stream_seek_block(exyz_stream_t* stream, size_t block);
+
+/// Decompress blocks of seekable files with up to `threads` threads, or one
+/// thread per CPU if `threads` is 0. The number of threads is capped to a small
+/// value, and never decreases. This does nothing for other streams.
+void exyz_stream_set_threads(exyz_stream_t* stream, size_t threads);
+
+/******************************************************************************/
+/*                                 Reader                                     */
+/******************************************************************************/
+
+/// Get the text of the next frame, without parsing it. `data` is valid until
+/// the next call to a function using this reader.
+exyz_status_t exyz_reader_next_raw_frame(exyz_reader_t* reader, const char** data, size_t* size);
+
+#endif
@@ -0,0 +1,261 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include "exyz.h"
+#include "internal.h"
+
+static exyz_status_t error(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    exyz_status_t status = exyz_set_error(format, args);
+    va_end(args);
+
+    return status;
+}
+
+struct exyz_lazy_frame_t {
+    /// allocator of the thread which read this frame, used for the frame and
+    /// all the arrays parsed later
+    exyz_allocator_t allocator;
+
+    size_t n_atoms;
+    exyz_info_t* info;
+    size_t info_count;
+    exyz_atom_property_t* properties;
+    size_t properties_count;
+
+    /// values of each property, only valid if `parsed[p]` is true
+    exyz_array_t* arrays;
+    bool* parsed;
+
+    /// text of the atoms lines, which is copied before parsing it since the
+    /// parser modifies its input. `atoms[atoms_length]` is a null character.
+    char* atoms;
+    size_t atoms_length;
+    /// offset of the start of each atom line in `atoms`, or NULL until
+    /// `exyz_lazy_frame_line` is called
+    size_t* lines;
+
+    /// options used to parse the atoms lines, without properties selection or
+    /// frames filter
+    exyz_parse_options_t options;
+
+    /// position of the comment line, used for errors in the atoms lines
+    int64_t frame;
+    int64_t line;
+    int64_t offset;
+};
+
+exyz_status_t exyz_lazy_frame_parse(
+    char* frame,
+    size_t frame_size,
+    size_t n_atoms,
+    const exyz_parse_options_t* options,
+    int64_t frame_index,
+    int64_t line,
+    int64_t offset,
+    exyz_lazy_frame_t** lazy
+) {
+    *lazy = NULL;
+
+    exyz_lazy_frame_t* result = exyz_calloc(1, sizeof(exyz_lazy_frame_t));
+    if (result == NULL) {
+        return error("failed to allocate memory");
+    }
+    result->allocator = *exyz_current_allocator();
+    result->n_atoms = n_atoms;
+
+    size_t atoms_start = 0;
+    exyz_status_t status = exyz_parse_frame_header(
+        frame, frame_size, n_atoms, options,
+        &result->properties, &result->properties_count,
+        &result->info, &result->info_count, &atoms_start
+    );
+    if (status != EXYZ_SUCCESS) {
+        exyz_free(result);
+        return status;
+    }
+
+    // errors in the atoms lines are relative to the first atom line, which
+    // comes after the comment line
+    result->frame = frame_index;
+    result->line = line;
+    result->offset = offset >= 0 ? offset + (int64_t)atoms_start : -1;
+
+    result->atoms_length = frame_size - atoms_start;
+    result->atoms = exyz_malloc(result->atoms_length + 1);
+    result->arrays = exyz_calloc(result->properties_count, sizeof(exyz_array_t));
+    result->parsed = exyz_calloc(result->properties_count, sizeof(bool));
+    if (result->atoms == NULL || result->arrays == NULL || result->parsed == NULL) {
+        exyz_lazy_frame_free(result);
+        return error("failed to allocate memory");
+    }
+    memcpy(result->atoms, frame + atoms_start, result->atoms_length);
+    result->atoms[result->atoms_length] = '\0';
+
+    if (options != NULL) {
+        result->options.threads = options->threads;
+        result->options.strict_species = options->strict_species;
+        result->options.unknown_species = options->unknown_species;
+        if (options->atomic_numbers != NULL) {
+            result->options.atomic_numbers = exyz_strdup(options->atomic_numbers);
+            if (result->options.atomic_numbers == NULL) {
+                exyz_lazy_frame_free(result);
+                return error("failed to allocate memory");
+            }
+        }
+    }
+
+    exyz_stats_t* stats = exyz_current_stats;
+    if (stats != NULL) {
+        stats->frames += 1;
+        stats->atoms += n_atoms;
+    }
+
+    *lazy = result;
+    return EXYZ_SUCCESS;
+}
+
+size_t exyz_lazy_frame_n_atoms(const exyz_lazy_frame_t* frame) {
+    return frame->n_atoms;
+}
+
+const exyz_info_t* exyz_lazy_frame_info(const exyz_lazy_frame_t* frame, size_t* count) {
+    *count = frame->info_count;
+    return frame->info;
+}
+
+const exyz_atom_property_t* exyz_lazy_frame_properties(const exyz_lazy_frame_t* frame, size_t* count) {
+    *count = frame->properties_count;
+    return frame->properties;
+}
+
+/// parse the values of `frame->properties[property]`
+static exyz_status_t parse_column(exyz_lazy_frame_t* frame, size_t property) {
+    char* block = exyz_malloc(frame->atoms_length + 1);
+    if (block == NULL) {
+        return error("failed to allocate memory");
+    }
+    memcpy(block, frame->atoms, frame->atoms_length + 1);
+
+    exyz_status_t status = exyz_parse_atoms_column(
+        block, frame->atoms_length, frame->n_atoms, &frame->options,
+        frame->properties, frame->properties_count, property, &frame->arrays[property]
+    );
+    exyz_free(block);
+
+    if (status == EXYZ_ERROR) {
+        exyz_error_shift(frame->line, frame->offset);
+        exyz_error_frame(frame->frame);
+    } else if (status == EXYZ_SUCCESS) {
+        frame->parsed[property] = true;
+    }
+
+    return status;
+}
+
+exyz_status_t exyz_lazy_frame_array(exyz_lazy_frame_t* frame, const char* key, const exyz_array_t** array) {
+    *array = NULL;
+    exyz_reset_error();
+
+    size_t property = 0;
+    while (property < frame->properties_count && strcmp(frame->properties[property].key, key) != 0) {
+        property += 1;
+    }
+
+    if (property == frame->properties_count) {
+        return error("there is no atom property named '%s' in this frame", key);
+    }
+
+    exyz_status_t status = EXYZ_SUCCESS;
+    if (!frame->parsed[property]) {
+        const exyz_allocator_t* previous_allocator = exyz_use_allocator(&frame->allocator);
+        status = parse_column(frame, property);
+        exyz_use_allocator(previous_allocator);
+    }
+
+    if (status == EXYZ_SUCCESS) {
+        *array = &frame->arrays[property];
+    }
+    return status;
+}
+
+/// find the start of all atoms lines in `frame`
+static exyz_status_t find_lines(exyz_lazy_frame_t* frame) {
+    frame->lines = exyz_malloc((frame->n_atoms + 1) * sizeof(size_t));
+    if (frame->lines == NULL) {
+        return error("failed to allocate memory");
+    }
+
+    size_t position = 0;
+    for (size_t atom=0; atom<frame->n_atoms; atom++) {
+        frame->lines[atom] = position;
+        const char* newline = memchr(frame->atoms + position, '\n', frame->atoms_length - position);
+        position = newline != NULL ? (size_t)(newline - frame->atoms) + 1 : frame->atoms_length + 1;
+    }
+    // one past the end of the last line, as if it was followed by a newline
+    frame->lines[frame->n_atoms] = position;
+
+    return EXYZ_SUCCESS;
+}
+
+exyz_status_t exyz_lazy_frame_line(exyz_lazy_frame_t* frame, size_t atom, const char** line, size_t* length) {
+    *line = NULL;
+    *length = 0;
+    exyz_reset_error();
+
+    if (atom >= frame->n_atoms) {
+        return error("atom index %zu is out of bounds for a frame with %zu atoms", atom, frame->n_atoms);
+    }
+
+    if (frame->lines == NULL) {
+        const exyz_allocator_t* previous_allocator = exyz_use_allocator(&frame->allocator);
+        exyz_status_t status = find_lines(frame);
+        exyz_use_allocator(previous_allocator);
+        if (status != EXYZ_SUCCESS) {
+            return status;
+        }
+    }
+
+    size_t start = frame->lines[atom];
+    size_t end = frame->lines[atom + 1] - 1;
+    if (end > start && frame->atoms[end - 1] == '\r') {
+        end -= 1;
+    }
+
+    *line = frame->atoms + start;
+    *length = end - start;
+    return EXYZ_SUCCESS;
+}
+
+void exyz_lazy_frame_free(exyz_lazy_frame_t* frame) {
+    if (frame == NULL) {
+        return;
+    }
+
+    exyz_allocator_t allocator = frame->allocator;
+    const exyz_allocator_t* previous_allocator = exyz_use_allocator(&allocator);
+
+    for (size_t i=0; i<frame->info_count; i++) {
+        exyz_info_free(frame->info[i]);
+    }
+    exyz_free(frame->info);
+
+    for (size_t p=0; p<frame->properties_count; p++) {
+        if (frame->parsed != NULL && frame->parsed[p]) {
+            exyz_array_free(frame->arrays[p]);
+        }
+        exyz_atom_property_free(frame->properties[p]);
+    }
+    exyz_free(frame->properties);
+    exyz_free(frame->arrays);
+    exyz_free(frame->parsed);
+
+    exyz_free(frame->atoms);
+    exyz_free(frame->lines);
+    exyz_free(frame->options.atomic_numbers);
+    exyz_free(frame);
+
+    exyz_use_allocator(previous_allocator);
+}
@@ -0,0 +1,537 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include <pthread.h>
+
+#include "exyz.h"
+#include "internal.h"
+
+static exyz_status_t error(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    exyz_status_t status = exyz_set_error(format, args);
+    va_end(args);
+
+    return status;
+}
+
+// Frames are spread over multiple shards depending on their index, each with
+// its own lock, hash table and list of entries from the most to the least
+// recently used. Readers using different shards never wait for each other.
+// The memory budget is shared by all shards: after adding a frame, the least
+// recently used frames are evicted from whichever shard contains the oldest
+// one until the cache fits in the budget again.
+
+/// number of independently locked parts of the cache
+#define CACHE_SHARDS 16
+
+/// initial number of hash buckets in each shard
+#define CACHE_INITIAL_BUCKETS 64
+
+typedef struct cache_entry_t {
+    /// index of the frame in the file
+    size_t index;
+    /// memory used by this entry and the frame data
+    size_t bytes;
+    /// time of the last use of this entry, from `exyz_frame_cache_t::clock`
+    uint64_t last_use;
+
+    size_t n_atoms;
+    exyz_info_t* info;
+    size_t info_count;
+    exyz_atom_array_t* arrays;
+    size_t arrays_count;
+
+    /// next entry in the same hash bucket
+    struct cache_entry_t* next;
+    /// neighbours in the list of entries of the shard, sorted by last use
+    struct cache_entry_t* newer;
+    struct cache_entry_t* older;
+} cache_entry_t;
+
+typedef struct cache_shard_t {
+    pthread_mutex_t mutex;
+    cache_entry_t** buckets;
+    size_t buckets_count;
+    size_t count;
+    cache_entry_t* newest;
+    cache_entry_t* oldest;
+} cache_shard_t;
+
+struct exyz_frame_cache_t {
+    /// allocator in use when the cache was created, used for all cached data
+    exyz_allocator_t allocator;
+    size_t max_bytes;
+    cache_shard_t shards[CACHE_SHARDS];
+
+    // shared counters, only accessed with atomic operations
+    uint64_t clock;
+    uint64_t bytes;
+    uint64_t frames;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+};
+
+/******************************************************************************/
+/*                              Frames data                                   */
+/******************************************************************************/
+
+static size_t array_bytes(const exyz_array_t* array) {
+    size_t count = array->nrows * array->ncols;
+    switch (array->type) {
+    case EXYZ_INTEGER:
+        return count * sizeof(int64_t);
+    case EXYZ_REAL:
+        return count * sizeof(double);
+    case EXYZ_BOOL:
+        return count * sizeof(bool);
+    case EXYZ_STRING: {
+        size_t bytes = count * sizeof(char*);
+        for (size_t i=0; i<count; i++) {
+            bytes += strlen(array->data.string[i]) + 1;
+        }
+        return bytes;
+    }
+    case EXYZ_ARRAY:
+        break;
+    }
+    return 0;
+}
+
+/// copy `array` to `copy`, with the allocator of the current thread
+static exyz_status_t array_copy(const exyz_array_t* array, exyz_array_t* copy) {
+    *copy = *array;
+    size_t count = array->nrows * array->ncols;
+    if (count == 0) {
+        return EXYZ_SUCCESS;
+    }
+
+    exyz_status_t status = EXYZ_SUCCESS;
+    if (array->type == EXYZ_INTEGER) {
+        status = exyz_array_init_integer(copy, array->nrows, array->ncols);
+    } else if (array->type == EXYZ_REAL) {
+        status = exyz_array_init_real(copy, array->nrows, array->ncols);
+    } else if (array->type == EXYZ_BOOL) {
+        status = exyz_array_init_bool(copy, array->nrows, array->ncols);
+    } else {
+        status = exyz_array_init_string(copy, array->nrows, array->ncols);
+    }
+    if (status != EXYZ_SUCCESS) {
+        return status;
+    }
+
+    if (array->type == EXYZ_STRING) {
+        for (size_t i=0; i<count; i++) {
+            copy->data.string[i] = exyz_strdup(array->data.string[i]);
+            if (copy->data.string[i] == NULL) {
+                exyz_array_free(*copy);
+                return error("failed to allocate memory");
+            }
+        }
+    } else {
+        size_t size = array_bytes(array);
+        memcpy(copy->data.integer, array->data.integer, size);
+    }
+
+    return EXYZ_SUCCESS;
+}
+
+static size_t info_bytes(const exyz_info_t* info) {
+    size_t bytes = sizeof(exyz_info_t) + strlen(info->key) + 1;
+    if (info->type == EXYZ_STRING) {
+        bytes += strlen(info->data.string) + 1;
+    } else if (info->type == EXYZ_ARRAY) {
+        bytes += array_bytes(&info->data.array);
+    }
+    return bytes;
+}
+
+static exyz_status_t info_copy(const exyz_info_t* info, exyz_info_t* copy) {
+    *copy = *info;
+    copy->key = exyz_strdup(info->key);
+    if (copy->key == NULL) {
+        return error("failed to allocate memory");
+    }
+
+    exyz_status_t status = EXYZ_SUCCESS;
+    if (info->type == EXYZ_STRING) {
+        copy->data.string = exyz_strdup(info->data.string);
+        if (copy->data.string == NULL) {
+            status = error("failed to allocate memory");
+        }
+    } else if (info->type == EXYZ_ARRAY) {
+        status = array_copy(&info->data.array, &copy->data.array);
+    }
+
+    if (status != EXYZ_SUCCESS) {
+        exyz_free(copy->key);
+    }
+    return status;
+}
+
+static void free_frame_data(exyz_info_t* info, size_t info_count, exyz_atom_array_t* arrays, size_t arrays_count) {
+    for (size_t i=0; i<info_count; i++) {
+        exyz_info_free(info[i]);
+    }
+    exyz_free(info);
+
+    for (size_t i=0; i<arrays_count; i++) {
+        exyz_atom_array_free(arrays[i]);
+    }
+    exyz_free(arrays);
+}
+
+/// copy a full frame, with the allocator of the current thread
+static exyz_status_t frame_copy(
+    const exyz_info_t* info,
+    size_t info_count,
+    const exyz_atom_array_t* arrays,
+    size_t arrays_count,
+    exyz_info_t** info_copy_ptr,
+    exyz_atom_array_t** arrays_copy_ptr
+) {
+    // allocate at least one entry, since the frames returned by the parser
+    // always contain a (possibly empty) allocated array
+    exyz_info_t* info_copies = exyz_calloc(info_count > 0 ? info_count : 1, sizeof(exyz_info_t));
+    exyz_atom_array_t* arrays_copies = exyz_calloc(arrays_count > 0 ? arrays_count : 1, sizeof(exyz_atom_array_t));
+    if (info_copies == NULL || arrays_copies == NULL) {
+        exyz_free(info_copies);
+        exyz_free(arrays_copies);
+        return error("failed to allocate memory");
+    }
+
+    exyz_status_t status = EXYZ_SUCCESS;
+    size_t copied_info = 0;
+    while (status == EXYZ_SUCCESS && copied_info < info_count) {
+        status = info_copy(&info[copied_info], &info_copies[copied_info]);
+        if (status == EXYZ_SUCCESS) {
+            copied_info += 1;
+        }
+    }
+
+    size_t copied_arrays = 0;
+    while (status == EXYZ_SUCCESS && copied_arrays < arrays_count) {
+        const exyz_atom_array_t* array = &arrays[copied_arrays];
+        exyz_atom_array_t* copy = &arrays_copies[copied_arrays];
+        copy->key = exyz_strdup(array->key);
+        if (copy->key == NULL) {
+            status = error("failed to allocate memory");
+            break;
+        }
+
+        status = array_copy(&array->array, &copy->array);
+        if (status == EXYZ_SUCCESS) {
+            copied_arrays += 1;
+        } else {
+            exyz_free(copy->key);
+        }
+    }
+
+    if (status != EXYZ_SUCCESS) {
+        free_frame_data(info_copies, copied_info, arrays_copies, copied_arrays);
+        return status;
+    }
+
+    *info_copy_ptr = info_copies;
+    *arrays_copy_ptr = arrays_copies;
+    return EXYZ_SUCCESS;
+}
+
+/******************************************************************************/
+/*                                 Shards                                     */
+/******************************************************************************/
+
+static cache_shard_t* shard_for(exyz_frame_cache_t* cache, size_t index) {
+    return &cache->shards[index % CACHE_SHARDS];
+}
+
+static size_t bucket_for(const cache_shard_t* shard, size_t index) {
+    return (index / CACHE_SHARDS) % shard->buckets_count;
+}
+
+static cache_entry_t* shard_find(cache_shard_t* shard, size_t index) {
+    cache_entry_t* entry = shard->buckets[bucket_for(shard, index)];
+    while (entry != NULL && entry->index != index) {
+        entry = entry->next;
+    }
+    return entry;
+}
+
+static void list_remove(cache_shard_t* shard, cache_entry_t* entry) {
+    if (entry->newer != NULL) {
+        entry->newer->older = entry->older;
+    } else {
+        shard->newest = entry->older;
+    }
+
+    if (entry->older != NULL) {
+        entry->older->newer = entry->newer;
+    } else {
+        shard->oldest = entry->newer;
+    }
+
+    entry->newer = NULL;
+    entry->older = NULL;
+}
+
+static void list_push_newest(cache_shard_t* shard, cache_entry_t* entry) {
+    entry->older = shard->newest;
+    entry->newer = NULL;
+    if (shard->newest != NULL) {
+        shard->newest->newer = entry;
+    } else {
+        shard->oldest = entry;
+    }
+    shard->newest = entry;
+}
+
+/// double the number of buckets in `shard`, keeping the current ones if
+/// memory allocation fails
+static void shard_grow(cache_shard_t* shard) {
+    size_t buckets_count = 2 * shard->buckets_count;
+    cache_entry_t** buckets = exyz_calloc(buckets_count, sizeof(cache_entry_t*));
+    if (buckets == NULL) {
+        return;
+    }
+
+    for (size_t i=0; i<shard->buckets_count; i++) {
+        cache_entry_t* entry = shard->buckets[i];
+        while (entry != NULL) {
+            cache_entry_t* next = entry->next;
+            size_t bucket = (entry->index / CACHE_SHARDS) % buckets_count;
+            entry->next = buckets[bucket];
+            buckets[bucket] = entry;
+            entry = next;
+        }
+    }
+
+    exyz_free(shard->buckets);
+    shard->buckets = buckets;
+    shard->buckets_count = buckets_count;
+}
+
+/// remove `entry` from `shard` and free it. This must be called with the
+/// shard locked and the cache allocator in use.
+static void shard_remove(exyz_frame_cache_t* cache, cache_shard_t* shard, cache_entry_t* entry) {
+    cache_entry_t** link = &shard->buckets[bucket_for(shard, entry->index)];
+    while (*link != entry) {
+        link = &(*link)->next;
+    }
+    *link = entry->next;
+    list_remove(shard, entry);
+    shard->count -= 1;
+
+    __atomic_sub_fetch(&cache->bytes, entry->bytes, __ATOMIC_RELAXED);
+    __atomic_sub_fetch(&cache->frames, 1, __ATOMIC_RELAXED);
+
+    free_frame_data(entry->info, entry->info_count, entry->arrays, entry->arrays_count);
+    exyz_free(entry);
+}
+
+/// evict the least recently used frames until the cache fits in its budget.
+/// This must be called with the cache allocator in use, and no shard locked.
+static void evict(exyz_frame_cache_t* cache) {
+    while (__atomic_load_n(&cache->bytes, __ATOMIC_RELAXED) > cache->max_bytes) {
+        // find the shard containing the oldest entry
+        cache_shard_t* oldest_shard = NULL;
+        uint64_t oldest_use = UINT64_MAX;
+        for (size_t s=0; s<CACHE_SHARDS; s++) {
+            cache_shard_t* shard = &cache->shards[s];
+            pthread_mutex_lock(&shard->mutex);
+            if (shard->oldest != NULL && shard->oldest->last_use < oldest_use) {
+                oldest_use = shard->oldest->last_use;
+                oldest_shard = shard;
+            }
+            pthread_mutex_unlock(&shard->mutex);
+        }
+
+        if (oldest_shard == NULL) {
+            return;
+        }
+
+        // the entry could have been used or removed by another thread in the
+        // meantime, in which case this evicts the oldest one remaining
+        pthread_mutex_lock(&oldest_shard->mutex);
+        if (oldest_shard->oldest != NULL) {
+            shard_remove(cache, oldest_shard, oldest_shard->oldest);
+            __atomic_add_fetch(&cache->evictions, 1, __ATOMIC_RELAXED);
+        }
+        pthread_mutex_unlock(&oldest_shard->mutex);
+    }
+}
+
+/******************************************************************************/
+/*                                Frame cache                                 */
+/******************************************************************************/
+
+exyz_status_t exyz_frame_cache_create(exyz_frame_cache_t** cache_ptr, size_t max_bytes) {
+    *cache_ptr = NULL;
+
+    exyz_frame_cache_t* cache = exyz_calloc(1, sizeof(exyz_frame_cache_t));
+    if (cache == NULL) {
+        return error("failed to allocate memory");
+    }
+    cache->allocator = *exyz_current_allocator();
+    cache->max_bytes = max_bytes;
+
+    for (size_t s=0; s<CACHE_SHARDS; s++) {
+        pthread_mutex_init(&cache->shards[s].mutex, NULL);
+    }
+
+    for (size_t s=0; s<CACHE_SHARDS; s++) {
+        cache_shard_t* shard = &cache->shards[s];
+        shard->buckets_count = CACHE_INITIAL_BUCKETS;
+        shard->buckets = exyz_calloc(shard->buckets_count, sizeof(cache_entry_t*));
+        if (shard->buckets == NULL) {
+            exyz_frame_cache_free(cache);
+            return error("failed to allocate memory");
+        }
+    }
+
+    *cache_ptr = cache;
+    return EXYZ_SUCCESS;
+}
+
+void exyz_frame_cache_free(exyz_frame_cache_t* cache) {
+    if (cache == NULL) {
+        return;
+    }
+
+    exyz_allocator_t allocator = cache->allocator;
+    const exyz_allocator_t* previous_allocator = exyz_use_allocator(&allocator);
+
+    for (size_t s=0; s<CACHE_SHARDS; s++) {
+        cache_shard_t* shard = &cache->shards[s];
+        if (shard->buckets != NULL) {
+            while (shard->oldest != NULL) {
+                shard_remove(cache, shard, shard->oldest);
+            }
+        }
+        exyz_free(shard->buckets);
+        pthread_mutex_destroy(&shard->mutex);
+    }
+    exyz_free(cache);
+
+    exyz_use_allocator(previous_allocator);
+}
+
+void exyz_frame_cache_counts(const exyz_frame_cache_t* cache, exyz_frame_cache_counts_t* counts) {
+    counts->hits = __atomic_load_n(&cache->hits, __ATOMIC_RELAXED);
+    counts->misses = __atomic_load_n(&cache->misses, __ATOMIC_RELAXED);
+    counts->evictions = __atomic_load_n(&cache->evictions, __ATOMIC_RELAXED);
+    counts->frames = __atomic_load_n(&cache->frames, __ATOMIC_RELAXED);
+    counts->bytes = __atomic_load_n(&cache->bytes, __ATOMIC_RELAXED);
+}
+
+exyz_status_t exyz_frame_cache_get(
+    exyz_frame_cache_t* cache,
+    size_t index,
+    size_t* n_atoms,
+    exyz_info_t** info,
+    size_t* info_count,
+    exyz_atom_array_t** arrays,
+    size_t* arrays_count
+) {
+    cache_shard_t* shard = shard_for(cache, index);
+    pthread_mutex_lock(&shard->mutex);
+
+    cache_entry_t* entry = shard_find(shard, index);
+    if (entry == NULL) {
+        pthread_mutex_unlock(&shard->mutex);
+        __atomic_add_fetch(&cache->misses, 1, __ATOMIC_RELAXED);
+        return EXYZ_FAILED_READING;
+    }
+
+    entry->last_use = __atomic_add_fetch(&cache->clock, 1, __ATOMIC_RELAXED);
+    list_remove(shard, entry);
+    list_push_newest(shard, entry);
+
+    // copy while the shard is locked, so the entry can not be evicted
+    exyz_status_t status = frame_copy(entry->info, entry->info_count, entry->arrays, entry->arrays_count, info, arrays);
+    if (status == EXYZ_SUCCESS) {
+        *n_atoms = entry->n_atoms;
+        *info_count = entry->info_count;
+        *arrays_count = entry->arrays_count;
+    }
+    pthread_mutex_unlock(&shard->mutex);
+
+    if (status == EXYZ_SUCCESS) {
+        __atomic_add_fetch(&cache->hits, 1, __ATOMIC_RELAXED);
+    }
+    return status;
+}
+
+void exyz_frame_cache_add(
+    exyz_frame_cache_t* cache,
+    size_t index,
+    size_t n_atoms,
+    const exyz_info_t* info,
+    size_t info_count,
+    const exyz_atom_array_t* arrays,
+    size_t arrays_count
+) {
+    size_t bytes = sizeof(cache_entry_t);
+    for (size_t i=0; i<info_count; i++) {
+        bytes += info_bytes(&info[i]);
+    }
+    for (size_t i=0; i<arrays_count; i++) {
+        bytes += sizeof(exyz_atom_array_t) + strlen(arrays[i].key) + 1 + array_bytes(&arrays[i].array);
+    }
+
+    if (bytes > cache->max_bytes) {
+        return;
+    }
+
+    // failing to add a frame is not an error, so keep the error of the
+    // current thread unchanged
+    exyz_error_state_t last_error;
+    exyz_save_error(&last_error);
+    const exyz_allocator_t* previous_allocator = exyz_use_allocator(&cache->allocator);
+
+    cache_entry_t* entry = exyz_calloc(1, sizeof(cache_entry_t));
+    if (entry == NULL) {
+        goto done;
+    }
+
+    entry->index = index;
+    entry->bytes = bytes;
+    entry->n_atoms = n_atoms;
+    entry->info_count = info_count;
+    entry->arrays_count = arrays_count;
+    if (frame_copy(info, info_count, arrays, arrays_count, &entry->info, &entry->arrays) != EXYZ_SUCCESS) {
+        exyz_free(entry);
+        goto done;
+    }
+
+    cache_shard_t* shard = shard_for(cache, index);
+    pthread_mutex_lock(&shard->mutex);
+
+    // another reader could have added the same frame
+    cache_entry_t* existing = shard_find(shard, index);
+    if (existing != NULL) {
+        shard_remove(cache, shard, existing);
+    }
+
+    if (shard->count >= shard->buckets_count) {
+        shard_grow(shard);
+    }
+
+    size_t bucket = bucket_for(shard, index);
+    entry->next = shard->buckets[bucket];
+    shard->buckets[bucket] = entry;
+    entry->last_use = __atomic_add_fetch(&cache->clock, 1, __ATOMIC_RELAXED);
+    list_push_newest(shard, entry);
+    shard->count += 1;
+
+    __atomic_add_fetch(&cache->bytes, bytes, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&cache->frames, 1, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&shard->mutex);
+
+    evict(cache);
+
+done:
+    exyz_use_allocator(previous_allocator);
+    exyz_restore_error(&last_error);
+}
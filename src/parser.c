@@ -3,30 +3,72 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
+#include <limits.h>
 #include <locale.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#ifdef __APPLE__
+#include <xlocale.h>
+#endif
 
 #include "exyz.h"
+#include "internal.h"
 
 static exyz_status_t error(const char* format, ...) {
     va_list args;
     va_start(args, format);
-    vfprintf(stderr, format, args);
+    exyz_status_t status = exyz_set_error(format, args);
     va_end(args);
 
-    return EXYZ_ERROR;
+    return status;
 }
 
 static void* alloc_one_more(void* ptr, size_t current, size_t size) {
     if (current == 0) {
         assert(ptr == NULL);
-        return calloc(1, size);
+        return exyz_calloc(1, size);
     } else {
-        ptr = realloc(ptr, (current + 1) * size);
+        ptr = exyz_realloc(ptr, (current + 1) * size);
         memset((char*)ptr + current * size, 0, size);
         return ptr;
     }
 }
 
+/******************************************************************************/
+/*                              Statistics                                    */
+/******************************************************************************/
+
+/// count a failed attempt at reading a value in the comment line as a given
+/// type, before trying the next one
+static void count_failed_read(void) {
+    exyz_stats_t* stats = exyz_current_stats;
+    if (stats != NULL) {
+        stats->failed_reads += 1;
+    }
+}
+
+/// count `count` values of the given `type`
+static void count_values(exyz_stats_t* stats, exyz_data_t type, uint64_t count) {
+    switch (type) {
+    case EXYZ_INTEGER:
+        stats->integers += count;
+        break;
+    case EXYZ_REAL:
+        stats->reals += count;
+        break;
+    case EXYZ_BOOL:
+        stats->booleans += count;
+        break;
+    case EXYZ_STRING:
+        stats->strings += count;
+        break;
+    case EXYZ_ARRAY:
+        stats->arrays += count;
+        break;
+    }
+}
+
 /******************************************************************************/
 /*                        Parser building blocks                              */
 /******************************************************************************/
@@ -160,7 +202,7 @@ static exyz_status_t skip_string(parser_context_t* ctx) {
 /// copy `value` of size `length` to the the output following extended xyz
 /// escape rules
 static char* unescape_quoted_string(const char* value, size_t length) {
-    char* output = calloc(length + 1, 1);
+    char* output = exyz_calloc(length + 1, 1);
     if (output == NULL) {
         return output;
     }
@@ -171,7 +213,7 @@ static char* unescape_quoted_string(const char* value, size_t length) {
         if (value[i] == '\\') {
             if (i + 1 == length) {
                 error("quoted string can not end with '\\'");
-                free(output);
+                exyz_free(output);
                 return NULL;
             }
 
@@ -239,7 +281,7 @@ static exyz_status_t read_bare_string(parser_context_t* ctx, char** value) {
         return EXYZ_FAILED_READING;
     }
 
-    *value = strndup(ctx->string + start, size);
+    *value = exyz_strndup(ctx->string + start, size);
     if (*value == NULL) {
         return error("failed to allocate memory");
     }
@@ -263,7 +305,7 @@ static exyz_status_t read_ident(parser_context_t* ctx, char** value) {
         size += 1;
     }
 
-    *value = strndup(ctx->string + start, size);
+    *value = exyz_strndup(ctx->string + start, size);
     if (*value == NULL) {
         return error("failed to allocate memory");
     }
@@ -394,7 +436,7 @@ static exyz_status_t try_read_real(parser_context_t* ctx, double* value, bool in
     // ok, we have what looks like a number, let's try to parse it
     char* number = ctx->string + start;
     if (fortran_style_exponent) {
-        number = strndup(ctx->string + start, size);
+        number = exyz_strndup(ctx->string + start, size);
         for (size_t i=0; i<size; i++) {
             if (number[i] == 'd' || number[i] == 'D') {
                 number[i] = 'e';
@@ -407,7 +449,7 @@ static exyz_status_t try_read_real(parser_context_t* ctx, double* value, bool in
     *value = strtod(number, &end);
 
     if (fortran_style_exponent) {
-        free(number);
+        exyz_free(number);
     }
 
     if (errno == ERANGE || number + size != end) {
@@ -471,6 +513,7 @@ static exyz_status_t get_array_value_type(
             return EXYZ_SUCCESS;
         } else if (status == EXYZ_FAILED_READING) {
             // try reading a real for this value
+            count_failed_read();
             *type = EXYZ_REAL;
         } else {
             return status;
@@ -484,6 +527,7 @@ static exyz_status_t get_array_value_type(
             return EXYZ_SUCCESS;
         } else if (status == EXYZ_FAILED_READING) {
             // try reading a bool for this value
+            count_failed_read();
             *type = EXYZ_BOOL;
         } else {
             return status;
@@ -497,6 +541,7 @@ static exyz_status_t get_array_value_type(
             return EXYZ_SUCCESS;
         } else if (status == EXYZ_FAILED_READING) {
             // try reading a string for this value
+            count_failed_read();
             *type = EXYZ_STRING;
         } else {
             return status;
@@ -942,7 +987,9 @@ static exyz_status_t try_read_array(
 /// the corresponding key in `key`
 static exyz_status_t info_key(parser_context_t* ctx, char** key) {
     exyz_status_t status = read_string(ctx, key);
-    if (status != EXYZ_SUCCESS) {
+    if (status == EXYZ_FAILED_READING) {
+        return error("expected a frame property key in comment line, got '%c'", ctx->string[ctx->current]);
+    } else if (status != EXYZ_SUCCESS) {
         return status;
     }
 
@@ -952,7 +999,7 @@ static exyz_status_t info_key(parser_context_t* ctx, char** key) {
         ctx->current += 1;
         return EXIT_SUCCESS;
     } else {
-        free(*key);
+        exyz_free(*key);
         return error("expected '=' after the frame property key in comment line, got '%c'", ctx->string[ctx->current]);
     }
 }
@@ -992,6 +1039,7 @@ static exyz_status_t info_value(parser_context_t* ctx, exyz_info_t* info) {
     } else if (status != EXYZ_FAILED_READING) {
         return status;
     }
+    count_failed_read();
 
     int64_t value_integer= 0;
     status = try_read_integer(ctx, &value_integer, false);
@@ -1002,6 +1050,7 @@ static exyz_status_t info_value(parser_context_t* ctx, exyz_info_t* info) {
     } else if (status != EXYZ_FAILED_READING) {
         return status;
     }
+    count_failed_read();
 
     double value_float = 0;
     status = try_read_real(ctx, &value_float, false);
@@ -1012,6 +1061,7 @@ static exyz_status_t info_value(parser_context_t* ctx, exyz_info_t* info) {
     } else if (status != EXYZ_FAILED_READING) {
         return status;
     }
+    count_failed_read();
 
     bool value_bool;
     status = try_read_boolean(ctx, &value_bool, false);
@@ -1022,6 +1072,7 @@ static exyz_status_t info_value(parser_context_t* ctx, exyz_info_t* info) {
     } else if (status != EXYZ_FAILED_READING) {
         return status;
     }
+    count_failed_read();
 
     char* value_string;
     status = read_string(ctx, &value_string);
@@ -1029,6 +1080,8 @@ static exyz_status_t info_value(parser_context_t* ctx, exyz_info_t* info) {
         info->type = EXYZ_STRING;
         info->data.string = value_string;
         return EXYZ_SUCCESS;
+    } else if (status == EXYZ_FAILED_READING) {
+        return error("missing value for '%s' in comment line", info->key);
     } else {
         return status;
     }
@@ -1060,7 +1113,9 @@ static exyz_status_t atoms_properties(
     };
 
     status = read_string(line_ctx, &ctx.string);
-    if (status != EXYZ_SUCCESS) {
+    if (status == EXYZ_FAILED_READING) {
+        return error("missing value for Properties in comment line");
+    } else if (status != EXYZ_SUCCESS) {
         return status;
     }
     ctx.length = strlen(ctx.string);
@@ -1124,17 +1179,17 @@ static exyz_status_t atoms_properties(
         }
     }
 
-    free(ctx.string);
+    exyz_free(ctx.string);
     return EXYZ_SUCCESS;
 
 error:
-    free(ctx.string);
-    free(current_key);
+    exyz_free(ctx.string);
+    exyz_free(current_key);
 
     for (size_t i=0; i<*properties_count; i++) {
         exyz_atom_property_free((*properties)[i]);
     }
-    free(*properties);
+    exyz_free(*properties);
     *properties = NULL;
     *properties_count = 0;
 
@@ -1169,7 +1224,7 @@ static exyz_status_t frame_properties(
 
         skip_whitespaces(ctx);
         if (strcmp(key, "Properties") == 0) {
-            free(key);
+            exyz_free(key);
 
             status = atoms_properties(ctx, properties, properties_count);
             if (status != EXYZ_SUCCESS) {
@@ -1178,7 +1233,7 @@ static exyz_status_t frame_properties(
         } else {
             *info = alloc_one_more(*info, *info_count, sizeof(exyz_info_t));
             if (info == NULL) {
-                free(key);
+                exyz_free(key);
                 status = error("failed to allocate memory");
                 goto error;
             }
@@ -1192,11 +1247,16 @@ static exyz_status_t frame_properties(
                 goto error;
             }
 
+            if (exyz_current_stats != NULL) {
+                count_values(exyz_current_stats, current_info->type, 1);
+            }
+
             // check that key=value items are separated by whitespace
             if (ctx->current != ctx->length) {
                 char current = ctx->string[ctx->current];
                 if (!is_whitespace(current)) {
-                    return error("key=value pairs should be separated by whitespace, got '%c'", current);
+                    status = error("key=value pairs should be separated by whitespace, got '%c'", current);
+                    goto error;
                 }
             }
         }
@@ -1208,14 +1268,14 @@ error:
     for (size_t i=0; i<*properties_count; i++) {
         exyz_atom_property_free((*properties)[i]);
     }
-    free(*properties);
+    exyz_free(*properties);
     *properties = NULL;
     *properties_count = 0;
 
     for (size_t i=0; i<*info_count; i++) {
         exyz_info_free((*info)[i]);
     }
-    free(*info);
+    exyz_free(*info);
     *info = NULL;
     *info_count = 0;
 
@@ -1223,157 +1283,1688 @@ error:
 }
 
 /******************************************************************************/
-/*                               I/O functions                                */
+/*                                 Locale                                     */
 /******************************************************************************/
 
+static locale_t C_LOCALE = (locale_t)0;
+static pthread_once_t C_LOCALE_ONCE = PTHREAD_ONCE_INIT;
 
-static exyz_status_t read_frame(FILE *fp, size_t* n_atoms, char** buffer, size_t* buffer_size) {
-    int64_t start = ftell(fp);
+static void create_c_locale(void) {
+    C_LOCALE = newlocale(LC_ALL_MASK, "C", (locale_t)0);
+}
 
-    char line[80] = {0};
-    size_t n_read = fread(line, 1, 80, fp);
-    if (n_read == 0) {
-        return error("failed to read a line");
+/// Force strtod to use the C locale instead of whatever is in the user
+/// environment. This only changes the locale of the calling thread, so
+/// multiple threads can parse files at the same time. The previous locale is
+/// returned, and must be given to `restore_locale`.
+static locale_t use_c_locale(void) {
+    pthread_once(&C_LOCALE_ONCE, create_c_locale);
+    if (C_LOCALE == (locale_t)0) {
+        return (locale_t)0;
     }
+    return uselocale(C_LOCALE);
+}
 
-    int count = sscanf(line, "%zu", n_atoms);
-    if (count == 0) {
-        return error("failed to parse the number of atoms");
+static void restore_locale(locale_t locale) {
+    if (locale != (locale_t)0) {
+        uselocale(locale);
     }
+}
 
-    for (size_t i=0; i<sizeof(line); i++) {
-        if (line[i] == '\n') {
-            start += i;
-            if (!fseek(fp, start, SEEK_SET)) {
-                return error("failed to fseek");
-            }
-            break;
+/******************************************************************************/
+/*                               Atoms lines                                  */
+/******************************************************************************/
+
+/// read a floating point value in an atom line, and store it in `value`.
+/// Atomic properties have a known type, so this does not need to deal with the
+/// ambiguities of comment line values.
+static exyz_status_t try_read_atom_real(parser_context_t* ctx, double* value) {
+    const char* start = ctx->string + ctx->current;
+    size_t size = 0;
+
+    if (start[size] == '+' || start[size] == '-') {
+        size += 1;
+    }
+
+    size_t digits_start = size;
+    while (is_digit(start[size])) {
+        size += 1;
+    }
+
+    if (size == digits_start) {
+        return EXYZ_FAILED_READING;
+    }
+
+    if (start[size] == '.') {
+        size += 1;
+        size_t fractional_start = size;
+        while (is_digit(start[size])) {
+            size += 1;
+        }
+
+        if (size == fractional_start) {
+            return EXYZ_FAILED_READING;
         }
     }
 
-    // find the end of the current frame
-    size_t expected_lines = (*n_atoms + 1);
-    size_t n_lines = 0;
-    while (n_lines != expected_lines) {
-        if (feof(fp)) {
-            return error("not enough lines in file for XYZ format");
+    bool fortran_style_exponent = false;
+    char current = start[size];
+    if (current == 'e' || current == 'E' || current == 'd' || current == 'D') {
+        fortran_style_exponent = (current == 'd' || current == 'D');
+        size += 1;
+
+        if (start[size] == '+' || start[size] == '-') {
+            size += 1;
+        }
+
+        size_t exponent_start = size;
+        while (is_digit(start[size])) {
+            size += 1;
         }
 
-        // TODO: will this work on windows? And on unix with \r\n line ending?
-        if (fgetc(fp) == '\n') {
-            n_lines += 1;
+        if (size == exponent_start) {
+            return EXYZ_FAILED_READING;
         }
     }
 
-    if (!fseek(fp, start, SEEK_SET)) {
-        return error("failed to fseek");
+    if (!is_end_of_value(start[size], false)) {
+        return EXYZ_FAILED_READING;
+    }
+
+    char* number = ctx->string + ctx->current;
+    if (fortran_style_exponent) {
+        number = exyz_strndup(start, size);
+        if (number == NULL) {
+            return error("failed to allocate memory");
+        }
+
+        for (size_t i=0; i<size; i++) {
+            if (number[i] == 'd' || number[i] == 'D') {
+                number[i] = 'e';
+            }
+        }
     }
 
-    size_t frame_size = (size_t)(ftell(fp) - start);
-    *buffer = calloc(frame_size + 1, 1);
+    errno = 0;
+    char* end = NULL;
+    *value = strtod(number, &end);
+    bool valid = (errno != ERANGE && end == number + size);
+
+    if (fortran_style_exponent) {
+        exyz_free(number);
+    }
 
-    n_read = fread(buffer, 1, frame_size, fp);
-    if (n_read != frame_size) {
-        free(*buffer);
-        *buffer = NULL;
-        return error("failed to read a whole frame");
+    if (!valid) {
+        return EXYZ_FAILED_READING;
     }
 
+    ctx->current += size;
     return EXYZ_SUCCESS;
 }
 
-/******************************************************************************/
-/*                     Public functions implementation                        */
-/******************************************************************************/
+static const char* type_name(exyz_data_t type) {
+    switch (type) {
+    case EXYZ_INTEGER:
+        return "integer";
+    case EXYZ_REAL:
+        return "real";
+    case EXYZ_BOOL:
+        return "boolean";
+    case EXYZ_STRING:
+        return "string";
+    case EXYZ_ARRAY:
+        return "array";
+    }
+    return "unknown";
+}
 
-exyz_status_t exyz_read_comment_line(
-    const char* line,
-    size_t line_length,
-    exyz_atom_property_t** properties,
-    size_t* properties_count,
-    exyz_info_t** info,
-    size_t* info_count
+/// Arrays filled by the atom lines parsers
+typedef struct atom_columns_t {
+    /// array to fill for each property, or NULL for skipped properties. String
+    /// properties with an integer array are converted to atomic numbers.
+    exyz_array_t** arrays;
+    /// should unknown species be an error when reading atomic numbers?
+    bool strict_species;
+    /// atomic number used for unknown species if `strict_species` is false
+    int64_t unknown_species;
+} atom_columns_t;
+
+/// read the chemical species of `atom` in `ctx`, and store the corresponding
+/// atomic number in `value`
+static exyz_status_t read_atomic_number(parser_context_t* ctx, const atom_columns_t* columns, size_t atom, int64_t* value) {
+    if (ctx->string[ctx->current] == '"') {
+        char* species = NULL;
+        exyz_status_t status = read_quoted_string(ctx, &species);
+        if (status != EXYZ_SUCCESS) {
+            return status;
+        }
+
+        *value = exyz_atomic_number(species, strlen(species));
+        if (*value == 0 && columns->strict_species) {
+            status = error("unknown chemical species '%s' for atom %zu", species, atom);
+        }
+        exyz_free(species);
+        if (status != EXYZ_SUCCESS) {
+            return status;
+        }
+    } else {
+        const char* species = ctx->string + ctx->current;
+        size_t size = 0;
+        while (ctx->current + size < ctx->length && is_bare_string_char(species[size])) {
+            size += 1;
+        }
+
+        if (size == 0) {
+            return EXYZ_FAILED_READING;
+        }
+
+        *value = exyz_atomic_number(species, size);
+        if (*value == 0 && columns->strict_species) {
+            return error("unknown chemical species '%.*s' for atom %zu", (int)size, species, atom);
+        }
+        ctx->current += size;
+    }
+
+    if (*value == 0) {
+        *value = columns->unknown_species;
+    }
+    return EXYZ_SUCCESS;
+}
+
+/// read the values of a single atom in `ctx`, and store them in the `atom` row
+/// of `columns`. The values of properties with a NULL array in `columns` are
+/// skipped without being converted.
+static exyz_status_t atom_line(
+    parser_context_t* ctx,
+    const exyz_atom_property_t* properties,
+    size_t properties_count,
+    const atom_columns_t* columns,
+    size_t atom
 ) {
-    exyz_status_t status = EXYZ_SUCCESS;
+    for (size_t p=0; p<properties_count; p++) {
+        const exyz_atom_property_t* property = &properties[p];
+        exyz_array_t* array = columns->arrays[p];
 
-    *properties_count = 0;
-    *info_count = 0;
+        for (size_t k=0; k<property->count; k++) {
+            skip_whitespaces(ctx);
+            if (ctx->current == ctx->length) {
+                return error("missing values for atom %zu, expected more values for '%s'", atom, property->key);
+            }
 
-    assert(strlen(line) >= line_length);
-    parser_context_t ctx = {
-        .string = strdup(line),
-        .length = line_length,
-        .current = 0,
-    };
+            size_t index = atom * property->count + k;
+            exyz_status_t status = EXYZ_SUCCESS;
+            if (array == NULL) {
+                status = skip_string(ctx);
+            } else if (property->type == EXYZ_INTEGER) {
+                status = try_read_integer(ctx, array->data.integer + index, false);
+            } else if (property->type == EXYZ_REAL) {
+                status = try_read_atom_real(ctx, array->data.real + index);
+            } else if (property->type == EXYZ_BOOL) {
+                status = try_read_boolean(ctx, array->data.boolean + index, false);
+            } else if (array->type == EXYZ_INTEGER) {
+                assert(property->type == EXYZ_STRING);
+                status = read_atomic_number(ctx, columns, atom, array->data.integer + index);
+            } else {
+                assert(property->type == EXYZ_STRING);
+                status = read_string(ctx, array->data.string + index);
+            }
 
-    if (ctx.string == NULL) {
-        return error("failed to allocate memory");
+            if (status == EXYZ_FAILED_READING) {
+                return error(
+                    "invalid value for %s property '%s' of atom %zu",
+                    type_name(property->type), property->key, atom
+                );
+            } else if (status != EXYZ_SUCCESS) {
+                return status;
+            }
+
+            char c = ctx->string[ctx->current];
+            if (!(is_whitespace(c) || c == '\0')) {
+                return error("values should be separated by whitespace in atom lines, got '%c'", c);
+            }
+        }
+    }
+
+    skip_whitespaces(ctx);
+    if (ctx->current != ctx->length) {
+        return error("too many values for atom %zu", atom);
+    }
+
+    return EXYZ_SUCCESS;
+}
+
+/// read the values of a single atom in `ctx` like `atom_line`, from the
+/// `count` fields found by `exyz_tokenize_fields` with a capacity of
+/// `values_count + 1`, where `values_count` is the total number of values in
+/// the line. The errors are the same as `atom_line`, except that skipped
+/// values are not validated.
+static exyz_status_t atom_line_fields(
+    parser_context_t* ctx,
+    const exyz_field_t* fields,
+    size_t count,
+    size_t values_count,
+    const exyz_atom_property_t* properties,
+    size_t properties_count,
+    const atom_columns_t* columns,
+    size_t atom
+) {
+    size_t field = 0;
+    for (size_t p=0; p<properties_count; p++) {
+        const exyz_atom_property_t* property = &properties[p];
+        exyz_array_t* array = columns->arrays[p];
+
+        for (size_t k=0; k<property->count; k++) {
+            if (field == count) {
+                ctx->current = ctx->length;
+                return error("missing values for atom %zu, expected more values for '%s'", atom, property->key);
+            }
+
+            size_t start = fields[field].start;
+            size_t end = fields[field].end;
+            field += 1;
+
+            if (array == NULL) {
+                continue;
+            }
+
+            // make the value a null-terminated string, as expected by the
+            // functions below
+            ctx->string[end] = '\0';
+            parser_context_t value = {
+                .string = ctx->string + start,
+                .length = end - start,
+                .current = 0,
+            };
+
+            size_t index = atom * property->count + k;
+            exyz_status_t status = EXYZ_SUCCESS;
+            if (property->type == EXYZ_INTEGER) {
+                status = try_read_integer(&value, array->data.integer + index, false);
+            } else if (property->type == EXYZ_REAL) {
+                status = try_read_atom_real(&value, array->data.real + index);
+            } else if (property->type == EXYZ_BOOL) {
+                status = try_read_boolean(&value, array->data.boolean + index, false);
+            } else if (array->type == EXYZ_INTEGER) {
+                assert(property->type == EXYZ_STRING);
+                status = read_atomic_number(&value, columns, atom, array->data.integer + index);
+            } else {
+                assert(property->type == EXYZ_STRING);
+                status = read_string(&value, array->data.string + index);
+            }
+
+            ctx->current = start + value.current;
+            if (status == EXYZ_FAILED_READING) {
+                return error(
+                    "invalid value for %s property '%s' of atom %zu",
+                    type_name(property->type), property->key, atom
+                );
+            } else if (status != EXYZ_SUCCESS) {
+                return status;
+            }
+
+            if (value.current != value.length) {
+                return error("values should be separated by whitespace in atom lines, got '%c'", value.string[value.current]);
+            }
+        }
+    }
+
+    if (count > values_count) {
+        ctx->current = fields[values_count].start;
+        return error("too many values for atom %zu", atom);
     }
 
-    for (size_t i=0; i<ctx.length; i++) {
-        if (ctx.string[i] == '\n' || ctx.string[i] == '\r') {
-            free(ctx.string);
-            return error("got a new line character inside the comment line");
+    return EXYZ_SUCCESS;
+}
+
+/// powers of ten which are exactly representable as double
+static const double EXACT_POWERS_OF_TEN[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+/// read a real value written as `[+-]digits[.digits]` in all the `length`
+/// bytes of `string`, as produced by `%f` formats. If the digits form an
+/// integer up to 2^53 and there are at most 22 digits after the decimal
+/// point, the value is the correctly rounded result of a single division,
+/// which is the same value `strtod` would give. Other values return
+/// `EXYZ_FAILED_READING`.
+static exyz_status_t read_fixed_real(const char* string, size_t length, double* value) {
+    size_t i = 0;
+    bool negative = false;
+    if (string[0] == '+' || string[0] == '-') {
+        negative = (string[0] == '-');
+        i += 1;
+    }
+
+    uint64_t mantissa = 0;
+    size_t digits_start = i;
+    while (i < length && is_digit(string[i])) {
+        mantissa = 10 * mantissa + (uint64_t)(string[i] - '0');
+        i += 1;
+        if (mantissa > (UINT64_C(1) << 53)) {
+            return EXYZ_FAILED_READING;
         }
     }
 
-    // Force strtod to use the C locale instead of whatever is in the user
-    // environemnt. We store & reset the existing locale to not change the user
-    // environemnt.
-    const char* old_locale = setlocale(LC_ALL, NULL);
-    setlocale(LC_ALL, "C");
+    if (i == digits_start) {
+        return EXYZ_FAILED_READING;
+    }
 
-    status = frame_properties(&ctx, properties, properties_count, info, info_count);
+    size_t decimals = 0;
+    if (i < length && string[i] == '.') {
+        i += 1;
+        size_t fractional_start = i;
+        while (i < length && is_digit(string[i])) {
+            mantissa = 10 * mantissa + (uint64_t)(string[i] - '0');
+            i += 1;
+            if (mantissa > (UINT64_C(1) << 53)) {
+                return EXYZ_FAILED_READING;
+            }
+        }
 
-    free(ctx.string);
-    setlocale(LC_ALL, old_locale);
-    return status;
+        decimals = i - fractional_start;
+        if (decimals == 0 || decimals > 22) {
+            return EXYZ_FAILED_READING;
+        }
+    }
+
+    if (i != length) {
+        return EXYZ_FAILED_READING;
+    }
+
+    double result = (double)mantissa / EXACT_POWERS_OF_TEN[decimals];
+    *value = negative ? -result : result;
+    return EXYZ_SUCCESS;
 }
 
-exyz_status_t exyz_read(
-    FILE* fp,
-    size_t* n_atoms,
-    exyz_info_t** info,
-    size_t* info_count,
-    exyz_atom_array_t** arrays,
-    size_t* arrays_count
+/// read an integer value written as `[+-]digits` in all the `length` bytes of
+/// `string`, with at most 18 digits to prevent overflow. Other values return
+/// `EXYZ_FAILED_READING`.
+static exyz_status_t read_fixed_integer(const char* string, size_t length, int64_t* value) {
+    size_t i = 0;
+    bool negative = false;
+    if (string[0] == '+' || string[0] == '-') {
+        negative = (string[0] == '-');
+        i += 1;
+    }
+
+    if (i == length || length - i > 18) {
+        return EXYZ_FAILED_READING;
+    }
+
+    int64_t result = 0;
+    for (; i<length; i++) {
+        if (!is_digit(string[i])) {
+            return EXYZ_FAILED_READING;
+        }
+        result = 10 * result + (string[i] - '0');
+    }
+
+    *value = negative ? -result : result;
+    return EXYZ_SUCCESS;
+}
+
+/// number of consecutive lines with the same layout needed before using
+/// `atom_line_fixed`
+#define FIXED_LAYOUT_LINES 4
+
+/// values always starting at the same position, e.g. written with `%-8s`
+#define FIXED_START 1
+/// values always ending at the same position, e.g. written with `%16.8f`
+#define FIXED_END 2
+
+/// Position of a value in atom lines written with a fixed width format
+typedef struct fixed_field_t {
+    size_t start;
+    size_t end;
+    /// which of `start` and `end` are the same in all lines, as a combination
+    /// of `FIXED_START` and `FIXED_END`
+    int fixed;
+} fixed_field_t;
+
+/// Position of all values in atom lines written with a fixed width format
+typedef struct fixed_layout_t {
+    fixed_field_t* fields;
+    size_t values_count;
+    /// number of consecutive lines with this layout
+    size_t lines;
+} fixed_layout_t;
+
+/// update `layout` after finding `count` `fields` in a line
+static void fixed_layout_update(fixed_layout_t* layout, const exyz_field_t* fields, size_t count) {
+    if (count != layout->values_count) {
+        layout->lines = 0;
+        return;
+    }
+
+    if (layout->lines != 0) {
+        bool matches = true;
+        for (size_t i=0; i<count; i++) {
+            fixed_field_t* field = &layout->fields[i];
+            if (field->start != fields[i].start) {
+                field->fixed &= ~FIXED_START;
+            }
+            if (field->end != fields[i].end) {
+                field->fixed &= ~FIXED_END;
+            }
+            if (field->fixed == 0) {
+                matches = false;
+                break;
+            }
+        }
+
+        if (matches) {
+            layout->lines += 1;
+            return;
+        }
+    }
+
+    // start a new layout from this line
+    for (size_t i=0; i<count; i++) {
+        layout->fields[i].start = fields[i].start;
+        layout->fields[i].end = fields[i].end;
+        layout->fields[i].fixed = FIXED_START | FIXED_END;
+    }
+    layout->lines = 1;
+}
+
+/// free the strings already read for `atom` in `columns`
+static void clear_atom_strings(
+    const exyz_atom_property_t* properties,
+    size_t properties_count,
+    const atom_columns_t* columns,
+    size_t atom
 ) {
-    char* frame = NULL;
-    size_t frame_size = 0;
-    exyz_status_t status = read_frame(fp, n_atoms, &frame, &frame_size);
-    if (status != EXYZ_SUCCESS) {
-        return status;
+    for (size_t p=0; p<properties_count; p++) {
+        exyz_array_t* array = columns->arrays[p];
+        if (array == NULL || array->type != EXYZ_STRING) {
+            continue;
+        }
+
+        for (size_t k=0; k<properties[p].count; k++) {
+            size_t index = atom * properties[p].count + k;
+            exyz_free(array->data.string[index]);
+            array->data.string[index] = NULL;
+        }
     }
+}
 
-    // separate the comment line and the atoms line by replacing the first
-    // \n in frame with a null character
-    char* comment = NULL;
-    size_t comment_length = 0;
-    char* atoms = NULL;
-    for (size_t i=0; i<frame_size; i++) {
-        if (frame[i] == '\n') {
-            frame[i] = '\0';
-
-            assert(i + 1 < frame_size);
-            atoms = frame + (i + 1);
-            comment = frame;
-            comment_length = i;
-            break;
+/// find the value described by `field` in `line`, starting the search at
+/// `position`, and store its limits in `start` and `end`. This returns false
+/// if the line does not follow the layout around this value.
+static bool fixed_value(const char* line, size_t length, size_t position, const fixed_field_t* field, size_t* start, size_t* end) {
+    if (field->fixed & FIXED_END) {
+        // values must be separated by whitespace, and the value goes from
+        // the end of the padding to the known end
+        if (field->end > length || (position != 0 && !is_whitespace(line[position]))) {
+            return false;
         }
+
+        size_t i = position;
+        while (i < field->end && is_whitespace(line[i])) {
+            i += 1;
+        }
+
+        if (i == field->end || (field->end != length && !is_whitespace(line[field->end]))) {
+            return false;
+        }
+
+        *start = i;
+        *end = field->end;
+    } else {
+        // the padding goes until the known start, and the value until the
+        // next whitespace
+        if (field->start >= length || (position != 0 && position >= field->start)) {
+            return false;
+        }
+
+        for (size_t i=position; i<field->start; i++) {
+            if (!is_whitespace(line[i])) {
+                return false;
+            }
+        }
+
+        size_t i = field->start;
+        while (i < length && !is_whitespace(line[i])) {
+            i += 1;
+        }
+
+        *start = field->start;
+        *end = i;
     }
 
-    exyz_atom_property_t* properties = NULL;
-    size_t properties_count = 0;
-    status = exyz_read_comment_line(comment, comment_length, &properties, &properties_count, info, info_count);
-    if (status != EXYZ_SUCCESS) {
-        goto cleanup;
+    for (size_t i=*start; i<*end; i++) {
+        if (is_whitespace(line[i])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/// read the values of a single atom in `ctx`, assuming the line follows
+/// `layout`. Values are found from their known start or end position, and
+/// checked to be separated by whitespace.
+///
+/// This returns `EXYZ_FAILED_READING` if the line does not follow the layout
+/// or contains invalid values, in which case it should be parsed again with
+/// the general parser to get the right values or errors.
+static exyz_status_t atom_line_fixed(
+    parser_context_t* ctx,
+    const fixed_layout_t* layout,
+    const exyz_atom_property_t* properties,
+    size_t properties_count,
+    const atom_columns_t* columns,
+    size_t atom
+) {
+    const char* line = ctx->string;
+    size_t length = ctx->length;
+    size_t position = 0;
+    const fixed_field_t* field = layout->fields;
+
+    for (size_t p=0; p<properties_count; p++) {
+        const exyz_atom_property_t* property = &properties[p];
+        exyz_array_t* array = columns->arrays[p];
+
+        for (size_t k=0; k<property->count; k++) {
+            size_t start = 0;
+            size_t end = 0;
+            if (!fixed_value(line, length, position, field, &start, &end)) {
+                clear_atom_strings(properties, properties_count, columns, atom);
+                return EXYZ_FAILED_READING;
+            }
+            field += 1;
+            position = end;
+
+            if (array == NULL) {
+                continue;
+            }
+
+            // values are followed by whitespace or the end of the line, as
+            // expected by the functions below
+            parser_context_t value = {
+                .string = ctx->string + start,
+                .length = end - start,
+                .current = 0,
+            };
+
+            size_t index = atom * property->count + k;
+            exyz_status_t status = EXYZ_SUCCESS;
+            if (property->type == EXYZ_INTEGER) {
+                status = read_fixed_integer(value.string, value.length, array->data.integer + index);
+                if (status == EXYZ_SUCCESS) {
+                    continue;
+                }
+                status = try_read_integer(&value, array->data.integer + index, false);
+            } else if (property->type == EXYZ_REAL) {
+                status = read_fixed_real(value.string, value.length, array->data.real + index);
+                if (status == EXYZ_SUCCESS) {
+                    continue;
+                }
+                status = try_read_atom_real(&value, array->data.real + index);
+            } else if (property->type == EXYZ_BOOL) {
+                status = try_read_boolean(&value, array->data.boolean + index, false);
+            } else if (value.string[0] == '"') {
+                // quoted strings are left to the general parser, since they
+                // could contain whitespace
+                status = EXYZ_FAILED_READING;
+            } else if (array->type == EXYZ_INTEGER) {
+                assert(property->type == EXYZ_STRING);
+                status = read_atomic_number(&value, columns, atom, array->data.integer + index);
+            } else {
+                assert(property->type == EXYZ_STRING);
+                status = read_bare_string(&value, array->data.string + index);
+            }
+
+            if (status == EXYZ_SUCCESS && value.current != value.length) {
+                status = EXYZ_FAILED_READING;
+            }
+
+            if (status != EXYZ_SUCCESS) {
+                clear_atom_strings(properties, properties_count, columns, atom);
+                ctx->current = start + value.current;
+                return status;
+            }
+        }
+    }
+
+    for (size_t i=position; i<length; i++) {
+        if (!is_whitespace(line[i])) {
+            clear_atom_strings(properties, properties_count, columns, atom);
+            return EXYZ_FAILED_READING;
+        }
+    }
+
+    return EXYZ_SUCCESS;
+}
+
+static exyz_status_t atom_array_init(exyz_array_t* array, exyz_data_t type, size_t nrows, size_t ncols) {
+    if (nrows * ncols == 0) {
+        array->data.integer = NULL;
+        array->type = type;
+        array->nrows = nrows;
+        array->ncols = ncols;
+        return EXYZ_SUCCESS;
     }
 
-    status = error("reading atoms is not yet implemented");
-    goto cleanup;
+    if (type == EXYZ_INTEGER) {
+        return exyz_array_init_integer(array, nrows, ncols);
+    } else if (type == EXYZ_REAL) {
+        return exyz_array_init_real(array, nrows, ncols);
+    } else if (type == EXYZ_BOOL) {
+        return exyz_array_init_bool(array, nrows, ncols);
+    } else {
+        assert(type == EXYZ_STRING);
+        return exyz_array_init_string(array, nrows, ncols);
+    }
+}
+
+/// check if the property named `key` should be read according to `options`
+static bool is_selected(const exyz_parse_options_t* options, const char* key) {
+    if (options == NULL || options->properties == NULL) {
+        return true;
+    }
+
+    for (size_t i=0; i<options->properties_count; i++) {
+        if (strcmp(options->properties[i], key) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/// check if the string `property` should be read as atomic numbers
+static bool is_atomic_numbers(const exyz_parse_options_t* options, const exyz_atom_property_t* property) {
+    if (options == NULL || options->atomic_numbers == NULL || property->type != EXYZ_STRING) {
+        return false;
+    }
+    return strcmp(options->atomic_numbers, property->key) == 0;
+}
+
+/// read `count` atoms lines in `block`, starting at `position` with the atom
+/// at index `first_atom`, and store their values in `columns`
+static exyz_status_t atoms_lines(
+    char* block,
+    size_t length,
+    size_t position,
+    size_t first_atom,
+    size_t count,
+    const exyz_atom_property_t* properties,
+    size_t properties_count,
+    const atom_columns_t* columns,
+    size_t n_atoms
+) {
+    size_t values_count = 0;
+    for (size_t p=0; p<properties_count; p++) {
+        values_count += properties[p].count;
+    }
+
+    exyz_field_t* fields = exyz_malloc((values_count + 1) * sizeof(exyz_field_t));
+    fixed_layout_t layout = {
+        .fields = exyz_malloc(values_count * sizeof(fixed_field_t)),
+        .values_count = values_count,
+        .lines = 0,
+    };
+    if (fields == NULL || layout.fields == NULL) {
+        exyz_free(fields);
+        exyz_free(layout.fields);
+        return error("failed to allocate memory");
+    }
+
+    exyz_status_t status = EXYZ_SUCCESS;
+    for (size_t atom=first_atom; atom<first_atom + count; atom++) {
+        if (position > length) {
+            status = error("expected %zu atoms in frame, got %zu", n_atoms, atom);
+            exyz_error_at((int64_t)atom + 1, (int64_t)length);
+            break;
+        }
+
+        size_t line_start = position;
+        char* line = block + position;
+        char* newline = memchr(line, '\n', length - position);
+        size_t line_length = newline != NULL ? (size_t)(newline - line) : length - position;
+        position += line_length + 1;
+
+        line[line_length] = '\0';
+        if (line_length > 0 && line[line_length - 1] == '\r') {
+            line_length -= 1;
+            line[line_length] = '\0';
+        }
+
+        parser_context_t ctx = {
+            .string = line,
+            .length = line_length,
+            .current = 0,
+        };
+
+        // once a few lines share the same layout, read the values directly
+        // from their known position
+        if (layout.lines >= FIXED_LAYOUT_LINES) {
+            status = atom_line_fixed(&ctx, &layout, properties, properties_count, columns, atom);
+            if (status == EXYZ_SUCCESS) {
+                continue;
+            } else if (status != EXYZ_FAILED_READING) {
+                exyz_error_at((int64_t)atom + 1, (int64_t)(line_start + ctx.current));
+                break;
+            }
+        }
+
+        size_t fields_count = exyz_tokenize_fields(line, line_length, length - line_start, fields, values_count + 1);
+        if (fields_count == SIZE_MAX) {
+            layout.lines = 0;
+            status = atom_line(&ctx, properties, properties_count, columns, atom);
+        } else {
+            fixed_layout_update(&layout, fields, fields_count);
+            status = atom_line_fields(&ctx, fields, fields_count, values_count, properties, properties_count, columns, atom);
+        }
+
+        if (status != EXYZ_SUCCESS) {
+            exyz_error_at((int64_t)atom + 1, (int64_t)(line_start + ctx.current));
+            break;
+        }
+    }
+
+    exyz_free(layout.fields);
+    exyz_free(fields);
+    return status;
+}
+
+/// minimal number of atoms in a frame to parse the atoms lines with multiple
+/// threads, and minimal number of atoms for each thread
+#define PARALLEL_MIN_ATOMS 65536
+
+/// part of the atoms lines of a frame, parsed by a single thread
+typedef struct atoms_task_t {
+    char* block;
+    size_t n_atoms;
+    /// lines starting between `start` and `end` belong to this task
+    size_t start;
+    size_t end;
+    /// index of the first atom and number of atoms in this task
+    size_t first_atom;
+    size_t count;
+
+    const exyz_atom_property_t* properties;
+    size_t properties_count;
+    const atom_columns_t* columns;
+
+    /// allocator and statistics of the thread which started this task
+    const exyz_allocator_t* allocator;
+    bool collect_stats;
+    exyz_stats_t stats;
+
+    exyz_status_t status;
+    exyz_error_state_t error;
+} atoms_task_t;
+
+/// count the lines starting in the range of `task`
+static void* count_atoms_lines(void* data) {
+    atoms_task_t* task = data;
+    task->count = 0;
+    if (task->start == task->end) {
+        return NULL;
+    }
+
+    // the first line starts at `task->start`, and each newline before the
+    // end of the range starts another one
+    task->count = 1;
+    const char* current = task->block + task->start;
+    const char* end = task->block + task->end - 1;
+    while (current < end) {
+        const char* newline = memchr(current, '\n', (size_t)(end - current));
+        if (newline == NULL) {
+            break;
+        }
+        task->count += 1;
+        current = newline + 1;
+    }
+
+    return NULL;
+}
+
+/// parse the lines in the range of `task`
+static void* parse_atoms_lines(void* data) {
+    atoms_task_t* task = data;
+    const exyz_allocator_t* previous_allocator = exyz_use_allocator(task->allocator);
+    exyz_stats_t* previous_stats = exyz_current_stats;
+    exyz_current_stats = task->collect_stats ? &task->stats : NULL;
+    locale_t old_locale = use_c_locale();
+
+    // the lines of this task end at `task->end`, and using it as the length
+    // of the block prevents reading bytes modified by other tasks
+    task->status = atoms_lines(
+        task->block, task->end, task->start, task->first_atom, task->count,
+        task->properties, task->properties_count, task->columns, task->n_atoms
+    );
+    if (task->status != EXYZ_SUCCESS) {
+        exyz_save_error(&task->error);
+    }
+
+    restore_locale(old_locale);
+    exyz_current_stats = previous_stats;
+    exyz_use_allocator(previous_allocator);
+    return NULL;
+}
+
+/// run `function` on all `tasks`, using one thread per task. The first task
+/// runs on the calling thread, as well as tasks for which we could not start
+/// a thread.
+static void run_atoms_tasks(atoms_task_t* tasks, size_t count, pthread_t* threads, bool* started, void* (*function)(void*)) {
+    for (size_t t=1; t<count; t++) {
+        started[t] = pthread_create(&threads[t], NULL, function, &tasks[t]) == 0;
+    }
+
+    function(&tasks[0]);
+    for (size_t t=1; t<count; t++) {
+        if (started[t]) {
+            pthread_join(threads[t], NULL);
+        } else {
+            function(&tasks[t]);
+        }
+    }
+}
+
+/// get the number of threads to use for the atoms of a frame with `n_atoms`
+/// atoms, or 1 to parse the atoms on the calling thread
+static size_t atoms_threads(const exyz_parse_options_t* options, size_t n_atoms) {
+    if (n_atoms < 2 * PARALLEL_MIN_ATOMS) {
+        return 1;
+    }
+
+    size_t threads = options != NULL ? options->threads : 0;
+    if (threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus < 1 ? 1 : (size_t)cpus;
+    }
+
+    if (threads > n_atoms / PARALLEL_MIN_ATOMS) {
+        threads = n_atoms / PARALLEL_MIN_ATOMS;
+    }
+    return threads;
+}
+
+/// read the atoms lines in `block` using multiple threads. The block is split
+/// in line-aligned ranges of bytes, the lines in each range are counted to
+/// know which rows of `columns` they correspond to, and then all ranges are
+/// parsed in parallel. This returns `EXYZ_FAILED_READING` if the block does
+/// not contain exactly `n_atoms` lines, in which case it should be parsed
+/// with `atoms_lines` to get the right error.
+static exyz_status_t atoms_lines_parallel(
+    char* block,
+    size_t length,
+    size_t n_atoms,
+    size_t threads,
+    const exyz_atom_property_t* properties,
+    size_t properties_count,
+    const atom_columns_t* columns
+) {
+    atoms_task_t* tasks = exyz_calloc(threads, sizeof(atoms_task_t));
+    pthread_t* handles = exyz_calloc(threads, sizeof(pthread_t));
+    bool* started = exyz_calloc(threads, sizeof(bool));
+    if (tasks == NULL || handles == NULL || started == NULL) {
+        exyz_free(tasks);
+        exyz_free(handles);
+        exyz_free(started);
+        return error("failed to allocate memory");
+    }
+
+    exyz_stats_t* stats = exyz_current_stats;
+    size_t previous_end = 0;
+    for (size_t t=0; t<threads; t++) {
+        atoms_task_t* task = &tasks[t];
+        task->block = block;
+        task->n_atoms = n_atoms;
+        task->properties = properties;
+        task->properties_count = properties_count;
+        task->columns = columns;
+        task->allocator = exyz_current_allocator();
+        task->collect_stats = stats != NULL;
+
+        task->start = previous_end;
+        task->end = length;
+        if (t + 1 != threads) {
+            // the range ends at the start of the first line after
+            // `(t + 1) * length / threads`
+            size_t split = (t + 1) * (length / threads);
+            if (split < task->start) {
+                split = task->start;
+            }
+            char* newline = memchr(block + split, '\n', length - split);
+            task->end = newline != NULL ? (size_t)(newline - block) + 1 : length;
+        }
+        previous_end = task->end;
+    }
+
+    run_atoms_tasks(tasks, threads, handles, started, count_atoms_lines);
+
+    size_t total = 0;
+    for (size_t t=0; t<threads; t++) {
+        tasks[t].first_atom = total;
+        total += tasks[t].count;
+    }
+
+    exyz_status_t status = EXYZ_FAILED_READING;
+    if (total == n_atoms) {
+        run_atoms_tasks(tasks, threads, handles, started, parse_atoms_lines);
+
+        // report the same error as the serial parser, from the first atom
+        // which failed
+        status = EXYZ_SUCCESS;
+        for (size_t t=0; t<threads; t++) {
+            if (tasks[t].status != EXYZ_SUCCESS) {
+                status = tasks[t].status;
+                exyz_restore_error(&tasks[t].error);
+                break;
+            }
+        }
+
+        if (stats != NULL) {
+            for (size_t t=0; t<threads; t++) {
+                exyz_stats_add(stats, &tasks[t].stats);
+            }
+        }
+    }
+
+    exyz_free(tasks);
+    exyz_free(handles);
+    exyz_free(started);
+
+    return status;
+}
+
+/// read all the atoms lines in `block`, using multiple threads for large
+/// frames, and store their values in `columns`
+static exyz_status_t fill_columns(
+    char* block,
+    size_t length,
+    size_t n_atoms,
+    const exyz_parse_options_t* options,
+    const exyz_atom_property_t* properties,
+    size_t properties_count,
+    const atom_columns_t* columns
+) {
+    exyz_status_t status = EXYZ_FAILED_READING;
+    size_t threads = atoms_threads(options, n_atoms);
+    if (threads > 1) {
+        status = atoms_lines_parallel(block, length, n_atoms, threads, properties, properties_count, columns);
+    }
+
+    if (status == EXYZ_FAILED_READING) {
+        status = atoms_lines(block, length, 0, 0, n_atoms, properties, properties_count, columns, n_atoms);
+    }
+
+    return status;
+}
+
+/// read the `n_atoms` lines in `block`, according to the `properties`
+/// specification. Only the properties selected in `options` are stored in
+/// `arrays`, and their keys are moved out of `properties` on success.
+static exyz_status_t atoms_block(
+    char* block,
+    size_t length,
+    size_t n_atoms,
+    const exyz_parse_options_t* options,
+    exyz_atom_property_t* properties,
+    size_t properties_count,
+    exyz_atom_array_t** arrays,
+    size_t* arrays_count
+) {
+    exyz_status_t status = EXYZ_SUCCESS;
+    *arrays = NULL;
+    *arrays_count = 0;
+
+    if (properties_count == 0) {
+        return EXYZ_SUCCESS;
+    }
+
+    atom_columns_t columns = {
+        .arrays = exyz_calloc(properties_count, sizeof(exyz_array_t*)),
+        .strict_species = options != NULL && options->strict_species,
+        .unknown_species = options != NULL ? options->unknown_species : 0,
+    };
+    *arrays = exyz_calloc(properties_count, sizeof(exyz_atom_array_t));
+    if (columns.arrays == NULL || *arrays == NULL) {
+        status = error("failed to allocate memory");
+        goto error;
+    }
+
+    for (size_t p=0; p<properties_count; p++) {
+        if (!is_selected(options, properties[p].key)) {
+            continue;
+        }
+
+        exyz_data_t type = properties[p].type;
+        if (is_atomic_numbers(options, &properties[p])) {
+            type = EXYZ_INTEGER;
+        }
+
+        exyz_array_t* array = &(*arrays)[*arrays_count].array;
+        status = atom_array_init(array, type, n_atoms, properties[p].count);
+        if (status != EXYZ_SUCCESS) {
+            goto error;
+        }
+        columns.arrays[p] = array;
+        *arrays_count += 1;
+    }
+
+    status = fill_columns(block, length, n_atoms, options, properties, properties_count, &columns);
+    if (status != EXYZ_SUCCESS) {
+        goto error;
+    }
+
+    exyz_stats_t* stats = exyz_current_stats;
+    size_t column = 0;
+    for (size_t p=0; p<properties_count; p++) {
+        exyz_array_t* array = columns.arrays[p];
+        if (array == NULL) {
+            continue;
+        }
+
+        (*arrays)[column].key = properties[p].key;
+        properties[p].key = NULL;
+        column += 1;
+
+        if (stats != NULL) {
+            count_values(stats, array->type, (uint64_t)n_atoms * properties[p].count);
+        }
+    }
+
+    exyz_free(columns.arrays);
+    return EXYZ_SUCCESS;
+
+error:
+    if (*arrays != NULL) {
+        for (size_t p=0; p<*arrays_count; p++) {
+            exyz_atom_array_free((*arrays)[p]);
+        }
+    }
+    exyz_free(*arrays);
+    exyz_free(columns.arrays);
+    *arrays = NULL;
+    *arrays_count = 0;
+
+    return status;
+}
+
+/// set `properties` to the default "species:S:1:pos:R:3" specification
+static exyz_status_t default_properties(exyz_atom_property_t** properties, size_t* properties_count) {
+    *properties = exyz_calloc(2, sizeof(exyz_atom_property_t));
+    if (*properties == NULL) {
+        return error("failed to allocate memory");
+    }
+
+    (*properties)[0].key = exyz_strdup("species");
+    (*properties)[0].type = EXYZ_STRING;
+    (*properties)[0].count = 1;
+
+    (*properties)[1].key = exyz_strdup("pos");
+    (*properties)[1].type = EXYZ_REAL;
+    (*properties)[1].count = 3;
+
+    *properties_count = 2;
+
+    if ((*properties)[0].key == NULL || (*properties)[1].key == NULL) {
+        return error("failed to allocate memory");
+    }
+
+    return EXYZ_SUCCESS;
+}
+
+exyz_status_t exyz_parse_atoms_column(
+    char* block,
+    size_t length,
+    size_t n_atoms,
+    const exyz_parse_options_t* options,
+    const exyz_atom_property_t* properties,
+    size_t properties_count,
+    size_t property,
+    exyz_array_t* array
+) {
+    exyz_data_t type = properties[property].type;
+    if (is_atomic_numbers(options, &properties[property])) {
+        type = EXYZ_INTEGER;
+    }
+
+    exyz_status_t status = atom_array_init(array, type, n_atoms, properties[property].count);
+    if (status != EXYZ_SUCCESS) {
+        return status;
+    }
+
+    atom_columns_t columns = {
+        .arrays = exyz_calloc(properties_count, sizeof(exyz_array_t*)),
+        .strict_species = options != NULL && options->strict_species,
+        .unknown_species = options != NULL ? options->unknown_species : 0,
+    };
+    if (columns.arrays == NULL) {
+        exyz_array_free(*array);
+        return error("failed to allocate memory");
+    }
+    columns.arrays[property] = array;
+
+    exyz_stats_t* stats = exyz_current_stats;
+    uint64_t start = stats != NULL ? exyz_stats_now() : 0;
+
+    locale_t old_locale = use_c_locale();
+    status = fill_columns(block, length, n_atoms, options, properties, properties_count, &columns);
+    restore_locale(old_locale);
+
+    if (stats != NULL) {
+        stats->atoms_ns += exyz_stats_now() - start;
+        if (status == EXYZ_SUCCESS) {
+            count_values(stats, array->type, (uint64_t)n_atoms * properties[property].count);
+        }
+    }
+
+    exyz_free(columns.arrays);
+    if (status != EXYZ_SUCCESS) {
+        exyz_array_free(*array);
+    }
+    return status;
+}
+
+/******************************************************************************/
+/*                               I/O functions                                */
+/******************************************************************************/
+
+bool exyz_is_blank_line(const char* line, size_t length) {
+    for (size_t i=0; i<length; i++) {
+        if (line[i] != ' ' && line[i] != '\t' && line[i] != '\r' && line[i] != '\n') {
+            return false;
+        }
+    }
+    return true;
+}
+
+exyz_status_t exyz_parse_atoms_count(const char* line, size_t length, size_t* n_atoms) {
+    size_t i = 0;
+    while (i < length && (line[i] == ' ' || line[i] == '\t')) {
+        i++;
+    }
+
+    size_t start = i;
+    size_t value = 0;
+    while (i < length && line[i] >= '0' && line[i] <= '9') {
+        size_t digit = (size_t)(line[i] - '0');
+        // the number of lines in the frame (n_atoms + 1) must also fit in
+        // a size_t
+        if (value > (SIZE_MAX - 1 - digit) / 10) {
+            return error("the number of atoms is too large");
+        }
+        value = 10 * value + digit;
+        i++;
+    }
+
+    if (i == start) {
+        return error("failed to parse the number of atoms");
+    }
+
+    while (i < length && (line[i] == ' ' || line[i] == '\t' || line[i] == '\r')) {
+        i++;
+    }
+
+    if (i != length) {
+        return error("unexpected content after the number of atoms: '%c'", line[i]);
+    }
+
+    *n_atoms = value;
+    return EXYZ_SUCCESS;
+}
+
+/// initial size of the buffer used by `read_frame`
+#define FRAME_BUFFER_SIZE 4096
+
+/// append the next line in `fp`, including the final newline if there is one,
+/// at `buffer + *length`, growing the buffer as needed. Returns
+/// `EXYZ_END_OF_FILE` if there is nothing left to read in `fp`.
+static exyz_status_t read_line(FILE* fp, char** buffer, size_t* length, size_t* capacity) {
+    size_t start = *length;
+    while (true) {
+        if (*capacity - *length < 2) {
+            size_t new_capacity = *capacity != 0 ? 2 * *capacity : FRAME_BUFFER_SIZE;
+            char* new_buffer = exyz_realloc(*buffer, new_capacity);
+            if (new_buffer == NULL) {
+                return error("failed to allocate memory");
+            }
+            *buffer = new_buffer;
+            *capacity = new_capacity;
+        }
+
+        size_t available = *capacity - *length;
+        if (available > INT_MAX) {
+            available = INT_MAX;
+        }
+
+        char* line = *buffer + *length;
+        if (fgets(line, (int)available, fp) == NULL) {
+            if (ferror(fp)) {
+                return error("failed to read a line");
+            }
+            return *length == start ? EXYZ_END_OF_FILE : EXYZ_SUCCESS;
+        }
+
+        size_t n_read = strlen(line);
+        *length += n_read;
+        if (n_read != 0 && line[n_read - 1] == '\n') {
+            return EXYZ_SUCCESS;
+        }
+    }
+}
+
+/// read the next frame in `fp`, only moving forward in the file so this also
+/// works with pipes and other non-seekable files. The frame text (without the
+/// line containing the number of atoms) is stored in `buffer`, the size of the
+/// line containing the number of atoms in `header_size`, and the total number
+/// of bytes consumed from `fp` in `consumed`.
+static exyz_status_t read_frame(
+    FILE *fp,
+    size_t* n_atoms,
+    char** buffer,
+    size_t* buffer_size,
+    size_t* header_size,
+    size_t* consumed
+) {
+    *buffer = NULL;
+    *buffer_size = 0;
+    *header_size = 0;
+    *consumed = 0;
+
+    char* data = NULL;
+    size_t length = 0;
+    size_t capacity = 0;
+    size_t skipped = 0;
+    exyz_status_t status = EXYZ_SUCCESS;
+    while (true) {
+        status = read_line(fp, &data, &length, &capacity);
+        if (status != EXYZ_SUCCESS) {
+            exyz_free(data);
+            return status;
+        }
+
+        // skip empty lines between frames and at the end of the file
+        if (!exyz_is_blank_line(data, length)) {
+            break;
+        }
+        skipped += length;
+        length = 0;
+    }
+
+    size_t line_length = length;
+    if (line_length != 0 && data[line_length - 1] == '\n') {
+        line_length -= 1;
+    }
+
+    status = exyz_parse_atoms_count(data, line_length, n_atoms);
+    if (status != EXYZ_SUCCESS) {
+        exyz_free(data);
+        return status;
+    }
+
+    // the same buffer is re-used for the rest of the frame
+    *header_size = skipped + length;
+    length = 0;
+
+    size_t expected_lines = (*n_atoms + 1);
+    for (size_t n_lines=0; n_lines<expected_lines; n_lines++) {
+        status = read_line(fp, &data, &length, &capacity);
+        if (status == EXYZ_END_OF_FILE) {
+            status = error("not enough lines in file for XYZ format");
+        }
+
+        if (status != EXYZ_SUCCESS) {
+            exyz_free(data);
+            return status;
+        }
+    }
+    *consumed = *header_size + length;
+
+    // remove the final newline, if any
+    if (length != 0 && data[length - 1] == '\n') {
+        length -= 1;
+    }
+    data[length] = '\0';
+
+    *buffer = data;
+    *buffer_size = length;
+    return EXYZ_SUCCESS;
+}
+
+/******************************************************************************/
+/*                     Public functions implementation                        */
+/******************************************************************************/
+
+/// parse the comment line in `line`, which must be null-terminated at
+/// `line_length`
+static exyz_status_t comment_line(
+    char* line,
+    size_t line_length,
+    exyz_atom_property_t** properties,
+    size_t* properties_count,
+    exyz_info_t** info,
+    size_t* info_count
+) {
+    for (size_t i=0; i<line_length; i++) {
+        if (line[i] == '\n' || line[i] == '\r') {
+            error("got a new line character inside the comment line");
+            exyz_error_at(1, (int64_t)i);
+            return EXYZ_ERROR;
+        }
+    }
+
+    parser_context_t ctx = {
+        .string = line,
+        .length = line_length,
+        .current = 0,
+    };
+
+    exyz_status_t status = frame_properties(&ctx, properties, properties_count, info, info_count);
+    if (status == EXYZ_FAILED_READING) {
+        // a value which could not be read by any of the speculative readers,
+        // the error they recorded does not describe it
+        status = error("invalid value in comment line");
+    }
+    if (status == EXYZ_ERROR) {
+        exyz_error_at(1, (int64_t)ctx.current);
+    }
+
+    return status;
+}
+
+exyz_status_t exyz_read_comment_line(
+    const char* line,
+    size_t line_length,
+    exyz_atom_property_t** properties,
+    size_t* properties_count,
+    exyz_info_t** info,
+    size_t* info_count
+) {
+    exyz_status_t status = EXYZ_SUCCESS;
+    exyz_reset_error();
+
+    *properties_count = 0;
+    *info_count = 0;
+
+    assert(strlen(line) >= line_length);
+    char* copy = exyz_strndup(line, line_length);
+    if (copy == NULL) {
+        return error("failed to allocate memory");
+    }
+
+    exyz_stats_t* stats = exyz_current_stats;
+    uint64_t start = stats != NULL ? exyz_stats_now() : 0;
+
+    locale_t old_locale = use_c_locale();
+    status = comment_line(copy, line_length, properties, properties_count, info, info_count);
+    restore_locale(old_locale);
+
+    if (stats != NULL) {
+        stats->bytes += line_length;
+        stats->comment_line_ns += exyz_stats_now() - start;
+    }
+
+    exyz_free(copy);
+    return status;
+}
+
+/// parse the comment line at the start of `frame`, and find the atoms lines,
+/// which start at `frame + *atoms_start`. This returns `EXYZ_FAILED_READING`
+/// if the frame is rejected by `options->filter`. `properties` and `info` are
+/// only set on success. This must be called with the C locale.
+static exyz_status_t frame_header(
+    char* frame,
+    size_t frame_size,
+    size_t n_atoms,
+    const exyz_parse_options_t* options,
+    exyz_atom_property_t** properties,
+    size_t* properties_count,
+    exyz_info_t** info,
+    size_t* info_count,
+    size_t* atoms_start
+) {
+    *properties = NULL;
+    *properties_count = 0;
+    *info = NULL;
+    *info_count = 0;
+
+    // separate the comment line and the atoms line by replacing the first
+    // \n in frame with a null character
+    char* comment = frame;
+    size_t comment_length = frame_size;
+    *atoms_start = frame_size;
+    char* newline = memchr(frame, '\n', frame_size);
+    if (newline != NULL) {
+        *newline = '\0';
+        comment_length = (size_t)(newline - frame);
+        *atoms_start = comment_length + 1;
+    } else if (n_atoms != 0) {
+        error("missing atoms lines in frame");
+        exyz_error_at(2, (int64_t)frame_size);
+        return EXYZ_ERROR;
+    }
+
+    if (comment_length > 0 && comment[comment_length - 1] == '\r') {
+        comment_length -= 1;
+        comment[comment_length] = '\0';
+    }
+
+    exyz_stats_t* stats = exyz_current_stats;
+    uint64_t start = stats != NULL ? exyz_stats_now() : 0;
+
+    exyz_status_t status = comment_line(comment, comment_length, properties, properties_count, info, info_count);
+    if (status != EXYZ_SUCCESS) {
+        goto error;
+    }
+
+    if (stats != NULL) {
+        stats->comment_line_ns += exyz_stats_now() - start;
+    }
+
+    if (options != NULL && options->filter != NULL) {
+        if (!options->filter(n_atoms, *info, *info_count, options->filter_data)) {
+            if (stats != NULL) {
+                stats->skipped_frames += 1;
+            }
+            status = EXYZ_FAILED_READING;
+            goto error;
+        }
+    }
+
+    if (*properties_count == 0) {
+        exyz_free(*properties);
+        status = default_properties(properties, properties_count);
+        if (status != EXYZ_SUCCESS) {
+            goto error;
+        }
+    }
+
+    return EXYZ_SUCCESS;
+
+error:
+    for (size_t i=0; i<*properties_count; i++) {
+        exyz_atom_property_free((*properties)[i]);
+    }
+    exyz_free(*properties);
+    *properties = NULL;
+    *properties_count = 0;
+
+    for (size_t i=0; i<*info_count; i++) {
+        exyz_info_free((*info)[i]);
+    }
+    exyz_free(*info);
+    *info = NULL;
+    *info_count = 0;
+
+    return status;
+}
+
+exyz_status_t exyz_parse_frame_header(
+    char* frame,
+    size_t frame_size,
+    size_t n_atoms,
+    const exyz_parse_options_t* options,
+    exyz_atom_property_t** properties,
+    size_t* properties_count,
+    exyz_info_t** info,
+    size_t* info_count,
+    size_t* atoms_start
+) {
+    exyz_reset_error();
+    locale_t old_locale = use_c_locale();
+    exyz_status_t status = frame_header(
+        frame, frame_size, n_atoms, options,
+        properties, properties_count, info, info_count, atoms_start
+    );
+    restore_locale(old_locale);
+    return status;
+}
+
+exyz_status_t exyz_parse_frame(
+    char* frame,
+    size_t frame_size,
+    size_t n_atoms,
+    const exyz_parse_options_t* options,
+    exyz_info_t** info,
+    size_t* info_count,
+    exyz_atom_array_t** arrays,
+    size_t* arrays_count
+) {
+    *arrays = NULL;
+    *arrays_count = 0;
+    exyz_reset_error();
+
+    locale_t old_locale = use_c_locale();
+
+    exyz_atom_property_t* properties = NULL;
+    size_t properties_count = 0;
+    size_t atoms_start = 0;
+    exyz_status_t status = frame_header(
+        frame, frame_size, n_atoms, options,
+        &properties, &properties_count, info, info_count, &atoms_start
+    );
+    if (status != EXYZ_SUCCESS) {
+        restore_locale(old_locale);
+        return status;
+    }
+
+    exyz_stats_t* stats = exyz_current_stats;
+    uint64_t start = stats != NULL ? exyz_stats_now() : 0;
+
+    char* atoms = frame + atoms_start;
+    status = atoms_block(atoms, frame_size - atoms_start, n_atoms, options, properties, properties_count, arrays, arrays_count);
+    if (status == EXYZ_FAILED_READING) {
+        // only the comment line can reject a frame
+        status = error("invalid atoms lines in frame");
+        exyz_error_at(1, 0);
+    }
+    if (status == EXYZ_ERROR) {
+        // atoms lines start on the second line of the frame
+        exyz_error_shift(1, (int64_t)atoms_start);
+    }
+
+    if (stats != NULL) {
+        stats->atoms_ns += exyz_stats_now() - start;
+        if (status == EXYZ_SUCCESS) {
+            stats->frames += 1;
+            stats->atoms += n_atoms;
+        }
+    }
+
+    restore_locale(old_locale);
+
+    for (size_t i=0; i<properties_count; i++) {
+        exyz_atom_property_free(properties[i]);
+    }
+    exyz_free(properties);
+
+    if (status != EXYZ_SUCCESS) {
+        for (size_t i=0; i<*info_count; i++) {
+            exyz_info_free((*info)[i]);
+        }
+        exyz_free(*info);
+        *info = NULL;
+        *info_count = 0;
+    }
+
+    return status;
+}
+
+exyz_status_t exyz_read(
+    FILE* fp,
+    size_t* n_atoms,
+    exyz_info_t** info,
+    size_t* info_count,
+    exyz_atom_array_t** arrays,
+    size_t* arrays_count
+) {
+    exyz_reset_error();
+    exyz_stats_t* stats = exyz_current_stats;
+    uint64_t start = stats != NULL ? exyz_stats_now() : 0;
+    // this is -1 for pipes and other non-seekable files, and all offsets in
+    // errors are then unknown
+    long position = ftell(fp);
+
+    char* frame = NULL;
+    size_t frame_size = 0;
+    size_t header_size = 0;
+    size_t consumed = 0;
+    exyz_status_t status = read_frame(fp, n_atoms, &frame, &frame_size, &header_size, &consumed);
+    if (status == EXYZ_ERROR) {
+        // lines are not counted, only the position of the frame is known
+        exyz_error_at(-1, (int64_t)position);
+    }
+    if (status != EXYZ_SUCCESS) {
+        return status;
+    }
+
+    if (stats != NULL) {
+        stats->framing_ns += exyz_stats_now() - start;
+        stats->bytes += consumed;
+    }
+
+    status = exyz_parse_frame(frame, frame_size, *n_atoms, NULL, info, info_count, arrays, arrays_count);
+    exyz_free(frame);
+
+    if (status == EXYZ_ERROR) {
+        // the frame text starts after the line with the number of atoms
+        exyz_error_shift(-1, position >= 0 ? (int64_t)position + (int64_t)header_size : -1);
+    }
+
+    return status;
+}
+
+exyz_status_t exyz_read_lazy(FILE* fp, exyz_lazy_frame_t** lazy) {
+    *lazy = NULL;
+    exyz_reset_error();
+
+    exyz_stats_t* stats = exyz_current_stats;
+    uint64_t start = stats != NULL ? exyz_stats_now() : 0;
+    long position = ftell(fp);
+
+    size_t n_atoms = 0;
+    char* frame = NULL;
+    size_t frame_size = 0;
+    size_t header_size = 0;
+    size_t consumed = 0;
+    exyz_status_t status = read_frame(fp, &n_atoms, &frame, &frame_size, &header_size, &consumed);
+    if (status == EXYZ_ERROR) {
+        exyz_error_at(-1, (int64_t)position);
+    }
+    if (status != EXYZ_SUCCESS) {
+        return status;
+    }
+
+    if (stats != NULL) {
+        stats->framing_ns += exyz_stats_now() - start;
+        stats->bytes += consumed;
+    }
+
+    // the frame text starts after the line with the number of atoms
+    int64_t offset = position >= 0 ? (int64_t)position + (int64_t)header_size : -1;
+    status = exyz_lazy_frame_parse(frame, frame_size, n_atoms, NULL, -1, -1, offset, lazy);
+    exyz_free(frame);
+
+    if (status == EXYZ_ERROR) {
+        exyz_error_shift(-1, offset);
+    }
 
-cleanup:
-    free(frame);
-    free(properties);
     return status;
 }
@@ -0,0 +1,763 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include "exyz.h"
+#include "internal.h"
+
+static exyz_status_t error(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    exyz_status_t status = exyz_set_error(format, args);
+    va_end(args);
+
+    return status;
+}
+
+/// initial size of the reader buffer, it will grow to fit the largest frame
+#define READER_BUFFER_SIZE (1024 * 1024)
+
+struct exyz_reader_t {
+    FILE* file;
+    bool owns_file;
+    exyz_stream_t* stream;
+
+    /// buffer containing uncompressed data. The data between `start` and `end`
+    /// has been read from the stream but not parsed yet. The buffer always has
+    /// space for one more byte than `capacity`, to null-terminate the data.
+    char* buffer;
+    size_t capacity;
+    size_t start;
+    size_t end;
+    /// did we reach the end of the stream?
+    bool eof;
+    /// where to collect statistics, if not NULL
+    exyz_stats_t* stats;
+    /// allocator in use when the reader was created, used for the reader
+    /// buffers
+    exyz_allocator_t allocator;
+    /// allocator for the frames returned by the reader, or NULL to use the
+    /// allocator of the calling thread
+    const exyz_allocator_t* frames_allocator;
+    /// which parts of the frames to parse
+    exyz_parse_options_t options;
+    /// cache of the parsed frames, or NULL
+    exyz_frame_cache_t* frame_cache;
+    /// only return frames with `start <= index < stop` and `index - start`
+    /// a multiple of `step`
+    size_t stride_start;
+    size_t stride_stop;
+    size_t stride_step;
+
+    /// index of the next frame in the file
+    int64_t frame;
+    /// the stream is not positioned at `frame` yet, since the last seek went
+    /// to a frame in the frame cache
+    bool seek_pending;
+    /// number of lines before `start`, or -1 if unknown (after seeking)
+    int64_t lines;
+    /// number of bytes of uncompressed data before `start`
+    int64_t offset;
+    /// last error that happened while using this reader
+    exyz_error_t error;
+};
+
+static exyz_status_t reader_init(exyz_reader_t** reader_ptr, FILE* file, bool owns_file) {
+    exyz_reader_t* reader = exyz_calloc(1, sizeof(exyz_reader_t));
+    if (reader == NULL) {
+        if (owns_file) {
+            fclose(file);
+        }
+        return error("failed to allocate memory");
+    }
+
+    reader->file = file;
+    reader->owns_file = owns_file;
+    reader->allocator = *exyz_current_allocator();
+    reader->stride_start = 0;
+    reader->stride_stop = SIZE_MAX;
+    reader->stride_step = 1;
+    reader->error.frame = -1;
+    reader->error.line = -1;
+    reader->error.offset = -1;
+
+    reader->capacity = READER_BUFFER_SIZE;
+    reader->buffer = exyz_malloc(reader->capacity + 1);
+    if (reader->buffer == NULL) {
+        exyz_reader_close(reader);
+        return error("failed to allocate memory");
+    }
+
+    exyz_status_t status = exyz_stream_open(&reader->stream, file);
+    if (status != EXYZ_SUCCESS) {
+        exyz_reader_close(reader);
+        return status;
+    }
+
+    *reader_ptr = reader;
+    return EXYZ_SUCCESS;
+}
+
+exyz_status_t exyz_reader_open(exyz_reader_t** reader, const char* path) {
+    exyz_reset_error();
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        return error("failed to open '%s'", path);
+    }
+
+    // the file is closed by reader_init on error
+    return reader_init(reader, file, true);
+}
+
+exyz_status_t exyz_reader_from_file(exyz_reader_t** reader, FILE* fp) {
+    exyz_reset_error();
+    return reader_init(reader, fp, false);
+}
+
+exyz_compression_t exyz_reader_compression(const exyz_reader_t* reader) {
+    return exyz_stream_compression(reader->stream);
+}
+
+/// remove the selection of atom properties, going back to reading all of them
+static void clear_properties(exyz_reader_t* reader) {
+    for (size_t i=0; i<reader->options.properties_count; i++) {
+        exyz_free(reader->options.properties[i]);
+    }
+    exyz_free(reader->options.properties);
+    reader->options.properties = NULL;
+    reader->options.properties_count = 0;
+}
+
+exyz_status_t exyz_reader_close(exyz_reader_t* reader) {
+    if (reader == NULL) {
+        return EXYZ_SUCCESS;
+    }
+
+    exyz_allocator_t allocator = reader->allocator;
+    const exyz_allocator_t* previous_allocator = exyz_use_allocator(&allocator);
+
+    clear_properties(reader);
+    exyz_free(reader->options.atomic_numbers);
+    exyz_stream_close(reader->stream);
+    if (reader->owns_file) {
+        fclose(reader->file);
+    }
+
+    exyz_free(reader->buffer);
+    exyz_free(reader);
+
+    exyz_use_allocator(previous_allocator);
+    return EXYZ_SUCCESS;
+}
+
+/// get more data from the stream, moving the unparsed data to the beginning
+/// of the buffer and growing the buffer if needed.
+static exyz_status_t fill_buffer(exyz_reader_t* reader) {
+    if (reader->start != 0) {
+        memmove(reader->buffer, reader->buffer + reader->start, reader->end - reader->start);
+        reader->end -= reader->start;
+        reader->start = 0;
+    }
+
+    if (reader->end == reader->capacity) {
+        size_t capacity = 2 * reader->capacity;
+        char* buffer = exyz_realloc(reader->buffer, capacity + 1);
+        if (buffer == NULL) {
+            return error("failed to allocate memory");
+        }
+        reader->buffer = buffer;
+        reader->capacity = capacity;
+    }
+
+    size_t n_read = 0;
+    exyz_status_t status = exyz_stream_read(
+        reader->stream, reader->buffer + reader->end, reader->capacity - reader->end, &n_read
+    );
+    if (status != EXYZ_SUCCESS) {
+        return status;
+    }
+
+    if (n_read == 0) {
+        reader->eof = true;
+    }
+    reader->end += n_read;
+
+    return EXYZ_SUCCESS;
+}
+
+/// find the next '\n' after `offset` bytes of unparsed data, reading more data
+/// if needed, and store its offset in `newline`. This returns
+/// `EXYZ_FAILED_READING` if we reach the end of the file before finding one.
+static exyz_status_t find_newline(exyz_reader_t* reader, size_t offset, size_t* newline) {
+    while (true) {
+        // offsets are relative to reader->start, since fill_buffer can move data
+        const char* data = reader->buffer + reader->start;
+        size_t size = reader->end - reader->start;
+
+        const char* found = memchr(data + offset, '\n', size - offset);
+        if (found != NULL) {
+            *newline = (size_t)(found - data);
+            return EXYZ_SUCCESS;
+        }
+        offset = size;
+
+        if (reader->eof) {
+            return EXYZ_FAILED_READING;
+        }
+
+        exyz_status_t status = fill_buffer(reader);
+        if (status != EXYZ_SUCCESS) {
+            return status;
+        }
+    }
+}
+
+/// find the next frame in the stream without parsing it. On success, the line
+/// with the number of atoms starts at `reader->start`, and `header_end` and
+/// `frame_end` are set to the offsets of the newline after this line and after
+/// the last atom line respectively.
+static exyz_status_t next_frame(exyz_reader_t* reader, size_t* n_atoms, size_t* header_end, size_t* frame_end) {
+    while (true) {
+        exyz_status_t status = find_newline(reader, 0, header_end);
+        if (status == EXYZ_FAILED_READING) {
+            if (exyz_is_blank_line(reader->buffer + reader->start, reader->end - reader->start)) {
+                reader->start = reader->end;
+                return EXYZ_END_OF_FILE;
+            }
+            error("expected a comment line after the number of atoms, got end of file");
+            exyz_error_at(1, 0);
+            return EXYZ_ERROR;
+        } else if (status != EXYZ_SUCCESS) {
+            return status;
+        }
+
+        // skip empty lines between frames and at the end of the file
+        if (exyz_is_blank_line(reader->buffer + reader->start, *header_end)) {
+            reader->start += *header_end + 1;
+            reader->offset += (int64_t)*header_end + 1;
+            if (reader->lines >= 0) {
+                reader->lines += 1;
+            }
+            continue;
+        }
+        break;
+    }
+
+    exyz_status_t status = exyz_parse_atoms_count(reader->buffer + reader->start, *header_end, n_atoms);
+    if (status != EXYZ_SUCCESS) {
+        exyz_error_at(1, 0);
+        return status;
+    }
+
+    // find the end of the comment line and of all atoms lines
+    *frame_end = *header_end;
+    for (size_t line=0; line<*n_atoms + 1; line++) {
+        status = find_newline(reader, *frame_end + 1, frame_end);
+        if (status == EXYZ_FAILED_READING) {
+            size_t remaining = reader->end - reader->start;
+            if (line == *n_atoms && remaining > *frame_end + 1) {
+                // the last line does not end with a newline
+                *frame_end = remaining;
+                break;
+            }
+            error("not enough lines in file for XYZ format: expected %zu atoms", *n_atoms);
+            exyz_error_at(1, 0);
+            return EXYZ_ERROR;
+        } else if (status != EXYZ_SUCCESS) {
+            return status;
+        }
+    }
+
+    return EXYZ_SUCCESS;
+}
+
+/// get the size of the frame ending at `frame_end`, including the final newline
+static size_t frame_size_with_newline(const exyz_reader_t* reader, size_t frame_end) {
+    size_t size = frame_end + 1;
+    if (reader->start + size > reader->end) {
+        size = reader->end - reader->start;
+    }
+    return size;
+}
+
+/// mark the frame with `n_atoms` atoms ending at `frame_end` as consumed
+static void consume_frame(exyz_reader_t* reader, size_t n_atoms, size_t frame_end) {
+    size_t size = frame_size_with_newline(reader, frame_end);
+    reader->start += size;
+    reader->offset += (int64_t)size;
+    if (reader->lines >= 0) {
+        reader->lines += (int64_t)n_atoms + 2;
+    }
+    reader->frame += 1;
+}
+
+/// complete the position of the last error, which is relative to the data at
+/// `reader->start`, and save it as the last error of this reader
+static void record_error(exyz_reader_t* reader) {
+    exyz_error_shift(reader->lines, reader->offset);
+    exyz_error_frame(reader->frame);
+    reader->error = *exyz_last_error();
+}
+
+/// find the next frame with `next_frame`, accounting for the time spent and
+/// the bytes of input in `stats` if it is not NULL
+static exyz_status_t next_frame_with_stats(
+    exyz_reader_t* reader,
+    exyz_stats_t* stats,
+    size_t* n_atoms,
+    size_t* header_end,
+    size_t* frame_end
+) {
+    if (stats == NULL) {
+        return next_frame(reader, n_atoms, header_end, frame_end);
+    }
+
+    uint64_t start = exyz_stats_now();
+    exyz_status_t status = next_frame(reader, n_atoms, header_end, frame_end);
+    stats->framing_ns += exyz_stats_now() - start;
+    if (status == EXYZ_SUCCESS) {
+        stats->bytes += frame_size_with_newline(reader, *frame_end);
+    }
+
+    return status;
+}
+
+void exyz_reader_set_stats(exyz_reader_t* reader, exyz_stats_t* stats) {
+    reader->stats = stats;
+}
+
+void exyz_reader_set_allocator(exyz_reader_t* reader, const exyz_allocator_t* allocator) {
+    reader->frames_allocator = allocator;
+}
+
+exyz_status_t exyz_reader_select_properties(exyz_reader_t* reader, const char* const* names, size_t count) {
+    const exyz_allocator_t* previous_allocator = exyz_use_allocator(&reader->allocator);
+    clear_properties(reader);
+
+    exyz_status_t status = EXYZ_SUCCESS;
+    if (names != NULL) {
+        // use at least one entry to distinguish an empty selection from no
+        // selection at all
+        reader->options.properties = exyz_calloc(count > 0 ? count : 1, sizeof(char*));
+        if (reader->options.properties == NULL) {
+            status = error("failed to allocate memory");
+        }
+
+        for (size_t i=0; status == EXYZ_SUCCESS && i<count; i++) {
+            reader->options.properties[i] = exyz_strdup(names[i]);
+            reader->options.properties_count += 1;
+            if (reader->options.properties[i] == NULL) {
+                status = error("failed to allocate memory");
+            }
+        }
+
+        if (status != EXYZ_SUCCESS) {
+            clear_properties(reader);
+        }
+    }
+
+    exyz_use_allocator(previous_allocator);
+    return status;
+}
+
+void exyz_reader_set_filter(exyz_reader_t* reader, exyz_frame_filter_t filter, void* data) {
+    reader->options.filter = filter;
+    reader->options.filter_data = data;
+}
+
+void exyz_reader_set_frame_cache(exyz_reader_t* reader, exyz_frame_cache_t* cache) {
+    reader->frame_cache = cache;
+}
+
+void exyz_reader_set_threads(exyz_reader_t* reader, size_t threads) {
+    reader->options.threads = threads;
+    exyz_stream_set_threads(reader->stream, threads);
+}
+
+exyz_status_t exyz_reader_set_atomic_numbers(exyz_reader_t* reader, const char* name, bool strict, int64_t unknown) {
+    const exyz_allocator_t* previous_allocator = exyz_use_allocator(&reader->allocator);
+    exyz_free(reader->options.atomic_numbers);
+    reader->options.atomic_numbers = NULL;
+    reader->options.strict_species = strict;
+    reader->options.unknown_species = unknown;
+
+    exyz_status_t status = EXYZ_SUCCESS;
+    if (name != NULL) {
+        reader->options.atomic_numbers = exyz_strdup(name);
+        if (reader->options.atomic_numbers == NULL) {
+            status = error("failed to allocate memory");
+        }
+    }
+
+    exyz_use_allocator(previous_allocator);
+    return status;
+}
+
+const exyz_error_t* exyz_reader_last_error(const exyz_reader_t* reader) {
+    return &reader->error;
+}
+
+exyz_status_t exyz_reader_next_raw_frame(exyz_reader_t* reader, const char** data, size_t* size) {
+    exyz_reset_error();
+    size_t n_atoms = 0;
+    size_t header_end = 0;
+    size_t frame_end = 0;
+    exyz_stats_t* stats = reader->stats != NULL ? reader->stats : exyz_current_stats;
+
+    const exyz_allocator_t* previous_allocator = exyz_use_allocator(&reader->allocator);
+    exyz_status_t status = next_frame_with_stats(reader, stats, &n_atoms, &header_end, &frame_end);
+    exyz_use_allocator(previous_allocator);
+    if (status == EXYZ_ERROR) {
+        record_error(reader);
+    }
+    if (status != EXYZ_SUCCESS) {
+        return status;
+    }
+
+    *data = reader->buffer + reader->start;
+    *size = frame_size_with_newline(reader, frame_end);
+
+    consume_frame(reader, n_atoms, frame_end);
+    return EXYZ_SUCCESS;
+}
+
+exyz_status_t exyz_reader_frames_count(exyz_reader_t* reader, size_t* count) {
+    exyz_reset_error();
+    const exyz_seek_table_t* table = exyz_stream_seek_table(reader->stream);
+    if (table == NULL || table->first_frames == NULL) {
+        return error("this file does not contain an index of the frames");
+    }
+
+    *count = (size_t)table->first_frames[table->blocks_count];
+    return EXYZ_SUCCESS;
+}
+
+/// find the block containing the frame at `index` in `table`
+static size_t find_block(const exyz_seek_table_t* table, size_t index) {
+    // binary search for the last block starting before this frame
+    size_t low = 0;
+    size_t high = table->blocks_count;
+    while (high - low > 1) {
+        size_t middle = low + (high - low) / 2;
+        if (table->first_frames[middle] <= index) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+/// check that the reader can seek to the frame at `index`
+static exyz_status_t check_seek(exyz_reader_t* reader, size_t index) {
+    const exyz_seek_table_t* table = exyz_stream_seek_table(reader->stream);
+    if (table == NULL || table->first_frames == NULL) {
+        return error("can not seek in this file, it does not contain an index of the frames");
+    }
+
+    if (index >= table->first_frames[table->blocks_count]) {
+        return error(
+            "can not seek to frame %zu, this file only contains %zu frames",
+            index, (size_t)table->first_frames[table->blocks_count]
+        );
+    }
+
+    return EXYZ_SUCCESS;
+}
+
+static exyz_status_t seek_frame(exyz_reader_t* reader, size_t index) {
+    exyz_status_t status = check_seek(reader, index);
+    if (status != EXYZ_SUCCESS) {
+        return status;
+    }
+
+    const exyz_seek_table_t* table = exyz_stream_seek_table(reader->stream);
+    size_t low = find_block(table, index);
+    status = exyz_stream_seek_block(reader->stream, low);
+    if (status != EXYZ_SUCCESS) {
+        return status;
+    }
+
+    reader->seek_pending = false;
+    reader->start = 0;
+    reader->end = 0;
+    reader->eof = false;
+
+    reader->frame = (int64_t)table->first_frames[low];
+    reader->lines = -1;
+    reader->offset = 0;
+    for (size_t i=0; i<low; i++) {
+        reader->offset += (int64_t)table->sizes[i];
+    }
+
+    // skip the frames before the requested one inside this block
+    for (size_t i=(size_t)table->first_frames[low]; i<index; i++) {
+        size_t n_atoms = 0;
+        size_t header_end = 0;
+        size_t frame_end = 0;
+        status = next_frame(reader, &n_atoms, &header_end, &frame_end);
+        if (status == EXYZ_END_OF_FILE) {
+            return error("invalid frame index: missing frames in block %zu", low);
+        } else if (status != EXYZ_SUCCESS) {
+            if (status == EXYZ_ERROR) {
+                record_error(reader);
+            }
+            return status;
+        }
+        consume_frame(reader, n_atoms, frame_end);
+    }
+
+    return EXYZ_SUCCESS;
+}
+
+exyz_status_t exyz_reader_seek_frame(exyz_reader_t* reader, size_t index) {
+    exyz_reset_error();
+    if (reader->frame_cache != NULL) {
+        // the stream is only moved when reading a frame which is not cached
+        exyz_status_t status = check_seek(reader, index);
+        if (status == EXYZ_SUCCESS) {
+            reader->frame = (int64_t)index;
+            reader->lines = -1;
+            reader->seek_pending = true;
+        }
+        return status;
+    }
+
+    const exyz_allocator_t* previous_allocator = exyz_use_allocator(&reader->allocator);
+    exyz_status_t status = seek_frame(reader, index);
+    exyz_use_allocator(previous_allocator);
+    return status;
+}
+
+exyz_status_t exyz_reader_set_stride(exyz_reader_t* reader, size_t start, size_t stop, size_t step) {
+    exyz_reset_error();
+    if (step == 0) {
+        return error("the stride step must be at least 1");
+    }
+
+    reader->stride_start = start;
+    reader->stride_stop = stop;
+    reader->stride_step = step;
+    return EXYZ_SUCCESS;
+}
+
+/// find the index of the first frame selected by the reader stride, starting
+/// from the current frame. This returns false if there are no more selected
+/// frames.
+static bool next_stride_frame(const exyz_reader_t* reader, size_t* next) {
+    size_t current = (size_t)reader->frame;
+    *next = reader->stride_start;
+    if (current > *next) {
+        size_t remainder = (current - *next) % reader->stride_step;
+        if (remainder != 0 && reader->stride_step - remainder > SIZE_MAX - current) {
+            // the next selected frame can not be represented
+            return false;
+        }
+        *next = remainder == 0 ? current : current + reader->stride_step - remainder;
+    }
+
+    return *next < reader->stride_stop && *next >= current;
+}
+
+/// skip frames until the next one is selected by the reader stride, seeking
+/// directly to it when the file contains an index of the frames. Skipped
+/// frames are only delimited, without parsing them. This returns
+/// `EXYZ_END_OF_FILE` if there are no more selected frames, and records errors
+/// in the reader.
+static exyz_status_t skip_to_stride(exyz_reader_t* reader, exyz_stats_t* stats) {
+    size_t current = (size_t)reader->frame;
+    size_t next = 0;
+    if (!next_stride_frame(reader, &next)) {
+        return EXYZ_END_OF_FILE;
+    }
+
+    if (next == current) {
+        return EXYZ_SUCCESS;
+    }
+
+    const exyz_seek_table_t* table = exyz_stream_seek_table(reader->stream);
+    if (table != NULL && table->first_frames != NULL) {
+        if (next >= table->first_frames[table->blocks_count]) {
+            return EXYZ_END_OF_FILE;
+        }
+
+        // only seek when this skips whole blocks, otherwise reading the
+        // frames from the current position is faster
+        if (table->first_frames[find_block(table, next)] > current) {
+            if (stats != NULL) {
+                stats->skipped_frames += next - current;
+            }
+            return seek_frame(reader, next);
+        }
+    }
+
+    while (current < next) {
+        size_t n_atoms = 0;
+        size_t header_end = 0;
+        size_t frame_end = 0;
+        exyz_status_t status = next_frame_with_stats(reader, stats, &n_atoms, &header_end, &frame_end);
+        if (status != EXYZ_SUCCESS) {
+            if (status == EXYZ_ERROR) {
+                record_error(reader);
+            }
+            return status;
+        }
+
+        consume_frame(reader, n_atoms, frame_end);
+        if (stats != NULL) {
+            stats->skipped_frames += 1;
+        }
+        current += 1;
+    }
+
+    return EXYZ_SUCCESS;
+}
+
+/// find the next frame selected by the reader stride, recording errors in the
+/// reader
+static exyz_status_t next_selected_frame(exyz_reader_t* reader, size_t* n_atoms, size_t* header_end, size_t* frame_end) {
+    if (reader->seek_pending) {
+        // the frames up to the current one came from the frame cache, and the
+        // current one could be the end of the file
+        const exyz_seek_table_t* table = exyz_stream_seek_table(reader->stream);
+        if ((uint64_t)reader->frame >= table->first_frames[table->blocks_count]) {
+            return EXYZ_END_OF_FILE;
+        }
+
+        exyz_status_t status = seek_frame(reader, (size_t)reader->frame);
+        if (status != EXYZ_SUCCESS) {
+            return status;
+        }
+    }
+
+    exyz_status_t status = skip_to_stride(reader, exyz_current_stats);
+    if (status == EXYZ_SUCCESS) {
+        status = next_frame_with_stats(reader, exyz_current_stats, n_atoms, header_end, frame_end);
+        if (status == EXYZ_ERROR) {
+            record_error(reader);
+        }
+    }
+    return status;
+}
+
+exyz_status_t exyz_reader_read(
+    exyz_reader_t* reader,
+    size_t* n_atoms,
+    exyz_info_t** info,
+    size_t* info_count,
+    exyz_atom_array_t** arrays,
+    size_t* arrays_count
+) {
+    exyz_reset_error();
+    exyz_stats_t* previous_stats = exyz_current_stats;
+    if (reader->stats != NULL) {
+        exyz_current_stats = reader->stats;
+    }
+
+    const exyz_allocator_t* previous_allocator = exyz_use_allocator(&reader->allocator);
+    const exyz_allocator_t* frames_allocator = reader->frames_allocator;
+    if (frames_allocator == NULL) {
+        frames_allocator = previous_allocator;
+    }
+
+    exyz_status_t status = EXYZ_FAILED_READING;
+    size_t next = 0;
+    if (reader->seek_pending && reader->frame_cache != NULL && next_stride_frame(reader, &next)) {
+        // get the frame from the cache without moving the stream if possible
+        exyz_use_allocator(frames_allocator);
+        status = exyz_frame_cache_get(reader->frame_cache, next, n_atoms, info, info_count, arrays, arrays_count);
+        if (status == EXYZ_SUCCESS) {
+            reader->frame = (int64_t)next + 1;
+        }
+    }
+
+    while (status == EXYZ_FAILED_READING) {
+        size_t header_end = 0;
+        size_t frame_end = 0;
+        exyz_use_allocator(&reader->allocator);
+        status = next_selected_frame(reader, n_atoms, &header_end, &frame_end);
+        if (status != EXYZ_SUCCESS) {
+            break;
+        }
+
+        char* frame = reader->buffer + reader->start + header_end + 1;
+        size_t frame_size = frame_end - header_end - 1;
+        frame[frame_size] = '\0';
+
+        exyz_use_allocator(frames_allocator);
+        size_t index = (size_t)reader->frame;
+        status = EXYZ_FAILED_READING;
+        if (reader->frame_cache != NULL) {
+            status = exyz_frame_cache_get(reader->frame_cache, index, n_atoms, info, info_count, arrays, arrays_count);
+        }
+
+        if (status == EXYZ_FAILED_READING) {
+            status = exyz_parse_frame(frame, frame_size, *n_atoms, &reader->options, info, info_count, arrays, arrays_count);
+            if (status == EXYZ_ERROR) {
+                // the frame text starts after the line with the number of atoms
+                exyz_error_shift(1, (int64_t)header_end + 1);
+                record_error(reader);
+            } else if (status == EXYZ_SUCCESS && reader->frame_cache != NULL) {
+                exyz_frame_cache_add(reader->frame_cache, index, *n_atoms, *info, *info_count, *arrays, *arrays_count);
+            }
+        }
+        consume_frame(reader, *n_atoms, frame_end);
+
+        // EXYZ_FAILED_READING means the frame was rejected by the filter
+    }
+
+    exyz_use_allocator(previous_allocator);
+    exyz_current_stats = previous_stats;
+    return status;
+}
+
+exyz_status_t exyz_reader_read_lazy(exyz_reader_t* reader, exyz_lazy_frame_t** frame) {
+    *frame = NULL;
+    exyz_reset_error();
+
+    exyz_stats_t* previous_stats = exyz_current_stats;
+    if (reader->stats != NULL) {
+        exyz_current_stats = reader->stats;
+    }
+
+    const exyz_allocator_t* previous_allocator = exyz_use_allocator(&reader->allocator);
+    exyz_status_t status = EXYZ_SUCCESS;
+    do {
+        size_t n_atoms = 0;
+        size_t header_end = 0;
+        size_t frame_end = 0;
+        exyz_use_allocator(&reader->allocator);
+        status = next_selected_frame(reader, &n_atoms, &header_end, &frame_end);
+        if (status != EXYZ_SUCCESS) {
+            break;
+        }
+
+        char* text = reader->buffer + reader->start + header_end + 1;
+        size_t text_size = frame_end - header_end - 1;
+        text[text_size] = '\0';
+
+        if (reader->frames_allocator != NULL) {
+            exyz_use_allocator(reader->frames_allocator);
+        } else {
+            exyz_use_allocator(previous_allocator);
+        }
+
+        // the comment line is the second line of the frame
+        status = exyz_lazy_frame_parse(
+            text, text_size, n_atoms, &reader->options, reader->frame,
+            reader->lines + 2, reader->offset + (int64_t)header_end + 1, frame
+        );
+        if (status == EXYZ_ERROR) {
+            exyz_error_shift(1, (int64_t)header_end + 1);
+            record_error(reader);
+        }
+        consume_frame(reader, n_atoms, frame_end);
+
+        // EXYZ_FAILED_READING means the frame was rejected by the filter
+    } while (status == EXYZ_FAILED_READING);
+
+    exyz_use_allocator(previous_allocator);
+    exyz_current_stats = previous_stats;
+    return status;
+}
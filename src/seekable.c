@@ -0,0 +1,465 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#ifdef EXYZ_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "exyz.h"
+#include "internal.h"
+
+static exyz_status_t error(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    exyz_status_t status = exyz_set_error(format, args);
+    va_end(args);
+
+    return status;
+}
+
+// The zstd seekable format is described in
+// https://github.com/facebook/zstd/blob/dev/contrib/seekable_format/zstd_seekable_compression_format.md
+//
+// Files are made of independent zstd frames (called blocks here to avoid
+// confusion with trajectory frames), followed by a skippable frame containing
+// the seek table. Files created by exyz also contain an additional skippable
+// frame between the last block and the seek table, with the number of
+// trajectory frames in each block.
+
+#define SKIPPABLE_HEADER_SIZE 8
+#define SEEK_TABLE_MAGIC 0x184D2A5Eu
+#define SEEK_TABLE_FOOTER_SIZE 9
+#define SEEKABLE_MAGIC 0x8F92EAB1u
+#define FRAME_INDEX_MAGIC 0x184D2A5Au
+#define FRAME_INDEX_TAG "EXYZ"
+
+static uint32_t read_u32(const uint8_t* data) {
+    return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+void exyz_seek_table_free(exyz_seek_table_t* table) {
+    if (table == NULL) {
+        return;
+    }
+
+    exyz_free(table->offsets);
+    exyz_free(table->sizes);
+    exyz_free(table->first_frames);
+    exyz_free(table);
+}
+
+static exyz_status_t read_at(FILE* file, long offset, int whence, uint8_t* buffer, size_t size) {
+    if (fseek(file, offset, whence) != 0) {
+        return EXYZ_FAILED_READING;
+    }
+
+    if (fread(buffer, 1, size, file) != size) {
+        return EXYZ_FAILED_READING;
+    }
+
+    return EXYZ_SUCCESS;
+}
+
+/// read the optional frame index stored by exyz between `start` and `end`
+static exyz_status_t read_frame_index(FILE* file, exyz_seek_table_t* table, uint64_t start, uint64_t end) {
+    size_t expected = SKIPPABLE_HEADER_SIZE + 8 + 4 * table->blocks_count;
+    if (end - start != expected) {
+        return EXYZ_FAILED_READING;
+    }
+
+    uint8_t* data = exyz_malloc(expected);
+    if (data == NULL) {
+        return error("failed to allocate memory");
+    }
+
+    exyz_status_t status = read_at(file, (long)start, SEEK_SET, data, expected);
+    if (status != EXYZ_SUCCESS) {
+        exyz_free(data);
+        return status;
+    }
+
+    if (read_u32(data) != FRAME_INDEX_MAGIC ||
+        read_u32(data + 4) != expected - SKIPPABLE_HEADER_SIZE ||
+        memcmp(data + 8, FRAME_INDEX_TAG, 4) != 0 ||
+        read_u32(data + 12) != table->blocks_count
+    ) {
+        exyz_free(data);
+        return EXYZ_FAILED_READING;
+    }
+
+    table->first_frames = exyz_malloc((table->blocks_count + 1) * sizeof(uint64_t));
+    if (table->first_frames == NULL) {
+        exyz_free(data);
+        return error("failed to allocate memory");
+    }
+
+    table->first_frames[0] = 0;
+    for (size_t i=0; i<table->blocks_count; i++) {
+        table->first_frames[i + 1] = table->first_frames[i] + read_u32(data + 16 + 4 * i);
+    }
+
+    exyz_free(data);
+    return EXYZ_SUCCESS;
+}
+
+exyz_status_t exyz_seek_table_read(FILE* file, long start, exyz_seek_table_t** table_ptr) {
+    long initial = ftell(file);
+    if (initial < 0 || start < 0) {
+        return EXYZ_FAILED_READING;
+    }
+
+    exyz_seek_table_t* table = NULL;
+    uint8_t* entries = NULL;
+
+    uint8_t footer[SEEK_TABLE_FOOTER_SIZE];
+    exyz_status_t status = read_at(file, -SEEK_TABLE_FOOTER_SIZE, SEEK_END, footer, SEEK_TABLE_FOOTER_SIZE);
+    if (status != EXYZ_SUCCESS) {
+        goto error;
+    }
+
+    if (read_u32(footer + 5) != SEEKABLE_MAGIC) {
+        status = EXYZ_FAILED_READING;
+        goto error;
+    }
+
+    size_t blocks_count = read_u32(footer);
+    uint8_t descriptor = footer[4];
+    if ((descriptor & 0x7c) != 0) {
+        // reserved bits must be 0
+        status = EXYZ_FAILED_READING;
+        goto error;
+    }
+    size_t entry_size = (descriptor & 0x80) ? 12 : 8;
+
+    long end = ftell(file);
+    size_t table_size = SKIPPABLE_HEADER_SIZE + blocks_count * entry_size + SEEK_TABLE_FOOTER_SIZE;
+    if (end < 0 || (size_t)(end - start) < table_size) {
+        status = EXYZ_FAILED_READING;
+        goto error;
+    }
+
+    entries = exyz_malloc(table_size);
+    if (entries == NULL) {
+        status = error("failed to allocate memory");
+        goto error;
+    }
+
+    status = read_at(file, -(long)table_size, SEEK_END, entries, table_size);
+    if (status != EXYZ_SUCCESS) {
+        goto error;
+    }
+
+    if (read_u32(entries) != SEEK_TABLE_MAGIC || read_u32(entries + 4) != table_size - SKIPPABLE_HEADER_SIZE) {
+        status = EXYZ_FAILED_READING;
+        goto error;
+    }
+
+    table = exyz_calloc(1, sizeof(exyz_seek_table_t));
+    if (table == NULL) {
+        status = error("failed to allocate memory");
+        goto error;
+    }
+    table->blocks_count = blocks_count;
+    table->offsets = exyz_malloc((blocks_count + 1) * sizeof(uint64_t));
+    table->sizes = exyz_malloc((blocks_count + 1) * sizeof(uint64_t));
+    if (table->offsets == NULL || table->sizes == NULL) {
+        status = error("failed to allocate memory");
+        goto error;
+    }
+
+    table->offsets[0] = (uint64_t)start;
+    for (size_t i=0; i<blocks_count; i++) {
+        const uint8_t* entry = entries + SKIPPABLE_HEADER_SIZE + i * entry_size;
+        table->offsets[i + 1] = table->offsets[i] + read_u32(entry);
+        table->sizes[i] = read_u32(entry + 4);
+    }
+
+    uint64_t table_start = (uint64_t)end - table_size;
+    if (table->offsets[blocks_count] > table_start) {
+        status = error("invalid zstd seek table: blocks extend past the seek table");
+        goto error;
+    }
+
+    if (table->offsets[blocks_count] != table_start) {
+        status = read_frame_index(file, table, table->offsets[blocks_count], table_start);
+        if (status == EXYZ_ERROR) {
+            goto error;
+        }
+        // a missing or unknown index is not an error, we just can not seek
+        // to specific frames in this file
+    }
+
+    exyz_free(entries);
+    *table_ptr = table;
+    return EXYZ_SUCCESS;
+
+error:
+    exyz_free(entries);
+    exyz_seek_table_free(table);
+    if (fseek(file, initial, SEEK_SET) != 0 && status == EXYZ_FAILED_READING) {
+        status = error("failed to reset the file position");
+    }
+    return status;
+}
+
+/******************************************************************************/
+
+#ifdef EXYZ_HAVE_ZSTD
+static void write_u32(uint8_t* data, uint32_t value) {
+    data[0] = (uint8_t)(value & 0xff);
+    data[1] = (uint8_t)((value >> 8) & 0xff);
+    data[2] = (uint8_t)((value >> 16) & 0xff);
+    data[3] = (uint8_t)((value >> 24) & 0xff);
+}
+
+typedef struct seekable_writer_t {
+    FILE* file;
+    ZSTD_CCtx* context;
+    int level;
+
+    /// uncompressed data for the current block
+    char* block;
+    size_t block_size;
+    size_t block_capacity;
+    size_t block_frames;
+
+    /// buffer for compressed data
+    uint8_t* compressed;
+    size_t compressed_capacity;
+
+    /// seek table entries and number of frames for each block
+    uint32_t* compressed_sizes;
+    uint32_t* decompressed_sizes;
+    uint32_t* frames;
+    size_t blocks_count;
+    size_t blocks_capacity;
+} seekable_writer_t;
+
+static exyz_status_t append_frame(seekable_writer_t* writer, const char* data, size_t size) {
+    // make space for an additional newline, if the frame does not have one
+    size_t needed = writer->block_size + size + 1;
+    if (needed > writer->block_capacity) {
+        size_t capacity = 2 * writer->block_capacity;
+        if (capacity < needed) {
+            capacity = needed;
+        }
+
+        char* block = exyz_realloc(writer->block, capacity);
+        if (block == NULL) {
+            return error("failed to allocate memory");
+        }
+        writer->block = block;
+        writer->block_capacity = capacity;
+    }
+
+    memcpy(writer->block + writer->block_size, data, size);
+    writer->block_size += size;
+    if (size == 0 || data[size - 1] != '\n') {
+        writer->block[writer->block_size] = '\n';
+        writer->block_size += 1;
+    }
+    writer->block_frames += 1;
+
+    return EXYZ_SUCCESS;
+}
+
+static exyz_status_t flush_block(seekable_writer_t* writer) {
+    if (writer->block_frames == 0) {
+        return EXYZ_SUCCESS;
+    }
+
+    if (writer->block_size > UINT32_MAX) {
+        return error("frames are too large for the zstd seekable format (more than 4GiB in a single block)");
+    }
+
+    size_t bound = ZSTD_compressBound(writer->block_size);
+    if (bound > writer->compressed_capacity) {
+        uint8_t* compressed = exyz_realloc(writer->compressed, bound);
+        if (compressed == NULL) {
+            return error("failed to allocate memory");
+        }
+        writer->compressed = compressed;
+        writer->compressed_capacity = bound;
+    }
+
+    size_t compressed_size = ZSTD_compressCCtx(
+        writer->context,
+        writer->compressed, writer->compressed_capacity,
+        writer->block, writer->block_size,
+        writer->level
+    );
+    if (ZSTD_isError(compressed_size)) {
+        return error("failed to compress data: %s", ZSTD_getErrorName(compressed_size));
+    }
+
+    if (fwrite(writer->compressed, 1, compressed_size, writer->file) != compressed_size) {
+        return error("failed to write compressed data");
+    }
+
+    if (writer->blocks_count == writer->blocks_capacity) {
+        size_t capacity = writer->blocks_capacity == 0 ? 64 : 2 * writer->blocks_capacity;
+        uint32_t* compressed_sizes = exyz_realloc(writer->compressed_sizes, capacity * sizeof(uint32_t));
+        if (compressed_sizes != NULL) {
+            writer->compressed_sizes = compressed_sizes;
+        }
+        uint32_t* decompressed_sizes = exyz_realloc(writer->decompressed_sizes, capacity * sizeof(uint32_t));
+        if (decompressed_sizes != NULL) {
+            writer->decompressed_sizes = decompressed_sizes;
+        }
+        uint32_t* frames = exyz_realloc(writer->frames, capacity * sizeof(uint32_t));
+        if (frames != NULL) {
+            writer->frames = frames;
+        }
+
+        if (compressed_sizes == NULL || decompressed_sizes == NULL || frames == NULL) {
+            return error("failed to allocate memory");
+        }
+        writer->blocks_capacity = capacity;
+    }
+
+    writer->compressed_sizes[writer->blocks_count] = (uint32_t)compressed_size;
+    writer->decompressed_sizes[writer->blocks_count] = (uint32_t)writer->block_size;
+    writer->frames[writer->blocks_count] = (uint32_t)writer->block_frames;
+    writer->blocks_count += 1;
+
+    writer->block_size = 0;
+    writer->block_frames = 0;
+
+    return EXYZ_SUCCESS;
+}
+
+/// write the frame index and the seek table after all the blocks
+static exyz_status_t write_seek_table(seekable_writer_t* writer) {
+    if (writer->blocks_count > UINT32_MAX) {
+        return error("too many blocks for the zstd seekable format");
+    }
+    uint32_t blocks_count = (uint32_t)writer->blocks_count;
+
+    size_t index_size = SKIPPABLE_HEADER_SIZE + 8 + 4 * writer->blocks_count;
+    size_t table_size = SKIPPABLE_HEADER_SIZE + 8 * writer->blocks_count + SEEK_TABLE_FOOTER_SIZE;
+    uint8_t* data = exyz_malloc(index_size + table_size);
+    if (data == NULL) {
+        return error("failed to allocate memory");
+    }
+
+    uint8_t* index = data;
+    write_u32(index, FRAME_INDEX_MAGIC);
+    write_u32(index + 4, (uint32_t)(index_size - SKIPPABLE_HEADER_SIZE));
+    memcpy(index + 8, FRAME_INDEX_TAG, 4);
+    write_u32(index + 12, blocks_count);
+    for (size_t i=0; i<writer->blocks_count; i++) {
+        write_u32(index + 16 + 4 * i, writer->frames[i]);
+    }
+
+    uint8_t* table = data + index_size;
+    write_u32(table, SEEK_TABLE_MAGIC);
+    write_u32(table + 4, (uint32_t)(table_size - SKIPPABLE_HEADER_SIZE));
+    for (size_t i=0; i<writer->blocks_count; i++) {
+        write_u32(table + SKIPPABLE_HEADER_SIZE + 8 * i, writer->compressed_sizes[i]);
+        write_u32(table + SKIPPABLE_HEADER_SIZE + 8 * i + 4, writer->decompressed_sizes[i]);
+    }
+
+    uint8_t* footer = table + table_size - SEEK_TABLE_FOOTER_SIZE;
+    write_u32(footer, blocks_count);
+    // no checksums
+    footer[4] = 0;
+    write_u32(footer + 5, SEEKABLE_MAGIC);
+
+    size_t size = index_size + table_size;
+    exyz_status_t status = EXYZ_SUCCESS;
+    if (fwrite(data, 1, size, writer->file) != size) {
+        status = error("failed to write seek table");
+    }
+
+    exyz_free(data);
+    return status;
+}
+
+exyz_status_t exyz_compress_seekable(
+    const char* input,
+    const char* output,
+    size_t block_size,
+    int level
+) {
+    exyz_reader_t* reader = NULL;
+    exyz_status_t status = exyz_reader_open(&reader, input);
+    if (status != EXYZ_SUCCESS) {
+        return status;
+    }
+
+    seekable_writer_t writer;
+    memset(&writer, 0, sizeof(writer));
+    writer.level = level;
+
+    writer.file = fopen(output, "wb");
+    if (writer.file == NULL) {
+        status = error("failed to open '%s' for writing", output);
+        goto cleanup;
+    }
+
+    writer.context = ZSTD_createCCtx();
+    if (writer.context == NULL) {
+        status = error("failed to initialize zstd compressor");
+        goto cleanup;
+    }
+
+    while (true) {
+        const char* data = NULL;
+        size_t size = 0;
+        status = exyz_reader_next_raw_frame(reader, &data, &size);
+        if (status == EXYZ_END_OF_FILE) {
+            status = EXYZ_SUCCESS;
+            break;
+        } else if (status != EXYZ_SUCCESS) {
+            goto cleanup;
+        }
+
+        status = append_frame(&writer, data, size);
+        if (status != EXYZ_SUCCESS) {
+            goto cleanup;
+        }
+
+        if (writer.block_size >= block_size) {
+            status = flush_block(&writer);
+            if (status != EXYZ_SUCCESS) {
+                goto cleanup;
+            }
+        }
+    }
+
+    status = flush_block(&writer);
+    if (status != EXYZ_SUCCESS) {
+        goto cleanup;
+    }
+
+    status = write_seek_table(&writer);
+
+cleanup:
+    exyz_reader_close(reader);
+    if (writer.file != NULL && fclose(writer.file) != 0 && status == EXYZ_SUCCESS) {
+        status = error("failed to write '%s'", output);
+    }
+    ZSTD_freeCCtx(writer.context);
+    exyz_free(writer.block);
+    exyz_free(writer.compressed);
+    exyz_free(writer.compressed_sizes);
+    exyz_free(writer.decompressed_sizes);
+    exyz_free(writer.frames);
+
+    return status;
+}
+
+#else
+
+exyz_status_t exyz_compress_seekable(
+    const char* input,
+    const char* output,
+    size_t block_size,
+    int level
+) {
+    return error("exyz was built without zstd support");
+}
+
+#endif
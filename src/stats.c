@@ -0,0 +1,36 @@
+#include <time.h>
+
+#include "exyz.h"
+#include "internal.h"
+
+_Thread_local exyz_stats_t* exyz_current_stats = NULL;
+
+exyz_stats_t* exyz_stats_collect(exyz_stats_t* stats) {
+    exyz_stats_t* previous = exyz_current_stats;
+    exyz_current_stats = stats;
+    return previous;
+}
+
+uint64_t exyz_stats_now(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t)time.tv_sec * 1000000000 + (uint64_t)time.tv_nsec;
+}
+
+void exyz_stats_add(exyz_stats_t* stats, const exyz_stats_t* other) {
+    stats->bytes += other->bytes;
+    stats->frames += other->frames;
+    stats->atoms += other->atoms;
+    stats->skipped_frames += other->skipped_frames;
+    stats->integers += other->integers;
+    stats->reals += other->reals;
+    stats->booleans += other->booleans;
+    stats->strings += other->strings;
+    stats->arrays += other->arrays;
+    stats->allocations += other->allocations;
+    stats->allocated_bytes += other->allocated_bytes;
+    stats->failed_reads += other->failed_reads;
+    stats->framing_ns += other->framing_ns;
+    stats->comment_line_ns += other->comment_line_ns;
+    stats->atoms_ns += other->atoms_ns;
+}
@@ -0,0 +1,1067 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include <pthread.h>
+#include <unistd.h>
+
+#ifdef EXYZ_HAVE_ZLIB
+#define ZLIB_CONST
+#include <zlib.h>
+#endif
+
+#ifdef EXYZ_HAVE_LZMA
+#include <lzma.h>
+#endif
+
+#ifdef EXYZ_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "exyz.h"
+#include "internal.h"
+
+static exyz_status_t error(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    exyz_status_t status = exyz_set_error(format, args);
+    va_end(args);
+
+    return status;
+}
+
+/// size of the buffer used to read data from the file
+#define INPUT_BUFFER_SIZE (256 * 1024)
+/// size of a single chunk of decompressed data
+#define CHUNK_SIZE (1024 * 1024)
+/// number of decompressed chunks which can be waiting for the parser
+#define CHUNK_COUNT 4
+/// maximal number of threads decompressing blocks of a zstd seekable file
+#define SEEKABLE_MAX_THREADS 4
+/// maximal number of decompressed blocks of a zstd seekable file kept in
+/// memory, which also limits how many blocks are decompressed in advance
+#define SEEKABLE_MAX_SLOTS 8
+
+/******************************************************************************/
+/*                               Decoders                                     */
+/******************************************************************************/
+
+/// A decoder takes compressed data in `input` and writes decompressed data in
+/// `output`, setting `consumed` and `produced` to the number of bytes it used
+/// in both. `input_end` is true when there is no more input data after the
+/// current one.
+typedef exyz_status_t (*decode_fn)(
+    void* state,
+    const uint8_t* input,
+    size_t input_size,
+    size_t* consumed,
+    uint8_t* output,
+    size_t output_size,
+    size_t* produced,
+    bool input_end
+);
+
+typedef struct decoder_t {
+    void* state;
+    decode_fn decode;
+    void (*free)(void* state);
+} decoder_t;
+
+#ifdef EXYZ_HAVE_ZLIB
+typedef struct gzip_decoder_t {
+    z_stream stream;
+    /// are we at the boundary between two gzip members?
+    bool member_end;
+} gzip_decoder_t;
+
+static exyz_status_t gzip_decode(
+    void* state,
+    const uint8_t* input,
+    size_t input_size,
+    size_t* consumed,
+    uint8_t* output,
+    size_t output_size,
+    size_t* produced,
+    bool input_end
+) {
+    gzip_decoder_t* decoder = state;
+    z_stream* stream = &decoder->stream;
+
+    stream->next_in = input;
+    stream->avail_in = (uInt)input_size;
+    stream->next_out = output;
+    stream->avail_out = (uInt)output_size;
+
+    int status = inflate(stream, Z_NO_FLUSH);
+
+    *consumed = input_size - stream->avail_in;
+    *produced = output_size - stream->avail_out;
+
+    if (status == Z_STREAM_END) {
+        // there might be another gzip member after this one
+        decoder->member_end = true;
+        if (inflateReset(stream) != Z_OK) {
+            return error("failed to reset gzip decompressor");
+        }
+    } else if (status == Z_OK) {
+        decoder->member_end = false;
+    } else if (status == Z_BUF_ERROR) {
+        if (input_end && input_size == 0 && !decoder->member_end) {
+            return error("unexpected end of gzip compressed data");
+        }
+    } else {
+        return error("failed to decompress gzip data: %s", stream->msg != NULL ? stream->msg : "unknown error");
+    }
+
+    return EXYZ_SUCCESS;
+}
+
+static void gzip_free(void* state) {
+    gzip_decoder_t* decoder = state;
+    inflateEnd(&decoder->stream);
+    exyz_free(decoder);
+}
+
+static exyz_status_t gzip_decoder(decoder_t* decoder) {
+    gzip_decoder_t* state = exyz_calloc(1, sizeof(gzip_decoder_t));
+    if (state == NULL) {
+        return error("failed to allocate memory");
+    }
+
+    // 15 + 32: maximal window size, and automatic gzip header detection
+    if (inflateInit2(&state->stream, 15 + 32) != Z_OK) {
+        exyz_free(state);
+        return error("failed to initialize gzip decompressor");
+    }
+
+    decoder->state = state;
+    decoder->decode = gzip_decode;
+    decoder->free = gzip_free;
+
+    return EXYZ_SUCCESS;
+}
+#endif
+
+#ifdef EXYZ_HAVE_LZMA
+typedef struct xz_decoder_t {
+    lzma_stream stream;
+    bool finished;
+} xz_decoder_t;
+
+static exyz_status_t xz_decode(
+    void* state,
+    const uint8_t* input,
+    size_t input_size,
+    size_t* consumed,
+    uint8_t* output,
+    size_t output_size,
+    size_t* produced,
+    bool input_end
+) {
+    xz_decoder_t* decoder = state;
+    lzma_stream* stream = &decoder->stream;
+
+    if (decoder->finished) {
+        *consumed = input_size;
+        *produced = 0;
+        return EXYZ_SUCCESS;
+    }
+
+    stream->next_in = input;
+    stream->avail_in = input_size;
+    stream->next_out = output;
+    stream->avail_out = output_size;
+
+    lzma_ret status = lzma_code(stream, input_end ? LZMA_FINISH : LZMA_RUN);
+
+    *consumed = input_size - stream->avail_in;
+    *produced = output_size - stream->avail_out;
+
+    if (status == LZMA_STREAM_END) {
+        decoder->finished = true;
+    } else if (status == LZMA_BUF_ERROR && input_end) {
+        return error("unexpected end of xz compressed data");
+    } else if (status != LZMA_OK && status != LZMA_BUF_ERROR) {
+        return error("failed to decompress xz data (lzma error %d)", (int)status);
+    }
+
+    return EXYZ_SUCCESS;
+}
+
+static void xz_free(void* state) {
+    xz_decoder_t* decoder = state;
+    lzma_end(&decoder->stream);
+    exyz_free(decoder);
+}
+
+static exyz_status_t xz_decoder(decoder_t* decoder) {
+    xz_decoder_t* state = exyz_calloc(1, sizeof(xz_decoder_t));
+    if (state == NULL) {
+        return error("failed to allocate memory");
+    }
+
+    lzma_stream init = LZMA_STREAM_INIT;
+    state->stream = init;
+    // LZMA_CONCATENATED: support files created by `cat a.xz b.xz`
+    if (lzma_stream_decoder(&state->stream, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK) {
+        exyz_free(state);
+        return error("failed to initialize xz decompressor");
+    }
+
+    decoder->state = state;
+    decoder->decode = xz_decode;
+    decoder->free = xz_free;
+
+    return EXYZ_SUCCESS;
+}
+#endif
+
+#ifdef EXYZ_HAVE_ZSTD
+typedef struct zstd_decoder_t {
+    ZSTD_DStream* stream;
+    /// last value returned by ZSTD_decompressStream, 0 when a zstd frame is
+    /// fully decoded
+    size_t last_status;
+} zstd_decoder_t;
+
+static exyz_status_t zstd_decode(
+    void* state,
+    const uint8_t* input,
+    size_t input_size,
+    size_t* consumed,
+    uint8_t* output,
+    size_t output_size,
+    size_t* produced,
+    bool input_end
+) {
+    zstd_decoder_t* decoder = state;
+
+    ZSTD_inBuffer in = {input, input_size, 0};
+    ZSTD_outBuffer out = {output, output_size, 0};
+
+    size_t status = ZSTD_decompressStream(decoder->stream, &out, &in);
+    if (ZSTD_isError(status)) {
+        return error("failed to decompress zstd data: %s", ZSTD_getErrorName(status));
+    }
+
+    *consumed = in.pos;
+    *produced = out.pos;
+
+    if (in.pos == 0 && out.pos == 0) {
+        if (input_end && decoder->last_status != 0) {
+            return error("unexpected end of zstd compressed data");
+        }
+    } else {
+        decoder->last_status = status;
+    }
+
+    return EXYZ_SUCCESS;
+}
+
+static void zstd_free(void* state) {
+    zstd_decoder_t* decoder = state;
+    ZSTD_freeDStream(decoder->stream);
+    exyz_free(decoder);
+}
+
+static exyz_status_t zstd_decoder(decoder_t* decoder) {
+    zstd_decoder_t* state = exyz_calloc(1, sizeof(zstd_decoder_t));
+    if (state == NULL) {
+        return error("failed to allocate memory");
+    }
+
+    state->stream = ZSTD_createDStream();
+    if (state->stream == NULL) {
+        exyz_free(state);
+        return error("failed to initialize zstd decompressor");
+    }
+    ZSTD_initDStream(state->stream);
+
+    decoder->state = state;
+    decoder->decode = zstd_decode;
+    decoder->free = zstd_free;
+
+    return EXYZ_SUCCESS;
+}
+#endif
+
+bool exyz_compression_supported(exyz_compression_t compression) {
+    switch (compression) {
+    case EXYZ_COMPRESSION_NONE:
+        return true;
+    case EXYZ_COMPRESSION_GZIP:
+#ifdef EXYZ_HAVE_ZLIB
+        return true;
+#else
+        return false;
+#endif
+    case EXYZ_COMPRESSION_XZ:
+#ifdef EXYZ_HAVE_LZMA
+        return true;
+#else
+        return false;
+#endif
+    case EXYZ_COMPRESSION_ZSTD:
+#ifdef EXYZ_HAVE_ZSTD
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    return false;
+}
+
+static const char* compression_name(exyz_compression_t compression) {
+    switch (compression) {
+    case EXYZ_COMPRESSION_NONE:
+        return "uncompressed";
+    case EXYZ_COMPRESSION_GZIP:
+        return "gzip";
+    case EXYZ_COMPRESSION_XZ:
+        return "xz";
+    case EXYZ_COMPRESSION_ZSTD:
+        return "zstd";
+    }
+
+    return "unknown";
+}
+
+static exyz_status_t create_decoder(exyz_compression_t compression, decoder_t* decoder) {
+    if (!exyz_compression_supported(compression)) {
+        return error("this file is %s compressed, but exyz was built without %s support",
+            compression_name(compression), compression_name(compression)
+        );
+    }
+
+    switch (compression) {
+#ifdef EXYZ_HAVE_ZLIB
+    case EXYZ_COMPRESSION_GZIP:
+        return gzip_decoder(decoder);
+#endif
+#ifdef EXYZ_HAVE_LZMA
+    case EXYZ_COMPRESSION_XZ:
+        return xz_decoder(decoder);
+#endif
+#ifdef EXYZ_HAVE_ZSTD
+    case EXYZ_COMPRESSION_ZSTD:
+        return zstd_decoder(decoder);
+#endif
+    default:
+        return error("internal error: no decoder for %s data", compression_name(compression));
+    }
+}
+
+static exyz_compression_t detect_compression(const uint8_t* data, size_t size) {
+    static const uint8_t GZIP_MAGIC[] = {0x1f, 0x8b};
+    static const uint8_t ZSTD_MAGIC[] = {0x28, 0xb5, 0x2f, 0xfd};
+    static const uint8_t XZ_MAGIC[] = {0xfd, '7', 'z', 'X', 'Z', 0x00};
+
+    if (size >= sizeof(GZIP_MAGIC) && memcmp(data, GZIP_MAGIC, sizeof(GZIP_MAGIC)) == 0) {
+        return EXYZ_COMPRESSION_GZIP;
+    } else if (size >= sizeof(ZSTD_MAGIC) && memcmp(data, ZSTD_MAGIC, sizeof(ZSTD_MAGIC)) == 0) {
+        return EXYZ_COMPRESSION_ZSTD;
+    } else if (size >= sizeof(XZ_MAGIC) && memcmp(data, XZ_MAGIC, sizeof(XZ_MAGIC)) == 0) {
+        return EXYZ_COMPRESSION_XZ;
+    } else {
+        return EXYZ_COMPRESSION_NONE;
+    }
+}
+
+/******************************************************************************/
+/*                                 Streams                                    */
+/******************************************************************************/
+
+typedef struct chunk_t {
+    uint8_t* data;
+    size_t size;
+} chunk_t;
+
+typedef enum block_state_t {
+    BLOCK_FREE,
+    BLOCK_BUSY,
+    BLOCK_READY,
+} block_state_t;
+
+/// slot for a single decompressed block of a zstd seekable file
+typedef struct block_slot_t {
+    /// buffer for the decompressed data, allocated by the first decompression
+    /// using this slot
+    uint8_t* data;
+    size_t capacity;
+    size_t size;
+    size_t block;
+    block_state_t state;
+    /// value of `seekable_t::generation` when this block was requested
+    uint64_t generation;
+} block_slot_t;
+
+/// Decompression state for zstd seekable files, where multiple threads
+/// decompress independent blocks in parallel. Block `i` is always decompressed
+/// in `slots[i % slots_count]`.
+typedef struct seekable_t {
+    exyz_seek_table_t* table;
+    int fd;
+
+    /// running decompression threads, with space for `SEEKABLE_MAX_THREADS`
+    pthread_t* threads;
+    size_t threads_count;
+    /// number of decompression threads to use, they are started by the first
+    /// read from the stream
+    size_t threads_wanted;
+    block_slot_t* slots;
+    size_t slots_count;
+
+    /// next block to give to a decompression thread
+    size_t next_block;
+    /// block currently used by the consumer
+    size_t current_block;
+    /// how many blocks after `current_block` can be decompressed in advance
+    size_t prefetch;
+    /// incremented on every seek, to discard blocks from before the seek
+    uint64_t generation;
+} seekable_t;
+
+struct exyz_stream_t {
+    FILE* file;
+    exyz_compression_t compression;
+    /// allocator in use when the stream was created, also used by the
+    /// decompression threads
+    exyz_allocator_t allocator;
+
+    // data read from the file, but not yet used
+    uint8_t* input;
+    size_t input_size;
+    size_t input_position;
+    bool input_end;
+
+    decoder_t decoder;
+
+    // ring buffer of decompressed chunks, shared between the decompression
+    // thread (producer) and the parser (consumer). All the fields below are
+    // protected by the mutex, except for the data inside the chunk currently
+    // being filled or consumed.
+    pthread_t thread;
+    bool thread_started;
+    pthread_mutex_t mutex;
+    pthread_cond_t chunk_ready;
+    pthread_cond_t chunk_free;
+    chunk_t chunks[CHUNK_COUNT];
+    size_t first_chunk;
+    size_t chunks_count;
+    /// set by the decompression thread when it stops
+    bool finished;
+    /// set by `exyz_stream_close` to stop the decompression thread
+    bool stop;
+    /// status of the decompression thread
+    exyz_status_t status;
+    /// error recorded by the decompression thread when `status` is
+    /// `EXYZ_ERROR`, moved to the reading thread
+    exyz_error_state_t error;
+
+    /// position inside the first chunk, only used by the consumer
+    size_t chunk_position;
+
+    /// only used for zstd seekable files, using the same mutex, conditions
+    /// and status as the ring buffer of chunks
+    seekable_t seekable;
+};
+
+static exyz_status_t fill_input(exyz_stream_t* stream) {
+    assert(stream->input_position == stream->input_size);
+
+    stream->input_size = fread(stream->input, 1, INPUT_BUFFER_SIZE, stream->file);
+    stream->input_position = 0;
+
+    if (stream->input_size == 0) {
+        if (ferror(stream->file)) {
+            return error("failed to read from file");
+        }
+        stream->input_end = true;
+    }
+
+    return EXYZ_SUCCESS;
+}
+
+/// decompress data until `chunk` is full or the input is exhausted. `done` is
+/// set to true once all the data has been decompressed.
+static exyz_status_t fill_chunk(exyz_stream_t* stream, chunk_t* chunk, bool* done) {
+    chunk->size = 0;
+    while (chunk->size != CHUNK_SIZE) {
+        if (stream->input_position == stream->input_size && !stream->input_end) {
+            exyz_status_t status = fill_input(stream);
+            if (status != EXYZ_SUCCESS) {
+                return status;
+            }
+        }
+
+        size_t consumed = 0;
+        size_t produced = 0;
+        size_t available = stream->input_size - stream->input_position;
+        exyz_status_t status = stream->decoder.decode(
+            stream->decoder.state,
+            stream->input + stream->input_position,
+            available,
+            &consumed,
+            chunk->data + chunk->size,
+            CHUNK_SIZE - chunk->size,
+            &produced,
+            stream->input_end
+        );
+        if (status != EXYZ_SUCCESS) {
+            return status;
+        }
+
+        stream->input_position += consumed;
+        chunk->size += produced;
+
+        if (consumed == 0 && produced == 0) {
+            if (stream->input_end && available == 0) {
+                *done = true;
+                break;
+            } else if (available != 0) {
+                return error("invalid %s compressed data", compression_name(stream->compression));
+            }
+        }
+    }
+
+    return EXYZ_SUCCESS;
+}
+
+static void* decompression_thread(void* data) {
+    exyz_stream_t* stream = data;
+    exyz_use_allocator(&stream->allocator);
+
+    while (true) {
+        pthread_mutex_lock(&stream->mutex);
+        while (stream->chunks_count == CHUNK_COUNT && !stream->stop) {
+            pthread_cond_wait(&stream->chunk_free, &stream->mutex);
+        }
+
+        if (stream->stop) {
+            stream->finished = true;
+            pthread_mutex_unlock(&stream->mutex);
+            break;
+        }
+
+        chunk_t* chunk = &stream->chunks[(stream->first_chunk + stream->chunks_count) % CHUNK_COUNT];
+        pthread_mutex_unlock(&stream->mutex);
+
+        // the consumer does not touch this chunk until it is published below,
+        // so we can fill it without holding the lock
+        bool done = false;
+        exyz_status_t status = fill_chunk(stream, chunk, &done);
+
+        pthread_mutex_lock(&stream->mutex);
+        if (chunk->size != 0 && status == EXYZ_SUCCESS) {
+            stream->chunks_count += 1;
+        }
+
+        if (status != EXYZ_SUCCESS || done) {
+            if (status != EXYZ_SUCCESS) {
+                exyz_save_error(&stream->error);
+            }
+            stream->status = status;
+            stream->finished = true;
+        }
+        pthread_cond_signal(&stream->chunk_ready);
+
+        bool finished = stream->finished;
+        pthread_mutex_unlock(&stream->mutex);
+
+        if (finished) {
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+/******************************************************************************/
+/*                         zstd seekable streams                              */
+/******************************************************************************/
+
+#ifdef EXYZ_HAVE_ZSTD
+/// read and decompress a single block in `slot`
+static exyz_status_t decompress_block(
+    exyz_stream_t* stream,
+    ZSTD_DCtx* context,
+    uint8_t** compressed,
+    size_t* compressed_capacity,
+    block_slot_t* slot,
+    size_t block
+) {
+    const exyz_seek_table_t* table = stream->seekable.table;
+    size_t decompressed_size = (size_t)table->sizes[block];
+    if (decompressed_size > slot->capacity) {
+        uint8_t* buffer = exyz_realloc(slot->data, decompressed_size);
+        if (buffer == NULL) {
+            return error("failed to allocate memory");
+        }
+        slot->data = buffer;
+        slot->capacity = decompressed_size;
+    }
+
+    size_t size = (size_t)(table->offsets[block + 1] - table->offsets[block]);
+    if (size > *compressed_capacity) {
+        uint8_t* buffer = exyz_realloc(*compressed, size);
+        if (buffer == NULL) {
+            return error("failed to allocate memory");
+        }
+        *compressed = buffer;
+        *compressed_capacity = size;
+    }
+
+    // pread does not use the shared file position, so multiple threads can
+    // read from the file at the same time
+    size_t n_read = 0;
+    while (n_read < size) {
+        ssize_t count = pread(
+            stream->seekable.fd,
+            *compressed + n_read,
+            size - n_read,
+            (off_t)(table->offsets[block] + n_read)
+        );
+        if (count <= 0) {
+            return error("failed to read compressed block %zu", block);
+        }
+        n_read += (size_t)count;
+    }
+
+    size_t decompressed = ZSTD_decompressDCtx(context, slot->data, decompressed_size, *compressed, size);
+    if (ZSTD_isError(decompressed)) {
+        return error("failed to decompress block %zu: %s", block, ZSTD_getErrorName(decompressed));
+    } else if (decompressed != table->sizes[block]) {
+        return error("invalid size for decompressed block %zu", block);
+    }
+    slot->size = decompressed;
+
+    return EXYZ_SUCCESS;
+}
+
+static void* seekable_thread(void* data) {
+    exyz_stream_t* stream = data;
+    exyz_use_allocator(&stream->allocator);
+    seekable_t* seekable = &stream->seekable;
+
+    uint8_t* compressed = NULL;
+    size_t compressed_capacity = 0;
+    ZSTD_DCtx* context = ZSTD_createDCtx();
+
+    pthread_mutex_lock(&stream->mutex);
+    if (context == NULL) {
+        stream->status = error("failed to initialize zstd decompressor");
+        exyz_save_error(&stream->error);
+        pthread_cond_broadcast(&stream->chunk_ready);
+        pthread_mutex_unlock(&stream->mutex);
+        return NULL;
+    }
+
+    while (true) {
+        // wait for a block to decompress
+        while (!stream->stop) {
+            size_t block = seekable->next_block;
+            if (block < seekable->table->blocks_count &&
+                block < seekable->current_block + seekable->prefetch &&
+                seekable->slots[block % seekable->slots_count].state == BLOCK_FREE
+            ) {
+                break;
+            }
+            pthread_cond_wait(&stream->chunk_free, &stream->mutex);
+        }
+
+        if (stream->stop) {
+            break;
+        }
+
+        size_t block = seekable->next_block;
+        seekable->next_block += 1;
+
+        block_slot_t* slot = &seekable->slots[block % seekable->slots_count];
+        slot->state = BLOCK_BUSY;
+        slot->block = block;
+        slot->generation = seekable->generation;
+        pthread_mutex_unlock(&stream->mutex);
+
+        exyz_status_t status = decompress_block(stream, context, &compressed, &compressed_capacity, slot, block);
+
+        pthread_mutex_lock(&stream->mutex);
+        if (slot->generation != seekable->generation) {
+            // the consumer moved to another block while we were working
+            slot->state = BLOCK_FREE;
+            pthread_cond_broadcast(&stream->chunk_free);
+            continue;
+        }
+
+        if (status != EXYZ_SUCCESS) {
+            slot->state = BLOCK_FREE;
+            // keep the first error if multiple threads fail
+            if (stream->status == EXYZ_SUCCESS) {
+                exyz_save_error(&stream->error);
+                stream->status = status;
+            }
+        } else {
+            slot->state = BLOCK_READY;
+        }
+        pthread_cond_broadcast(&stream->chunk_ready);
+    }
+    pthread_mutex_unlock(&stream->mutex);
+
+    ZSTD_freeDCtx(context);
+    exyz_free(compressed);
+
+    return NULL;
+}
+
+static exyz_status_t seekable_open(exyz_stream_t* stream, exyz_seek_table_t* table) {
+    seekable_t* seekable = &stream->seekable;
+    seekable->table = table;
+    seekable->fd = fileno(stream->file);
+
+    seekable->threads_wanted = 1;
+    seekable->slots_count = table->blocks_count < SEEKABLE_MAX_SLOTS ? table->blocks_count : SEEKABLE_MAX_SLOTS;
+    if (seekable->slots_count == 0) {
+        seekable->slots_count = 1;
+    }
+    // only decompress the first block until we know the access pattern
+    seekable->prefetch = 1;
+
+    // the data of each slot is only allocated when it is used
+    seekable->slots = exyz_calloc(seekable->slots_count, sizeof(block_slot_t));
+    if (seekable->slots == NULL) {
+        return error("failed to allocate memory");
+    }
+
+    seekable->threads = exyz_calloc(SEEKABLE_MAX_THREADS, sizeof(pthread_t));
+    if (seekable->threads == NULL) {
+        return error("failed to allocate memory");
+    }
+
+    return EXYZ_SUCCESS;
+}
+
+/// start decompression threads until there are `seekable->threads_wanted` of
+/// them. This must be called from the consumer thread.
+static exyz_status_t seekable_start_threads(exyz_stream_t* stream) {
+    seekable_t* seekable = &stream->seekable;
+    while (seekable->threads_count < seekable->threads_wanted) {
+        pthread_t* thread = &seekable->threads[seekable->threads_count];
+        if (pthread_create(thread, NULL, seekable_thread, stream) != 0) {
+            break;
+        }
+        seekable->threads_count += 1;
+    }
+
+    if (seekable->threads_count == 0) {
+        return error("failed to start decompression threads");
+    }
+
+    return EXYZ_SUCCESS;
+}
+
+static exyz_status_t seekable_read(exyz_stream_t* stream, char* buffer, size_t size, size_t* n_read) {
+    seekable_t* seekable = &stream->seekable;
+    if (seekable->threads_count < seekable->threads_wanted) {
+        exyz_status_t status = seekable_start_threads(stream);
+        if (status != EXYZ_SUCCESS) {
+            return status;
+        }
+    }
+
+    pthread_mutex_lock(&stream->mutex);
+    if (seekable->current_block == seekable->table->blocks_count) {
+        pthread_mutex_unlock(&stream->mutex);
+        return EXYZ_SUCCESS;
+    }
+
+    block_slot_t* slot = &seekable->slots[seekable->current_block % seekable->slots_count];
+    while (!(slot->state == BLOCK_READY && slot->block == seekable->current_block) && stream->status == EXYZ_SUCCESS) {
+        pthread_cond_wait(&stream->chunk_ready, &stream->mutex);
+    }
+
+    if (stream->status != EXYZ_SUCCESS) {
+        // the error was recorded on a decompression thread
+        exyz_restore_error(&stream->error);
+        exyz_status_t status = stream->status;
+        pthread_mutex_unlock(&stream->mutex);
+        return status;
+    }
+    pthread_mutex_unlock(&stream->mutex);
+
+    size_t available = slot->size - stream->chunk_position;
+    *n_read = size < available ? size : available;
+    memcpy(buffer, slot->data + stream->chunk_position, *n_read);
+    stream->chunk_position += *n_read;
+
+    if (stream->chunk_position == slot->size) {
+        pthread_mutex_lock(&stream->mutex);
+        slot->state = BLOCK_FREE;
+        seekable->current_block += 1;
+        // the data is read sequentially, start decompressing blocks in advance,
+        // keeping two blocks per thread at most
+        seekable->prefetch = 2 * seekable->threads_count;
+        if (seekable->prefetch > seekable->slots_count) {
+            seekable->prefetch = seekable->slots_count;
+        }
+        stream->chunk_position = 0;
+        pthread_cond_broadcast(&stream->chunk_free);
+        pthread_mutex_unlock(&stream->mutex);
+    }
+
+    return EXYZ_SUCCESS;
+}
+#endif
+
+const exyz_seek_table_t* exyz_stream_seek_table(const exyz_stream_t* stream) {
+    return stream->seekable.table;
+}
+
+exyz_status_t exyz_stream_seek_block(exyz_stream_t* stream, size_t block) {
+    seekable_t* seekable = &stream->seekable;
+    if (seekable->table == NULL) {
+        return error("can not seek in this file");
+    }
+    assert(block < seekable->table->blocks_count);
+
+    pthread_mutex_lock(&stream->mutex);
+    seekable->generation += 1;
+    // errors from the blocks before the seek are no longer relevant
+    stream->status = EXYZ_SUCCESS;
+    for (size_t i=0; i<seekable->slots_count; i++) {
+        if (seekable->slots[i].state == BLOCK_READY) {
+            seekable->slots[i].state = BLOCK_FREE;
+        }
+    }
+
+    seekable->next_block = block;
+    seekable->current_block = block;
+    seekable->prefetch = 1;
+    stream->chunk_position = 0;
+    pthread_cond_broadcast(&stream->chunk_free);
+    pthread_mutex_unlock(&stream->mutex);
+
+    return EXYZ_SUCCESS;
+}
+
+void exyz_stream_set_threads(exyz_stream_t* stream, size_t threads) {
+    seekable_t* seekable = &stream->seekable;
+    if (seekable->table == NULL) {
+        return;
+    }
+
+    if (threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus < 1 ? 1 : (size_t)cpus;
+    }
+
+    if (threads > SEEKABLE_MAX_THREADS) {
+        threads = SEEKABLE_MAX_THREADS;
+    }
+    if (threads > seekable->slots_count) {
+        threads = seekable->slots_count;
+    }
+
+    // threads are never stopped before the stream is closed
+    if (threads > seekable->threads_wanted) {
+        seekable->threads_wanted = threads;
+    }
+}
+
+exyz_status_t exyz_stream_open(exyz_stream_t** stream_ptr, FILE* file) {
+    exyz_stream_t* stream = exyz_calloc(1, sizeof(exyz_stream_t));
+    if (stream == NULL) {
+        return error("failed to allocate memory");
+    }
+
+    stream->file = file;
+    stream->allocator = *exyz_current_allocator();
+    stream->status = EXYZ_SUCCESS;
+    pthread_mutex_init(&stream->mutex, NULL);
+    pthread_cond_init(&stream->chunk_ready, NULL);
+    pthread_cond_init(&stream->chunk_free, NULL);
+
+    stream->input = exyz_malloc(INPUT_BUFFER_SIZE);
+    if (stream->input == NULL) {
+        exyz_stream_close(stream);
+        return error("failed to allocate memory");
+    }
+
+#ifdef EXYZ_HAVE_ZSTD
+    // this is -1 if the file can not be seeked
+    long start = ftell(file);
+#endif
+
+    // read the first block of data to detect the compression. This data is
+    // then used as the first input of the decoder, so we never have to seek
+    // back in the file.
+    exyz_status_t status = fill_input(stream);
+    if (status != EXYZ_SUCCESS) {
+        goto error;
+    }
+
+    stream->compression = detect_compression(stream->input, stream->input_size);
+    if (stream->compression == EXYZ_COMPRESSION_NONE) {
+        *stream_ptr = stream;
+        return EXYZ_SUCCESS;
+    }
+
+#ifdef EXYZ_HAVE_ZSTD
+    if (stream->compression == EXYZ_COMPRESSION_ZSTD) {
+        exyz_seek_table_t* table = NULL;
+        status = exyz_seek_table_read(file, start, &table);
+        if (status == EXYZ_SUCCESS) {
+            status = seekable_open(stream, table);
+            if (status != EXYZ_SUCCESS) {
+                goto error;
+            }
+
+            *stream_ptr = stream;
+            return EXYZ_SUCCESS;
+        } else if (status != EXYZ_FAILED_READING) {
+            goto error;
+        }
+        // not a seekable file, use the streaming decompression below
+    }
+#endif
+
+    status = create_decoder(stream->compression, &stream->decoder);
+    if (status != EXYZ_SUCCESS) {
+        goto error;
+    }
+
+    for (size_t i=0; i<CHUNK_COUNT; i++) {
+        stream->chunks[i].data = exyz_malloc(CHUNK_SIZE);
+        if (stream->chunks[i].data == NULL) {
+            status = error("failed to allocate memory");
+            goto error;
+        }
+    }
+
+    if (pthread_create(&stream->thread, NULL, decompression_thread, stream) != 0) {
+        status = error("failed to start decompression thread");
+        goto error;
+    }
+    stream->thread_started = true;
+
+    *stream_ptr = stream;
+    return EXYZ_SUCCESS;
+
+error:
+    exyz_stream_close(stream);
+    return status;
+}
+
+exyz_status_t exyz_stream_read(exyz_stream_t* stream, char* buffer, size_t size, size_t* n_read) {
+    *n_read = 0;
+
+    if (stream->compression == EXYZ_COMPRESSION_NONE) {
+        if (stream->input_position != stream->input_size) {
+            size_t available = stream->input_size - stream->input_position;
+            *n_read = size < available ? size : available;
+            memcpy(buffer, stream->input + stream->input_position, *n_read);
+            stream->input_position += *n_read;
+            return EXYZ_SUCCESS;
+        }
+
+        if (stream->input_end) {
+            return EXYZ_SUCCESS;
+        }
+
+        *n_read = fread(buffer, 1, size, stream->file);
+        if (*n_read == 0 && ferror(stream->file)) {
+            return error("failed to read from file");
+        }
+        return EXYZ_SUCCESS;
+    }
+
+#ifdef EXYZ_HAVE_ZSTD
+    if (stream->seekable.table != NULL) {
+        return seekable_read(stream, buffer, size, n_read);
+    }
+#endif
+
+    pthread_mutex_lock(&stream->mutex);
+    while (stream->chunks_count == 0 && !stream->finished) {
+        pthread_cond_wait(&stream->chunk_ready, &stream->mutex);
+    }
+
+    if (stream->chunks_count == 0) {
+        // all the data has been consumed, or the decompression failed
+        exyz_status_t status = stream->status;
+        if (status == EXYZ_ERROR) {
+            // the error was recorded on the decompression thread
+            exyz_restore_error(&stream->error);
+        }
+        pthread_mutex_unlock(&stream->mutex);
+        return status;
+    }
+
+    chunk_t* chunk = &stream->chunks[stream->first_chunk];
+    pthread_mutex_unlock(&stream->mutex);
+
+    size_t available = chunk->size - stream->chunk_position;
+    *n_read = size < available ? size : available;
+    memcpy(buffer, chunk->data + stream->chunk_position, *n_read);
+    stream->chunk_position += *n_read;
+
+    if (stream->chunk_position == chunk->size) {
+        // give the chunk back to the decompression thread
+        pthread_mutex_lock(&stream->mutex);
+        stream->first_chunk = (stream->first_chunk + 1) % CHUNK_COUNT;
+        stream->chunks_count -= 1;
+        stream->chunk_position = 0;
+        pthread_cond_signal(&stream->chunk_free);
+        pthread_mutex_unlock(&stream->mutex);
+    }
+
+    return EXYZ_SUCCESS;
+}
+
+exyz_compression_t exyz_stream_compression(const exyz_stream_t* stream) {
+    return stream->compression;
+}
+
+void exyz_stream_close(exyz_stream_t* stream) {
+    if (stream == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&stream->mutex);
+    stream->stop = true;
+    pthread_cond_broadcast(&stream->chunk_free);
+    pthread_mutex_unlock(&stream->mutex);
+
+    if (stream->thread_started) {
+        pthread_join(stream->thread, NULL);
+    }
+
+    seekable_t* seekable = &stream->seekable;
+    for (size_t i=0; i<seekable->threads_count; i++) {
+        pthread_join(seekable->threads[i], NULL);
+    }
+    exyz_free(seekable->threads);
+
+    if (seekable->slots != NULL) {
+        for (size_t i=0; i<seekable->slots_count; i++) {
+            exyz_free(seekable->slots[i].data);
+        }
+        exyz_free(seekable->slots);
+    }
+    exyz_seek_table_free(seekable->table);
+
+    pthread_cond_destroy(&stream->chunk_free);
+    pthread_cond_destroy(&stream->chunk_ready);
+    pthread_mutex_destroy(&stream->mutex);
+
+    if (stream->decoder.free != NULL) {
+        stream->decoder.free(stream->decoder.state);
+    }
+
+    for (size_t i=0; i<CHUNK_COUNT; i++) {
+        exyz_free(stream->chunks[i].data);
+    }
+
+    exyz_free(stream->input);
+    exyz_free(stream);
+}
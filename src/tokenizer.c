@@ -0,0 +1,190 @@
+#include <stdint.h>
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include "exyz.h"
+#include "internal.h"
+
+// The line is processed in chunks of 64 bytes. For each chunk, we build a
+// bitmask with one bit per byte, set for whitespace. Fields start at the
+// non-whitespace bytes following whitespace (or the start of the line), and
+// end at the whitespace bytes following non-whitespace. Both sets of
+// positions are found with a few bitwise operations on the mask, and then
+// extracted one bit at a time.
+//
+// The masks are built with the best SIMD instructions available on the CPU
+// running the code, and one byte at a time otherwise. The last chunk of the
+// line is read past the end of the line when the caller allows it, and the
+// extra bits are cleared from the masks.
+
+/// size of the chunks of line handled at once
+#define CHUNK_SIZE 64
+
+/// build the masks of whitespace and quote/null bytes for the `size` first
+/// bytes of `data`
+static void scalar_masks(const char* data, size_t size, uint64_t* whitespace, uint64_t* special) {
+    uint64_t blank_mask = 0;
+    uint64_t other_mask = 0;
+    for (size_t i=0; i<size; i++) {
+        char c = data[i];
+        if (c == ' ' || c == '\t') {
+            blank_mask |= UINT64_C(1) << i;
+        } else if (c == '"' || c == '\0') {
+            other_mask |= UINT64_C(1) << i;
+        }
+    }
+
+    *whitespace = blank_mask;
+    *special = other_mask;
+}
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+
+// All x86 kernels are compiled with the corresponding `target` attribute,
+// and the one used is selected at runtime from the CPU features.
+#define EXYZ_X86_KERNELS
+
+/// build the masks of whitespace and quote/null bytes for `CHUNK_SIZE` bytes
+/// of `data`, using AVX-512
+__attribute__((target("avx512f,avx512bw")))
+static void avx512_masks(const char* data, uint64_t* whitespace, uint64_t* special) {
+    __m512i bytes = _mm512_loadu_si512((const void*)data);
+    *whitespace = _mm512_cmpeq_epi8_mask(bytes, _mm512_set1_epi8(' ')) |
+                  _mm512_cmpeq_epi8_mask(bytes, _mm512_set1_epi8('\t'));
+    *special = _mm512_cmpeq_epi8_mask(bytes, _mm512_set1_epi8('"')) |
+               _mm512_cmpeq_epi8_mask(bytes, _mm512_setzero_si512());
+}
+
+/// same as `avx512_masks`, using AVX2
+__attribute__((target("avx2")))
+static void avx2_masks(const char* data, uint64_t* whitespace, uint64_t* special) {
+    const __m256i spaces = _mm256_set1_epi8(' ');
+    const __m256i tabs = _mm256_set1_epi8('\t');
+    const __m256i quotes = _mm256_set1_epi8('"');
+    const __m256i nulls = _mm256_setzero_si256();
+
+    uint64_t blank_mask = 0;
+    uint64_t other_mask = 0;
+    for (size_t i=0; i<CHUNK_SIZE; i+=32) {
+        __m256i bytes = _mm256_loadu_si256((const __m256i*)(const void*)(data + i));
+        __m256i blank = _mm256_or_si256(_mm256_cmpeq_epi8(bytes, spaces), _mm256_cmpeq_epi8(bytes, tabs));
+        __m256i other = _mm256_or_si256(_mm256_cmpeq_epi8(bytes, quotes), _mm256_cmpeq_epi8(bytes, nulls));
+        blank_mask |= (uint64_t)(uint32_t)_mm256_movemask_epi8(blank) << i;
+        other_mask |= (uint64_t)(uint32_t)_mm256_movemask_epi8(other) << i;
+    }
+
+    *whitespace = blank_mask;
+    *special = other_mask;
+}
+
+/// same as `avx512_masks`, using SSE2
+__attribute__((target("sse2")))
+static void sse2_masks(const char* data, uint64_t* whitespace, uint64_t* special) {
+    const __m128i spaces = _mm_set1_epi8(' ');
+    const __m128i tabs = _mm_set1_epi8('\t');
+    const __m128i quotes = _mm_set1_epi8('"');
+    const __m128i nulls = _mm_setzero_si128();
+
+    uint64_t blank_mask = 0;
+    uint64_t other_mask = 0;
+    for (size_t i=0; i<CHUNK_SIZE; i+=16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i*)(const void*)(data + i));
+        __m128i blank = _mm_or_si128(_mm_cmpeq_epi8(bytes, spaces), _mm_cmpeq_epi8(bytes, tabs));
+        __m128i other = _mm_or_si128(_mm_cmpeq_epi8(bytes, quotes), _mm_cmpeq_epi8(bytes, nulls));
+        blank_mask |= (uint64_t)(uint32_t)_mm_movemask_epi8(blank) << i;
+        other_mask |= (uint64_t)(uint32_t)_mm_movemask_epi8(other) << i;
+    }
+
+    *whitespace = blank_mask;
+    *special = other_mask;
+}
+
+#endif
+
+/// same as `avx512_masks`, one byte at a time
+static void chunk_scalar_masks(const char* data, uint64_t* whitespace, uint64_t* special) {
+    scalar_masks(data, CHUNK_SIZE, whitespace, special);
+}
+
+typedef void (*chunk_masks_t)(const char* data, uint64_t* whitespace, uint64_t* special);
+
+/// kernel used for full chunks, selected once from the CPU features
+static chunk_masks_t CHUNK_MASKS = chunk_scalar_masks;
+static pthread_once_t CHUNK_MASKS_ONCE = PTHREAD_ONCE_INIT;
+
+static void select_chunk_masks(void) {
+    exyz_simd_t simd = exyz_cpu_simd();
+    (void)simd;
+#if defined(EXYZ_X86_KERNELS)
+    if (simd >= EXYZ_SIMD_AVX512) {
+        CHUNK_MASKS = avx512_masks;
+    } else if (simd >= EXYZ_SIMD_AVX2) {
+        CHUNK_MASKS = avx2_masks;
+    } else if (simd >= EXYZ_SIMD_SSE2) {
+        CHUNK_MASKS = sse2_masks;
+    }
+#endif
+}
+
+size_t exyz_tokenize_fields(const char* line, size_t length, size_t readable, exyz_field_t* fields, size_t capacity) {
+    pthread_once(&CHUNK_MASKS_ONCE, select_chunk_masks);
+    chunk_masks_t chunk_masks = CHUNK_MASKS;
+
+    size_t count = 0;
+    size_t closed = 0;
+    // is the last byte of the previous chunk part of a field?
+    uint64_t inside_field = 0;
+
+    for (size_t offset=0; offset<length; offset+=CHUNK_SIZE) {
+        size_t size = length - offset < CHUNK_SIZE ? length - offset : CHUNK_SIZE;
+
+        uint64_t whitespace = 0;
+        uint64_t special = 0;
+        if (readable - offset >= CHUNK_SIZE) {
+            chunk_masks(line + offset, &whitespace, &special);
+        } else {
+            scalar_masks(line + offset, size, &whitespace, &special);
+        }
+
+        uint64_t valid = size == CHUNK_SIZE ? UINT64_MAX : (UINT64_C(1) << size) - 1;
+        whitespace &= valid;
+        if ((special & valid) != 0) {
+            return SIZE_MAX;
+        }
+
+        uint64_t values = ~whitespace & valid;
+        uint64_t after_value = (values << 1) | inside_field;
+        uint64_t starts = values & ~after_value;
+        uint64_t ends = whitespace & after_value;
+        inside_field = (values >> (size - 1)) & 1;
+
+        while (starts != 0) {
+            if (count < capacity) {
+                fields[count].start = offset + (size_t)__builtin_ctzll(starts);
+            }
+            count += 1;
+            starts &= starts - 1;
+        }
+
+        while (ends != 0) {
+            if (closed < capacity) {
+                fields[closed].end = offset + (size_t)__builtin_ctzll(ends);
+            }
+            closed += 1;
+            ends &= ends - 1;
+        }
+
+        if (count > capacity) {
+            return count;
+        }
+    }
+
+    if (closed < count) {
+        fields[closed].end = length;
+    }
+
+    return count;
+}
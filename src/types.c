@@ -4,24 +4,148 @@
 #include <stdarg.h>
 
 #include "exyz.h"
+#include "internal.h"
 
 static exyz_status_t error(const char* format, ...) {
     va_list args;
     va_start(args, format);
-    vfprintf(stderr, format, args);
+    exyz_status_t status = exyz_set_error(format, args);
     va_end(args);
 
-    return EXYZ_ERROR;
+    return status;
 }
 
 static exyz_status_t exyz_info_init_key(exyz_info_t* info,  const char* name) {
-    info->key = strdup(name);
+    info->key = exyz_strdup(name);
     if (info->key == NULL) {
         return error("failed to allocate memory");
     }
     return EXYZ_SUCCESS;
 }
 
+const exyz_info_t* exyz_info_find(const exyz_info_t* info, size_t count, const char* key) {
+    for (size_t i=0; i<count; i++) {
+        if (strcmp(info[i].key, key) == 0) {
+            return &info[i];
+        }
+    }
+    return NULL;
+}
+
+/******************************************************************************/
+
+struct exyz_keys_index_t {
+    /// keys in the indexed list, borrowed from the list
+    const char** keys;
+    size_t count;
+    /// open addressing hash table from keys to their position in `keys`, with
+    /// -1 for empty slots
+    int64_t* slots;
+    size_t size;
+};
+
+static uint64_t hash_key(const char* key) {
+    uint64_t hash = UINT64_C(0xcbf29ce484222325);
+    for (const char* c=key; *c != '\0'; c++) {
+        hash ^= (uint8_t)*c;
+        hash *= UINT64_C(0x100000001b3);
+    }
+    return hash;
+}
+
+/// find the slot containing `key` in `index`, or the empty slot where it
+/// should go
+static size_t index_slot(const exyz_keys_index_t* index, const char* key) {
+    size_t slot = (size_t)hash_key(key) & (index->size - 1);
+    while (index->slots[slot] != -1 && strcmp(index->keys[index->slots[slot]], key) != 0) {
+        slot = (slot + 1) & (index->size - 1);
+    }
+    return slot;
+}
+
+/// allocate an index for `count` keys, which must then be set in
+/// `index->keys` before calling `index_fill`
+static exyz_status_t index_alloc(size_t count, exyz_keys_index_t** index_ptr) {
+    exyz_keys_index_t* index = exyz_calloc(1, sizeof(exyz_keys_index_t));
+    if (index == NULL) {
+        return error("failed to allocate memory");
+    }
+
+    index->count = count;
+    index->size = 8;
+    while (index->size < 2 * count) {
+        index->size *= 2;
+    }
+
+    index->keys = exyz_malloc((count + 1) * sizeof(const char*));
+    index->slots = exyz_malloc(index->size * sizeof(int64_t));
+    if (index->keys == NULL || index->slots == NULL) {
+        exyz_keys_index_free(index);
+        return error("failed to allocate memory");
+    }
+
+    *index_ptr = index;
+    return EXYZ_SUCCESS;
+}
+
+static void index_fill(exyz_keys_index_t* index) {
+    for (size_t i=0; i<index->size; i++) {
+        index->slots[i] = -1;
+    }
+
+    for (size_t i=0; i<index->count; i++) {
+        size_t slot = index_slot(index, index->keys[i]);
+        // keep the first one for duplicated keys
+        if (index->slots[slot] == -1) {
+            index->slots[slot] = (int64_t)i;
+        }
+    }
+}
+
+exyz_status_t exyz_info_index(const exyz_info_t* info, size_t count, exyz_keys_index_t** index) {
+    *index = NULL;
+    exyz_status_t status = index_alloc(count, index);
+    if (status != EXYZ_SUCCESS) {
+        return status;
+    }
+
+    for (size_t i=0; i<count; i++) {
+        (*index)->keys[i] = info[i].key;
+    }
+    index_fill(*index);
+
+    return EXYZ_SUCCESS;
+}
+
+exyz_status_t exyz_atom_properties_index(const exyz_atom_property_t* properties, size_t count, exyz_keys_index_t** index) {
+    *index = NULL;
+    exyz_status_t status = index_alloc(count, index);
+    if (status != EXYZ_SUCCESS) {
+        return status;
+    }
+
+    for (size_t i=0; i<count; i++) {
+        (*index)->keys[i] = properties[i].key;
+    }
+    index_fill(*index);
+
+    return EXYZ_SUCCESS;
+}
+
+int64_t exyz_keys_index_find(const exyz_keys_index_t* index, const char* key) {
+    return index->slots[index_slot(index, key)];
+}
+
+void exyz_keys_index_free(exyz_keys_index_t* index) {
+    if (index == NULL) {
+        return;
+    }
+
+    exyz_free(index->keys);
+    exyz_free(index->slots);
+    exyz_free(index);
+}
+
 exyz_status_t exyz_info_init_integer(exyz_info_t* info, const char* name, int64_t value) {
     exyz_status_t status = exyz_info_init_key(info, name);
     if (status != EXYZ_SUCCESS) {
@@ -55,7 +179,7 @@ exyz_status_t exyz_info_init_string(exyz_info_t* info, const char* name, const c
     }
 
     size_t len = strlen(value);
-    info->data.string = malloc(len);
+    info->data.string = exyz_malloc(len);
     if (info->data.string == NULL) {
         return error("failed to allocate memory");
     }
@@ -79,12 +203,12 @@ exyz_status_t exyz_info_init_bool(exyz_info_t* info, const char* name, bool valu
 }
 
 exyz_status_t exyz_info_free(exyz_info_t info) {
-    free(info.key);
+    exyz_free(info.key);
 
     if (info.type == EXYZ_ARRAY) {
         exyz_array_free(info.data.array);
     } else if (info.type == EXYZ_STRING) {
-        free(info.data.string);
+        exyz_free(info.data.string);
     }
 
     return EXYZ_SUCCESS;
@@ -94,7 +218,7 @@ exyz_status_t exyz_info_free(exyz_info_t info) {
 /******************************************************************************/
 
 exyz_status_t exyz_atom_property_free(exyz_atom_property_t property) {
-    free(property.key);
+    exyz_free(property.key);
     return EXYZ_SUCCESS;
 }
 
@@ -108,7 +232,7 @@ exyz_status_t exyz_array_init_integer(exyz_array_t* array, size_t nrows, size_t
     assert(count != 0);
 
     array->type = EXYZ_INTEGER;
-    array->data.integer = malloc(count * sizeof(int64_t));
+    array->data.integer = exyz_malloc(count * sizeof(int64_t));
     if (array->data.integer == NULL) {
         exyz_array_free(*array);
         return error("failed to allocate memory");
@@ -125,7 +249,7 @@ exyz_status_t exyz_array_init_real(exyz_array_t* array, size_t nrows, size_t nco
     assert(count != 0);
 
     array->type = EXYZ_REAL;
-    array->data.real = malloc(count * sizeof(double));
+    array->data.real = exyz_malloc(count * sizeof(double));
     if (array->data.real == NULL) {
         exyz_array_free(*array);
         return error("failed to allocate memory");
@@ -142,7 +266,7 @@ exyz_status_t exyz_array_init_string(exyz_array_t* array, size_t nrows, size_t n
     assert(count != 0);
 
     array->type = EXYZ_STRING;
-    array->data.string = calloc(count, sizeof(char*));
+    array->data.string = exyz_calloc(count, sizeof(char*));
     if (array->data.string == NULL) {
         exyz_array_free(*array);
         return error("failed to allocate memory");
@@ -159,7 +283,7 @@ exyz_status_t exyz_array_init_bool(exyz_array_t* array, size_t nrows, size_t nco
     assert(count != 0);
 
     array->type = EXYZ_BOOL;
-    array->data.boolean = malloc(count * sizeof(bool));
+    array->data.boolean = exyz_malloc(count * sizeof(bool));
     if (array->data.boolean == NULL) {
         exyz_array_free(*array);
         return error("failed to allocate memory");
@@ -173,18 +297,28 @@ exyz_status_t exyz_array_init_bool(exyz_array_t* array, size_t nrows, size_t nco
 exyz_status_t exyz_array_free(exyz_array_t array) {
     assert(array.type != EXYZ_ARRAY);
     if (array.type == EXYZ_INTEGER) {
-        free(array.data.integer);
+        exyz_free(array.data.integer);
     } else if (array.type == EXYZ_REAL) {
-        free(array.data.real);
+        exyz_free(array.data.real);
     } else if (array.type == EXYZ_BOOL) {
-        free(array.data.boolean);
+        exyz_free(array.data.boolean);
     } else if (array.type == EXYZ_STRING) {
-        size_t count = array.nrows * array.ncols;
-        for (size_t i=0; i<count; i++) {
-            free(array.data.string[i]);
+        if (array.data.string != NULL) {
+            size_t count = array.nrows * array.ncols;
+            for (size_t i=0; i<count; i++) {
+                exyz_free(array.data.string[i]);
+            }
         }
-        free(array.data.string);
+        exyz_free(array.data.string);
     }
 
     return EXYZ_SUCCESS;
 }
+
+
+/******************************************************************************/
+
+exyz_status_t exyz_atom_array_free(exyz_atom_array_t array) {
+    exyz_free(array.key);
+    return exyz_array_free(array.array);
+}
@@ -1,14 +1,15 @@
 #include <stdarg.h>
 
 #include "exyz.h"
+#include "internal.h"
 
 static exyz_status_t error(const char* format, ...) {
     va_list args;
     va_start(args, format);
-    vfprintf(stderr, format, args);
+    exyz_status_t status = exyz_set_error(format, args);
     va_end(args);
 
-    return EXYZ_ERROR;
+    return status;
 }
 
 exyz_status_t exyz_write(FILE* fd, size_t* n_atoms, exyz_info_t* info, exyz_array_t* arrays) {
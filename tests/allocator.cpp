@@ -0,0 +1,94 @@
+#include <catch.hpp>
+#include <exyz.h>
+
+/// read all frames in `reader`, freeing them with the `frames` allocator
+static size_t read_all(exyz_reader_t* reader, const exyz_allocator_t* frames) {
+    size_t count = 0;
+    while (true) {
+        size_t n_atoms = 0;
+        exyz_info_t* info = nullptr;
+        size_t info_count = 0;
+        exyz_atom_array_t* arrays = nullptr;
+        size_t arrays_count = 0;
+        auto status = exyz_reader_read(reader, &n_atoms, &info, &info_count, &arrays, &arrays_count);
+        if (status == EXYZ_END_OF_FILE) {
+            break;
+        }
+        REQUIRE(status == EXYZ_SUCCESS);
+
+        auto previous = exyz_use_allocator(frames);
+        for (size_t i=0; i<info_count; i++) {
+            exyz_info_free(info[i]);
+        }
+        exyz_free(info);
+
+        for (size_t i=0; i<arrays_count; i++) {
+            exyz_atom_array_free(arrays[i]);
+        }
+        exyz_free(arrays);
+        exyz_use_allocator(previous);
+
+        count += 1;
+    }
+    return count;
+}
+
+TEST_CASE("Allocator") {
+    exyz_allocator_t allocator;
+    exyz_allocation_counts_t counts;
+    exyz_counting_allocator(&allocator, &counts);
+
+    SECTION("Thread allocator") {
+        CHECK(exyz_use_allocator(&allocator) == nullptr);
+
+        exyz_reader_t* reader = nullptr;
+        auto status = exyz_reader_open(&reader, EXYZ_TESTS_DATA "/water.xyz.gz");
+        REQUIRE(status == EXYZ_SUCCESS);
+        CHECK(read_all(reader, &allocator) == 3);
+        exyz_reader_close(reader);
+
+        CHECK(exyz_use_allocator(nullptr) == &allocator);
+
+        CHECK(counts.allocations > 0);
+        CHECK(counts.frees == counts.allocations);
+        CHECK(counts.current_bytes == 0);
+        CHECK(counts.peak_bytes > 0);
+        CHECK(counts.peak_bytes <= counts.allocated_bytes);
+    }
+
+    SECTION("Reader allocator") {
+        exyz_reader_t* reader = nullptr;
+        auto status = exyz_reader_open(&reader, EXYZ_TESTS_DATA "/water.xyz");
+        REQUIRE(status == EXYZ_SUCCESS);
+        exyz_reader_set_allocator(reader, &allocator);
+        CHECK(read_all(reader, &allocator) == 3);
+        exyz_reader_close(reader);
+
+        // only the frames use the reader allocator
+        CHECK(counts.allocations > 0);
+        CHECK(counts.frees == counts.allocations);
+        CHECK(counts.current_bytes == 0);
+        CHECK(counts.peak_bytes < 1024 * 1024);
+    }
+
+    SECTION("Global allocator") {
+        exyz_set_allocator(&allocator);
+
+        exyz_array_t array;
+        auto status = exyz_array_init_string(&array, 2, 3);
+        REQUIRE(status == EXYZ_SUCCESS);
+        CHECK(counts.allocations == 1);
+        CHECK(counts.current_bytes == 6 * sizeof(char*));
+
+        exyz_array_free(array);
+        CHECK(counts.frees == 1);
+        CHECK(counts.current_bytes == 0);
+
+        exyz_set_allocator(nullptr);
+
+        status = exyz_array_init_real(&array, 2, 3);
+        REQUIRE(status == EXYZ_SUCCESS);
+        exyz_array_free(array);
+        CHECK(counts.allocations == 1);
+    }
+}
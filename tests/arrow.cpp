@@ -0,0 +1,260 @@
+#include <cstring>
+#include <string>
+
+#include <catch.hpp>
+#include <exyz.h>
+#include <exyz_arrow.h>
+
+static bool bit(const void* bitmap, size_t i) {
+    return (static_cast<const uint8_t*>(bitmap)[i / 8] >> (i % 8)) & 1;
+}
+
+static void free_info(exyz_info_t* info, size_t info_count) {
+    for (size_t i=0; i<info_count; i++) {
+        exyz_info_free(info[i]);
+    }
+    free(info);
+}
+
+static std::string utf8_value(const ArrowArray* array, size_t i) {
+    auto offsets = static_cast<const int32_t*>(array->buffers[1]);
+    auto data = static_cast<const char*>(array->buffers[2]);
+    return std::string(data + offsets[i], static_cast<size_t>(offsets[i + 1] - offsets[i]));
+}
+
+TEST_CASE("Arrow export") {
+    SECTION("Atom properties") {
+        auto file = std::tmpfile();
+        std::string content = "3\nProperties=species:S:1:pos:R:3:fixed:L:1:id:I:1\n"
+            "O 0 0 0.5 T 4\n"
+            "H 1 0 0 F 5\n"
+            "H 2 0 0 T 6\n";
+        std::fwrite(content.data(), 1, content.size(), file);
+        std::rewind(file);
+
+        size_t n_atoms = 0;
+        exyz_info_t* info = nullptr;
+        size_t info_count = 0;
+        exyz_atom_array_t* arrays = nullptr;
+        size_t arrays_count = 0;
+        auto status = exyz_read(file, &n_atoms, &info, &info_count, &arrays, &arrays_count);
+        REQUIRE(status == EXYZ_SUCCESS);
+        std::fclose(file);
+        free_info(info, info_count);
+
+        // keep a pointer to check that positions are not copied
+        auto positions = arrays[1].array.data.real;
+
+        ArrowSchema schema;
+        ArrowArray array;
+        status = exyz_arrow_export_atoms(n_atoms, arrays, arrays_count, &schema, &array);
+        REQUIRE(status == EXYZ_SUCCESS);
+
+        CHECK(schema.format == std::string("+s"));
+        REQUIRE(schema.n_children == 4);
+        CHECK(array.length == 3);
+        REQUIRE(array.n_children == 4);
+
+        // species, dictionary-encoded
+        CHECK(schema.children[0]->name == std::string("species"));
+        CHECK(schema.children[0]->format == std::string("i"));
+        REQUIRE(schema.children[0]->dictionary != nullptr);
+        CHECK(schema.children[0]->dictionary->format == std::string("u"));
+
+        auto species = array.children[0];
+        auto indexes = static_cast<const int32_t*>(species->buffers[1]);
+        CHECK(indexes[0] == 0);
+        CHECK(indexes[1] == 1);
+        CHECK(indexes[2] == 1);
+        REQUIRE(species->dictionary != nullptr);
+        CHECK(species->dictionary->length == 2);
+        CHECK(utf8_value(species->dictionary, 0) == "O");
+        CHECK(utf8_value(species->dictionary, 1) == "H");
+
+        // positions, as fixed size lists
+        CHECK(schema.children[1]->name == std::string("pos"));
+        CHECK(schema.children[1]->format == std::string("+w:3"));
+        CHECK(schema.children[1]->children[0]->format == std::string("g"));
+        auto pos = array.children[1]->children[0];
+        CHECK(pos->length == 9);
+        CHECK(pos->buffers[1] == positions);
+
+        CHECK(schema.children[2]->format == std::string("b"));
+        auto fixed = array.children[2]->buffers[1];
+        CHECK(bit(fixed, 0));
+        CHECK_FALSE(bit(fixed, 1));
+        CHECK(bit(fixed, 2));
+
+        CHECK(schema.children[3]->format == std::string("l"));
+        CHECK(static_cast<const int64_t*>(array.children[3]->buffers[1])[2] == 6);
+
+        // children can be moved out and outlive the parent
+        ArrowArray moved = *array.children[1];
+        array.children[1]->release = nullptr;
+
+        array.release(&array);
+        schema.release(&schema);
+        CHECK(array.release == nullptr);
+        CHECK(schema.release == nullptr);
+
+        CHECK(static_cast<const double*>(moved.children[0]->buffers[1])[2] == 0.5);
+        moved.release(&moved);
+    }
+
+    SECTION("Multiple frames") {
+        auto file = std::tmpfile();
+        std::string content =
+            "2\nProperties=species:S:1:pos:R:3\nO 0 0 0\nH 1 0 0\n"
+            "1\nProperties=species:S:1:pos:R:3\nC 2 0 0\n"
+            "3\nProperties=species:S:1:pos:R:3\nH 3 0 0\nH 4 0 0\nN 5 0 0\n";
+        std::fwrite(content.data(), 1, content.size(), file);
+        std::rewind(file);
+
+        size_t n_atoms[3] = {0, 0, 0};
+        exyz_atom_array_t* arrays[3] = {nullptr, nullptr, nullptr};
+        size_t arrays_count[3] = {0, 0, 0};
+        for (size_t frame=0; frame<3; frame++) {
+            exyz_info_t* info = nullptr;
+            size_t info_count = 0;
+            auto status = exyz_read(file, &n_atoms[frame], &info, &info_count, &arrays[frame], &arrays_count[frame]);
+            REQUIRE(status == EXYZ_SUCCESS);
+            free_info(info, info_count);
+        }
+        std::fclose(file);
+
+        ArrowArrayStream stream;
+        auto status = exyz_arrow_export_atoms_stream(3, n_atoms, arrays, arrays_count, &stream);
+        REQUIRE(status == EXYZ_SUCCESS);
+
+        ArrowSchema schema;
+        REQUIRE(stream.get_schema(&stream, &schema) == 0);
+        REQUIRE(schema.n_children == 2);
+        CHECK(schema.children[0]->name == std::string("species"));
+        CHECK(schema.children[1]->format == std::string("+w:3"));
+        schema.release(&schema);
+
+        double first_x[3] = {0, 2, 3};
+        std::string last_species[3] = {"H", "C", "N"};
+        for (size_t frame=0; frame<3; frame++) {
+            ArrowArray array;
+            REQUIRE(stream.get_next(&stream, &array) == 0);
+            REQUIRE(array.release != nullptr);
+            CHECK(array.length == static_cast<int64_t>(n_atoms[frame]));
+
+            auto pos = array.children[1]->children[0];
+            CHECK(static_cast<const double*>(pos->buffers[1])[0] == first_x[frame]);
+
+            auto species = array.children[0];
+            auto indexes = static_cast<const int32_t*>(species->buffers[1]);
+            auto last = static_cast<size_t>(indexes[n_atoms[frame] - 1]);
+            CHECK(utf8_value(species->dictionary, last) == last_species[frame]);
+            array.release(&array);
+        }
+
+        // end of stream
+        ArrowArray end;
+        REQUIRE(stream.get_next(&stream, &end) == 0);
+        CHECK(end.release == nullptr);
+        stream.release(&stream);
+        CHECK(stream.release == nullptr);
+    }
+
+    SECTION("Multiple frames with different properties") {
+        exyz_reader_t* reader = nullptr;
+        auto status = exyz_reader_open(&reader, EXYZ_TESTS_DATA "/water.xyz");
+        REQUIRE(status == EXYZ_SUCCESS);
+
+        size_t n_atoms[3] = {0, 0, 0};
+        exyz_atom_array_t* arrays[3] = {nullptr, nullptr, nullptr};
+        size_t arrays_count[3] = {0, 0, 0};
+        for (size_t frame=0; frame<3; frame++) {
+            exyz_info_t* info = nullptr;
+            size_t info_count = 0;
+            status = exyz_reader_read(reader, &n_atoms[frame], &info, &info_count, &arrays[frame], &arrays_count[frame]);
+            REQUIRE(status == EXYZ_SUCCESS);
+            free_info(info, info_count);
+        }
+        exyz_reader_close(reader);
+
+        // the last frame does not contain forces
+        ArrowArrayStream stream;
+        status = exyz_arrow_export_atoms_stream(3, n_atoms, arrays, arrays_count, &stream);
+        CHECK(status == EXYZ_ERROR);
+        CHECK(std::string(exyz_last_error()->message) == "frame 2 has 2 atom properties, but the first frame has 3");
+
+        // frames not given to an unused stream are released with it
+        status = exyz_arrow_export_atoms_stream(2, n_atoms, arrays, arrays_count, &stream);
+        REQUIRE(status == EXYZ_SUCCESS);
+        stream.release(&stream);
+
+        for (size_t i=0; i<arrays_count[2]; i++) {
+            exyz_atom_array_free(arrays[2][i]);
+        }
+        free(arrays[2]);
+    }
+
+    SECTION("Frames info") {
+        exyz_reader_t* reader = nullptr;
+        auto status = exyz_reader_open(&reader, EXYZ_TESTS_DATA "/water.xyz");
+        REQUIRE(status == EXYZ_SUCCESS);
+
+        exyz_info_t* info[3] = {nullptr, nullptr, nullptr};
+        size_t info_count[3] = {0, 0, 0};
+        for (size_t frame=0; frame<3; frame++) {
+            size_t n_atoms = 0;
+            exyz_atom_array_t* arrays = nullptr;
+            size_t arrays_count = 0;
+            status = exyz_reader_read(reader, &n_atoms, &info[frame], &info_count[frame], &arrays, &arrays_count);
+            REQUIRE(status == EXYZ_SUCCESS);
+
+            for (size_t i=0; i<arrays_count; i++) {
+                exyz_atom_array_free(arrays[i]);
+            }
+            free(arrays);
+        }
+        exyz_reader_close(reader);
+
+        // remove the energy from the last frame
+        exyz_info_free(info[2][0]);
+        info[2][0] = info[2][info_count[2] - 1];
+        info_count[2] -= 1;
+
+        ArrowSchema schema;
+        ArrowArray array;
+        status = exyz_arrow_export_info(info, info_count, 3, &schema, &array);
+        REQUIRE(status == EXYZ_SUCCESS);
+
+        CHECK(array.length == 3);
+        REQUIRE(schema.n_children == 3);
+        CHECK(schema.children[0]->name == std::string("energy"));
+        CHECK(schema.children[0]->format == std::string("g"));
+        CHECK(schema.children[1]->name == std::string("config_type"));
+        CHECK(schema.children[1]->format == std::string("u"));
+        CHECK(schema.children[2]->name == std::string("step"));
+        CHECK(schema.children[2]->format == std::string("l"));
+
+        auto energy = array.children[0];
+        CHECK(energy->null_count == 1);
+        CHECK(bit(energy->buffers[0], 0));
+        CHECK_FALSE(bit(energy->buffers[0], 2));
+        CHECK(static_cast<const double*>(energy->buffers[1])[1] == -14.18);
+
+        auto config_type = array.children[1];
+        CHECK(config_type->null_count == 0);
+        CHECK(utf8_value(config_type, 0) == "bulk");
+        CHECK(utf8_value(config_type, 1) == "surface");
+
+        auto step = array.children[2];
+        CHECK(static_cast<const int64_t*>(step->buffers[1])[2] == 2);
+
+        array.release(&array);
+        schema.release(&schema);
+
+        for (size_t frame=0; frame<3; frame++) {
+            for (size_t i=0; i<info_count[frame]; i++) {
+                exyz_info_free(info[frame][i]);
+            }
+            free(info[frame]);
+        }
+    }
+}
@@ -0,0 +1,113 @@
+#include <cstdio>
+#include <string>
+
+#include <catch.hpp>
+#include <exyz.h>
+
+static void write_file(const char* path, const std::string& content) {
+    auto file = std::fopen(path, "wb");
+    REQUIRE(file != nullptr);
+    std::fwrite(content.data(), 1, content.size(), file);
+    std::fclose(file);
+}
+
+static const char* FRAME = "2\n"
+    "Properties=species:S:1:pos:R:3:fixed:L:1 energy=-3.5 name=test step=4 cell=\"1 2 3\"\n"
+    "H 0 0 0.5 T\n"
+    "O 1 0 -0.5 F\n";
+
+TEST_CASE("Binary cache") {
+    // these files are created in the current working directory
+    auto path = "cache-test.xyz";
+    auto cache_path = "cache-test.xyz.exyzcache";
+    write_file(path, std::string(FRAME) + FRAME);
+    std::remove(cache_path);
+
+    auto check_frames = [&](size_t expected) {
+        exyz_cache_t* cache = nullptr;
+        auto status = exyz_cache_open(&cache, path, nullptr);
+        REQUIRE(status == EXYZ_SUCCESS);
+        REQUIRE(exyz_cache_frames_count(cache) == expected);
+
+        size_t n_atoms = 0;
+        exyz_info_t* info = nullptr;
+        size_t info_count = 0;
+        exyz_atom_array_t* arrays = nullptr;
+        size_t arrays_count = 0;
+        for (size_t frame=0; frame<expected; frame++) {
+            status = exyz_cache_read(cache, frame, &n_atoms, &info, &info_count, &arrays, &arrays_count);
+            REQUIRE(status == EXYZ_SUCCESS);
+            CHECK(n_atoms == 2);
+
+            REQUIRE(info_count == 4);
+            CHECK(info[0].key == std::string("energy"));
+            REQUIRE(info[0].type == EXYZ_REAL);
+            CHECK(info[0].data.real == -3.5);
+            CHECK(info[1].key == std::string("name"));
+            REQUIRE(info[1].type == EXYZ_STRING);
+            CHECK(info[1].data.string == std::string("test"));
+            CHECK(info[2].key == std::string("step"));
+            REQUIRE(info[2].type == EXYZ_INTEGER);
+            CHECK(info[2].data.integer == 4);
+            CHECK(info[3].key == std::string("cell"));
+            REQUIRE(info[3].type == EXYZ_ARRAY);
+            REQUIRE(info[3].data.array.type == EXYZ_INTEGER);
+            CHECK(info[3].data.array.ncols == 3);
+            CHECK(info[3].data.array.data.integer[2] == 3);
+
+            REQUIRE(arrays_count == 3);
+            CHECK(arrays[0].key == std::string("species"));
+            REQUIRE(arrays[0].array.type == EXYZ_STRING);
+            CHECK(arrays[0].array.data.string[0] == std::string("H"));
+            CHECK(arrays[0].array.data.string[1] == std::string("O"));
+
+            CHECK(arrays[1].key == std::string("pos"));
+            REQUIRE(arrays[1].array.type == EXYZ_REAL);
+            CHECK(arrays[1].array.nrows == 2);
+            CHECK(arrays[1].array.ncols == 3);
+            CHECK(arrays[1].array.data.real[2] == 0.5);
+            CHECK(arrays[1].array.data.real[5] == -0.5);
+
+            CHECK(arrays[2].key == std::string("fixed"));
+            REQUIRE(arrays[2].array.type == EXYZ_BOOL);
+            CHECK(arrays[2].array.data.boolean[0] == true);
+            CHECK(arrays[2].array.data.boolean[1] == false);
+        }
+
+        status = exyz_cache_read(cache, expected, &n_atoms, &info, &info_count, &arrays, &arrays_count);
+        CHECK(status == EXYZ_ERROR);
+
+        exyz_cache_close(cache);
+    };
+
+    SECTION("Creation and loading") {
+        check_frames(2);
+
+        // the cache file now exists and is used directly
+        auto file = std::fopen(cache_path, "rb");
+        CHECK(file != nullptr);
+        std::fclose(file);
+        check_frames(2);
+    }
+
+    SECTION("Invalidation") {
+        check_frames(2);
+
+        // the cache is re-created when the trajectory changes
+        write_file(path, std::string(FRAME) + FRAME + FRAME);
+        check_frames(3);
+    }
+
+    SECTION("Errors") {
+        exyz_cache_t* cache = nullptr;
+        auto status = exyz_cache_open(&cache, "not-there.xyz", nullptr);
+        CHECK(status == EXYZ_ERROR);
+
+        write_file(path, "2\nProperties=species:S:1:pos:R:3\nH 0 0 0\n");
+        status = exyz_cache_open(&cache, path, nullptr);
+        CHECK(status == EXYZ_ERROR);
+    }
+
+    std::remove(path);
+    std::remove(cache_path);
+}
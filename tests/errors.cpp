@@ -0,0 +1,227 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include <catch.hpp>
+#include <exyz.h>
+
+static std::FILE* file_with_content(const std::string& content) {
+    auto file = std::tmpfile();
+    REQUIRE(file != nullptr);
+    std::fwrite(content.data(), 1, content.size(), file);
+    std::rewind(file);
+    return file;
+}
+
+static exyz_status_t read_frame(exyz_reader_t* reader) {
+    size_t n_atoms = 0;
+    exyz_info_t* info = nullptr;
+    size_t info_count = 0;
+    exyz_atom_array_t* arrays = nullptr;
+    size_t arrays_count = 0;
+    auto status = exyz_reader_read(reader, &n_atoms, &info, &info_count, &arrays, &arrays_count);
+
+    for (size_t i=0; i<info_count; i++) {
+        exyz_info_free(info[i]);
+    }
+    exyz_free(info);
+    for (size_t i=0; i<arrays_count; i++) {
+        exyz_atom_array_free(arrays[i]);
+    }
+    exyz_free(arrays);
+
+    return status;
+}
+
+static std::string format(const exyz_error_t* error) {
+    auto size = exyz_error_format(error, nullptr, 0);
+    std::string message(size, '\0');
+    CHECK(exyz_error_format(error, &message[0], size + 1) == size);
+    return message;
+}
+
+static const std::string GOOD_FRAME = "1\nenergy=1.0\nH 0 0 0\n";
+static const std::string BAD_FRAME = "2\nProperties=species:S:1:pos:R:3\nH 0 0 0\nO 0 x 0\n";
+
+TEST_CASE("Errors") {
+    SECTION("Reader") {
+        // the blank line between frames is skipped by the reader
+        auto content = GOOD_FRAME + "\n" + BAD_FRAME;
+        auto file = file_with_content(content);
+
+        exyz_reader_t* reader = nullptr;
+        auto status = exyz_reader_from_file(&reader, file);
+        REQUIRE(status == EXYZ_SUCCESS);
+        CHECK(exyz_reader_last_error(reader)->frame == -1);
+
+        CHECK(read_frame(reader) == EXYZ_SUCCESS);
+        CHECK(read_frame(reader) == EXYZ_ERROR);
+
+        auto error = exyz_reader_last_error(reader);
+        CHECK(std::string(error->message) == "invalid value for real property 'pos' of atom 1");
+        CHECK(error->frame == 1);
+        CHECK(error->line == 8);
+
+        auto line_start = static_cast<int64_t>(content.find("O 0 x 0"));
+        CHECK(error->offset >= line_start);
+        CHECK(error->offset <= line_start + 7);
+
+        // the same error is available for the thread
+        CHECK(std::memcmp(error, exyz_last_error(), sizeof(exyz_error_t)) == 0);
+
+        auto expected = "invalid value for real property 'pos' of atom 1 (frame 1, line 8, byte " + std::to_string(error->offset) + ")";
+        CHECK(format(error) == expected);
+
+        exyz_reader_close(reader);
+        std::fclose(file);
+    }
+
+    SECTION("Number of atoms") {
+        auto content = GOOD_FRAME + "abc\ncomment\n";
+        auto file = file_with_content(content);
+
+        exyz_reader_t* reader = nullptr;
+        auto status = exyz_reader_from_file(&reader, file);
+        REQUIRE(status == EXYZ_SUCCESS);
+
+        CHECK(read_frame(reader) == EXYZ_SUCCESS);
+        CHECK(read_frame(reader) == EXYZ_ERROR);
+
+        auto error = exyz_reader_last_error(reader);
+        CHECK(std::string(error->message) == "failed to parse the number of atoms");
+        CHECK(error->frame == 1);
+        CHECK(error->line == 4);
+        CHECK(error->offset == static_cast<int64_t>(GOOD_FRAME.size()));
+
+        exyz_reader_close(reader);
+        std::fclose(file);
+    }
+
+    SECTION("exyz_read") {
+        auto content = GOOD_FRAME + BAD_FRAME;
+        auto file = file_with_content(content);
+
+        size_t n_atoms = 0;
+        exyz_info_t* info = nullptr;
+        size_t info_count = 0;
+        exyz_atom_array_t* arrays = nullptr;
+        size_t arrays_count = 0;
+        auto status = exyz_read(file, &n_atoms, &info, &info_count, &arrays, &arrays_count);
+        REQUIRE(status == EXYZ_SUCCESS);
+        for (size_t i=0; i<info_count; i++) {
+            exyz_info_free(info[i]);
+        }
+        exyz_free(info);
+        for (size_t i=0; i<arrays_count; i++) {
+            exyz_atom_array_free(arrays[i]);
+        }
+        exyz_free(arrays);
+
+        status = exyz_read(file, &n_atoms, &info, &info_count, &arrays, &arrays_count);
+        CHECK(status == EXYZ_ERROR);
+
+        // lines and frames are not counted by exyz_read
+        auto error = exyz_last_error();
+        CHECK(std::string(error->message) == "invalid value for real property 'pos' of atom 1");
+        CHECK(error->frame == -1);
+        CHECK(error->line == -1);
+
+        auto line_start = static_cast<int64_t>(content.find("O 0 x 0"));
+        CHECK(error->offset >= line_start);
+        CHECK(error->offset <= line_start + 7);
+
+        std::fclose(file);
+    }
+
+    SECTION("Comment line") {
+        exyz_atom_property_t* properties = nullptr;
+        size_t properties_count = 0;
+        exyz_info_t* info = nullptr;
+        size_t info_count = 0;
+        std::string line = "a=1 b=2 c=\"unclosed";
+        auto status = exyz_read_comment_line(line.c_str(), line.size(), &properties, &properties_count, &info, &info_count);
+        CHECK(status == EXYZ_ERROR);
+
+        auto error = exyz_last_error();
+        CHECK(error->frame == -1);
+        CHECK(error->line == 1);
+        CHECK(error->offset >= 8);
+        CHECK(error->offset <= static_cast<int64_t>(line.size()));
+        CHECK(std::string(error->message) == "quoted string must end with \"");
+
+        // the previous error is not reported for the next lines
+        line = "a=";
+        status = exyz_read_comment_line(line.c_str(), line.size(), &properties, &properties_count, &info, &info_count);
+        CHECK(status == EXYZ_ERROR);
+        CHECK(std::string(exyz_last_error()->message) == "missing value for 'a' in comment line");
+        CHECK(exyz_last_error()->line == 1);
+
+        line = "=3";
+        status = exyz_read_comment_line(line.c_str(), line.size(), &properties, &properties_count, &info, &info_count);
+        CHECK(status == EXYZ_ERROR);
+        CHECK(std::string(exyz_last_error()->message) == "expected a frame property key in comment line, got '='");
+
+        line = "Properties=";
+        status = exyz_read_comment_line(line.c_str(), line.size(), &properties, &properties_count, &info, &info_count);
+        CHECK(status == EXYZ_ERROR);
+        CHECK(std::string(exyz_last_error()->message) == "missing value for Properties in comment line");
+
+        line = "a=1 b=2";
+        status = exyz_read_comment_line(line.c_str(), line.size(), &properties, &properties_count, &info, &info_count);
+        REQUIRE(status == EXYZ_SUCCESS);
+        CHECK(std::string(exyz_last_error()->message).empty());
+        CHECK(exyz_last_error()->line == -1);
+        for (size_t i=0; i<info_count; i++) {
+            exyz_info_free(info[i]);
+        }
+        exyz_free(info);
+        exyz_free(properties);
+    }
+
+    SECTION("Message arguments") {
+        auto file = file_with_content(GOOD_FRAME);
+        exyz_lazy_frame_t* frame = nullptr;
+        auto status = exyz_read_lazy(file, &frame);
+        REQUIRE(status == EXYZ_SUCCESS);
+
+        // string arguments are copied when the error happens, and the message
+        // is created later
+        const exyz_array_t* array = nullptr;
+        auto key = std::string("velocities");
+        status = exyz_lazy_frame_array(frame, key.c_str(), &array);
+        CHECK(status == EXYZ_ERROR);
+        key.assign(key.size(), 'x');
+        CHECK(std::string(exyz_last_error()->message) == "there is no atom property named 'velocities' in this frame");
+
+        const char* line = nullptr;
+        size_t length = 0;
+        status = exyz_lazy_frame_line(frame, 3, &line, &length);
+        CHECK(status == EXYZ_ERROR);
+        CHECK(format(exyz_last_error()) == "atom index 3 is out of bounds for a frame with 1 atoms");
+
+        exyz_lazy_frame_free(frame);
+        std::fclose(file);
+    }
+
+    SECTION("Format") {
+        exyz_error_t error;
+        std::strcpy(error.message, "something went wrong");
+        error.frame = -1;
+        error.line = -1;
+        error.offset = -1;
+        CHECK(format(&error) == "something went wrong");
+
+        error.line = 3;
+        CHECK(format(&error) == "something went wrong (line 3)");
+
+        error.frame = 0;
+        error.offset = 12;
+        CHECK(format(&error) == "something went wrong (frame 0, line 3, byte 12)");
+
+        // the full length is returned when the buffer is too small
+        char buffer[10];
+        auto size = exyz_error_format(&error, buffer, sizeof(buffer));
+        CHECK(size == std::strlen("something went wrong (frame 0, line 3, byte 12)"));
+        CHECK(std::string(buffer) == "something");
+    }
+}
@@ -0,0 +1,262 @@
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <catch.hpp>
+#include <exyz.h>
+
+static void free_frame(exyz_info_t* info, size_t info_count, exyz_atom_array_t* arrays, size_t arrays_count) {
+    for (size_t i=0; i<info_count; i++) {
+        exyz_info_free(info[i]);
+    }
+    exyz_free(info);
+
+    for (size_t i=0; i<arrays_count; i++) {
+        exyz_atom_array_free(arrays[i]);
+    }
+    exyz_free(arrays);
+}
+
+/// read the next frame in `reader`, and get the value of the "step" info and
+/// the first position
+static exyz_status_t read_step(exyz_reader_t* reader, int64_t* step, double* position) {
+    size_t n_atoms = 0;
+    exyz_info_t* info = nullptr;
+    size_t info_count = 0;
+    exyz_atom_array_t* arrays = nullptr;
+    size_t arrays_count = 0;
+    auto status = exyz_reader_read(reader, &n_atoms, &info, &info_count, &arrays, &arrays_count);
+    if (status != EXYZ_SUCCESS) {
+        return status;
+    }
+
+    auto found = exyz_info_find(info, info_count, "step");
+    *step = found != nullptr ? found->data.integer : -1;
+    *position = arrays_count > 1 ? arrays[1].array.data.real[0] : 0.0;
+    free_frame(info, info_count, arrays, arrays_count);
+    return status;
+}
+
+/// read all the steps from the file at `path`, using `cache`
+static std::vector<int64_t> read_steps(const std::string& path, exyz_frame_cache_t* cache) {
+    exyz_reader_t* reader = nullptr;
+    auto status = exyz_reader_open(&reader, path.c_str());
+    REQUIRE(status == EXYZ_SUCCESS);
+    exyz_reader_set_frame_cache(reader, cache);
+
+    auto steps = std::vector<int64_t>();
+    int64_t step = 0;
+    double position = 0;
+    while ((status = read_step(reader, &step, &position)) == EXYZ_SUCCESS) {
+        steps.push_back(step);
+    }
+    CHECK(status == EXYZ_END_OF_FILE);
+
+    exyz_reader_close(reader);
+    return steps;
+}
+
+static std::string trajectory(size_t frames) {
+    auto content = std::string();
+    for (size_t frame=0; frame<frames; frame++) {
+        content += "2\nstep=" + std::to_string(frame) + "\n";
+        content += "H " + std::to_string(frame) + " 0 0\nO 0 0 0\n";
+    }
+    return content;
+}
+
+TEST_CASE("Frame cache") {
+    SECTION("Shared between readers") {
+        exyz_frame_cache_t* cache = nullptr;
+        auto status = exyz_frame_cache_create(&cache, 1024 * 1024);
+        REQUIRE(status == EXYZ_SUCCESS);
+
+        auto expected = std::vector<int64_t>{0, 1, 2};
+        CHECK(read_steps(EXYZ_TESTS_DATA "/water.xyz", cache) == expected);
+
+        exyz_frame_cache_counts_t counts;
+        exyz_frame_cache_counts(cache, &counts);
+        CHECK(counts.hits == 0);
+        CHECK(counts.misses == 3);
+        CHECK(counts.frames == 3);
+        CHECK(counts.bytes > 0);
+
+        // the second reader gets all frames from the cache
+        CHECK(read_steps(EXYZ_TESTS_DATA "/water.xyz", cache) == expected);
+        exyz_frame_cache_counts(cache, &counts);
+        CHECK(counts.hits == 3);
+        CHECK(counts.misses == 3);
+        CHECK(counts.evictions == 0);
+
+        exyz_frame_cache_free(cache);
+    }
+
+    SECTION("Memory budget") {
+        exyz_frame_cache_t* cache = nullptr;
+        auto status = exyz_frame_cache_create(&cache, 1024 * 1024);
+        REQUIRE(status == EXYZ_SUCCESS);
+        read_steps(EXYZ_TESTS_DATA "/water.xyz", cache);
+
+        exyz_frame_cache_counts_t counts;
+        exyz_frame_cache_counts(cache, &counts);
+        auto frame_bytes = counts.bytes / 3;
+        exyz_frame_cache_free(cache);
+
+        // only the most recent frames are kept
+        status = exyz_frame_cache_create(&cache, static_cast<size_t>(frame_bytes * 3 / 2));
+        REQUIRE(status == EXYZ_SUCCESS);
+        read_steps(EXYZ_TESTS_DATA "/water.xyz", cache);
+
+        exyz_frame_cache_counts(cache, &counts);
+        CHECK(counts.frames == 1);
+        CHECK(counts.evictions == 2);
+        CHECK(counts.bytes <= frame_bytes * 3 / 2);
+
+        // the last frame is evicted before it is read again
+        read_steps(EXYZ_TESTS_DATA "/water.xyz", cache);
+        exyz_frame_cache_counts(cache, &counts);
+        CHECK(counts.hits == 0);
+        CHECK(counts.evictions == 5);
+        exyz_frame_cache_free(cache);
+
+        // frames larger than the budget are never cached
+        status = exyz_frame_cache_create(&cache, 16);
+        REQUIRE(status == EXYZ_SUCCESS);
+        read_steps(EXYZ_TESTS_DATA "/water.xyz", cache);
+        exyz_frame_cache_counts(cache, &counts);
+        CHECK(counts.frames == 0);
+        CHECK(counts.bytes == 0);
+        exyz_frame_cache_free(cache);
+    }
+
+    SECTION("Seeking") {
+        if (!exyz_compression_supported(EXYZ_COMPRESSION_ZSTD)) {
+            WARN("skipping test for seeking with a frame cache, zstd compression is not supported");
+            return;
+        }
+
+        auto input = std::string("frame-cache.xyz");
+        auto path = std::string("frame-cache.xyz.zst");
+        auto file = std::fopen(input.c_str(), "wb");
+        REQUIRE(file != nullptr);
+        auto content = trajectory(20);
+        std::fwrite(content.data(), 1, content.size(), file);
+        std::fclose(file);
+        auto status = exyz_compress_seekable(input.c_str(), path.c_str(), 64, 3);
+        REQUIRE(status == EXYZ_SUCCESS);
+
+        exyz_frame_cache_t* cache = nullptr;
+        status = exyz_frame_cache_create(&cache, 1024 * 1024);
+        REQUIRE(status == EXYZ_SUCCESS);
+
+        exyz_reader_t* reader = nullptr;
+        status = exyz_reader_open(&reader, path.c_str());
+        REQUIRE(status == EXYZ_SUCCESS);
+        exyz_reader_set_frame_cache(reader, cache);
+
+        int64_t step = 0;
+        double position = 0;
+        for (size_t frame: {12, 3, 12, 3, 19, 12}) {
+            status = exyz_reader_seek_frame(reader, frame);
+            REQUIRE(status == EXYZ_SUCCESS);
+            status = read_step(reader, &step, &position);
+            REQUIRE(status == EXYZ_SUCCESS);
+            CHECK(step == static_cast<int64_t>(frame));
+            CHECK(position == static_cast<double>(frame));
+        }
+
+        exyz_frame_cache_counts_t counts;
+        exyz_frame_cache_counts(cache, &counts);
+        CHECK(counts.hits == 3);
+        CHECK(counts.frames == 3);
+
+        // reading continues after the cached frame, with frame 13 from the
+        // file and frame 14 skipped by the stride
+        status = exyz_reader_set_stride(reader, 0, SIZE_MAX, 2);
+        REQUIRE(status == EXYZ_SUCCESS);
+        status = exyz_reader_seek_frame(reader, 12);
+        REQUIRE(status == EXYZ_SUCCESS);
+        for (int64_t expected: {12, 14, 16, 18}) {
+            status = read_step(reader, &step, &position);
+            REQUIRE(status == EXYZ_SUCCESS);
+            CHECK(step == expected);
+        }
+
+        // the last frame is cached, and seeking to it gives the end of file
+        // afterwards
+        status = exyz_reader_set_stride(reader, 0, SIZE_MAX, 1);
+        REQUIRE(status == EXYZ_SUCCESS);
+        status = exyz_reader_seek_frame(reader, 19);
+        REQUIRE(status == EXYZ_SUCCESS);
+        CHECK(read_step(reader, &step, &position) == EXYZ_SUCCESS);
+        CHECK(step == 19);
+        CHECK(read_step(reader, &step, &position) == EXYZ_END_OF_FILE);
+
+        CHECK(exyz_reader_seek_frame(reader, 20) == EXYZ_ERROR);
+
+        exyz_reader_close(reader);
+        exyz_frame_cache_free(cache);
+        std::remove(input.c_str());
+        std::remove(path.c_str());
+    }
+
+    SECTION("Concurrent readers") {
+        auto path = std::string("frame-cache-threads.xyz");
+        auto file = std::fopen(path.c_str(), "wb");
+        REQUIRE(file != nullptr);
+        auto content = trajectory(500);
+        std::fwrite(content.data(), 1, content.size(), file);
+        std::fclose(file);
+
+        // small enough to evict frames while the threads are reading
+        exyz_frame_cache_t* cache = nullptr;
+        auto status = exyz_frame_cache_create(&cache, 32 * 1024);
+        REQUIRE(status == EXYZ_SUCCESS);
+
+        auto results = std::vector<std::vector<int64_t>>(4);
+        auto threads = std::vector<std::thread>();
+        for (size_t t=0; t<results.size(); t++) {
+            threads.emplace_back([&, t]() {
+                for (size_t pass=0; pass<3; pass++) {
+                    exyz_reader_t* reader = nullptr;
+                    if (exyz_reader_open(&reader, path.c_str()) != EXYZ_SUCCESS) {
+                        return;
+                    }
+                    exyz_reader_set_frame_cache(reader, cache);
+
+                    int64_t step = 0;
+                    double position = 0;
+                    while (read_step(reader, &step, &position) == EXYZ_SUCCESS) {
+                        if (static_cast<double>(step) != position) {
+                            step = -1;
+                        }
+                        results[t].push_back(step);
+                    }
+                    exyz_reader_close(reader);
+                }
+            });
+        }
+        for (auto& thread: threads) {
+            thread.join();
+        }
+
+        auto expected = std::vector<int64_t>();
+        for (size_t pass=0; pass<3; pass++) {
+            for (int64_t step=0; step<500; step++) {
+                expected.push_back(step);
+            }
+        }
+        for (const auto& steps: results) {
+            CHECK(steps == expected);
+        }
+
+        exyz_frame_cache_counts_t counts;
+        exyz_frame_cache_counts(cache, &counts);
+        CHECK(counts.hits + counts.misses == 4 * 3 * 500);
+        CHECK(counts.bytes <= 32 * 1024);
+
+        exyz_frame_cache_free(cache);
+        std::remove(path.c_str());
+    }
+}
@@ -989,3 +989,51 @@ TEST_CASE("Array properties -- old style with brackets") {
         // TODO: missing end of array
     }
 }
+
+TEST_CASE("Keys index") {
+    exyz_atom_property_t* properties = nullptr;
+    size_t properties_count = 0;
+
+    exyz_info_t* info = nullptr;
+    size_t info_count = 0;
+
+    auto line = std::string("Properties=species:S:1:pos:R:3 a=1 b=2");
+    for (size_t i=0; i<60; i++) {
+        line += " key_" + std::to_string(i) + "=" + std::to_string(i);
+    }
+    line += " a=3";
+
+    auto status = exyz_read_comment_line(
+        line.data(), line.size(), &properties, &properties_count, &info, &info_count
+    );
+    REQUIRE(status == EXYZ_SUCCESS);
+    REQUIRE(info_count == 63);
+
+    exyz_keys_index_t* index = nullptr;
+    status = exyz_info_index(info, info_count, &index);
+    REQUIRE(status == EXYZ_SUCCESS);
+
+    CHECK(exyz_keys_index_find(index, "b") == 1);
+    CHECK(exyz_keys_index_find(index, "key_41") == 43);
+    CHECK(exyz_keys_index_find(index, "key_60") == -1);
+    CHECK(exyz_keys_index_find(index, "") == -1);
+    // the first value is used for duplicated keys, like exyz_info_find
+    CHECK(exyz_keys_index_find(index, "a") == 0);
+    CHECK(exyz_info_find(info, info_count, "a") == &info[0]);
+    exyz_keys_index_free(index);
+
+    status = exyz_atom_properties_index(properties, properties_count, &index);
+    REQUIRE(status == EXYZ_SUCCESS);
+    CHECK(exyz_keys_index_find(index, "species") == 0);
+    CHECK(exyz_keys_index_find(index, "pos") == 1);
+    CHECK(exyz_keys_index_find(index, "forces") == -1);
+    exyz_keys_index_free(index);
+
+    // empty lists
+    status = exyz_info_index(nullptr, 0, &index);
+    REQUIRE(status == EXYZ_SUCCESS);
+    CHECK(exyz_keys_index_find(index, "a") == -1);
+    exyz_keys_index_free(index);
+
+    free_data(properties, properties_count, info, info_count);
+}
@@ -0,0 +1,115 @@
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <catch.hpp>
+#include <exyz.h>
+
+static void write_file(const std::string& path, const std::string& content) {
+    auto file = std::fopen(path.c_str(), "wb");
+    REQUIRE(file != nullptr);
+    std::fwrite(content.data(), 1, content.size(), file);
+    std::fclose(file);
+}
+
+static std::vector<uint64_t> index_frames(const std::string& path, size_t threads) {
+    uint64_t* offsets = nullptr;
+    size_t count = 0;
+    auto status = exyz_index_frames(path.c_str(), threads, &offsets, &count);
+    REQUIRE(status == EXYZ_SUCCESS);
+
+    auto result = std::vector<uint64_t>(offsets, offsets + count + 1);
+    exyz_free(offsets);
+    return result;
+}
+
+TEST_CASE("Frames index") {
+    SECTION("Small file") {
+        auto offsets = index_frames(EXYZ_TESTS_DATA "/water.xyz", 0);
+        REQUIRE(offsets.size() == 4);
+        CHECK(offsets[0] == 0);
+
+        auto file = std::fopen(EXYZ_TESTS_DATA "/water.xyz", "rb");
+        REQUIRE(file != nullptr);
+        std::fseek(file, 0, SEEK_END);
+        CHECK(offsets[3] == static_cast<uint64_t>(std::ftell(file)));
+
+        // the second frame starts after 5 lines
+        std::rewind(file);
+        char line[256];
+        for (size_t i=0; i<5; i++) {
+            REQUIRE(std::fgets(line, sizeof(line), file) != nullptr);
+        }
+        CHECK(offsets[1] == static_cast<uint64_t>(std::ftell(file)));
+        std::fclose(file);
+    }
+
+    SECTION("Multiple threads") {
+        // large enough to be split between multiple threads, with frames
+        // containing lines that could be mistaken for the number of atoms
+        auto content = std::string();
+        auto expected = std::vector<uint64_t>();
+        for (size_t frame=0; frame<100000; frame++) {
+            if (frame % 7 == 3) {
+                content += "\n  \r\n";
+            }
+
+            expected.push_back(content.size());
+            auto n_atoms = frame % 13;
+            content += "  " + std::to_string(n_atoms) + "\r\n";
+            if (frame % 5 == 0) {
+                // integer comment line
+                content += "12\n";
+            } else {
+                content += "Properties=id:I:1:pos:R:3 frame=" + std::to_string(frame) + "\n";
+            }
+
+            for (size_t atom=0; atom<n_atoms; atom++) {
+                if (frame % 5 == 0) {
+                    content += std::to_string(atom + 1) + "\n";
+                } else {
+                    content += std::to_string(atom + 1) + " 0.0 1.0 2.0\n";
+                }
+            }
+        }
+        expected.push_back(content.size());
+        // trailing blank lines and no final newline
+        content += "\n   ";
+
+        auto path = std::string("index-test.xyz");
+        write_file(path, content);
+
+        for (size_t threads: {1, 3, 8}) {
+            auto offsets = index_frames(path, threads);
+            REQUIRE(offsets.size() == expected.size());
+            CHECK(std::equal(offsets.begin(), offsets.end(), expected.begin()));
+        }
+
+        std::remove(path.c_str());
+    }
+
+    SECTION("Errors") {
+        auto path = std::string("index-errors.xyz");
+        write_file(path, "1\ncomment\nH 0 0 0\n3\ncomment\nH 0 0 0\n");
+
+        uint64_t* offsets = nullptr;
+        size_t count = 0;
+        auto status = exyz_index_frames(path.c_str(), 0, &offsets, &count);
+        CHECK(status == EXYZ_ERROR);
+        CHECK(offsets == nullptr);
+
+        auto error = exyz_last_error();
+        CHECK(std::string(error->message) == "not enough lines in file for XYZ format: expected 3 atoms");
+        CHECK(error->frame == 1);
+        CHECK(error->line == 4);
+        CHECK(error->offset == 18);
+
+        write_file(path, "1\ncomment\nH 0 0 0\nH 0 0 0\n");
+        status = exyz_index_frames(path.c_str(), 0, &offsets, &count);
+        CHECK(status == EXYZ_ERROR);
+        CHECK(exyz_last_error()->line == 4);
+
+        std::remove(path.c_str());
+    }
+}
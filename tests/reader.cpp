@@ -0,0 +1,1260 @@
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <catch.hpp>
+#include <exyz.h>
+
+static void free_frame(
+    exyz_info_t* info,
+    size_t info_count,
+    exyz_atom_array_t* arrays,
+    size_t arrays_count
+) {
+    for (size_t i=0; i<info_count; i++) {
+        exyz_info_free(info[i]);
+    }
+    free(info);
+
+    for (size_t i=0; i<arrays_count; i++) {
+        exyz_atom_array_free(arrays[i]);
+    }
+    free(arrays);
+}
+
+static void check_water(exyz_reader_t* reader) {
+    size_t n_atoms = 0;
+    exyz_info_t* info = nullptr;
+    size_t info_count = 0;
+    exyz_atom_array_t* arrays = nullptr;
+    size_t arrays_count = 0;
+
+    // first frame
+    auto status = exyz_reader_read(reader, &n_atoms, &info, &info_count, &arrays, &arrays_count);
+    REQUIRE(status == EXYZ_SUCCESS);
+    CHECK(n_atoms == 3);
+
+    REQUIRE(info_count == 3);
+    CHECK(info[0].key == std::string("energy"));
+    REQUIRE(info[0].type == EXYZ_REAL);
+    CHECK(info[0].data.real == -14.22);
+    CHECK(info[1].key == std::string("config_type"));
+    REQUIRE(info[1].type == EXYZ_STRING);
+    CHECK(info[1].data.string == std::string("bulk"));
+
+    REQUIRE(arrays_count == 3);
+    CHECK(arrays[0].key == std::string("species"));
+    REQUIRE(arrays[0].array.type == EXYZ_STRING);
+    CHECK(arrays[0].array.nrows == 3);
+    CHECK(arrays[0].array.ncols == 1);
+    CHECK(arrays[0].array.data.string[0] == std::string("O"));
+    CHECK(arrays[0].array.data.string[2] == std::string("H"));
+
+    CHECK(arrays[1].key == std::string("pos"));
+    REQUIRE(arrays[1].array.type == EXYZ_REAL);
+    CHECK(arrays[1].array.nrows == 3);
+    CHECK(arrays[1].array.ncols == 3);
+    CHECK(arrays[1].array.data.real[2] == 0.119262);
+    CHECK(arrays[1].array.data.real[4] == 0.763239);
+
+    CHECK(arrays[2].key == std::string("forces"));
+    REQUIRE(arrays[2].array.type == EXYZ_REAL);
+    CHECK(arrays[2].array.data.real[2] == 1.5e-2);
+    CHECK(arrays[2].array.data.real[5] == -1.5e-2);
+
+    free_frame(info, info_count, arrays, arrays_count);
+
+    // second frame
+    status = exyz_reader_read(reader, &n_atoms, &info, &info_count, &arrays, &arrays_count);
+    REQUIRE(status == EXYZ_SUCCESS);
+    REQUIRE(info_count == 3);
+    CHECK(info[1].data.string == std::string("surface"));
+    free_frame(info, info_count, arrays, arrays_count);
+
+    // third frame, using the default Properties
+    status = exyz_reader_read(reader, &n_atoms, &info, &info_count, &arrays, &arrays_count);
+    REQUIRE(status == EXYZ_SUCCESS);
+    CHECK(n_atoms == 3);
+    REQUIRE(arrays_count == 2);
+    CHECK(arrays[0].key == std::string("species"));
+    CHECK(arrays[1].key == std::string("pos"));
+    CHECK(arrays[1].array.data.real[8] == -0.497047);
+    free_frame(info, info_count, arrays, arrays_count);
+
+    status = exyz_reader_read(reader, &n_atoms, &info, &info_count, &arrays, &arrays_count);
+    CHECK(status == EXYZ_END_OF_FILE);
+}
+
+TEST_CASE("Read frames") {
+    SECTION("exyz_read") {
+        auto file = std::fopen(EXYZ_TESTS_DATA "/water.xyz", "rb");
+        REQUIRE(file != nullptr);
+
+        size_t n_atoms = 0;
+        exyz_info_t* info = nullptr;
+        size_t info_count = 0;
+        exyz_atom_array_t* arrays = nullptr;
+        size_t arrays_count = 0;
+
+        for (size_t step=0; step<3; step++) {
+            auto status = exyz_read(file, &n_atoms, &info, &info_count, &arrays, &arrays_count);
+            REQUIRE(status == EXYZ_SUCCESS);
+            CHECK(n_atoms == 3);
+            REQUIRE(info_count == 3);
+            CHECK(info[2].key == std::string("step"));
+            CHECK(info[2].data.integer == static_cast<int64_t>(step));
+            free_frame(info, info_count, arrays, arrays_count);
+        }
+
+        std::fclose(file);
+    }
+
+    SECTION("reader") {
+        exyz_reader_t* reader = nullptr;
+        auto status = exyz_reader_open(&reader, EXYZ_TESTS_DATA "/water.xyz");
+        REQUIRE(status == EXYZ_SUCCESS);
+        CHECK(exyz_reader_compression(reader) == EXYZ_COMPRESSION_NONE);
+
+        check_water(reader);
+        exyz_reader_close(reader);
+    }
+
+    SECTION("errors") {
+        auto file = std::tmpfile();
+        std::string content = "2\nProperties=species:S:1:pos:R:3\nH 0 0 0\nH 0 0\n";
+        std::fwrite(content.data(), 1, content.size(), file);
+        std::rewind(file);
+
+        exyz_reader_t* reader = nullptr;
+        auto status = exyz_reader_from_file(&reader, file);
+        REQUIRE(status == EXYZ_SUCCESS);
+
+        size_t n_atoms = 0;
+        exyz_info_t* info = nullptr;
+        size_t info_count = 0;
+        exyz_atom_array_t* arrays = nullptr;
+        size_t arrays_count = 0;
+        status = exyz_reader_read(reader, &n_atoms, &info, &info_count, &arrays, &arrays_count);
+        CHECK(status == EXYZ_ERROR);
+
+        exyz_reader_close(reader);
+        std::fclose(file);
+    }
+
+    SECTION("Number of atoms") {
+        // exyz_read and the reader accept the same files
+        auto read_all = [](const std::string& content, bool use_reader, std::string& message) {
+            auto file = std::tmpfile();
+            REQUIRE(file != nullptr);
+            std::fwrite(content.data(), 1, content.size(), file);
+            std::rewind(file);
+
+            exyz_reader_t* reader = nullptr;
+            if (use_reader) {
+                REQUIRE(exyz_reader_from_file(&reader, file) == EXYZ_SUCCESS);
+            }
+
+            size_t frames = 0;
+            exyz_status_t status = EXYZ_SUCCESS;
+            while (true) {
+                size_t n_atoms = 0;
+                exyz_info_t* info = nullptr;
+                size_t info_count = 0;
+                exyz_atom_array_t* arrays = nullptr;
+                size_t arrays_count = 0;
+                if (use_reader) {
+                    status = exyz_reader_read(reader, &n_atoms, &info, &info_count, &arrays, &arrays_count);
+                } else {
+                    status = exyz_read(file, &n_atoms, &info, &info_count, &arrays, &arrays_count);
+                }
+                if (status != EXYZ_SUCCESS) {
+                    break;
+                }
+                free_frame(info, info_count, arrays, arrays_count);
+                frames += 1;
+            }
+
+            message = status == EXYZ_ERROR ? exyz_last_error()->message : "";
+            exyz_reader_close(reader);
+            std::fclose(file);
+            return std::make_pair(frames, status);
+        };
+
+        for (bool use_reader: {false, true}) {
+            auto message = std::string();
+            auto result = read_all("-1\ncomment\n", use_reader, message);
+            CHECK(result == std::make_pair(size_t(0), EXYZ_ERROR));
+            CHECK(message == "failed to parse the number of atoms");
+
+            result = read_all("1 2\ncomment\nH 0 0 0\n", use_reader, message);
+            CHECK(result == std::make_pair(size_t(0), EXYZ_ERROR));
+            CHECK(message == "unexpected content after the number of atoms: '2'");
+
+            result = read_all("1\na=1\nH 0 0 0\n\n \n1\na=2\nH 0 0 0\n\t\n\n", use_reader, message);
+            CHECK(result.first == 2);
+            CHECK(result.second == EXYZ_END_OF_FILE);
+            CHECK(message == "");
+        }
+    }
+}
+
+TEST_CASE("Select atom properties") {
+    exyz_reader_t* reader = nullptr;
+    auto status = exyz_reader_open(&reader, EXYZ_TESTS_DATA "/water.xyz");
+    REQUIRE(status == EXYZ_SUCCESS);
+
+    const char* names[] = {"forces", "species"};
+    status = exyz_reader_select_properties(reader, names, 2);
+    REQUIRE(status == EXYZ_SUCCESS);
+
+    size_t n_atoms = 0;
+    exyz_info_t* info = nullptr;
+    size_t info_count = 0;
+    exyz_atom_array_t* arrays = nullptr;
+    size_t arrays_count = 0;
+
+    // properties are returned in file order, skipping pos
+    status = exyz_reader_read(reader, &n_atoms, &info, &info_count, &arrays, &arrays_count);
+    REQUIRE(status == EXYZ_SUCCESS);
+    CHECK(info_count == 3);
+    REQUIRE(arrays_count == 2);
+    CHECK(arrays[0].key == std::string("species"));
+    CHECK(arrays[0].array.data.string[0] == std::string("O"));
+    CHECK(arrays[1].key == std::string("forces"));
+    REQUIRE(arrays[1].array.type == EXYZ_REAL);
+    CHECK(arrays[1].array.nrows == 3);
+    CHECK(arrays[1].array.data.real[2] == 1.5e-2);
+    CHECK(arrays[1].array.data.real[5] == -1.5e-2);
+    free_frame(info, info_count, arrays, arrays_count);
+
+    // NULL selects all properties again
+    status = exyz_reader_select_properties(reader, nullptr, 0);
+    REQUIRE(status == EXYZ_SUCCESS);
+    status = exyz_reader_read(reader, &n_atoms, &info, &info_count, &arrays, &arrays_count);
+    REQUIRE(status == EXYZ_SUCCESS);
+    CHECK(arrays_count == 3);
+    free_frame(info, info_count, arrays, arrays_count);
+
+    // the third frame does not contain forces
+    status = exyz_reader_select_properties(reader, names, 1);
+    REQUIRE(status == EXYZ_SUCCESS);
+    status = exyz_reader_read(reader, &n_atoms, &info, &info_count, &arrays, &arrays_count);
+    REQUIRE(status == EXYZ_SUCCESS);
+    CHECK(n_atoms == 3);
+    CHECK(arrays_count == 0);
+    free_frame(info, info_count, arrays, arrays_count);
+
+    exyz_reader_close(reader);
+
+    SECTION("Skipped values are still tokenized") {
+        auto file = std::tmpfile();
+        std::string content = "2\nProperties=species:S:1:pos:R:3\nH 0 0 0\nH 0 0\n";
+        std::fwrite(content.data(), 1, content.size(), file);
+        std::rewind(file);
+
+        status = exyz_reader_from_file(&reader, file);
+        REQUIRE(status == EXYZ_SUCCESS);
+
+        status = exyz_reader_select_properties(reader, names + 1, 1);
+        REQUIRE(status == EXYZ_SUCCESS);
+        status = exyz_reader_read(reader, &n_atoms, &info, &info_count, &arrays, &arrays_count);
+        CHECK(status == EXYZ_ERROR);
+
+        exyz_reader_close(reader);
+        std::fclose(file);
+    }
+}
+
+static bool is_bulk(size_t, const exyz_info_t* info, size_t info_count, void* data) {
+    *static_cast<size_t*>(data) += 1;
+    auto config_type = exyz_info_find(info, info_count, "config_type");
+    return config_type != nullptr && config_type->type == EXYZ_STRING && config_type->data.string == std::string("bulk");
+}
+
+TEST_CASE("Filter frames") {
+    size_t calls = 0;
+    size_t n_atoms = 0;
+    exyz_info_t* info = nullptr;
+    size_t info_count = 0;
+    exyz_atom_array_t* arrays = nullptr;
+    size_t arrays_count = 0;
+
+    SECTION("Comment line values") {
+        exyz_reader_t* reader = nullptr;
+        auto status = exyz_reader_open(&reader, EXYZ_TESTS_DATA "/water.xyz");
+        REQUIRE(status == EXYZ_SUCCESS);
+        exyz_reader_set_filter(reader, is_bulk, &calls);
+
+        exyz_stats_t stats = {};
+        exyz_reader_set_stats(reader, &stats);
+
+        status = exyz_reader_read(reader, &n_atoms, &info, &info_count, &arrays, &arrays_count);
+        REQUIRE(status == EXYZ_SUCCESS);
+        CHECK(info[2].data.integer == 0);
+        free_frame(info, info_count, arrays, arrays_count);
+
+        status = exyz_reader_read(reader, &n_atoms, &info, &info_count, &arrays, &arrays_count);
+        REQUIRE(status == EXYZ_SUCCESS);
+        CHECK(info[2].data.integer == 2);
+        free_frame(info, info_count, arrays, arrays_count);
+
+        status = exyz_reader_read(reader, &n_atoms, &info, &info_count, &arrays, &arrays_count);
+        CHECK(status == EXYZ_END_OF_FILE);
+
+        CHECK(calls == 3);
+        CHECK(stats.frames == 2);
+        CHECK(stats.skipped_frames == 1);
+        CHECK(stats.atoms == 6);
+
+        exyz_reader_close(reader);
+    }
+
+    SECTION("Rejected atoms are not parsed") {
+        auto file = std::tmpfile();
+        std::string content =
+            "1\nconfig_type=surface\nnot an atom line\n"
+            "1\nconfig_type=bulk\nH 0 0 1\n";
+        std::fwrite(content.data(), 1, content.size(), file);
+        std::rewind(file);
+
+        exyz_reader_t* reader = nullptr;
+        auto status = exyz_reader_from_file(&reader, file);
+        REQUIRE(status == EXYZ_SUCCESS);
+        exyz_reader_set_filter(reader, is_bulk, &calls);
+
+        status = exyz_reader_read(reader, &n_atoms, &info, &info_count, &arrays, &arrays_count);
+        REQUIRE(status == EXYZ_SUCCESS);
+        REQUIRE(arrays_count == 2);
+        CHECK(arrays[1].array.data.real[2] == 1);
+        free_frame(info, info_count, arrays, arrays_count);
+
+        // without a filter, the first frame is invalid
+        std::rewind(file);
+        exyz_reader_close(reader);
+        status = exyz_reader_from_file(&reader, file);
+        REQUIRE(status == EXYZ_SUCCESS);
+        status = exyz_reader_read(reader, &n_atoms, &info, &info_count, &arrays, &arrays_count);
+        CHECK(status == EXYZ_ERROR);
+
+        exyz_reader_close(reader);
+        std::fclose(file);
+    }
+}
+
+/// read all remaining frames in `reader`, and return the value of their
+/// `step` info
+static std::vector<int64_t> read_steps(exyz_reader_t* reader) {
+    auto steps = std::vector<int64_t>();
+    while (true) {
+        size_t n_atoms = 0;
+        exyz_info_t* info = nullptr;
+        size_t info_count = 0;
+        exyz_atom_array_t* arrays = nullptr;
+        size_t arrays_count = 0;
+        auto status = exyz_reader_read(reader, &n_atoms, &info, &info_count, &arrays, &arrays_count);
+        if (status == EXYZ_END_OF_FILE) {
+            break;
+        }
+        REQUIRE(status == EXYZ_SUCCESS);
+
+        auto step = exyz_info_find(info, info_count, "step");
+        REQUIRE(step != nullptr);
+        steps.push_back(step->data.integer);
+        free_frame(info, info_count, arrays, arrays_count);
+    }
+    return steps;
+}
+
+TEST_CASE("Stride") {
+    exyz_reader_t* reader = nullptr;
+    auto status = exyz_reader_open(&reader, EXYZ_TESTS_DATA "/water.xyz");
+    REQUIRE(status == EXYZ_SUCCESS);
+
+    SECTION("Start and step") {
+        exyz_stats_t stats = {};
+        exyz_reader_set_stats(reader, &stats);
+
+        status = exyz_reader_set_stride(reader, 1, SIZE_MAX, 1);
+        REQUIRE(status == EXYZ_SUCCESS);
+        CHECK(read_steps(reader) == std::vector<int64_t>{1, 2});
+        CHECK(stats.frames == 2);
+        CHECK(stats.skipped_frames == 1);
+    }
+
+    SECTION("Stop") {
+        status = exyz_reader_set_stride(reader, 0, 2, 2);
+        REQUIRE(status == EXYZ_SUCCESS);
+        CHECK(read_steps(reader) == std::vector<int64_t>{0});
+    }
+
+    SECTION("Step") {
+        status = exyz_reader_set_stride(reader, 0, SIZE_MAX, 2);
+        REQUIRE(status == EXYZ_SUCCESS);
+        CHECK(read_steps(reader) == std::vector<int64_t>{0, 2});
+
+        status = exyz_reader_set_stride(reader, 0, SIZE_MAX, 0);
+        CHECK(status == EXYZ_ERROR);
+    }
+
+    SECTION("Huge step") {
+        // the frame after the first selected one is past SIZE_MAX
+        status = exyz_reader_set_stride(reader, 1, SIZE_MAX, SIZE_MAX);
+        REQUIRE(status == EXYZ_SUCCESS);
+        CHECK(read_steps(reader) == std::vector<int64_t>{1});
+    }
+
+    SECTION("Invalid step") {
+        // record an error with a position
+        exyz_atom_property_t* properties = nullptr;
+        size_t properties_count = 0;
+        exyz_info_t* info = nullptr;
+        size_t info_count = 0;
+        status = exyz_read_comment_line("a=", 2, &properties, &properties_count, &info, &info_count);
+        REQUIRE(status == EXYZ_ERROR);
+        REQUIRE(exyz_last_error()->line == 1);
+
+        status = exyz_reader_set_stride(reader, 0, SIZE_MAX, 0);
+        CHECK(status == EXYZ_ERROR);
+        CHECK(std::string(exyz_last_error()->message) == "the stride step must be at least 1");
+        CHECK(exyz_last_error()->line == -1);
+        CHECK(exyz_last_error()->offset == -1);
+    }
+
+    exyz_reader_close(reader);
+}
+
+/// content of a frame large enough to be parsed by multiple threads
+static std::string large_frame(size_t n_atoms) {
+    auto content = std::to_string(n_atoms) + "\nProperties=species:S:1:pos:R:3:id:I:1:fixed:L:1\n";
+    for (size_t atom=0; atom<n_atoms; atom++) {
+        content += atom % 3 == 0 ? "Ar" : "H";
+        content += " " + std::to_string(atom) + ".5 -1.25e-3 " + std::to_string(atom % 17);
+        content += " " + std::to_string(atom) + (atom % 2 == 0 ? " T" : " F");
+        content += atom % 5 == 0 ? "\r\n" : "\n";
+    }
+    return content;
+}
+
+struct read_result_t {
+    exyz_status_t status;
+    exyz_error_t error;
+    exyz_stats_t stats;
+    size_t n_atoms;
+    exyz_atom_array_t* arrays;
+    size_t arrays_count;
+};
+
+static read_result_t read_with_threads(const std::string& content, size_t threads) {
+    auto file = std::tmpfile();
+    REQUIRE(file != nullptr);
+    std::fwrite(content.data(), 1, content.size(), file);
+    std::rewind(file);
+
+    exyz_reader_t* reader = nullptr;
+    auto status = exyz_reader_from_file(&reader, file);
+    REQUIRE(status == EXYZ_SUCCESS);
+    exyz_reader_set_threads(reader, threads);
+
+    read_result_t result = {};
+    exyz_reader_set_stats(reader, &result.stats);
+
+    exyz_info_t* info = nullptr;
+    size_t info_count = 0;
+    result.status = exyz_reader_read(reader, &result.n_atoms, &info, &info_count, &result.arrays, &result.arrays_count);
+    result.error = *exyz_reader_last_error(reader);
+    free_frame(info, info_count, nullptr, 0);
+
+    exyz_reader_close(reader);
+    std::fclose(file);
+    return result;
+}
+
+static bool same_array(const exyz_array_t& first, const exyz_array_t& second) {
+    if (first.type != second.type || first.nrows != second.nrows || first.ncols != second.ncols) {
+        return false;
+    }
+
+    auto size = first.nrows * first.ncols;
+    switch (first.type) {
+    case EXYZ_INTEGER:
+        return std::equal(first.data.integer, first.data.integer + size, second.data.integer);
+    case EXYZ_REAL:
+        return std::equal(first.data.real, first.data.real + size, second.data.real);
+    case EXYZ_BOOL:
+        return std::equal(first.data.boolean, first.data.boolean + size, second.data.boolean);
+    case EXYZ_STRING:
+        for (size_t i=0; i<size; i++) {
+            if (std::string(first.data.string[i]) != second.data.string[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+TEST_CASE("Parallel parsing of large frames") {
+    auto n_atoms = size_t(300000);
+    auto content = large_frame(n_atoms);
+
+    SECTION("Same result as serial parsing") {
+        auto serial = read_with_threads(content, 1);
+        auto parallel = read_with_threads(content, 4);
+        REQUIRE(serial.status == EXYZ_SUCCESS);
+        REQUIRE(parallel.status == EXYZ_SUCCESS);
+
+        CHECK(parallel.n_atoms == n_atoms);
+        REQUIRE(parallel.arrays_count == 4);
+        REQUIRE(serial.arrays_count == 4);
+        for (size_t i=0; i<4; i++) {
+            CHECK(parallel.arrays[i].key == std::string(serial.arrays[i].key));
+            CHECK(same_array(parallel.arrays[i].array, serial.arrays[i].array));
+        }
+        CHECK(parallel.arrays[1].array.data.real[3 * 12345] == 12345.5);
+        CHECK(parallel.arrays[2].array.data.integer[n_atoms - 1] == static_cast<int64_t>(n_atoms - 1));
+
+        CHECK(parallel.stats.atoms == serial.stats.atoms);
+        CHECK(parallel.stats.reals == serial.stats.reals);
+        CHECK(parallel.stats.strings == serial.stats.strings);
+        CHECK(parallel.stats.integers == serial.stats.integers);
+        CHECK(parallel.stats.booleans == serial.stats.booleans);
+
+        free_frame(nullptr, 0, serial.arrays, serial.arrays_count);
+        free_frame(nullptr, 0, parallel.arrays, parallel.arrays_count);
+    }
+
+    SECTION("Same errors as serial parsing") {
+        // invalid values in two different chunks, the first one is reported
+        auto first = content.find("\nH 200000.5 ") + 3;
+        content[first] = 'x';
+        auto second = content.find("\nH 250000.5 ") + 3;
+        content[second] = 'x';
+
+        auto serial = read_with_threads(content, 1);
+        auto parallel = read_with_threads(content, 4);
+        CHECK(serial.status == EXYZ_ERROR);
+        CHECK(parallel.status == EXYZ_ERROR);
+        CHECK(std::string(parallel.error.message) == serial.error.message);
+        CHECK(parallel.error.frame == serial.error.frame);
+        CHECK(parallel.error.line == serial.error.line);
+        CHECK(parallel.error.offset == serial.error.offset);
+        CHECK(parallel.error.line == 200003);
+    }
+
+    SECTION("Wrong number of atoms") {
+        content.replace(0, std::to_string(n_atoms).size(), std::to_string(n_atoms + 1));
+
+        auto serial = read_with_threads(content, 1);
+        auto parallel = read_with_threads(content, 4);
+        CHECK(serial.status == EXYZ_ERROR);
+        CHECK(parallel.status == EXYZ_ERROR);
+        CHECK(std::string(parallel.error.message) == serial.error.message);
+        CHECK(parallel.error.line == serial.error.line);
+    }
+}
+
+TEST_CASE("Atom lines") {
+    // the tests below run with the instruction set selected for this CPU, or
+    // the one given to EXYZ_SIMD at build time
+    auto simd = std::string(exyz_simd_level());
+    CHECK((simd == "avx512" || simd == "avx2" || simd == "sse2" || simd == "scalar"));
+
+    SECTION("Long lines") {
+        // values are split between the chunks used by the tokenizer
+        auto padding = std::string(61, ' ');
+        auto content = "2\nProperties=species:S:1:pos:R:3:id:I:1\n"
+            "H" + padding + "1.5\t\t2.5 3.5e2 " + padding + padding + "42   \n"
+            "\t  Ar 1 2 3 7\r\n";
+
+        auto result = read_with_threads(content, 1);
+        REQUIRE(result.status == EXYZ_SUCCESS);
+        REQUIRE(result.arrays_count == 3);
+        CHECK(result.arrays[0].array.data.string[0] == std::string("H"));
+        CHECK(result.arrays[0].array.data.string[1] == std::string("Ar"));
+        CHECK(result.arrays[1].array.data.real[0] == 1.5);
+        CHECK(result.arrays[1].array.data.real[2] == 350.0);
+        CHECK(result.arrays[1].array.data.real[5] == 3.0);
+        CHECK(result.arrays[2].array.data.integer[0] == 42);
+        CHECK(result.arrays[2].array.data.integer[1] == 7);
+        free_frame(nullptr, 0, result.arrays, result.arrays_count);
+    }
+
+    SECTION("Quoted strings") {
+        auto content = "2\nProperties=species:S:1:pos:R:3\n"
+            "\"H 1\" 0 0 0\n"
+            "He 0 0 0\n";
+
+        auto result = read_with_threads(content, 1);
+        REQUIRE(result.status == EXYZ_SUCCESS);
+        REQUIRE(result.arrays_count == 2);
+        CHECK(result.arrays[0].array.data.string[0] == std::string("H 1"));
+        CHECK(result.arrays[0].array.data.string[1] == std::string("He"));
+        free_frame(nullptr, 0, result.arrays, result.arrays_count);
+    }
+
+    SECTION("Fixed width lines") {
+        // left-aligned species and right-aligned numbers, as written by
+        // `%-4s %12.6f %12.6f %12.6f %6d`
+        auto content = std::string("12\nProperties=species:S:1:pos:R:3:id:I:1\n");
+        auto fixed_line = [](const char* species, double x, int id) {
+            char buffer[128];
+            std::snprintf(buffer, sizeof(buffer), "%-4s %12.6f %12.6f %12.6f %6d\n", species, x, -x, 2 * x, id);
+            return std::string(buffer);
+        };
+        for (int i=0; i<8; i++) {
+            content += fixed_line(i % 2 ? "H" : "Si", 1.25 * i - 3.0, i);
+        }
+        // a line breaking the layout, and lines following it again
+        content += "O 1.5 2.5 3.5 8\n";
+        content += fixed_line("Cu", 123456.123456, -9);
+        content += fixed_line("H", 0.1, 10);
+        content += fixed_line("H", 1e-7, 11);
+
+        auto result = read_with_threads(content, 1);
+        REQUIRE(result.status == EXYZ_SUCCESS);
+        REQUIRE(result.arrays_count == 3);
+        auto species = result.arrays[0].array.data.string;
+        auto positions = result.arrays[1].array.data.real;
+        auto ids = result.arrays[2].array.data.integer;
+        for (int i=0; i<8; i++) {
+            CHECK(species[i] == std::string(i % 2 ? "H" : "Si"));
+            CHECK(positions[3 * i] == 1.25 * i - 3.0);
+            CHECK(positions[3 * i + 1] == -(1.25 * i - 3.0));
+            CHECK(ids[i] == i);
+        }
+        CHECK(species[8] == std::string("O"));
+        CHECK(positions[3 * 8 + 1] == 2.5);
+        CHECK(species[9] == std::string("Cu"));
+        CHECK(positions[3 * 9] == 123456.123456);
+        CHECK(ids[9] == -9);
+        CHECK(positions[3 * 10] == 0.1);
+        CHECK(positions[3 * 11] == 0.0);
+        CHECK(positions[3 * 11 + 1] == 0.0);
+        CHECK(ids[11] == 11);
+        free_frame(nullptr, 0, result.arrays, result.arrays_count);
+
+        // errors in lines following the layout are the same as usual
+        auto lines = std::string();
+        for (int i=0; i<8; i++) {
+            lines += fixed_line("H", 1.0, i);
+        }
+        auto header = std::string("9\nProperties=species:S:1:pos:R:3:id:I:1\n");
+
+        auto bad = fixed_line("H", 1.0, 8);
+        bad[10] = 'x';
+        result = read_with_threads(header + lines + bad, 1);
+        CHECK(result.status == EXYZ_ERROR);
+        CHECK(std::string(result.error.message) == "invalid value for real property 'pos' of atom 8");
+
+        // an additional value in the padding
+        bad = fixed_line("H", 1.0, 8);
+        bad[2] = '1';
+        result = read_with_threads(header + lines + bad, 1);
+        CHECK(result.status == EXYZ_ERROR);
+        CHECK(std::string(result.error.message) == "invalid value for integer property 'id' of atom 8");
+
+        bad = fixed_line("H", 1.0, 8);
+        bad.insert(bad.size() - 1, " 7");
+        result = read_with_threads(header + lines + bad, 1);
+        CHECK(result.status == EXYZ_ERROR);
+        CHECK(std::string(result.error.message) == "too many values for atom 8");
+    }
+
+    SECTION("Errors") {
+        auto header = std::string("1\nProperties=species:S:1:pos:R:3\n");
+
+        auto result = read_with_threads(header + "H 0 0\n", 1);
+        CHECK(result.status == EXYZ_ERROR);
+        CHECK(std::string(result.error.message) == "missing values for atom 0, expected more values for 'pos'");
+
+        result = read_with_threads(header + "H 0 0 0   12\n", 1);
+        CHECK(result.status == EXYZ_ERROR);
+        CHECK(std::string(result.error.message) == "too many values for atom 0");
+        CHECK(result.error.offset == static_cast<int64_t>(header.size() + 10));
+
+        result = read_with_threads(header + "H 0 1.0x 0\n", 1);
+        CHECK(result.status == EXYZ_ERROR);
+        CHECK(std::string(result.error.message) == "invalid value for real property 'pos' of atom 0");
+
+        result = read_with_threads(header + "H=2 0 0 0\n", 1);
+        CHECK(result.status == EXYZ_ERROR);
+        CHECK(std::string(result.error.message) == "values should be separated by whitespace in atom lines, got '='");
+        CHECK(result.error.offset == static_cast<int64_t>(header.size() + 1));
+    }
+}
+
+/// read the first frame of `content` with the species read as atomic numbers
+static read_result_t read_atomic_numbers(const std::string& content, bool strict, int64_t unknown) {
+    auto file = std::tmpfile();
+    REQUIRE(file != nullptr);
+    std::fwrite(content.data(), 1, content.size(), file);
+    std::rewind(file);
+
+    exyz_reader_t* reader = nullptr;
+    auto status = exyz_reader_from_file(&reader, file);
+    REQUIRE(status == EXYZ_SUCCESS);
+    status = exyz_reader_set_atomic_numbers(reader, "species", strict, unknown);
+    REQUIRE(status == EXYZ_SUCCESS);
+
+    read_result_t result = {};
+    exyz_info_t* info = nullptr;
+    size_t info_count = 0;
+    result.status = exyz_reader_read(reader, &result.n_atoms, &info, &info_count, &result.arrays, &result.arrays_count);
+    result.error = *exyz_reader_last_error(reader);
+    free_frame(info, info_count, nullptr, 0);
+
+    exyz_reader_close(reader);
+    std::fclose(file);
+    return result;
+}
+
+TEST_CASE("Atomic numbers") {
+    SECTION("Reader") {
+        exyz_reader_t* reader = nullptr;
+        auto status = exyz_reader_open(&reader, EXYZ_TESTS_DATA "/water.xyz");
+        REQUIRE(status == EXYZ_SUCCESS);
+        status = exyz_reader_set_atomic_numbers(reader, "species", true, 0);
+        REQUIRE(status == EXYZ_SUCCESS);
+
+        size_t n_atoms = 0;
+        exyz_info_t* info = nullptr;
+        size_t info_count = 0;
+        exyz_atom_array_t* arrays = nullptr;
+        size_t arrays_count = 0;
+        status = exyz_reader_read(reader, &n_atoms, &info, &info_count, &arrays, &arrays_count);
+        REQUIRE(status == EXYZ_SUCCESS);
+        REQUIRE(arrays_count == 3);
+        CHECK(arrays[0].key == std::string("species"));
+        REQUIRE(arrays[0].array.type == EXYZ_INTEGER);
+        CHECK(arrays[0].array.nrows == 3);
+        CHECK(arrays[0].array.ncols == 1);
+        CHECK(arrays[0].array.data.integer[0] == 8);
+        CHECK(arrays[0].array.data.integer[1] == 1);
+        CHECK(arrays[0].array.data.integer[2] == 1);
+        free_frame(info, info_count, arrays, arrays_count);
+
+        // NULL reads the species as strings again
+        status = exyz_reader_set_atomic_numbers(reader, nullptr, true, 0);
+        REQUIRE(status == EXYZ_SUCCESS);
+        status = exyz_reader_read(reader, &n_atoms, &info, &info_count, &arrays, &arrays_count);
+        REQUIRE(status == EXYZ_SUCCESS);
+        REQUIRE(arrays[0].array.type == EXYZ_STRING);
+        CHECK(arrays[0].array.data.string[0] == std::string("O"));
+        free_frame(info, info_count, arrays, arrays_count);
+
+        exyz_reader_close(reader);
+    }
+
+    SECTION("Unknown species") {
+        auto content = std::string("4\nProperties=species:S:1:pos:R:3\n");
+        content += "Fe 0 0 0\nXx 0 0 0\n\"Og\" 0 0 0\nfe 0 0 0\n";
+
+        auto result = read_atomic_numbers(content, false, -1);
+        REQUIRE(result.status == EXYZ_SUCCESS);
+        REQUIRE(result.arrays_count == 2);
+        auto species = result.arrays[0].array.data.integer;
+        CHECK(species[0] == 26);
+        CHECK(species[1] == -1);
+        CHECK(species[2] == 118);
+        CHECK(species[3] == -1);
+        free_frame(nullptr, 0, result.arrays, result.arrays_count);
+
+        result = read_atomic_numbers(content, true, 0);
+        CHECK(result.status == EXYZ_ERROR);
+        CHECK(std::string(result.error.message) == "unknown chemical species 'Xx' for atom 1");
+    }
+
+    SECTION("Fixed width lines") {
+        // the same species are read from known positions after a few lines
+        auto header = std::string("Properties=species:S:1:pos:R:3\n");
+        auto content = std::string();
+        for (size_t atom=0; atom<20; atom++) {
+            content += atom % 2 == 0 ? "C " : "Cl";
+            content += "   1.000   2.000   3.000\n";
+        }
+
+        auto result = read_atomic_numbers("20\n" + header + content, true, 0);
+        REQUIRE(result.status == EXYZ_SUCCESS);
+        for (size_t atom=0; atom<20; atom++) {
+            CHECK(result.arrays[0].array.data.integer[atom] == (atom % 2 == 0 ? 6 : 17));
+        }
+        free_frame(nullptr, 0, result.arrays, result.arrays_count);
+
+        content += "Q    1.000   2.000   3.000\n";
+        result = read_atomic_numbers("21\n" + header + content, true, 0);
+        CHECK(result.status == EXYZ_ERROR);
+        CHECK(std::string(result.error.message) == "unknown chemical species 'Q' for atom 20");
+        CHECK(result.error.offset == static_cast<int64_t>(3 + header.size() + 20 * 27));
+    }
+
+    SECTION("Large frames") {
+        auto content = large_frame(300000);
+        auto result = read_atomic_numbers(content, true, 0);
+        REQUIRE(result.status == EXYZ_SUCCESS);
+        REQUIRE(result.arrays_count == 4);
+        auto species = result.arrays[0].array.data.integer;
+        CHECK(species[0] == 18);
+        CHECK(species[1] == 1);
+        CHECK(species[299997] == 18);
+        free_frame(nullptr, 0, result.arrays, result.arrays_count);
+    }
+}
+
+TEST_CASE("Lazy frames") {
+    SECTION("Reader") {
+        exyz_reader_t* reader = nullptr;
+        auto status = exyz_reader_open(&reader, EXYZ_TESTS_DATA "/water.xyz");
+        REQUIRE(status == EXYZ_SUCCESS);
+
+        exyz_lazy_frame_t* frame = nullptr;
+        status = exyz_reader_read_lazy(reader, &frame);
+        REQUIRE(status == EXYZ_SUCCESS);
+        CHECK(exyz_lazy_frame_n_atoms(frame) == 3);
+
+        size_t count = 0;
+        auto info = exyz_lazy_frame_info(frame, &count);
+        REQUIRE(count == 3);
+        CHECK(info[0].key == std::string("energy"));
+        CHECK(info[0].data.real == -14.22);
+
+        auto properties = exyz_lazy_frame_properties(frame, &count);
+        REQUIRE(count == 3);
+        CHECK(properties[1].key == std::string("pos"));
+        CHECK(properties[1].type == EXYZ_REAL);
+        CHECK(properties[1].count == 3);
+
+        const exyz_array_t* pos = nullptr;
+        status = exyz_lazy_frame_array(frame, "pos", &pos);
+        REQUIRE(status == EXYZ_SUCCESS);
+        REQUIRE(pos->type == EXYZ_REAL);
+        CHECK(pos->nrows == 3);
+        CHECK(pos->ncols == 3);
+        CHECK(pos->data.real[2] == 0.119262);
+        CHECK(pos->data.real[4] == 0.763239);
+
+        // the array is only parsed once
+        const exyz_array_t* again = nullptr;
+        status = exyz_lazy_frame_array(frame, "pos", &again);
+        REQUIRE(status == EXYZ_SUCCESS);
+        CHECK(again == pos);
+
+        const exyz_array_t* species = nullptr;
+        status = exyz_lazy_frame_array(frame, "species", &species);
+        REQUIRE(status == EXYZ_SUCCESS);
+        CHECK(species->data.string[0] == std::string("O"));
+
+        status = exyz_lazy_frame_array(frame, "velocities", &species);
+        CHECK(status == EXYZ_ERROR);
+        CHECK(species == nullptr);
+        CHECK(std::string(exyz_last_error()->message) == "there is no atom property named 'velocities' in this frame");
+
+        const char* line = nullptr;
+        size_t length = 0;
+        status = exyz_lazy_frame_line(frame, 0, &line, &length);
+        REQUIRE(status == EXYZ_SUCCESS);
+        CHECK(std::string(line, length).substr(0, 1) == "O");
+        status = exyz_lazy_frame_line(frame, 3, &line, &length);
+        CHECK(status == EXYZ_ERROR);
+        exyz_lazy_frame_free(frame);
+
+        // the third frame uses the default properties
+        status = exyz_reader_read_lazy(reader, &frame);
+        REQUIRE(status == EXYZ_SUCCESS);
+        exyz_lazy_frame_free(frame);
+        status = exyz_reader_read_lazy(reader, &frame);
+        REQUIRE(status == EXYZ_SUCCESS);
+        exyz_lazy_frame_properties(frame, &count);
+        CHECK(count == 2);
+        status = exyz_lazy_frame_array(frame, "pos", &pos);
+        REQUIRE(status == EXYZ_SUCCESS);
+        CHECK(pos->data.real[8] == -0.497047);
+        exyz_lazy_frame_free(frame);
+
+        status = exyz_reader_read_lazy(reader, &frame);
+        CHECK(status == EXYZ_END_OF_FILE);
+        CHECK(frame == nullptr);
+        exyz_reader_close(reader);
+    }
+
+    SECTION("Errors") {
+        // invalid values are only reported for the corresponding property, at
+        // the same position as when reading the full frame
+        auto content = std::string("1\nenergy=1.0\nH 0 0 0\n");
+        content += "3\nProperties=species:S:1:pos:R:3\nH 0 0 0\nO 0 0 0\r\nC 0 x 0\n";
+        auto file = std::tmpfile();
+        REQUIRE(file != nullptr);
+        std::fwrite(content.data(), 1, content.size(), file);
+        std::rewind(file);
+
+        exyz_reader_t* reader = nullptr;
+        auto status = exyz_reader_from_file(&reader, file);
+        REQUIRE(status == EXYZ_SUCCESS);
+        size_t n_atoms = 0;
+        exyz_info_t* info = nullptr;
+        size_t info_count = 0;
+        exyz_atom_array_t* arrays = nullptr;
+        size_t arrays_count = 0;
+        REQUIRE(exyz_reader_read(reader, &n_atoms, &info, &info_count, &arrays, &arrays_count) == EXYZ_SUCCESS);
+        free_frame(info, info_count, arrays, arrays_count);
+        CHECK(exyz_reader_read(reader, &n_atoms, &info, &info_count, &arrays, &arrays_count) == EXYZ_ERROR);
+        auto expected = *exyz_reader_last_error(reader);
+        exyz_reader_close(reader);
+
+        std::rewind(file);
+        status = exyz_reader_from_file(&reader, file);
+        REQUIRE(status == EXYZ_SUCCESS);
+        exyz_lazy_frame_t* frame = nullptr;
+        REQUIRE(exyz_reader_read_lazy(reader, &frame) == EXYZ_SUCCESS);
+        exyz_lazy_frame_free(frame);
+        REQUIRE(exyz_reader_read_lazy(reader, &frame) == EXYZ_SUCCESS);
+        exyz_reader_close(reader);
+
+        const exyz_array_t* array = nullptr;
+        status = exyz_lazy_frame_array(frame, "species", &array);
+        REQUIRE(status == EXYZ_SUCCESS);
+        CHECK(array->data.string[2] == std::string("C"));
+
+        status = exyz_lazy_frame_array(frame, "pos", &array);
+        CHECK(status == EXYZ_ERROR);
+        auto error = exyz_last_error();
+        CHECK(std::string(error->message) == "invalid value for real property 'pos' of atom 2");
+        CHECK(error->frame == expected.frame);
+        CHECK(error->line == expected.line);
+        CHECK(error->offset == expected.offset);
+
+        const char* line = nullptr;
+        size_t length = 0;
+        REQUIRE(exyz_lazy_frame_line(frame, 1, &line, &length) == EXYZ_SUCCESS);
+        CHECK(std::string(line, length) == "O 0 0 0");
+        REQUIRE(exyz_lazy_frame_line(frame, 2, &line, &length) == EXYZ_SUCCESS);
+        CHECK(std::string(line, length) == "C 0 x 0");
+        exyz_lazy_frame_free(frame);
+
+        // exyz_read_lazy does not count lines or frames
+        std::rewind(file);
+        REQUIRE(exyz_read_lazy(file, &frame) == EXYZ_SUCCESS);
+        CHECK(exyz_lazy_frame_n_atoms(frame) == 1);
+        exyz_lazy_frame_free(frame);
+        REQUIRE(exyz_read_lazy(file, &frame) == EXYZ_SUCCESS);
+        status = exyz_lazy_frame_array(frame, "pos", &array);
+        CHECK(status == EXYZ_ERROR);
+        error = exyz_last_error();
+        CHECK(error->frame == -1);
+        CHECK(error->line == -1);
+        CHECK(error->offset == expected.offset);
+        exyz_lazy_frame_free(frame);
+
+        std::fclose(file);
+    }
+}
+
+TEST_CASE("Compressed files") {
+    auto check_compressed = [](const char* path, exyz_compression_t compression) {
+        if (!exyz_compression_supported(compression)) {
+            WARN("skipping test for " << path << ", compression is not supported");
+            return;
+        }
+
+        exyz_reader_t* reader = nullptr;
+        auto status = exyz_reader_open(&reader, path);
+        REQUIRE(status == EXYZ_SUCCESS);
+        CHECK(exyz_reader_compression(reader) == compression);
+
+        check_water(reader);
+        exyz_reader_close(reader);
+    };
+
+    SECTION("gzip") {
+        check_compressed(EXYZ_TESTS_DATA "/water.xyz.gz", EXYZ_COMPRESSION_GZIP);
+    }
+
+    SECTION("xz") {
+        check_compressed(EXYZ_TESTS_DATA "/water.xyz.xz", EXYZ_COMPRESSION_XZ);
+    }
+
+    SECTION("zstd") {
+        check_compressed(EXYZ_TESTS_DATA "/water.xyz.zst", EXYZ_COMPRESSION_ZSTD);
+    }
+
+    SECTION("Invalid compressed data") {
+        if (!exyz_compression_supported(EXYZ_COMPRESSION_GZIP)) {
+            WARN("skipping test for invalid gzip data, compression is not supported");
+            return;
+        }
+
+        auto input = std::fopen(EXYZ_TESTS_DATA "/water.xyz.gz", "rb");
+        REQUIRE(input != nullptr);
+        auto compressed = std::string(1024, '\0');
+        compressed.resize(std::fread(&compressed[0], 1, compressed.size(), input));
+        std::fclose(input);
+
+        // errors from the decompression thread are reported to the caller
+        auto read_error = [](const std::string& content) {
+            auto file = std::tmpfile();
+            REQUIRE(file != nullptr);
+            std::fwrite(content.data(), 1, content.size(), file);
+            std::rewind(file);
+
+            exyz_reader_t* reader = nullptr;
+            REQUIRE(exyz_reader_from_file(&reader, file) == EXYZ_SUCCESS);
+
+            size_t n_atoms = 0;
+            exyz_info_t* info = nullptr;
+            size_t info_count = 0;
+            exyz_atom_array_t* arrays = nullptr;
+            size_t arrays_count = 0;
+            auto status = EXYZ_SUCCESS;
+            while (status == EXYZ_SUCCESS) {
+                status = exyz_reader_read(reader, &n_atoms, &info, &info_count, &arrays, &arrays_count);
+                if (status == EXYZ_SUCCESS) {
+                    free_frame(info, info_count, arrays, arrays_count);
+                }
+            }
+            CHECK(status == EXYZ_ERROR);
+
+            auto message = std::string(exyz_last_error()->message);
+            CHECK(message == exyz_reader_last_error(reader)->message);
+            exyz_reader_close(reader);
+            std::fclose(file);
+            return message;
+        };
+
+        auto truncated = compressed.substr(0, compressed.size() / 2);
+        CHECK(read_error(truncated) == "unexpected end of gzip compressed data");
+
+        auto corrupted = compressed;
+        for (size_t i=20; i<corrupted.size() - 8; i++) {
+            corrupted[i] = static_cast<char>(0xff);
+        }
+        CHECK(read_error(corrupted).find("failed to decompress gzip data: ") == 0);
+    }
+}
+
+TEST_CASE("Non-seekable input") {
+    SECTION("exyz_read") {
+        auto pipe = popen("cat " EXYZ_TESTS_DATA "/water.xyz", "r");
+        REQUIRE(pipe != nullptr);
+
+        size_t n_atoms = 0;
+        exyz_info_t* info = nullptr;
+        size_t info_count = 0;
+        exyz_atom_array_t* arrays = nullptr;
+        size_t arrays_count = 0;
+
+        for (size_t step=0; step<3; step++) {
+            auto status = exyz_read(pipe, &n_atoms, &info, &info_count, &arrays, &arrays_count);
+            REQUIRE(status == EXYZ_SUCCESS);
+            CHECK(n_atoms == 3);
+            REQUIRE(info_count == 3);
+            CHECK(info[2].data.integer == static_cast<int64_t>(step));
+            REQUIRE(arrays_count >= 2);
+            CHECK(arrays[1].array.data.real[8] == Approx(-0.477047 - 0.01 * static_cast<double>(step)));
+            free_frame(info, info_count, arrays, arrays_count);
+        }
+
+        auto status = exyz_read(pipe, &n_atoms, &info, &info_count, &arrays, &arrays_count);
+        CHECK(status == EXYZ_END_OF_FILE);
+        pclose(pipe);
+    }
+
+    SECTION("exyz_read_lazy") {
+        auto pipe = popen("cat " EXYZ_TESTS_DATA "/water.xyz", "r");
+        REQUIRE(pipe != nullptr);
+
+        exyz_lazy_frame_t* frame = nullptr;
+        for (size_t step=0; step<3; step++) {
+            REQUIRE(exyz_read_lazy(pipe, &frame) == EXYZ_SUCCESS);
+            CHECK(exyz_lazy_frame_n_atoms(frame) == 3);
+
+            const char* line = nullptr;
+            size_t length = 0;
+            REQUIRE(exyz_lazy_frame_line(frame, 2, &line, &length) == EXYZ_SUCCESS);
+            CHECK(std::string(line, 1) == "H");
+            exyz_lazy_frame_free(frame);
+        }
+        CHECK(exyz_read_lazy(pipe, &frame) == EXYZ_END_OF_FILE);
+        pclose(pipe);
+    }
+
+    SECTION("Missing final newline") {
+        auto pipe = popen("printf '1\\nstep=0\\nH 0 0 0\\n1\\nstep=1\\nO 1 2 3'", "r");
+        REQUIRE(pipe != nullptr);
+
+        size_t n_atoms = 0;
+        exyz_info_t* info = nullptr;
+        size_t info_count = 0;
+        exyz_atom_array_t* arrays = nullptr;
+        size_t arrays_count = 0;
+        for (size_t step=0; step<2; step++) {
+            auto status = exyz_read(pipe, &n_atoms, &info, &info_count, &arrays, &arrays_count);
+            REQUIRE(status == EXYZ_SUCCESS);
+            REQUIRE(info_count == 1);
+            CHECK(info[0].data.integer == static_cast<int64_t>(step));
+            REQUIRE(arrays_count == 2);
+            CHECK(arrays[1].array.data.real[2] == 3.0 * static_cast<double>(step));
+            free_frame(info, info_count, arrays, arrays_count);
+        }
+
+        auto status = exyz_read(pipe, &n_atoms, &info, &info_count, &arrays, &arrays_count);
+        CHECK(status == EXYZ_END_OF_FILE);
+        pclose(pipe);
+    }
+
+    SECTION("Errors") {
+        auto pipe = popen("printf '2\\nstep=0\\nH 0 0 0\\nH 0 x 0\\n3\\nstep=1\\nH 0 0 0\\n'", "r");
+        REQUIRE(pipe != nullptr);
+
+        size_t n_atoms = 0;
+        exyz_info_t* info = nullptr;
+        size_t info_count = 0;
+        exyz_atom_array_t* arrays = nullptr;
+        size_t arrays_count = 0;
+
+        // offsets are unknown when the position in the file is not available
+        auto status = exyz_read(pipe, &n_atoms, &info, &info_count, &arrays, &arrays_count);
+        CHECK(status == EXYZ_ERROR);
+        auto error = exyz_last_error();
+        CHECK(std::string(error->message) == "invalid value for real property 'pos' of atom 1");
+        CHECK(error->offset == -1);
+
+        status = exyz_read(pipe, &n_atoms, &info, &info_count, &arrays, &arrays_count);
+        CHECK(status == EXYZ_ERROR);
+        CHECK(std::string(exyz_last_error()->message) == "not enough lines in file for XYZ format");
+        pclose(pipe);
+    }
+
+    SECTION("Compressed reader") {
+        if (!exyz_compression_supported(EXYZ_COMPRESSION_ZSTD)) {
+            WARN("skipping test for compressed pipes, zstd compression is not supported");
+            return;
+        }
+
+        auto pipe = popen("cat " EXYZ_TESTS_DATA "/water.xyz.zst", "r");
+        REQUIRE(pipe != nullptr);
+
+        exyz_reader_t* reader = nullptr;
+        auto status = exyz_reader_from_file(&reader, pipe);
+        REQUIRE(status == EXYZ_SUCCESS);
+        CHECK(exyz_reader_compression(reader) == EXYZ_COMPRESSION_ZSTD);
+
+        check_water(reader);
+        exyz_reader_close(reader);
+        pclose(pipe);
+    }
+}
+
+TEST_CASE("Seekable files") {
+    if (!exyz_compression_supported(EXYZ_COMPRESSION_ZSTD)) {
+        WARN("skipping test for seekable files, zstd compression is not supported");
+        return;
+    }
+
+    // this file is created in the current working directory
+    auto path = std::string("water-seekable.xyz.zst");
+    // use a small block size to get one frame per block
+    auto status = exyz_compress_seekable(EXYZ_TESTS_DATA "/water.xyz", path.c_str(), 16, 3);
+    REQUIRE(status == EXYZ_SUCCESS);
+
+    SECTION("Sequential read") {
+        exyz_reader_t* reader = nullptr;
+        status = exyz_reader_open(&reader, path.c_str());
+        REQUIRE(status == EXYZ_SUCCESS);
+        CHECK(exyz_reader_compression(reader) == EXYZ_COMPRESSION_ZSTD);
+
+        check_water(reader);
+        exyz_reader_close(reader);
+    }
+
+    SECTION("Multiple decompression threads") {
+        exyz_reader_t* reader = nullptr;
+        status = exyz_reader_open(&reader, path.c_str());
+        REQUIRE(status == EXYZ_SUCCESS);
+        exyz_reader_set_threads(reader, 3);
+
+        check_water(reader);
+
+        // more threads can be added after the first read
+        exyz_reader_set_threads(reader, 0);
+        status = exyz_reader_seek_frame(reader, 0);
+        REQUIRE(status == EXYZ_SUCCESS);
+        check_water(reader);
+
+        exyz_reader_close(reader);
+    }
+
+    SECTION("Stride") {
+        exyz_reader_t* reader = nullptr;
+        status = exyz_reader_open(&reader, path.c_str());
+        REQUIRE(status == EXYZ_SUCCESS);
+
+        // the second frame is skipped by seeking to the third block
+        status = exyz_reader_set_stride(reader, 0, SIZE_MAX, 2);
+        REQUIRE(status == EXYZ_SUCCESS);
+        CHECK(read_steps(reader) == std::vector<int64_t>{0, 2});
+
+        exyz_reader_close(reader);
+    }
+
+    SECTION("Random access") {
+        exyz_reader_t* reader = nullptr;
+        status = exyz_reader_open(&reader, path.c_str());
+        REQUIRE(status == EXYZ_SUCCESS);
+
+        size_t count = 0;
+        status = exyz_reader_frames_count(reader, &count);
+        REQUIRE(status == EXYZ_SUCCESS);
+        CHECK(count == 3);
+
+        size_t n_atoms = 0;
+        exyz_info_t* info = nullptr;
+        size_t info_count = 0;
+        exyz_atom_array_t* arrays = nullptr;
+        size_t arrays_count = 0;
+
+        for (size_t frame: {2, 0, 1, 1}) {
+            status = exyz_reader_seek_frame(reader, frame);
+            REQUIRE(status == EXYZ_SUCCESS);
+
+            status = exyz_reader_read(reader, &n_atoms, &info, &info_count, &arrays, &arrays_count);
+            REQUIRE(status == EXYZ_SUCCESS);
+            CHECK(n_atoms == 3);
+
+            REQUIRE(info_count == 3);
+            CHECK(info[2].key == std::string("step"));
+            REQUIRE(info[2].type == EXYZ_INTEGER);
+            CHECK(info[2].data.integer == static_cast<int64_t>(frame));
+            free_frame(info, info_count, arrays, arrays_count);
+        }
+
+        // reading continues after the last frame we seeked to
+        status = exyz_reader_read(reader, &n_atoms, &info, &info_count, &arrays, &arrays_count);
+        REQUIRE(status == EXYZ_SUCCESS);
+        REQUIRE(info_count == 3);
+        CHECK(info[2].data.integer == 2);
+        free_frame(info, info_count, arrays, arrays_count);
+
+        status = exyz_reader_read(reader, &n_atoms, &info, &info_count, &arrays, &arrays_count);
+        CHECK(status == EXYZ_END_OF_FILE);
+
+        status = exyz_reader_seek_frame(reader, 3);
+        CHECK(status == EXYZ_ERROR);
+
+        exyz_reader_close(reader);
+    }
+
+    SECTION("Files without index") {
+        exyz_reader_t* reader = nullptr;
+        status = exyz_reader_open(&reader, EXYZ_TESTS_DATA "/water.xyz.zst");
+        REQUIRE(status == EXYZ_SUCCESS);
+
+        size_t count = 0;
+        CHECK(exyz_reader_frames_count(reader, &count) == EXYZ_ERROR);
+        CHECK(exyz_reader_seek_frame(reader, 1) == EXYZ_ERROR);
+
+        exyz_reader_close(reader);
+    }
+
+    std::remove(path.c_str());
+}
@@ -0,0 +1,121 @@
+#include <cstdio>
+#include <cstring>
+
+#include <catch.hpp>
+#include <exyz.h>
+
+static void free_frame(
+    exyz_info_t* info,
+    size_t info_count,
+    exyz_atom_array_t* arrays,
+    size_t arrays_count
+) {
+    for (size_t i=0; i<info_count; i++) {
+        exyz_info_free(info[i]);
+    }
+    free(info);
+
+    for (size_t i=0; i<arrays_count; i++) {
+        exyz_atom_array_free(arrays[i]);
+    }
+    free(arrays);
+}
+
+static void check_water_stats(const exyz_stats_t& stats) {
+    CHECK(stats.frames == 3);
+    CHECK(stats.atoms == 9);
+
+    // energy, config_type and step in the comment line, species, positions
+    // and forces in the atoms lines
+    CHECK(stats.integers == 3);
+    CHECK(stats.reals == 3 + 2 * 3 * 6 + 3 * 3);
+    CHECK(stats.strings == 3 + 3 * 3);
+    CHECK(stats.booleans == 0);
+    CHECK(stats.arrays == 0);
+
+    // energy is tried as an array and an integer, config_type as an array,
+    // an integer, a real and a boolean, and step as an array
+    CHECK(stats.failed_reads == 3 * (2 + 4 + 1));
+
+    CHECK(stats.allocations > 0);
+    CHECK(stats.allocated_bytes > 0);
+}
+
+TEST_CASE("Statistics") {
+    auto file = std::fopen(EXYZ_TESTS_DATA "/water.xyz", "rb");
+    REQUIRE(file != nullptr);
+    std::fseek(file, 0, SEEK_END);
+    auto file_size = static_cast<uint64_t>(std::ftell(file));
+    std::rewind(file);
+
+    SECTION("Reader") {
+        exyz_reader_t* reader = nullptr;
+        auto status = exyz_reader_open(&reader, EXYZ_TESTS_DATA "/water.xyz");
+        REQUIRE(status == EXYZ_SUCCESS);
+
+        exyz_stats_t stats;
+        std::memset(&stats, 0, sizeof(stats));
+        exyz_reader_set_stats(reader, &stats);
+
+        while (true) {
+            size_t n_atoms = 0;
+            exyz_info_t* info = nullptr;
+            size_t info_count = 0;
+            exyz_atom_array_t* arrays = nullptr;
+            size_t arrays_count = 0;
+            status = exyz_reader_read(reader, &n_atoms, &info, &info_count, &arrays, &arrays_count);
+            if (status == EXYZ_END_OF_FILE) {
+                break;
+            }
+            REQUIRE(status == EXYZ_SUCCESS);
+            free_frame(info, info_count, arrays, arrays_count);
+        }
+        exyz_reader_close(reader);
+
+        check_water_stats(stats);
+        CHECK(stats.bytes == file_size);
+
+        // the reader statistics are not used by other calls on this thread
+        CHECK(exyz_stats_collect(nullptr) == nullptr);
+    }
+
+    SECTION("Current thread") {
+        exyz_stats_t stats;
+        std::memset(&stats, 0, sizeof(stats));
+        CHECK(exyz_stats_collect(&stats) == nullptr);
+
+        for (size_t frame=0; frame<3; frame++) {
+            size_t n_atoms = 0;
+            exyz_info_t* info = nullptr;
+            size_t info_count = 0;
+            exyz_atom_array_t* arrays = nullptr;
+            size_t arrays_count = 0;
+            auto status = exyz_read(file, &n_atoms, &info, &info_count, &arrays, &arrays_count);
+            REQUIRE(status == EXYZ_SUCCESS);
+            free_frame(info, info_count, arrays, arrays_count);
+        }
+
+        CHECK(exyz_stats_collect(nullptr) == &stats);
+        check_water_stats(stats);
+        CHECK(stats.bytes == file_size);
+
+        // nothing is collected after this point
+        auto allocations = stats.allocations;
+        exyz_atom_property_t* properties = nullptr;
+        size_t properties_count = 0;
+        exyz_info_t* info = nullptr;
+        size_t info_count = 0;
+        auto status = exyz_read_comment_line("a=1 b=2", 7, &properties, &properties_count, &info, &info_count);
+        REQUIRE(status == EXYZ_SUCCESS);
+        CHECK(stats.allocations == allocations);
+        CHECK(stats.integers == 3);
+
+        for (size_t i=0; i<info_count; i++) {
+            exyz_info_free(info[i]);
+        }
+        free(info);
+        free(properties);
+    }
+
+    std::fclose(file);
+}